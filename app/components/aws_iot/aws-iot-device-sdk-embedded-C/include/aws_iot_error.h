@@ -156,7 +156,11 @@ typedef enum {
 	/** Some limit has been exceeded, e.g. the maximum number of subscriptions has been reached */
 			LIMIT_EXCEEDED_ERROR = -51,
 	/** Invalid input topic type */
-			INVALID_TOPIC_TYPE_ERROR = -52
+			INVALID_TOPIC_TYPE_ERROR = -52,
+	/** All slots of the QoS1 in flight window are waiting for a PUBACK */
+			MQTT_INFLIGHT_WINDOW_FULL_ERROR = -53,
+	/** The broker refused one or more topic filters of a SUBSCRIBE */
+			MQTT_SUBSCRIBE_REFUSED_ERROR = -54
 } IoT_Error_t;
 
 #ifdef __cplusplus
@@ -52,6 +52,7 @@ extern "C" {
 /* AWS Specific header files */
 #include "aws_iot_error.h"
 #include "aws_iot_config.h"
+#include "aws_iot_mqtt_client_topic_trie.h"
 
 /* Platform specific implementation header files */
 #include "network_interface.h"
@@ -63,6 +64,26 @@ extern "C" {
 
 #define MAX_PACKET_ID 65535
 
+#ifndef AWS_IOT_MQTT_INFLIGHT_WINDOW_MAX
+#define AWS_IOT_MQTT_INFLIGHT_WINDOW_MAX 4 ///< QoS1 publishes that can wait for their PUBACK at the same time, see aws_iot_mqtt_set_inflight_window
+#endif
+
+#ifndef AWS_IOT_MQTT_INFLIGHT_PACKET_LEN
+#define AWS_IOT_MQTT_INFLIGHT_PACKET_LEN 256 ///< Largest QoS1 PUBLISH packet kept for retransmission while in flight
+#endif
+
+#ifndef AWS_IOT_MQTT_INFLIGHT_MAX_RETRIES
+#define AWS_IOT_MQTT_INFLIGHT_MAX_RETRIES 3 ///< Retransmissions of an in flight PUBLISH before it completes with MQTT_REQUEST_TIMEOUT_ERROR
+#endif
+
+#ifndef AWS_IOT_MQTT_SUBSCRIBE_BATCH_MAX
+#define AWS_IOT_MQTT_SUBSCRIBE_BATCH_MAX 8 ///< Topic filters packed in one SUBSCRIBE, AWS IoT accepts at most 8
+#endif
+
+#ifndef AWS_IOT_MQTT_READ_AHEAD_LEN
+#define AWS_IOT_MQTT_READ_AHEAD_LEN 512 ///< Bytes pulled from the network in one read and parsed into packets from there. Packets larger than this are read straight into the RX buffer
+#endif
+
 typedef struct _Client AWS_IoT_Client;
 
 /**
@@ -220,6 +241,68 @@ typedef enum _ClientState {
 typedef void (*pApplicationHandler_t)(AWS_IoT_Client *pClient, char *pTopicName, uint16_t topicNameLen,
 									  IoT_Publish_Message_Params *pParams, void *pClientData);
 
+/**
+ * @brief Application Stream Handler Type
+ *
+ * Defining a TYPE for the function receiving a PUBLISH too large for the read buffer.
+ * Used by aws_iot_mqtt_set_stream_handler. pParams->payload and pParams->payloadLen
+ * hold one chunk of the payload, chunks come in order. The message is complete when
+ * payloadOffset + pParams->payloadLen equals payloadTotalLen.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pTopicName Topic name of the PUBLISH
+ * @param topicNameLen Length of the topic name
+ * @param pParams Publish parameters, the payload is the current chunk
+ * @param payloadOffset Offset of the chunk in the payload
+ * @param payloadTotalLen Length of the whole payload
+ * @param pClientData Data passed to aws_iot_mqtt_set_stream_handler
+ */
+typedef void (*pApplicationStreamHandler_t)(AWS_IoT_Client *pClient, char *pTopicName, uint16_t topicNameLen,
+											IoT_Publish_Message_Params *pParams, size_t payloadOffset,
+											size_t payloadTotalLen, void *pClientData);
+
+/**
+ * @brief Publish Payload Writer Type
+ *
+ * Defining a TYPE for callbacks that write a publish payload directly into the
+ * client write buffer. Used by aws_iot_mqtt_publish_in_place.
+ *
+ * @param pBuf Pointer to the payload area of the write buffer
+ * @param bufLen Space available for the payload
+ * @param pWriterData Data passed to aws_iot_mqtt_publish_in_place
+ *
+ * @return Length of the written payload, 0 if it could not be written
+ */
+typedef size_t (*pPublishPayloadWriter_t)(unsigned char *pBuf, size_t bufLen, void *pWriterData);
+
+/**
+ * @brief Publish Complete Handler Type
+ *
+ * Defining a TYPE for the function called when an in flight QoS1 publish completes.
+ * Used by the in flight window, see aws_iot_mqtt_set_inflight_window.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param packetId Packet identifier of the publish, returned in IoT_Publish_Message_Params.id
+ * @param result SUCCESS when the PUBACK arrived, MQTT_REQUEST_TIMEOUT_ERROR when all retransmissions failed
+ * @param pData Data passed to aws_iot_mqtt_set_inflight_window
+ */
+typedef void (*pPublishCompleteHandler_t)(AWS_IoT_Client *pClient, uint16_t packetId, IoT_Error_t result,
+										  void *pData);
+
+/**
+ * @brief In Flight Publish Type
+ *
+ * A QoS1 PUBLISH sent without waiting for its PUBACK, kept for retransmission
+ *
+ */
+typedef struct {
+	uint16_t packetId;        ///< Packet identifier, 0 if the slot is free
+	uint8_t retries;          ///< Retransmissions done so far
+	Timer retryTimer;         ///< Expires when the PUBLISH must be sent again
+	size_t len;               ///< Length of the serialized PUBLISH
+	unsigned char packet[AWS_IOT_MQTT_INFLIGHT_PACKET_LEN]; ///< Serialized PUBLISH
+} MQTT_Inflight_Publish;
+
 /**
  * @brief MQTT Message Handler
  *
@@ -235,6 +318,21 @@ typedef struct _MessageHandlers {
 	void *pApplicationHandlerData;
 } MessageHandlers;   /* Message handlers are indexed by subscription topic */
 
+/**
+ * @brief Subscription of a batch subscribe
+ *
+ * Defines one topic filter of aws_iot_mqtt_subscribe_batch.
+ * pTopicName and pApplicationHandlerData need to be static in memory, as for aws_iot_mqtt_subscribe.
+ *
+ */
+typedef struct {
+	const char *pTopicName;						///< Topic filter to subscribe to
+	uint16_t topicNameLen;						///< Length of the topic filter
+	QoS qos;									///< Requested QoS
+	pApplicationHandler_t pApplicationHandler;	///< Handler called for messages on the topic filter
+	void *pApplicationHandlerData;				///< Data passed to the handler
+} IoT_Subscribe_Filter;
+
 /**
  * @brief MQTT Client Status
  *
@@ -246,6 +344,7 @@ typedef struct _ClientStatus {
 	ClientState clientState;
 	bool isPingOutstanding;
 	bool isAutoReconnectEnabled;
+	bool isSessionPresent;	/* Broker resumed the previous session, its subscriptions are still active */
 } ClientStatus;
 
 /**
@@ -273,16 +372,44 @@ typedef struct _ClientData {
 	unsigned char writeBuf[AWS_IOT_MQTT_TX_BUF_LEN];
 	unsigned char readBuf[AWS_IOT_MQTT_RX_BUF_LEN];
 
+	/* Bytes read from the network but not yet parsed,
+	 * they belong to the packets following the current one */
+	size_t readAheadStart;
+	size_t readAheadEnd;
+	unsigned char readAheadBuf[AWS_IOT_MQTT_READ_AHEAD_LEN];
+
+	/* PUBLISH larger than readBuf, passed to streamHandler in chunks of the space left after its header */
+	pApplicationStreamHandler_t streamHandler;
+	void *streamHandlerData;
+	size_t streamHeaderLen;		/* Fixed and variable header of the PUBLISH being streamed, 0 if none */
+	size_t streamPayloadLen;	/* Payload length of the PUBLISH being streamed */
+
 #ifdef _ENABLE_THREAD_SUPPORT_
 	bool isBlockOnThreadLockEnabled;
 	IoT_Mutex_t state_change_mutex;
 	IoT_Mutex_t tls_read_mutex;
 	IoT_Mutex_t tls_write_mutex;
+	/* Held by every writer from serializing into writeBuf until the packet is sent, it also guards inflight */
+	IoT_Mutex_t write_buf_mutex;
+	/* Publishes that do not wait for a PUBACK run beside yield, see aws_iot_mqtt_set_full_duplex */
+	bool isFullDuplexEnabled;
 #endif
 
 	IoT_Client_Connect_Params options;
 
 	MessageHandlers messageHandlers[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+	AWS_IoT_Topic_Trie topicTrie; /* Topic filters of messageHandlers, indexed by topic level */
+
+	/* QoS1 publishes waiting for their PUBACK, QoS1 publish is blocking when inflightWindow is 0 */
+	uint8_t inflightWindow;
+	uint32_t inflightRetryMs;
+	pPublishCompleteHandler_t inflightHandler;
+	void *inflightHandlerData;
+	MQTT_Inflight_Publish inflight[AWS_IOT_MQTT_INFLIGHT_WINDOW_MAX];
+
+	/* Hash of topic filter and QoS of each subscription the broker session holds */
+	uint16_t sessionRecordCount;
+	uint32_t sessionRecord[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
 	iot_disconnect_handler disconnectHandler;
 
 	void *disconnectHandlerData;
@@ -341,6 +468,19 @@ IoT_Error_t aws_iot_mqtt_set_connect_params(AWS_IoT_Client *pClient, const IoT_C
  */
 bool aws_iot_mqtt_is_client_connected(AWS_IoT_Client *pClient);
 
+/**
+ * @brief Are received bytes waiting to be parsed?
+ *
+ * Bytes left in the read-ahead buffer were already taken from the network, so the socket
+ * does not report them as readable. An application that waits on socket readiness must
+ * yield again while this returns true.
+ *
+ * @param pClient Reference to the IoT Client
+ *
+ * @return true = bytes are buffered, false = read-ahead buffer is empty
+ */
+bool aws_iot_mqtt_is_rx_pending(AWS_IoT_Client *pClient);
+
 /**
  * @brief Get the current state of the client
  *
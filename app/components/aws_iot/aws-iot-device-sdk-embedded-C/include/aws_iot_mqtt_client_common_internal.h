@@ -68,6 +68,9 @@ typedef enum msgTypes {
 	DISCONNECT = 14
 } MessageTypes;
 
+/* Max length of packet header */
+#define MAX_NO_OF_REMAINING_LENGTH_BYTES 4
+
 /* Macros for parsing header fields from incoming MQTT frame. */
 #define MQTT_HEADER_FIELD_TYPE(_byte)	((_byte >> 4) & 0x0F)
 #define MQTT_HEADER_FIELD_DUP(_byte)	((_byte & (1 << 3)) >> 3)
@@ -104,9 +107,24 @@ void aws_iot_mqtt_internal_write_char(unsigned char **pptr, unsigned char c);
 void aws_iot_mqtt_internal_write_utf8_string(unsigned char **pptr, const char *string, uint16_t stringLen);
 
 IoT_Error_t aws_iot_mqtt_internal_flushBuffers( AWS_IoT_Client *pClient );
+IoT_Error_t aws_iot_mqtt_internal_flushReadAhead( AWS_IoT_Client *pClient );
+
+void aws_iot_mqtt_internal_inflight_init(AWS_IoT_Client *pClient);
+MQTT_Inflight_Publish *aws_iot_mqtt_internal_inflight_get_free(AWS_IoT_Client *pClient);
+bool aws_iot_mqtt_internal_inflight_ack(AWS_IoT_Client *pClient);
+IoT_Error_t aws_iot_mqtt_internal_inflight_retry(AWS_IoT_Client *pClient);
+
+uint32_t aws_iot_mqtt_internal_session_hash(const char *pTopicName, uint16_t topicNameLen, QoS qos);
+bool aws_iot_mqtt_internal_session_find(AWS_IoT_Client *pClient, uint32_t hash);
+void aws_iot_mqtt_internal_session_add(AWS_IoT_Client *pClient, uint32_t hash);
+void aws_iot_mqtt_internal_session_remove(AWS_IoT_Client *pClient, uint32_t hash);
 IoT_Error_t aws_iot_mqtt_internal_send_packet(AWS_IoT_Client *pClient, size_t length, Timer *pTimer);
+IoT_Error_t aws_iot_mqtt_internal_send_packet_from(AWS_IoT_Client *pClient, size_t offset, size_t length,
+												   Timer *pTimer);
 IoT_Error_t aws_iot_mqtt_internal_cycle_read(AWS_IoT_Client *pClient, Timer *pTimer, uint8_t *pPacketType);
 IoT_Error_t aws_iot_mqtt_internal_wait_for_read(AWS_IoT_Client *pClient, uint8_t packetType, Timer *pTimer);
+IoT_Error_t aws_iot_mqtt_internal_deliver_message(AWS_IoT_Client *pClient, char *pTopicName, uint16_t topicNameLen,
+												  IoT_Publish_Message_Params *pMessageParams);
 IoT_Error_t aws_iot_mqtt_internal_serialize_zero(unsigned char *pTxBuf, size_t txBufLen,
 												 MessageTypes packetType, size_t *pSerializedLength);
 IoT_Error_t aws_iot_mqtt_internal_deserialize_publish(uint8_t *dup, QoS *qos,
@@ -118,6 +136,9 @@ IoT_Error_t aws_iot_mqtt_internal_deserialize_publish(uint8_t *dup, QoS *qos,
 IoT_Error_t aws_iot_mqtt_set_client_state(AWS_IoT_Client *pClient, ClientState expectedCurrentState,
 										  ClientState newState);
 
+IoT_Error_t aws_iot_mqtt_internal_write_buf_lock(AWS_IoT_Client *pClient);
+void aws_iot_mqtt_internal_write_buf_unlock(AWS_IoT_Client *pClient);
+
 #ifdef _ENABLE_THREAD_SUPPORT_
 
 IoT_Error_t aws_iot_mqtt_client_lock_mutex(AWS_IoT_Client *pClient, IoT_Mutex_t *pMutex);
@@ -99,7 +99,8 @@ IoT_Error_t aws_iot_mqtt_connect(AWS_IoT_Client *pClient, const IoT_Client_Conne
  * Called to publish an MQTT message on a topic.
  * @note Call is blocking.  In the case of a QoS 0 message the function returns
  * after the message was successfully passed to the TLS layer.  In the case of QoS 1
- * the function returns after the receipt of the PUBACK control packet.
+ * the function returns after the receipt of the PUBACK control packet, or right after
+ * sending when an in flight window is set, see aws_iot_mqtt_set_inflight_window.
  *
  * @param pClient Reference to the IoT Client
  * @param pTopicName Topic Name to publish to
@@ -111,6 +112,126 @@ IoT_Error_t aws_iot_mqtt_connect(AWS_IoT_Client *pClient, const IoT_Client_Conne
 IoT_Error_t aws_iot_mqtt_publish(AWS_IoT_Client *pClient, const char *pTopicName, uint16_t topicNameLen,
 								 IoT_Publish_Message_Params *pParams);
 
+/**
+ * @brief Publish an MQTT message on a topic without copying the payload
+ *
+ * Same as aws_iot_mqtt_publish, but the payload is written by pWriter directly
+ * into the client write buffer behind the reserved PUBLISH header. No intermediate
+ * payload buffer is needed and the payload is not copied again on serialization.
+ * pParams->payload is ignored, pParams->payloadLen returns the written length.
+ * @note Call is blocking, see aws_iot_mqtt_publish.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pTopicName Topic Name to publish to
+ * @param topicNameLen Length of the topic name
+ * @param pParams Pointer to Publish Message parameters
+ * @param pWriter Callback that writes the payload and returns its length
+ * @param pWriterData Data passed to pWriter
+ *
+ * @return An IoT Error Type defining successful/failed publish
+ */
+IoT_Error_t aws_iot_mqtt_publish_in_place(AWS_IoT_Client *pClient, const char *pTopicName, uint16_t topicNameLen,
+										  IoT_Publish_Message_Params *pParams, pPublishPayloadWriter_t pWriter,
+										  void *pWriterData);
+
+/**
+ * @brief Set the in flight window of QoS1 publishes
+ *
+ * With a window of N, aws_iot_mqtt_publish and aws_iot_mqtt_publish_in_place return as soon as
+ * a QoS1 PUBLISH is sent, up to N PUBLISH can wait for their PUBACK at the same time.
+ * A PUBLISH without PUBACK after retryTimeout_ms is sent again with the DUP flag, up to
+ * AWS_IOT_MQTT_INFLIGHT_MAX_RETRIES times. pHandler is called from yield when it completes.
+ * Publishing to a full window returns MQTT_INFLIGHT_WINDOW_FULL_ERROR.
+ * A window of 0 restores the blocking QoS1 publish. Shrinking the window is refused with
+ * MQTT_CLIENT_NOT_IDLE_ERROR while publishes are in flight.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param windowSize Number of in flight publishes, at most AWS_IOT_MQTT_INFLIGHT_WINDOW_MAX
+ * @param retryTimeout_ms Time to wait for a PUBACK before retransmission
+ * @param pHandler Called when an in flight publish completes, can be NULL
+ * @param pHandlerData Data passed to pHandler
+ *
+ * @return An IoT Error Type defining successful/failed call
+ */
+IoT_Error_t aws_iot_mqtt_set_inflight_window(AWS_IoT_Client *pClient, uint8_t windowSize, uint32_t retryTimeout_ms,
+											 pPublishCompleteHandler_t pHandler, void *pHandlerData);
+
+/**
+ * @brief Number of QoS1 publishes waiting for their PUBACK
+ *
+ * @param pClient Reference to the IoT Client
+ *
+ * @return Number of in flight publishes
+ */
+uint8_t aws_iot_mqtt_get_inflight_count(AWS_IoT_Client *pClient);
+
+/**
+ * @brief Time until the next in flight publish must be sent again
+ *
+ * Yield does the retransmission, an application that sleeps between yields
+ * must wake up after this time.
+ *
+ * @param pClient Reference to the IoT Client
+ *
+ * @return Time in ms, 0 if a retransmission is due, UINT32_MAX if nothing is in flight
+ */
+uint32_t aws_iot_mqtt_get_inflight_wait_ms(AWS_IoT_Client *pClient);
+
+/**
+ * @brief Receive messages larger than the read buffer in chunks
+ *
+ * Without a stream handler, a PUBLISH that does not fit in AWS_IOT_MQTT_RX_BUF_LEN is
+ * dropped and yield returns MQTT_RX_BUFFER_TOO_SHORT_ERROR. With one, its payload is
+ * passed to pHandler in chunks as it is read from the network, whatever its topic.
+ * The subscribe handlers do not see it, unless pHandler puts the payload together and passes
+ * it to aws_iot_mqtt_deliver_message. A QoS1 PUBLISH is acknowledged after its last chunk.
+ * The topic name and packet identifier must still fit in the read buffer.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pHandler Called for each chunk, NULL drops large messages again
+ * @param pHandlerData Data passed to pHandler
+ *
+ * @return An IoT Error Type defining successful/failed call
+ */
+IoT_Error_t aws_iot_mqtt_set_stream_handler(AWS_IoT_Client *pClient, pApplicationStreamHandler_t pHandler,
+											void *pHandlerData);
+
+/**
+ * @brief Pass a message put together by the stream handler to the subscribe handlers of its topic
+ *
+ * Called from the stream handler with the topic name of the last chunk, the handlers
+ * are called as for a PUBLISH that fits in the read buffer.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pTopicName Topic name passed to the stream handler
+ * @param topicNameLen Length of the topic name
+ * @param pParams Publish parameters, payload and payloadLen cover the whole message
+ *
+ * @return An IoT Error Type defining successful/failed call
+ */
+IoT_Error_t aws_iot_mqtt_deliver_message(AWS_IoT_Client *pClient, char *pTopicName, uint16_t topicNameLen,
+										 IoT_Publish_Message_Params *pParams);
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+/**
+ * @brief Let publishes that do not wait for a PUBACK run beside yield
+ *
+ * A QoS0 publish, or a QoS1 publish with an in flight window set, only writes to the
+ * network. With full duplex enabled it does not take the client state, so one thread can
+ * publish while another one is blocked in aws_iot_mqtt_yield reading the network and
+ * calling the subscribe handlers. Writers are serialized on the write buffer.
+ * Calls that wait for a response (subscribe, unsubscribe, blocking QoS1 publish, connect)
+ * read the network themselves and still need the client idle, yield returns
+ * MQTT_CLIENT_NOT_IDLE_ERROR while one of them is running.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param isEnabled true = full duplex, false = every call takes the client state
+ *
+ * @return An IoT Error Type defining successful/failed call
+ */
+IoT_Error_t aws_iot_mqtt_set_full_duplex(AWS_IoT_Client *pClient, bool isEnabled);
+#endif
+
 /**
  * @brief Subscribe to an MQTT topic.
  *
@@ -132,6 +253,25 @@ IoT_Error_t aws_iot_mqtt_publish(AWS_IoT_Client *pClient, const char *pTopicName
 IoT_Error_t aws_iot_mqtt_subscribe(AWS_IoT_Client *pClient, const char *pTopicName, uint16_t topicNameLen,
 								   QoS qos, pApplicationHandler_t pApplicationHandler, void *pApplicationHandlerData);
 
+/**
+ * @brief Subscribe to several MQTT topics in one round trip.
+ *
+ * All topic filters are sent in a single SUBSCRIBE and acknowledged by a single SUBACK.
+ * Filters already held by a resumed session are registered without being sent.
+ * Filters refused by the broker are not registered, the others stay subscribed.
+ * @note Call is blocking.  The call returns after the receipt of the SUBACK control packet.
+ * @warning The topic names and handler data of the filters need to be static in memory.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pFilters Topic filters to subscribe to, the array itself is not kept
+ * @param count Number of filters, at most AWS_IOT_MQTT_SUBSCRIBE_BATCH_MAX
+ *
+ * @return An IoT Error Type defining successful/failed subscription,
+ *     MQTT_SUBSCRIBE_REFUSED_ERROR if the broker refused some filters
+ */
+IoT_Error_t aws_iot_mqtt_subscribe_batch(AWS_IoT_Client *pClient, const IoT_Subscribe_Filter *pFilters,
+										 uint8_t count);
+
 /**
  * @brief Subscribe to an MQTT topic.
  *
@@ -146,6 +286,47 @@ IoT_Error_t aws_iot_mqtt_subscribe(AWS_IoT_Client *pClient, const char *pTopicNa
  */
 IoT_Error_t aws_iot_mqtt_resubscribe(AWS_IoT_Client *pClient);
 
+/**
+ * @brief Did the broker resume the previous session?
+ *
+ * Only possible when connected with isCleanSession false. The broker kept the
+ * subscriptions of the session and queued QoS1 messages while the client was offline.
+ *
+ * @param pClient Reference to the IoT Client
+ *
+ * @return true = session resumed, false = new session
+ */
+bool aws_iot_mqtt_is_session_present(AWS_IoT_Client *pClient);
+
+/**
+ * @brief Load the record of subscriptions held by the broker session
+ *
+ * The client keeps a hash of topic filter and QoS of each subscription acknowledged
+ * in the current session. When the session is resumed, aws_iot_mqtt_subscribe to a
+ * recorded filter only registers the handler, without a SUBSCRIBE round trip, and
+ * aws_iot_mqtt_attempt_reconnect skips the resubscribe. A record saved before a reboot
+ * is loaded here, after aws_iot_mqtt_init and before aws_iot_mqtt_connect.
+ * The record is dropped when the broker starts a new session.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pRecord Record from aws_iot_mqtt_get_session_record
+ * @param count Number of entries, at most AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS
+ *
+ * @return An IoT Error Type defining successful/failed call
+ */
+IoT_Error_t aws_iot_mqtt_set_session_record(AWS_IoT_Client *pClient, const uint32_t *pRecord, uint16_t count);
+
+/**
+ * @brief Copy the record of subscriptions held by the broker session
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pRecord Destination of the record
+ * @param maxCount Number of entries pRecord can hold
+ *
+ * @return Number of entries copied
+ */
+uint16_t aws_iot_mqtt_get_session_record(AWS_IoT_Client *pClient, uint32_t *pRecord, uint16_t maxCount);
+
 /**
  * @brief Unsubscribe to an MQTT topic.
  *
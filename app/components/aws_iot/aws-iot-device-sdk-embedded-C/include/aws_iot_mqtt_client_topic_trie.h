@@ -0,0 +1,116 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_mqtt_client_topic_trie.h
+ * @brief Topic filter trie used to find the message handlers of an incoming PUBLISH
+ *
+ * Every subscribed topic filter is stored as a path of topic levels. Dispatching a
+ * topic name walks the trie one level at a time, so the cost depends on the depth
+ * of the topic and not on the number of message handlers. Levels are compared by
+ * hash and length only, the trie may return extra candidates on a hash collision
+ * and the caller must confirm each candidate against its topic filter.
+ */
+
+#ifndef AWS_IOT_SDK_SRC_IOT_MQTT_CLIENT_TOPIC_TRIE_H
+#define AWS_IOT_SDK_SRC_IOT_MQTT_CLIENT_TOPIC_TRIE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "aws_iot_error.h"
+#include "aws_iot_config.h"
+
+#ifndef AWS_IOT_MQTT_TOPIC_TRIE_NUM_NODES
+#define AWS_IOT_MQTT_TOPIC_TRIE_NUM_NODES (AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS * 4) ///< Topic levels that can be stored, levels shared by several filters are stored once
+#endif
+
+#define AWS_IOT_MQTT_TOPIC_TRIE_MATCH_WORDS ((AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS + 31) / 32) ///< Size of the match bitmap in 32 bit words
+
+/**
+ * @brief Topic trie node, one topic level of one or more topic filters
+ */
+typedef struct _AWS_IoT_Topic_Trie_Node {
+	uint32_t levelHash;		///< FNV-1a hash of the level
+	uint16_t levelLen;		///< Length of the level
+	uint16_t refCount;		///< Number of topic filters going through this node, 0 if node is free
+	int16_t parent;			///< Parent node, -1 for a first level node
+	int16_t firstChild;		///< First node of the next level, -1 if none
+	int16_t nextSibling;	///< Next node of the same level, -1 if none
+	int16_t firstHandler;	///< First message handler whose topic filter ends here, -1 if none
+	char wildcard;			///< '+' or '#' for a wildcard level, 0 otherwise
+} AWS_IoT_Topic_Trie_Node;
+
+/**
+ * @brief Topic trie
+ */
+typedef struct _AWS_IoT_Topic_Trie {
+	AWS_IoT_Topic_Trie_Node nodes[AWS_IOT_MQTT_TOPIC_TRIE_NUM_NODES];
+	int16_t handlerNode[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];	///< Last node of each message handler, -1 if unused
+	int16_t nextHandler[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];	///< Next message handler ending at the same node
+	int16_t firstRoot;		///< First node of the first level, -1 if trie is empty
+} AWS_IoT_Topic_Trie;
+
+/**
+ * @brief Initialize an empty topic trie
+ *
+ * @param pTrie Reference to the trie
+ */
+void aws_iot_mqtt_topic_trie_init(AWS_IoT_Topic_Trie *pTrie);
+
+/**
+ * @brief Add the topic filter of a message handler
+ *
+ * @param pTrie Reference to the trie
+ * @param handlerIndex Index of the message handler
+ * @param pTopicFilter Topic filter, does not need to stay in memory
+ * @param topicFilterLen Length of the topic filter
+ *
+ * @return SUCCESS, NULL_VALUE_ERROR or MQTT_MAX_SUBSCRIPTIONS_REACHED_ERROR if the trie is full.
+ *         The trie is left unchanged on error.
+ */
+IoT_Error_t aws_iot_mqtt_topic_trie_insert(AWS_IoT_Topic_Trie *pTrie, uint16_t handlerIndex,
+										   const char *pTopicFilter, uint16_t topicFilterLen);
+
+/**
+ * @brief Remove the topic filter of a message handler
+ *
+ * @param pTrie Reference to the trie
+ * @param handlerIndex Index of the message handler, nothing is done if it is not in the trie
+ */
+void aws_iot_mqtt_topic_trie_remove(AWS_IoT_Topic_Trie *pTrie, uint16_t handlerIndex);
+
+/**
+ * @brief Find the message handlers whose topic filter may match a topic name
+ *
+ * @param pTrie Reference to the trie
+ * @param pTopicName Topic name of the incoming PUBLISH
+ * @param topicNameLen Length of the topic name
+ * @param pMatched Bitmap of AWS_IOT_MQTT_TOPIC_TRIE_MATCH_WORDS words, bit i is set for candidate handler i
+ *
+ * @return Number of candidate handlers
+ */
+uint32_t aws_iot_mqtt_topic_trie_match(const AWS_IoT_Topic_Trie *pTrie, const char *pTopicName,
+									   uint16_t topicNameLen, uint32_t *pMatched);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AWS_IOT_SDK_SRC_IOT_MQTT_CLIENT_TOPIC_TRIE_H */
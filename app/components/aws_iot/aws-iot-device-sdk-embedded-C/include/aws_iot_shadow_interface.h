@@ -74,6 +74,7 @@ typedef struct {
 	const char *pMqttClientId; ///< Currently the Shadow uses MQTT to connect and it is important to ensure we have unique client id
 	uint16_t mqttClientIdLen; ///< Currently the Shadow uses MQTT to connect and it is important to ensure we have unique client id
 	pApplicationHandler_t deleteActionHandler;	///< Callback to be invoked when Thing shadow for this device is deleted
+	bool isCleanSession;	///< Set to false to resume the previous MQTT session, see aws_iot_mqtt_set_session_record
 } ShadowConnectParameters_t;
 
 /*!
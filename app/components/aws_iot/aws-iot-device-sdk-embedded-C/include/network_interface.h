@@ -66,6 +66,7 @@ struct Network {
 	IoT_Error_t (*connect)(Network *, TLSConnectParams *);
 
 	IoT_Error_t (*read)(Network *, unsigned char *, size_t, Timer *, size_t *);    ///< Function pointer pointing to the network function to read from the network
+	IoT_Error_t (*readAvailable)(Network *, unsigned char *, size_t, Timer *, size_t *);    ///< Function pointer pointing to the network function to read whatever is available, up to the given length
 	IoT_Error_t (*write)(Network *, unsigned char *, size_t, Timer *, size_t *);    ///< Function pointer pointing to the network function to write to the network
 	IoT_Error_t (*disconnect)(Network *);    ///< Function pointer pointing to the network function to disconnect from the network
 	IoT_Error_t (*isConnected)(Network *);    ///< Function pointer pointing to the network function to check if TLS is connected
@@ -132,6 +133,22 @@ IoT_Error_t iot_tls_write(Network *, unsigned char *, size_t, Timer *, size_t *)
  */
 IoT_Error_t iot_tls_read(Network *, unsigned char *, size_t, Timer *, size_t *);
 
+/**
+ * @brief Read the bytes available on the network socket
+ *
+ * Waits until at least one byte arrives or the timer expires, then returns
+ * the rest of the TLS record that is already decrypted, up to the given length.
+ * Unlike iot_tls_read it does not wait for the whole length.
+ *
+ * @param Network - Pointer to a Network struct defining the network interface.
+ * @param unsigned char pointer - pointer to buffer where read bytes should be copied
+ * @param size_t - maximum number of bytes to read
+ * @param Timer * - operation timer
+ * @param size_t - pointer to store number of bytes read
+ * @return IoT_Error_t - successful read, NETWORK_SSL_NOTHING_TO_READ or TLS error code
+ */
+IoT_Error_t iot_tls_read_available(Network *, unsigned char *, size_t, Timer *, size_t *);
+
 /**
  * @brief Disconnect from network socket
  *
@@ -80,6 +80,7 @@ IoT_Error_t iot_tls_init(Network *pNetwork, char *pRootCALocation, char *pDevice
 
 	pNetwork->connect = iot_tls_connect;
 	pNetwork->read = iot_tls_read;
+	pNetwork->readAvailable = iot_tls_read_available;
 	pNetwork->write = iot_tls_write;
 	pNetwork->disconnect = iot_tls_disconnect;
 	pNetwork->isConnected = iot_tls_is_connected;
@@ -349,6 +350,40 @@ IoT_Error_t iot_tls_read(Network *pNetwork, unsigned char *pMsg, size_t len, Tim
 	}
 }
 
+IoT_Error_t iot_tls_read_available(Network *pNetwork, unsigned char *pMsg, size_t len, Timer *timer, size_t *read_len) {
+	mbedtls_ssl_context *ssl = &(pNetwork->tlsDataParams.ssl);
+	size_t rxLen = 0;
+	int ret;
+
+	// Block only until the first record arrives
+	while (rxLen == 0 && len > 0) {
+		ret = mbedtls_ssl_read(ssl, pMsg, len);
+		if (ret > 0) {
+			rxLen = ret;
+		} else if (ret == 0 || (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE && ret != MBEDTLS_ERR_SSL_TIMEOUT)) {
+			return NETWORK_SSL_READ_ERROR;
+		} else if (has_timer_expired(timer)) {
+			break;
+		}
+	}
+
+	// Then take the records mbedTLS already holds, without waiting on the socket
+	while (rxLen < len && mbedtls_ssl_check_pending(ssl)) {
+		ret = mbedtls_ssl_read(ssl, pMsg + rxLen, len - rxLen);
+		if (ret <= 0) {
+			break;
+		}
+		rxLen += ret;
+	}
+
+	if (rxLen == 0) {
+		return NETWORK_SSL_NOTHING_TO_READ;
+	}
+
+	*read_len = rxLen;
+	return SUCCESS;
+}
+
 IoT_Error_t iot_tls_disconnect(Network *pNetwork) {
 	mbedtls_ssl_context *ssl = &(pNetwork->tlsDataParams.ssl);
 	int ret = 0;
@@ -89,7 +89,9 @@ static const aws_err_msg_t AWS_ERR_MSG_TABLE[] =
   AWS_ERR_TBL_IT(MUTEX_DESTROY_ERROR),
   AWS_ERR_TBL_IT(MAX_SIZE_ERROR),
   AWS_ERR_TBL_IT(LIMIT_EXCEEDED_ERROR),
-  AWS_ERR_TBL_IT(INVALID_TOPIC_TYPE_ERROR)
+  AWS_ERR_TBL_IT(INVALID_TOPIC_TYPE_ERROR),
+  AWS_ERR_TBL_IT(MQTT_INFLIGHT_WINDOW_FULL_ERROR),
+  AWS_ERR_TBL_IT(MQTT_SUBSCRIBE_REFUSED_ERROR)
 };
 
 /* Private function prototypes ---------------------------------------------- */
@@ -43,6 +43,7 @@ extern "C" {
 
 #include "aws_iot_log.h"
 #include "aws_iot_mqtt_client_interface.h"
+#include "aws_iot_mqtt_client_common_internal.h"
 #include "aws_iot_version.h"
 
 #if !DISABLE_METRICS
@@ -100,6 +101,33 @@ IoT_Error_t aws_iot_mqtt_client_unlock_mutex(AWS_IoT_Client *pClient, IoT_Mutex_
 }
 #endif
 
+/**
+ * @brief Take the write buffer before serializing a packet into it
+ *
+ * Always blocks, the lock is only held while a packet is serialized and sent. Writers
+ * are queued here, so the trylock on tls_write_mutex never fails because of another writer.
+ *
+ * @param pClient Reference to the IoT Client
+ *
+ * @return An IoT Error Type defining successful/failed locking
+ */
+IoT_Error_t aws_iot_mqtt_internal_write_buf_lock(AWS_IoT_Client *pClient) {
+#ifdef _ENABLE_THREAD_SUPPORT_
+	return aws_iot_thread_mutex_lock(&(pClient->clientData.write_buf_mutex));
+#else
+	IOT_UNUSED(pClient);
+	return SUCCESS;
+#endif
+}
+
+void aws_iot_mqtt_internal_write_buf_unlock(AWS_IoT_Client *pClient) {
+#ifdef _ENABLE_THREAD_SUPPORT_
+	(void)aws_iot_thread_mutex_unlock(&(pClient->clientData.write_buf_mutex));
+#else
+	IOT_UNUSED(pClient);
+#endif
+}
+
 IoT_Error_t aws_iot_mqtt_set_client_state(AWS_IoT_Client *pClient, ClientState expectedCurrentState,
 										  ClientState newState) {
 	IoT_Error_t rc;
@@ -196,6 +224,13 @@ IoT_Error_t aws_iot_mqtt_free(AWS_IoT_Client *pClient)
 		}else{
 			(void)aws_iot_thread_mutex_destroy(&(pClient->clientData.tls_write_mutex));
 		}
+
+		if (rc == SUCCESS)
+		{
+			rc = aws_iot_thread_mutex_destroy(&(pClient->clientData.write_buf_mutex));
+		}else{
+			(void)aws_iot_thread_mutex_destroy(&(pClient->clientData.write_buf_mutex));
+		}
 	#endif
 	}
 
@@ -221,11 +256,20 @@ IoT_Error_t aws_iot_mqtt_init(AWS_IoT_Client *pClient, const IoT_Client_Init_Par
 		pClient->clientData.messageHandlers[i].pApplicationHandlerData = NULL;
 		pClient->clientData.messageHandlers[i].qos = QOS0;
 	}
+	aws_iot_mqtt_topic_trie_init(&pClient->clientData.topicTrie);
+	aws_iot_mqtt_internal_inflight_init(pClient);
 
 	pClient->clientData.packetTimeoutMs = pInitParams->mqttPacketTimeout_ms;
 	pClient->clientData.commandTimeoutMs = pInitParams->mqttCommandTimeout_ms;
 	pClient->clientData.writeBufSize = AWS_IOT_MQTT_TX_BUF_LEN;
 	pClient->clientData.readBufSize = AWS_IOT_MQTT_RX_BUF_LEN;
+	pClient->clientData.readBufIndex = 0;
+	pClient->clientData.readAheadStart = 0;
+	pClient->clientData.readAheadEnd = 0;
+	pClient->clientData.streamHandler = NULL;
+	pClient->clientData.streamHandlerData = NULL;
+	pClient->clientData.streamHeaderLen = 0;
+	pClient->clientData.streamPayloadLen = 0;
 	pClient->clientData.counterNetworkDisconnected = 0;
 	pClient->clientData.disconnectHandler = pInitParams->disconnectHandler;
 	pClient->clientData.disconnectHandlerData = pInitParams->disconnectHandlerData;
@@ -239,6 +283,7 @@ IoT_Error_t aws_iot_mqtt_init(AWS_IoT_Client *pClient, const IoT_Client_Init_Par
 
 #ifdef _ENABLE_THREAD_SUPPORT_
 	pClient->clientData.isBlockOnThreadLockEnabled = pInitParams->isBlockOnThreadLockEnabled;
+	pClient->clientData.isFullDuplexEnabled = false;
 	rc = aws_iot_thread_mutex_init(&(pClient->clientData.state_change_mutex));
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
@@ -254,10 +299,19 @@ IoT_Error_t aws_iot_mqtt_init(AWS_IoT_Client *pClient, const IoT_Client_Init_Par
 		(void)aws_iot_thread_mutex_destroy(&(pClient->clientData.state_change_mutex));
 		FUNC_EXIT_RC(rc);
 	}
+	rc = aws_iot_thread_mutex_init(&(pClient->clientData.write_buf_mutex));
+	if(SUCCESS != rc) {
+		(void)aws_iot_thread_mutex_destroy(&(pClient->clientData.tls_write_mutex));
+		(void)aws_iot_thread_mutex_destroy(&(pClient->clientData.tls_read_mutex));
+		(void)aws_iot_thread_mutex_destroy(&(pClient->clientData.state_change_mutex));
+		FUNC_EXIT_RC(rc);
+	}
 #endif
 
 	pClient->clientStatus.isPingOutstanding = 0;
 	pClient->clientStatus.isAutoReconnectEnabled = pInitParams->enableAutoReconnect;
+	pClient->clientStatus.isSessionPresent = false;
+	pClient->clientData.sessionRecordCount = 0;
 
 	rc = iot_tls_init(&(pClient->networkStack), pInitParams->pRootCALocation, pInitParams->pDeviceCertLocation,
 					  pInitParams->pDevicePrivateKeyLocation, pInitParams->pHostURL, pInitParams->port,
@@ -268,6 +322,7 @@ IoT_Error_t aws_iot_mqtt_init(AWS_IoT_Client *pClient, const IoT_Client_Init_Par
 		(void)aws_iot_thread_mutex_destroy(&(pClient->clientData.tls_read_mutex));
 		(void)aws_iot_thread_mutex_destroy(&(pClient->clientData.state_change_mutex));
 		(void)aws_iot_thread_mutex_destroy(&(pClient->clientData.tls_write_mutex));
+		(void)aws_iot_thread_mutex_destroy(&(pClient->clientData.write_buf_mutex));
 		#endif
 		pClient->clientStatus.clientState = CLIENT_STATE_INVALID;
 		FUNC_EXIT_RC(rc);
@@ -323,6 +378,14 @@ bool aws_iot_mqtt_is_client_connected(AWS_IoT_Client *pClient) {
 	FUNC_EXIT_RC(isConnected);
 }
 
+bool aws_iot_mqtt_is_rx_pending(AWS_IoT_Client *pClient) {
+	if(NULL == pClient) {
+		return false;
+	}
+
+	return pClient->clientData.readAheadStart < pClient->clientData.readAheadEnd;
+}
+
 bool aws_iot_is_autoreconnect_enabled(AWS_IoT_Client *pClient) {
 	FUNC_ENTRY;
 	if(NULL == pClient) {
@@ -342,6 +405,37 @@ IoT_Error_t aws_iot_mqtt_autoreconnect_set_status(AWS_IoT_Client *pClient, bool
 	FUNC_EXIT_RC(SUCCESS);
 }
 
+IoT_Error_t aws_iot_mqtt_set_stream_handler(AWS_IoT_Client *pClient, pApplicationStreamHandler_t pHandler,
+											void *pHandlerData) {
+	FUNC_ENTRY;
+	if(NULL == pClient) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+	pClient->clientData.streamHandler = pHandler;
+	pClient->clientData.streamHandlerData = pHandlerData;
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+IoT_Error_t aws_iot_mqtt_deliver_message(AWS_IoT_Client *pClient, char *pTopicName, uint16_t topicNameLen,
+										 IoT_Publish_Message_Params *pParams) {
+	FUNC_ENTRY;
+	if(NULL == pClient || NULL == pParams) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+	FUNC_EXIT_RC(aws_iot_mqtt_internal_deliver_message(pClient, pTopicName, topicNameLen, pParams));
+}
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+IoT_Error_t aws_iot_mqtt_set_full_duplex(AWS_IoT_Client *pClient, bool isEnabled) {
+	FUNC_ENTRY;
+	if(NULL == pClient) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+	pClient->clientData.isFullDuplexEnabled = isEnabled;
+	FUNC_EXIT_RC(SUCCESS);
+}
+#endif
+
 IoT_Error_t aws_iot_mqtt_set_disconnect_handler(AWS_IoT_Client *pClient, iot_disconnect_handler pDisconnectHandler,
 												void *pDisconnectHandlerData) {
 	FUNC_ENTRY;
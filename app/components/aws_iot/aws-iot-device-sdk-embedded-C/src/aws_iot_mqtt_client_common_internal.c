@@ -43,9 +43,6 @@ extern "C" {
 #include <aws_iot_mqtt_client.h>
 #include "aws_iot_mqtt_client_common_internal.h"
 
-/* Max length of packet header */
-#define MAX_NO_OF_REMAINING_LENGTH_BYTES 4
-
 /**
  * Encodes the message length according to the MQTT algorithm
  * @param buf the buffer into which the encoded data is written
@@ -266,6 +263,35 @@ IoT_Error_t aws_iot_mqtt_internal_init_header(MQTTHeader *pHeader, MessageTypes
 
 IoT_Error_t aws_iot_mqtt_internal_send_packet(AWS_IoT_Client *pClient, size_t length, Timer *pTimer) {
 
+	FUNC_ENTRY;
+
+	if(NULL == pClient || NULL == pTimer) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(length >= pClient->clientData.writeBufSize) {
+		FUNC_EXIT_RC(MQTT_TX_BUFFER_TOO_SHORT_ERROR);
+	}
+
+	FUNC_EXIT_RC(aws_iot_mqtt_internal_send_packet_from(pClient, 0, length, pTimer));
+}
+
+/**
+ * @brief Send a packet that does not start at the beginning of the write buffer
+ *
+ * Used when the packet header is written after the payload, in front of it,
+ * so the packet starts somewhere inside the write buffer.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param offset Start of the packet in the write buffer
+ * @param length Length of the packet
+ * @param pTimer Timer for the send operation
+ *
+ * @return An IoT Error Type defining successful/failed send
+ */
+IoT_Error_t aws_iot_mqtt_internal_send_packet_from(AWS_IoT_Client *pClient, size_t offset, size_t length,
+												   Timer *pTimer) {
+
 	size_t sentLen, sent;
 	IoT_Error_t rc;
 
@@ -275,7 +301,7 @@ IoT_Error_t aws_iot_mqtt_internal_send_packet(AWS_IoT_Client *pClient, size_t le
 		FUNC_EXIT_RC(NULL_VALUE_ERROR);
 	}
 
-	if(length >= pClient->clientData.writeBufSize) {
+	if(offset + length > pClient->clientData.writeBufSize) {
 		FUNC_EXIT_RC(MQTT_TX_BUFFER_TOO_SHORT_ERROR);
 	}
 
@@ -291,7 +317,7 @@ IoT_Error_t aws_iot_mqtt_internal_send_packet(AWS_IoT_Client *pClient, size_t le
 
 	while(sent < length && !has_timer_expired(pTimer)) {
 		rc = pClient->networkStack.write(&(pClient->networkStack),
-						 &pClient->clientData.writeBuf[sent],
+						 &pClient->clientData.writeBuf[offset + sent],
 						 (length - sent),
 						 pTimer,
 						 &sentLen);
@@ -318,6 +344,68 @@ IoT_Error_t aws_iot_mqtt_internal_send_packet(AWS_IoT_Client *pClient, size_t le
 	FUNC_EXIT_RC(rc);
 }
 
+/**
+ * @brief Read bytes for the packet being parsed
+ *
+ * Bytes left over from an earlier network read are used first. When they run out,
+ * short reads refill the read-ahead buffer with whatever the network has, so several
+ * small packets arriving in one TLS record cost a single network read. Reads at least
+ * as large as the read-ahead buffer go straight to the destination.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pDest Buffer to copy the bytes into
+ * @param len Number of bytes wanted
+ * @param pTimer Timer for the network read
+ * @param read_len Number of bytes copied, less than len on error
+ *
+ * @return An IoT Error Type defining successful/failed read
+ */
+static IoT_Error_t _aws_iot_mqtt_internal_read_ahead(AWS_IoT_Client *pClient, unsigned char *pDest, size_t len,
+													 Timer *pTimer, size_t *read_len) {
+	ClientData *pData = &(pClient->clientData);
+	IoT_Error_t rc = SUCCESS;
+	size_t copyLen, byteRead;
+
+	*read_len = 0;
+
+	while(*read_len < len) {
+		if(pData->readAheadStart < pData->readAheadEnd) {
+			copyLen = pData->readAheadEnd - pData->readAheadStart;
+			if(copyLen > len - *read_len) {
+				copyLen = len - *read_len;
+			}
+			memcpy(pDest + *read_len, pData->readAheadBuf + pData->readAheadStart, copyLen);
+			pData->readAheadStart += copyLen;
+			*read_len += copyLen;
+			continue;
+		}
+
+		pData->readAheadStart = 0;
+		pData->readAheadEnd = 0;
+		byteRead = 0;
+
+		if(NULL == pClient->networkStack.readAvailable || (len - *read_len) >= AWS_IOT_MQTT_READ_AHEAD_LEN) {
+			rc = pClient->networkStack.read(&(pClient->networkStack), pDest + *read_len, len - *read_len, pTimer,
+											&byteRead);
+			*read_len += byteRead;
+			break;
+		}
+
+		rc = pClient->networkStack.readAvailable(&(pClient->networkStack), pData->readAheadBuf,
+												 AWS_IOT_MQTT_READ_AHEAD_LEN, pTimer, &byteRead);
+		if(SUCCESS != rc || 0 == byteRead) {
+			/* Part of the bytes already arrived, the rest did not come in time */
+			if(NETWORK_SSL_NOTHING_TO_READ == rc && 0 < *read_len) {
+				rc = NETWORK_SSL_READ_TIMEOUT_ERROR;
+			}
+			break;
+		}
+		pData->readAheadEnd = byteRead;
+	}
+
+	return rc;
+}
+
 static IoT_Error_t _aws_iot_mqtt_internal_readWrapper( AWS_IoT_Client *pClient, size_t offset, size_t size, Timer *pTimer, size_t * read_len ) {
     IoT_Error_t rc;
     int byteToRead;
@@ -327,7 +415,7 @@ static IoT_Error_t _aws_iot_mqtt_internal_readWrapper( AWS_IoT_Client *pClient,
 
     if ( byteToRead > 0 )
     {
-        rc = pClient->networkStack.read( &( pClient->networkStack ),
+        rc = _aws_iot_mqtt_internal_read_ahead( pClient,
             pClient->clientData.readBuf + pClient->clientData.readBufIndex,
             (size_t)byteToRead,
             pTimer,
@@ -344,8 +432,6 @@ static IoT_Error_t _aws_iot_mqtt_internal_readWrapper( AWS_IoT_Client *pClient,
         rc = SUCCESS;
     }
 
- 
-
     return rc;
 }
 static IoT_Error_t _aws_iot_mqtt_internal_decode_packet_remaining_len(AWS_IoT_Client *pClient, size_t * offset,
@@ -378,6 +464,56 @@ static IoT_Error_t _aws_iot_mqtt_internal_decode_packet_remaining_len(AWS_IoT_Cl
 	FUNC_EXIT_RC(rc);
 }
 
+/**
+ * @brief Read the variable header of a PUBLISH too large for the read buffer
+ *
+ * The topic name and packet identifier are kept in the read buffer,
+ * the payload is read later in chunks by _aws_iot_mqtt_internal_stream_publish.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param offset Length of the fixed header
+ * @param rem_len Remaining length of the PUBLISH
+ * @param pTimer Timer for the network read
+ *
+ * @return SUCCESS when the payload is streamed, MQTT_RX_BUFFER_TOO_SHORT_ERROR when the PUBLISH is dropped
+ */
+static IoT_Error_t _aws_iot_mqtt_internal_stream_begin(AWS_IoT_Client *pClient, size_t offset, size_t rem_len,
+													   Timer *pTimer) {
+	ClientData *pData = &(pClient->clientData);
+	size_t header_len, read_len;
+	IoT_Error_t rc;
+
+	if(NULL == pData->streamHandler) {
+		return MQTT_RX_BUFFER_TOO_SHORT_ERROR;
+	}
+
+	/* Topic name length */
+	rc = _aws_iot_mqtt_internal_readWrapper(pClient, offset, 2, pTimer, &read_len);
+	if(SUCCESS != rc) {
+		return rc;
+	}
+
+	header_len = 2 + (((size_t) pData->readBuf[offset] << 8) | pData->readBuf[offset + 1]);
+	if(QOS0 != MQTT_HEADER_FIELD_QOS(pData->readBuf[0])) {
+		header_len += 2;
+	}
+
+	/* Each chunk holds at least one byte after the header */
+	if(header_len > rem_len || (offset + header_len) >= pData->readBufSize) {
+		return MQTT_RX_BUFFER_TOO_SHORT_ERROR;
+	}
+
+	rc = _aws_iot_mqtt_internal_readWrapper(pClient, offset + 2, header_len - 2, pTimer, &read_len);
+	if(SUCCESS != rc) {
+		return rc;
+	}
+
+	pData->streamHeaderLen = offset + header_len;
+	pData->streamPayloadLen = rem_len - header_len;
+
+	return SUCCESS;
+}
+
 static IoT_Error_t _aws_iot_mqtt_internal_read_packet(AWS_IoT_Client *pClient, Timer *pTimer, uint8_t *pPacketType) {
 	size_t rem_len, total_bytes_read, bytes_to_be_read, read_len;
 	IoT_Error_t rc;
@@ -406,21 +542,33 @@ static IoT_Error_t _aws_iot_mqtt_internal_read_packet(AWS_IoT_Client *pClient, T
 		return rc;
 	} 
      
-	/* if the buffer is too short then the message will be dropped silently */
 	if((rem_len + offset) >= pClient->clientData.readBufSize) {
-		bytes_to_be_read = pClient->clientData.readBufSize;
-		do {
-			rc = pClient->networkStack.read(&(pClient->networkStack), pClient->clientData.readBuf, bytes_to_be_read,
-											pTimer, &read_len);
+		/* A PUBLISH is passed to the stream handler in chunks, see aws_iot_mqtt_set_stream_handler */
+		if(PUBLISH == MQTT_HEADER_FIELD_TYPE(pClient->clientData.readBuf[0])) {
+			rc = _aws_iot_mqtt_internal_stream_begin(pClient, offset, rem_len, pTimer);
+			if(SUCCESS == rc) {
+				*pPacketType = PUBLISH;
+				FUNC_EXIT_RC(rc);
+			} else if(MQTT_RX_BUFFER_TOO_SHORT_ERROR != rc) {
+				return rc;
+			}
+			total_bytes_read = pClient->clientData.readBufIndex - offset;
+			rc = SUCCESS;
+		}
+
+		/* if the buffer is too short then the message will be dropped silently */
+		/* Never read past this packet, the next one may already be in the read-ahead buffer */
+		while(total_bytes_read < rem_len && SUCCESS == rc) {
+			bytes_to_be_read = rem_len - total_bytes_read;
+			if(bytes_to_be_read > pClient->clientData.readBufSize) {
+				bytes_to_be_read = pClient->clientData.readBufSize;
+			}
+			rc = _aws_iot_mqtt_internal_read_ahead(pClient, pClient->clientData.readBuf, bytes_to_be_read,
+												   pTimer, &read_len);
 			if(SUCCESS == rc) {
 				total_bytes_read += read_len;
-				if((rem_len - total_bytes_read) >= pClient->clientData.readBufSize) {
-					bytes_to_be_read = pClient->clientData.readBufSize;
-				} else {
-					bytes_to_be_read = rem_len - total_bytes_read;
-				}
 			}
-		} while(total_bytes_read < rem_len && SUCCESS == rc);
+		}
 
         /* Check buffer was correctly emptied, otherwise, return error message. */
         if ( total_bytes_read == rem_len )
@@ -489,10 +637,10 @@ static bool _aws_iot_mqtt_internal_is_topic_matched(char *pTopicFilter, char *pT
 	return (curn == curn_end) && (*curf == '\0');
 }
 
-static IoT_Error_t _aws_iot_mqtt_internal_deliver_message(AWS_IoT_Client *pClient, char *pTopicName,
-														  uint16_t topicNameLen,
-														  IoT_Publish_Message_Params *pMessageParams) {
+IoT_Error_t aws_iot_mqtt_internal_deliver_message(AWS_IoT_Client *pClient, char *pTopicName, uint16_t topicNameLen,
+												  IoT_Publish_Message_Params *pMessageParams) {
 	uint32_t itr;
+	uint32_t matched[AWS_IOT_MQTT_TOPIC_TRIE_MATCH_WORDS];
 	IoT_Error_t rc;
 	ClientState clientState;
 
@@ -508,8 +656,14 @@ static IoT_Error_t _aws_iot_mqtt_internal_deliver_message(AWS_IoT_Client *pClien
 	clientState = aws_iot_mqtt_get_client_state(pClient);
 	aws_iot_mqtt_set_client_state(pClient, clientState, CLIENT_STATE_CONNECTED_WAIT_FOR_CB_RETURN);
 
-	/* Find the right message handler - indexed by topic */
+	/* Find the candidate message handlers in the topic trie, then confirm each one.
+	 * Handlers are called in index order, as with a scan of all handlers. */
+	aws_iot_mqtt_topic_trie_match(&(pClient->clientData.topicTrie), pTopicName, topicNameLen, matched);
+
 	for(itr = 0; itr < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; ++itr) {
+		if(0 == (matched[itr / 32] & (1u << (itr % 32)))) {
+			continue;
+		}
 		if(NULL != pClient->clientData.messageHandlers[itr].topicName) {
 			if(((topicNameLen == pClient->clientData.messageHandlers[itr].topicNameLen)
 				&&
@@ -529,6 +683,97 @@ static IoT_Error_t _aws_iot_mqtt_internal_deliver_message(AWS_IoT_Client *pClien
 	FUNC_EXIT_RC(rc);
 }
 
+/**
+ * @brief Pass the payload of a PUBLISH too large for the read buffer to the stream handler
+ *
+ * Each chunk is read into the read buffer after the header kept by _aws_iot_mqtt_internal_stream_begin.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pMsg Publish parameters, filled from the header and set to each chunk in turn
+ *
+ * @return An IoT Error Type defining successful/failed delivery
+ */
+static IoT_Error_t _aws_iot_mqtt_internal_stream_publish(AWS_IoT_Client *pClient, IoT_Publish_Message_Params *pMsg) {
+	ClientData *pData = &(pClient->clientData);
+	unsigned char *curData = pData->readBuf;
+	unsigned char *pChunk = pData->readBuf + pData->streamHeaderLen;
+	size_t chunkMax = pData->readBufSize - pData->streamHeaderLen;
+	size_t payloadOffset = 0;
+	size_t readLen = 0;
+	char *topicName;
+	uint16_t topicNameLen;
+	MQTTHeader header = {0};
+	ClientState clientState;
+	Timer chunkTimer;
+	IoT_Error_t rc = SUCCESS;
+#ifdef _ENABLE_THREAD_SUPPORT_
+	IoT_Error_t threadRc;
+#endif
+
+	header.byte = aws_iot_mqtt_internal_read_char(&curData);
+	pMsg->isDup = MQTT_HEADER_FIELD_DUP(header.byte);
+	pMsg->qos = (QoS) MQTT_HEADER_FIELD_QOS(header.byte);
+	pMsg->isRetained = MQTT_HEADER_FIELD_RETAIN(header.byte);
+	pMsg->id = 0;
+
+	/* Remaining length was decoded by read_packet */
+	while(0 != (aws_iot_mqtt_internal_read_char(&curData) & 128)) {
+	}
+
+	topicNameLen = aws_iot_mqtt_internal_read_uint16_t(&curData);
+	topicName = (char *) curData;
+	curData += topicNameLen;
+	if(QOS0 != pMsg->qos) {
+		pMsg->id = aws_iot_mqtt_internal_read_uint16_t(&curData);
+	}
+
+	init_timer(&chunkTimer);
+	clientState = aws_iot_mqtt_get_client_state(pClient);
+
+	while(SUCCESS == rc && payloadOffset < pData->streamPayloadLen) {
+		pMsg->payload = pChunk;
+		pMsg->payloadLen = pData->streamPayloadLen - payloadOffset;
+		if(pMsg->payloadLen > chunkMax) {
+			pMsg->payloadLen = chunkMax;
+		}
+
+		/* The rest of a packet already started gets the packet timeout, not what is left of the yield */
+		countdown_ms(&chunkTimer, pData->packetTimeoutMs);
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+		rc = aws_iot_mqtt_client_lock_mutex(pClient, &(pData->tls_read_mutex));
+		if(SUCCESS != rc) {
+			break;
+		}
+#endif
+		rc = _aws_iot_mqtt_internal_read_ahead(pClient, pChunk, pMsg->payloadLen, &chunkTimer, &readLen);
+#ifdef _ENABLE_THREAD_SUPPORT_
+		threadRc = aws_iot_mqtt_client_unlock_mutex(pClient, &(pData->tls_read_mutex));
+		if(SUCCESS == rc) {
+			rc = threadRc;
+		}
+#endif
+		if(SUCCESS != rc || readLen != pMsg->payloadLen) {
+			rc = (SUCCESS != rc) ? rc : FAILURE;
+			break;
+		}
+
+		/* Yield cannot be called while the handler runs, as for the subscribe handlers */
+		aws_iot_mqtt_set_client_state(pClient, clientState, CLIENT_STATE_CONNECTED_WAIT_FOR_CB_RETURN);
+		pData->streamHandler(pClient, topicName, topicNameLen, pMsg, payloadOffset, pData->streamPayloadLen,
+							 pData->streamHandlerData);
+		rc = aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_CONNECTED_WAIT_FOR_CB_RETURN, clientState);
+
+		payloadOffset += pMsg->payloadLen;
+	}
+
+	pData->streamHeaderLen = 0;
+	pData->streamPayloadLen = 0;
+	aws_iot_mqtt_internal_flushBuffers(pClient);
+
+	return rc;
+}
+
 static IoT_Error_t _aws_iot_mqtt_internal_handle_publish(AWS_IoT_Client *pClient, Timer *pTimer) {
 	char *topicName;
 	uint16_t topicNameLen;
@@ -542,17 +787,19 @@ static IoT_Error_t _aws_iot_mqtt_internal_handle_publish(AWS_IoT_Client *pClient
 	topicNameLen = 0;
 	len = 0;
 
-	rc = aws_iot_mqtt_internal_deserialize_publish(&msg.isDup, &msg.qos, &msg.isRetained,
-												   &msg.id, &topicName, &topicNameLen,
-												   (unsigned char **) &msg.payload, &msg.payloadLen,
-												   pClient->clientData.readBuf,
-												   pClient->clientData.readBufSize);
-
-	if(SUCCESS != rc) {
-		FUNC_EXIT_RC(rc);
+	if(0 != pClient->clientData.streamHeaderLen) {
+		rc = _aws_iot_mqtt_internal_stream_publish(pClient, &msg);
+	} else {
+		rc = aws_iot_mqtt_internal_deserialize_publish(&msg.isDup, &msg.qos, &msg.isRetained,
+													   &msg.id, &topicName, &topicNameLen,
+													   (unsigned char **) &msg.payload, &msg.payloadLen,
+													   pClient->clientData.readBuf,
+													   pClient->clientData.readBufSize);
+		if(SUCCESS == rc) {
+			rc = aws_iot_mqtt_internal_deliver_message(pClient, topicName, topicNameLen, &msg);
+		}
 	}
 
-	rc = _aws_iot_mqtt_internal_deliver_message(pClient, topicName, topicNameLen, &msg);
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
@@ -562,15 +809,20 @@ static IoT_Error_t _aws_iot_mqtt_internal_handle_publish(AWS_IoT_Client *pClient
 		FUNC_EXIT_RC(SUCCESS);
 	}
 
+	rc = aws_iot_mqtt_internal_write_buf_lock(pClient);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
 	/* Message assumed to be QoS1 since we do not support QoS2 at this time */
 	rc = aws_iot_mqtt_internal_serialize_ack(pClient->clientData.writeBuf, pClient->clientData.writeBufSize,
 											 PUBACK, 0, msg.id, &len);
-
-	if(SUCCESS != rc) {
-		FUNC_EXIT_RC(rc);
+	if(SUCCESS == rc) {
+		rc = aws_iot_mqtt_internal_send_packet(pClient, len, pTimer);
 	}
 
-	rc = aws_iot_mqtt_internal_send_packet(pClient, len, pTimer);
+	aws_iot_mqtt_internal_write_buf_unlock(pClient);
+
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
@@ -614,8 +866,13 @@ IoT_Error_t aws_iot_mqtt_internal_cycle_read(AWS_IoT_Client *pClient, Timer *pTi
 	}
 
 	switch(*pPacketType) {
-		case CONNACK:
 		case PUBACK:
+			/* An in flight publish is complete here, hide its PUBACK from a blocking publish */
+			if(aws_iot_mqtt_internal_inflight_ack(pClient)) {
+				*pPacketType = UNKNOWN;
+			}
+			break;
+		case CONNACK:
 		case SUBACK:
 		case UNSUBACK:
 			/* SDK is blocking, these responses will be forwarded to calling function to process */
@@ -649,6 +906,12 @@ IoT_Error_t aws_iot_mqtt_internal_flushBuffers( AWS_IoT_Client *pClient ) {
     return SUCCESS;
 }
 
+IoT_Error_t aws_iot_mqtt_internal_flushReadAhead( AWS_IoT_Client *pClient ) {
+    pClient->clientData.readAheadStart = 0;
+    pClient->clientData.readAheadEnd = 0;
+    return SUCCESS;
+}
+
 /* only used in single-threaded mode where one command at a time is in process */
 IoT_Error_t aws_iot_mqtt_internal_wait_for_read(AWS_IoT_Client *pClient, uint8_t packetType, Timer *pTimer) {
 	IoT_Error_t rc;
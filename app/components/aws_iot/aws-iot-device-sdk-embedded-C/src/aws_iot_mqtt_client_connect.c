@@ -83,14 +83,14 @@ typedef union {
 #if defined(REVERSED)
 	struct
 	{
-		unsigned int sessionpresent : 1;	/**< session present flag */
 		unsigned int : 7;					/**< unused */
+		unsigned int sessionpresent : 1;	/**< session present flag */
 	} bits;
 #else
 	struct {
+		unsigned int sessionpresent : 1;    /**< session present flag, bit 0 of the acknowledge flags */
 		unsigned int : 7;
 		/**< unused */
-		unsigned int sessionpresent : 1;    /**< session present flag */
 	} bits;
 #endif
 } MQTT_Connack_Header_Flags;
@@ -408,15 +408,22 @@ static IoT_Error_t _aws_iot_mqtt_internal_connect(AWS_IoT_Client *pClient, const
 	countdown_ms(&connect_timer, pClient->clientData.commandTimeoutMs);
 
 	pClient->clientData.keepAliveInterval = pClient->clientData.options.keepAliveIntervalInSec;
+
+	rc = aws_iot_mqtt_internal_write_buf_lock(pClient);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
 	rc = _aws_iot_mqtt_serialize_connect(pClient->clientData.writeBuf, pClient->clientData.writeBufSize,
 										 &(pClient->clientData.options), &len);
-	if(SUCCESS != rc || 0 >= len) {
-		FUNC_EXIT_RC(rc);
+	if(SUCCESS == rc && 0 < len) {
+		/* send the connect packet */
+		rc = aws_iot_mqtt_internal_send_packet(pClient, len, &connect_timer);
 	}
 
-	/* send the connect packet */
-	rc = aws_iot_mqtt_internal_send_packet(pClient, len, &connect_timer);
-	if(SUCCESS != rc) {
+	aws_iot_mqtt_internal_write_buf_unlock(pClient);
+
+	if(SUCCESS != rc || 0 >= len) {
 		FUNC_EXIT_RC(rc);
 	}
 
@@ -437,6 +444,12 @@ static IoT_Error_t _aws_iot_mqtt_internal_connect(AWS_IoT_Client *pClient, const
 		FUNC_EXIT_RC(connack_rc);
 	}
 
+	/* A new session holds no subscriptions, forget the ones recorded for the previous session */
+	pClient->clientStatus.isSessionPresent = (0 != sessionPresent) && !pClient->clientData.options.isCleanSession;
+	if(!pClient->clientStatus.isSessionPresent) {
+		pClient->clientData.sessionRecordCount = 0;
+	}
+
 	pClient->clientStatus.isPingOutstanding = false;
 	countdown_sec(&pClient->pingTimer, pClient->clientData.keepAliveInterval);
 
@@ -464,6 +477,7 @@ IoT_Error_t aws_iot_mqtt_connect(AWS_IoT_Client *pClient, const IoT_Client_Conne
 		FUNC_EXIT_RC(NULL_VALUE_ERROR);
 	}
     aws_iot_mqtt_internal_flushBuffers( pClient );
+    aws_iot_mqtt_internal_flushReadAhead( pClient );
 	clientState = aws_iot_mqtt_get_client_state(pClient);
 
 	if(false == _aws_iot_mqtt_is_client_state_valid_for_connect(clientState)) {
@@ -509,10 +523,17 @@ IoT_Error_t _aws_iot_mqtt_internal_disconnect(AWS_IoT_Client *pClient) {
 
 	FUNC_ENTRY;
 
+	/* Held until the network is closed, a full duplex publish must not write to it meanwhile */
+	rc = aws_iot_mqtt_internal_write_buf_lock(pClient);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
 	rc = aws_iot_mqtt_internal_serialize_zero(pClient->clientData.writeBuf, pClient->clientData.writeBufSize,
 											  DISCONNECT,
 											  &serialized_len);
 	if(SUCCESS != rc) {
+		aws_iot_mqtt_internal_write_buf_unlock(pClient);
 		FUNC_EXIT_RC(rc);
 	}
 
@@ -527,6 +548,7 @@ IoT_Error_t _aws_iot_mqtt_internal_disconnect(AWS_IoT_Client *pClient) {
 	/* Clean network stack */
 	pClient->networkStack.disconnect(&(pClient->networkStack));
 	rc = pClient->networkStack.destroy(&(pClient->networkStack));
+	aws_iot_mqtt_internal_write_buf_unlock(pClient);
 	if(0 != rc) {
 		/* TLS Destroy failed, return error */
 		FUNC_EXIT_RC(FAILURE);
@@ -614,9 +636,12 @@ IoT_Error_t aws_iot_mqtt_attempt_reconnect(AWS_IoT_Client *pClient) {
 		FUNC_EXIT_RC(NETWORK_ATTEMPTING_RECONNECT);
 	}
 
-	rc = aws_iot_mqtt_resubscribe(pClient);
-	if(SUCCESS != rc) {
-		FUNC_EXIT_RC(rc);
+	/* Subscriptions are still active in a resumed session */
+	if(!aws_iot_mqtt_is_session_present(pClient)) {
+		rc = aws_iot_mqtt_resubscribe(pClient);
+		if(SUCCESS != rc) {
+			FUNC_EXIT_RC(rc);
+		}
 	}
 
 	FUNC_EXIT_RC(NETWORK_RECONNECTED);
@@ -0,0 +1,227 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_mqtt_client_inflight.c
+ * @brief In flight window of QoS1 publishes waiting for their PUBACK
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "aws_iot_mqtt_client_common_internal.h"
+
+#define MQTT_HEADER_DUP_FLAG 0x08
+
+/* The slot is freed with the write buffer locked, the handler is called after unlocking it, it may publish again */
+static void _aws_iot_mqtt_internal_inflight_complete(AWS_IoT_Client *pClient, uint16_t packetId, IoT_Error_t result) {
+	if(NULL != pClient->clientData.inflightHandler) {
+		pClient->clientData.inflightHandler(pClient, packetId, result, pClient->clientData.inflightHandlerData);
+	}
+}
+
+void aws_iot_mqtt_internal_inflight_init(AWS_IoT_Client *pClient) {
+	uint8_t i;
+
+	pClient->clientData.inflightWindow = 0;
+	pClient->clientData.inflightRetryMs = 0;
+	pClient->clientData.inflightHandler = NULL;
+	pClient->clientData.inflightHandlerData = NULL;
+
+	for(i = 0; i < AWS_IOT_MQTT_INFLIGHT_WINDOW_MAX; i++) {
+		pClient->clientData.inflight[i].packetId = 0;
+	}
+}
+
+MQTT_Inflight_Publish *aws_iot_mqtt_internal_inflight_get_free(AWS_IoT_Client *pClient) {
+	uint8_t i;
+
+	for(i = 0; i < pClient->clientData.inflightWindow; i++) {
+		if(0 == pClient->clientData.inflight[i].packetId) {
+			return &(pClient->clientData.inflight[i]);
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Complete the in flight publish acknowledged by the PUBACK in the read buffer
+ *
+ * @param pClient Reference to the IoT Client
+ *
+ * @return true if the PUBACK belongs to an in flight publish, false if a blocking publish waits for it
+ */
+bool aws_iot_mqtt_internal_inflight_ack(AWS_IoT_Client *pClient) {
+	uint16_t packetId;
+	unsigned char dup, type;
+	bool isFound = false;
+	uint8_t i;
+
+	if(SUCCESS != aws_iot_mqtt_internal_deserialize_ack(&type, &dup, &packetId, pClient->clientData.readBuf,
+														pClient->clientData.readBufSize)) {
+		return false;
+	}
+
+	if(0 == packetId || SUCCESS != aws_iot_mqtt_internal_write_buf_lock(pClient)) {
+		return false;
+	}
+
+	for(i = 0; i < AWS_IOT_MQTT_INFLIGHT_WINDOW_MAX; i++) {
+		if(packetId == pClient->clientData.inflight[i].packetId) {
+			pClient->clientData.inflight[i].packetId = 0;
+			isFound = true;
+			break;
+		}
+	}
+
+	aws_iot_mqtt_internal_write_buf_unlock(pClient);
+
+	if(isFound) {
+		_aws_iot_mqtt_internal_inflight_complete(pClient, packetId, SUCCESS);
+	}
+
+	return isFound;
+}
+
+/**
+ * @brief Send again the in flight publishes whose PUBACK did not come in time
+ *
+ * The DUP flag is set on the retransmitted PUBLISH. After AWS_IOT_MQTT_INFLIGHT_MAX_RETRIES
+ * the publish completes with MQTT_REQUEST_TIMEOUT_ERROR.
+ *
+ * @param pClient Reference to the IoT Client
+ *
+ * @return An IoT Error Type defining successful/failed send
+ */
+IoT_Error_t aws_iot_mqtt_internal_inflight_retry(AWS_IoT_Client *pClient) {
+	MQTT_Inflight_Publish *pSlot;
+	IoT_Error_t rc = SUCCESS;
+	uint16_t packetId;
+	Timer timer;
+	uint8_t i;
+
+	for(i = 0; i < AWS_IOT_MQTT_INFLIGHT_WINDOW_MAX; i++) {
+		pSlot = &(pClient->clientData.inflight[i]);
+
+		rc = aws_iot_mqtt_internal_write_buf_lock(pClient);
+		if(SUCCESS != rc) {
+			break;
+		}
+
+		if(0 == pSlot->packetId || !has_timer_expired(&(pSlot->retryTimer))) {
+			aws_iot_mqtt_internal_write_buf_unlock(pClient);
+			continue;
+		}
+
+		if(AWS_IOT_MQTT_INFLIGHT_MAX_RETRIES <= pSlot->retries) {
+			packetId = pSlot->packetId;
+			pSlot->packetId = 0;
+			aws_iot_mqtt_internal_write_buf_unlock(pClient);
+			_aws_iot_mqtt_internal_inflight_complete(pClient, packetId, MQTT_REQUEST_TIMEOUT_ERROR);
+			continue;
+		}
+
+		/* The packet goes through the write buffer, it is the only buffer the network layer sends from */
+		memcpy(pClient->clientData.writeBuf, pSlot->packet, pSlot->len);
+		pClient->clientData.writeBuf[0] |= MQTT_HEADER_DUP_FLAG;
+
+		init_timer(&timer);
+		countdown_ms(&timer, pClient->clientData.commandTimeoutMs);
+		rc = aws_iot_mqtt_internal_send_packet(pClient, pSlot->len, &timer);
+		if(SUCCESS == rc) {
+			pSlot->retries++;
+			countdown_ms(&(pSlot->retryTimer), pClient->clientData.inflightRetryMs);
+		}
+
+		aws_iot_mqtt_internal_write_buf_unlock(pClient);
+
+		if(SUCCESS != rc) {
+			break;
+		}
+	}
+
+	return rc;
+}
+
+IoT_Error_t aws_iot_mqtt_set_inflight_window(AWS_IoT_Client *pClient, uint8_t windowSize, uint32_t retryTimeout_ms,
+											 pPublishCompleteHandler_t pHandler, void *pHandlerData) {
+	FUNC_ENTRY;
+
+	if(NULL == pClient) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(AWS_IOT_MQTT_INFLIGHT_WINDOW_MAX < windowSize || (0 < windowSize && 0 == retryTimeout_ms)) {
+		FUNC_EXIT_RC(MAX_SIZE_ERROR);
+	}
+
+	/* Slots beyond the new window would never be acknowledged */
+	if(0 != aws_iot_mqtt_get_inflight_count(pClient) && windowSize < pClient->clientData.inflightWindow) {
+		FUNC_EXIT_RC(MQTT_CLIENT_NOT_IDLE_ERROR);
+	}
+
+	pClient->clientData.inflightWindow = windowSize;
+	pClient->clientData.inflightRetryMs = retryTimeout_ms;
+	pClient->clientData.inflightHandler = pHandler;
+	pClient->clientData.inflightHandlerData = pHandlerData;
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+uint8_t aws_iot_mqtt_get_inflight_count(AWS_IoT_Client *pClient) {
+	uint8_t i, count = 0;
+
+	if(NULL == pClient) {
+		return 0;
+	}
+
+	for(i = 0; i < AWS_IOT_MQTT_INFLIGHT_WINDOW_MAX; i++) {
+		if(0 != pClient->clientData.inflight[i].packetId) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+uint32_t aws_iot_mqtt_get_inflight_wait_ms(AWS_IoT_Client *pClient) {
+	uint32_t waitMs = UINT32_MAX;
+	uint32_t leftMs;
+	uint8_t i;
+
+	if(NULL == pClient) {
+		return waitMs;
+	}
+
+	for(i = 0; i < AWS_IOT_MQTT_INFLIGHT_WINDOW_MAX; i++) {
+		if(0 == pClient->clientData.inflight[i].packetId) {
+			continue;
+		}
+
+		leftMs = has_timer_expired(&(pClient->clientData.inflight[i].retryTimer)) ?
+				 0 : left_ms(&(pClient->clientData.inflight[i].retryTimer));
+		if(leftMs < waitMs) {
+			waitMs = leftMs;
+		}
+	}
+
+	return waitMs;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -177,13 +177,108 @@ IoT_Error_t aws_iot_mqtt_internal_serialize_ack(unsigned char *pTxBuf, size_t tx
 	FUNC_EXIT_RC(SUCCESS);
 }
 
+/**
+ * @brief Send a serialized PUBLISH
+ *
+ * With an in flight window set, a QoS1 PUBLISH is copied into a free window slot,
+ * the PUBACK is matched later in yield. Called with the write buffer locked.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param offset Start of the packet in the write buffer
+ * @param len Length of the packet
+ * @param pParams Pointer to Publish Message parameters
+ * @param pTimer Timer for the whole publish operation
+ *
+ * @return An IoT Error Type defining successful/failed send
+ */
+static IoT_Error_t _aws_iot_mqtt_internal_publish_send(AWS_IoT_Client *pClient, size_t offset, size_t len,
+													   IoT_Publish_Message_Params *pParams, Timer *pTimer) {
+	IoT_Error_t rc;
+
+	MQTT_Inflight_Publish *pSlot = NULL;
+
+	FUNC_ENTRY;
+
+	if(QOS1 == pParams->qos && 0 < pClient->clientData.inflightWindow) {
+		if(AWS_IOT_MQTT_INFLIGHT_PACKET_LEN < len) {
+			FUNC_EXIT_RC(MQTT_TX_BUFFER_TOO_SHORT_ERROR);
+		}
+
+		pSlot = aws_iot_mqtt_internal_inflight_get_free(pClient);
+		if(NULL == pSlot) {
+			FUNC_EXIT_RC(MQTT_INFLIGHT_WINDOW_FULL_ERROR);
+		}
+	}
+
+	/* send the publish packet */
+	rc = aws_iot_mqtt_internal_send_packet_from(pClient, offset, len, pTimer);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	/* Keep the packet for retransmission, the PUBACK completes it later */
+	if(NULL != pSlot) {
+		memcpy(pSlot->packet, &pClient->clientData.writeBuf[offset], len);
+		pSlot->len = len;
+		pSlot->retries = 0;
+		pSlot->packetId = pParams->id;
+		init_timer(&(pSlot->retryTimer));
+		countdown_ms(&(pSlot->retryTimer), pClient->clientData.inflightRetryMs);
+	}
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+/**
+ * @brief Does the publish return without reading the network?
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pParams Pointer to Publish Message parameters
+ *
+ * @return true for QoS0 and for QoS1 with an in flight window, false if the PUBACK is waited for
+ */
+static bool _aws_iot_mqtt_is_publish_non_blocking(AWS_IoT_Client *pClient, IoT_Publish_Message_Params *pParams) {
+	return QOS0 == pParams->qos || 0 < pClient->clientData.inflightWindow;
+}
+
+/**
+ * @brief Wait for the PUBACK of a blocking QoS1 publish
+ *
+ * Called after the write buffer is unlocked, other writers may go on while waiting.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pParams Pointer to Publish Message parameters
+ * @param pTimer Timer for the whole publish operation
+ *
+ * @return An IoT Error Type defining successful/failed publish
+ */
+static IoT_Error_t _aws_iot_mqtt_internal_publish_wait_ack(AWS_IoT_Client *pClient,
+														   IoT_Publish_Message_Params *pParams, Timer *pTimer) {
+	uint16_t packet_id;
+	unsigned char dup, type;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(_aws_iot_mqtt_is_publish_non_blocking(pClient, pParams)) {
+		FUNC_EXIT_RC(SUCCESS);
+	}
+
+	rc = aws_iot_mqtt_internal_wait_for_read(pClient, PUBACK, pTimer);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	rc = aws_iot_mqtt_internal_deserialize_ack(&type, &dup, &packet_id, pClient->clientData.readBuf,
+											   pClient->clientData.readBufSize);
+
+	FUNC_EXIT_RC(rc);
+}
+
 /**
  * @brief Publish an MQTT message on a topic
  *
- * Called to publish an MQTT message on a topic.
- * @note Call is blocking.  In the case of a QoS 0 message the function returns
- * after the message was successfully passed to the TLS layer.  In the case of QoS 1
- * the function returns after the receipt of the PUBACK control packet.
+ * Called to serialize and send an MQTT PUBLISH, the PUBACK is not waited for here.
  * This is the internal function which is called by the publish API to perform the operation.
  * Not meant to be called directly as it doesn't do validations or client state changes
  *
@@ -191,22 +286,18 @@ IoT_Error_t aws_iot_mqtt_internal_serialize_ack(unsigned char *pTxBuf, size_t tx
  * @param pTopicName Topic Name to publish to
  * @param topicNameLen Length of the topic name
  * @param pParams Pointer to Publish Message parameters
+ * @param pTimer Timer for the whole publish operation
  *
  * @return An IoT Error Type defining successful/failed publish
  */
 static IoT_Error_t _aws_iot_mqtt_internal_publish(AWS_IoT_Client *pClient, const char *pTopicName,
-												  uint16_t topicNameLen, IoT_Publish_Message_Params *pParams) {
-	Timer timer;
+												  uint16_t topicNameLen, IoT_Publish_Message_Params *pParams,
+												  Timer *pTimer) {
 	uint32_t len = 0;
-	uint16_t packet_id;
-	unsigned char dup, type;
 	IoT_Error_t rc;
 
 	FUNC_ENTRY;
 
-	init_timer(&timer);
-	countdown_ms(&timer, pClient->clientData.commandTimeoutMs);
-
 	if(QOS1 == pParams->qos) {
 		pParams->id = aws_iot_mqtt_get_next_packet_id(pClient);
 	}
@@ -219,27 +310,140 @@ static IoT_Error_t _aws_iot_mqtt_internal_publish(AWS_IoT_Client *pClient, const
 		FUNC_EXIT_RC(rc);
 	}
 
-	/* send the publish packet */
-	rc = aws_iot_mqtt_internal_send_packet(pClient, len, &timer);
+	rc = _aws_iot_mqtt_internal_publish_send(pClient, 0, len, pParams, pTimer);
+
+	FUNC_EXIT_RC(rc);
+}
+
+/**
+ * @brief Publish an MQTT message on a topic, payload written in place
+ *
+ * The payload is written by pWriter into the write buffer at the offset it would have
+ * with the longest (4 byte) remaining length field. The fixed and variable headers are
+ * written afterwards, right in front of the payload, once its length is known.
+ * This is the internal function which is called by the publish in place API to perform the operation.
+ * Not meant to be called directly as it doesn't do validations or client state changes
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pTopicName Topic Name to publish to
+ * @param topicNameLen Length of the topic name
+ * @param pParams Pointer to Publish Message parameters
+ * @param pWriter Callback that writes the payload
+ * @param pWriterData Data passed to pWriter
+ * @param pTimer Timer for the whole publish operation
+ *
+ * @return An IoT Error Type defining successful/failed publish
+ */
+static IoT_Error_t _aws_iot_mqtt_internal_publish_in_place(AWS_IoT_Client *pClient, const char *pTopicName,
+														   uint16_t topicNameLen, IoT_Publish_Message_Params *pParams,
+														   pPublishPayloadWriter_t pWriter, void *pWriterData,
+														   Timer *pTimer) {
+	unsigned char *ptr;
+	unsigned char remLenBuf[MAX_NO_OF_REMAINING_LENGTH_BYTES];
+	size_t varHeaderLen, payloadOffset, start, remLenBytes;
+	uint32_t rem_len;
+	IoT_Error_t rc;
+	MQTTHeader header = {0};
+
+	FUNC_ENTRY;
+
+	varHeaderLen = (size_t) topicNameLen + 2;
+	if(QOS0 != pParams->qos) {
+		varHeaderLen += 2; /* packetId */
+	}
+
+	/* Header byte plus the longest remaining length field */
+	payloadOffset = 1 + MAX_NO_OF_REMAINING_LENGTH_BYTES + varHeaderLen;
+	if(payloadOffset >= pClient->clientData.writeBufSize) {
+		FUNC_EXIT_RC(MQTT_TX_BUFFER_TOO_SHORT_ERROR);
+	}
+
+	pParams->payloadLen = pWriter(&pClient->clientData.writeBuf[payloadOffset],
+								  pClient->clientData.writeBufSize - payloadOffset, pWriterData);
+	if(0 == pParams->payloadLen || pParams->payloadLen > pClient->clientData.writeBufSize - payloadOffset) {
+		FUNC_EXIT_RC(MQTT_TX_BUFFER_TOO_SHORT_ERROR);
+	}
+	pParams->payload = &pClient->clientData.writeBuf[payloadOffset];
+
+	if(QOS1 == pParams->qos) {
+		pParams->id = aws_iot_mqtt_get_next_packet_id(pClient);
+	}
+
+	rc = aws_iot_mqtt_internal_init_header(&header, PUBLISH, pParams->qos, 0, pParams->isRetained);
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
 
-	/* Wait for ack if QoS1 */
-	if(QOS1 == pParams->qos) {
-		rc = aws_iot_mqtt_internal_wait_for_read(pClient, PUBACK, &timer);
-		if(SUCCESS != rc) {
-			FUNC_EXIT_RC(rc);
-		}
+	/* Headers end where the payload starts, find where they begin */
+	rem_len = (uint32_t) (varHeaderLen + pParams->payloadLen);
+	remLenBytes = aws_iot_mqtt_internal_write_len_to_buffer(remLenBuf, rem_len);
+	start = MAX_NO_OF_REMAINING_LENGTH_BYTES - remLenBytes;
 
-		rc = aws_iot_mqtt_internal_deserialize_ack(&type, &dup, &packet_id, pClient->clientData.readBuf,
-												   pClient->clientData.readBufSize);
-		if(SUCCESS != rc) {
-			FUNC_EXIT_RC(rc);
-		}
+	ptr = &pClient->clientData.writeBuf[start];
+	aws_iot_mqtt_internal_write_char(&ptr, header.byte); /* write header */
+	memcpy(ptr, remLenBuf, remLenBytes); /* write remaining length */
+	ptr += remLenBytes;
+	aws_iot_mqtt_internal_write_utf8_string(&ptr, pTopicName, topicNameLen);
+	if(QOS0 != pParams->qos) {
+		aws_iot_mqtt_internal_write_uint_16(&ptr, pParams->id);
 	}
 
-	FUNC_EXIT_RC(SUCCESS);
+	rc = _aws_iot_mqtt_internal_publish_send(pClient, start, payloadOffset + pParams->payloadLen - start, pParams,
+											 pTimer);
+
+	FUNC_EXIT_RC(rc);
+}
+
+/**
+ * @brief Publish an MQTT message with the write buffer locked
+ *
+ * The PUBLISH is serialized and sent with the write buffer locked, the PUBACK of a
+ * blocking QoS1 publish is waited for after unlocking it.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pTopicName Topic Name to publish to
+ * @param topicNameLen Length of the topic name
+ * @param pParams Pointer to Publish Message parameters
+ * @param pWriter Callback that writes the payload in place, NULL to copy pParams->payload
+ * @param pWriterData Data passed to pWriter
+ *
+ * @return An IoT Error Type defining successful/failed publish
+ */
+static IoT_Error_t _aws_iot_mqtt_internal_publish_locked(AWS_IoT_Client *pClient, const char *pTopicName,
+														 uint16_t topicNameLen, IoT_Publish_Message_Params *pParams,
+														 pPublishPayloadWriter_t pWriter, void *pWriterData) {
+	Timer timer;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	init_timer(&timer);
+	countdown_ms(&timer, pClient->clientData.commandTimeoutMs);
+
+	rc = aws_iot_mqtt_internal_write_buf_lock(pClient);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	/* Checked again under the lock, a full duplex publish does not hold the client state */
+	if(!aws_iot_mqtt_is_client_connected(pClient)) {
+		rc = NETWORK_DISCONNECTED_ERROR;
+	} else if(NULL == pWriter) {
+		rc = _aws_iot_mqtt_internal_publish(pClient, pTopicName, topicNameLen, pParams, &timer);
+	} else {
+		rc = _aws_iot_mqtt_internal_publish_in_place(pClient, pTopicName, topicNameLen, pParams, pWriter,
+													 pWriterData, &timer);
+	}
+
+	aws_iot_mqtt_internal_write_buf_unlock(pClient);
+
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	rc = _aws_iot_mqtt_internal_publish_wait_ack(pClient, pParams, &timer);
+
+	FUNC_EXIT_RC(rc);
 }
 
 /**
@@ -248,7 +452,8 @@ static IoT_Error_t _aws_iot_mqtt_internal_publish(AWS_IoT_Client *pClient, const
  * Called to publish an MQTT message on a topic.
  * @note Call is blocking.  In the case of a QoS 0 message the function returns
  * after the message was successfully passed to the TLS layer.  In the case of QoS 1
- * the function returns after the receipt of the PUBACK control packet.
+ * the function returns after the receipt of the PUBACK control packet, or right after
+ * sending when an in flight window is set, see aws_iot_mqtt_set_inflight_window.
  * This is the outer function which does the validations and calls the internal publish above
  * to perform the actual operation. It is also responsible for client state changes
  *
@@ -274,6 +479,77 @@ IoT_Error_t aws_iot_mqtt_publish(AWS_IoT_Client *pClient, const char *pTopicName
 		FUNC_EXIT_RC(NETWORK_DISCONNECTED_ERROR);
 	}
 
+#ifdef _ENABLE_THREAD_SUPPORT_
+	/* Nothing is read from the network, the publish can run beside yield */
+	if(pClient->clientData.isFullDuplexEnabled && _aws_iot_mqtt_is_publish_non_blocking(pClient, pParams)) {
+		pubRc = _aws_iot_mqtt_internal_publish_locked(pClient, pTopicName, topicNameLen, pParams, NULL, NULL);
+		FUNC_EXIT_RC(pubRc);
+	}
+#endif
+
+	clientState = aws_iot_mqtt_get_client_state(pClient);
+	if(CLIENT_STATE_CONNECTED_IDLE != clientState && CLIENT_STATE_CONNECTED_WAIT_FOR_CB_RETURN != clientState) {
+		FUNC_EXIT_RC(MQTT_CLIENT_NOT_IDLE_ERROR);
+	}
+
+	rc = aws_iot_mqtt_set_client_state(pClient, clientState, CLIENT_STATE_CONNECTED_PUBLISH_IN_PROGRESS);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	pubRc = _aws_iot_mqtt_internal_publish_locked(pClient, pTopicName, topicNameLen, pParams, NULL, NULL);
+
+	rc = aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_CONNECTED_PUBLISH_IN_PROGRESS, clientState);
+	if(SUCCESS == pubRc && SUCCESS != rc) {
+		pubRc = rc;
+	}
+
+	FUNC_EXIT_RC(pubRc);
+}
+
+/**
+ * @brief Publish an MQTT message on a topic without copying the payload
+ *
+ * Called to publish an MQTT message on a topic, the payload is written by pWriter
+ * directly into the client write buffer.
+ * @note Call is blocking, see aws_iot_mqtt_publish.
+ * This is the outer function which does the validations and calls the internal publish in place
+ * above to perform the actual operation. It is also responsible for client state changes
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pTopicName Topic Name to publish to
+ * @param topicNameLen Length of the topic name
+ * @param pParams Pointer to Publish Message parameters
+ * @param pWriter Callback that writes the payload and returns its length
+ * @param pWriterData Data passed to pWriter
+ *
+ * @return An IoT Error Type defining successful/failed publish
+ */
+IoT_Error_t aws_iot_mqtt_publish_in_place(AWS_IoT_Client *pClient, const char *pTopicName, uint16_t topicNameLen,
+										  IoT_Publish_Message_Params *pParams, pPublishPayloadWriter_t pWriter,
+										  void *pWriterData) {
+	IoT_Error_t rc, pubRc;
+	ClientState clientState;
+
+	FUNC_ENTRY;
+
+	if(NULL == pClient || NULL == pTopicName || 0 == topicNameLen || NULL == pParams || NULL == pWriter) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(!aws_iot_mqtt_is_client_connected(pClient)) {
+		FUNC_EXIT_RC(NETWORK_DISCONNECTED_ERROR);
+	}
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+	/* Nothing is read from the network, the publish can run beside yield */
+	if(pClient->clientData.isFullDuplexEnabled && _aws_iot_mqtt_is_publish_non_blocking(pClient, pParams)) {
+		pubRc = _aws_iot_mqtt_internal_publish_locked(pClient, pTopicName, topicNameLen, pParams, pWriter,
+													  pWriterData);
+		FUNC_EXIT_RC(pubRc);
+	}
+#endif
+
 	clientState = aws_iot_mqtt_get_client_state(pClient);
 	if(CLIENT_STATE_CONNECTED_IDLE != clientState && CLIENT_STATE_CONNECTED_WAIT_FOR_CB_RETURN != clientState) {
 		FUNC_EXIT_RC(MQTT_CLIENT_NOT_IDLE_ERROR);
@@ -284,7 +560,8 @@ IoT_Error_t aws_iot_mqtt_publish(AWS_IoT_Client *pClient, const char *pTopicName
 		FUNC_EXIT_RC(rc);
 	}
 
-	pubRc = _aws_iot_mqtt_internal_publish(pClient, pTopicName, topicNameLen, pParams);
+	pubRc = _aws_iot_mqtt_internal_publish_locked(pClient, pTopicName, topicNameLen, pParams, pWriter,
+												  pWriterData);
 
 	rc = aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_CONNECTED_PUBLISH_IN_PROGRESS, clientState);
 	if(SUCCESS == pubRc && SUCCESS != rc) {
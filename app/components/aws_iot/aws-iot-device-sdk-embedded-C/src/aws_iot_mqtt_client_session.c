@@ -0,0 +1,137 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_mqtt_client_session.c
+ * @brief Record of the subscriptions held by a persistent MQTT session
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "aws_iot_mqtt_client_common_internal.h"
+
+#define SESSION_HASH_OFFSET 2166136261u
+#define SESSION_HASH_PRIME 16777619u
+
+/**
+ * @brief Hash of a subscription, FNV-1a over the topic filter followed by the QoS
+ *
+ * @param pTopicName Topic filter
+ * @param topicNameLen Length of the topic filter
+ * @param qos Requested QoS
+ *
+ * @return Hash of the subscription
+ */
+uint32_t aws_iot_mqtt_internal_session_hash(const char *pTopicName, uint16_t topicNameLen, QoS qos) {
+	uint32_t hash = SESSION_HASH_OFFSET;
+	uint16_t i;
+
+	for(i = 0; i < topicNameLen; i++) {
+		hash = (hash ^ (unsigned char) pTopicName[i]) * SESSION_HASH_PRIME;
+	}
+
+	return (hash ^ (unsigned char) qos) * SESSION_HASH_PRIME;
+}
+
+bool aws_iot_mqtt_internal_session_find(AWS_IoT_Client *pClient, uint32_t hash) {
+	uint16_t i;
+
+	for(i = 0; i < pClient->clientData.sessionRecordCount; i++) {
+		if(hash == pClient->clientData.sessionRecord[i]) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void aws_iot_mqtt_internal_session_add(AWS_IoT_Client *pClient, uint32_t hash) {
+	if(aws_iot_mqtt_internal_session_find(pClient, hash) ||
+	   AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS <= pClient->clientData.sessionRecordCount) {
+		return;
+	}
+
+	pClient->clientData.sessionRecord[pClient->clientData.sessionRecordCount++] = hash;
+}
+
+void aws_iot_mqtt_internal_session_remove(AWS_IoT_Client *pClient, uint32_t hash) {
+	uint16_t i;
+
+	for(i = 0; i < pClient->clientData.sessionRecordCount; i++) {
+		if(hash == pClient->clientData.sessionRecord[i]) {
+			/* Order does not matter, the last entry fills the gap */
+			pClient->clientData.sessionRecordCount--;
+			pClient->clientData.sessionRecord[i] =
+					pClient->clientData.sessionRecord[pClient->clientData.sessionRecordCount];
+			return;
+		}
+	}
+}
+
+bool aws_iot_mqtt_is_session_present(AWS_IoT_Client *pClient) {
+	if(NULL == pClient) {
+		return false;
+	}
+
+	return pClient->clientStatus.isSessionPresent;
+}
+
+IoT_Error_t aws_iot_mqtt_set_session_record(AWS_IoT_Client *pClient, const uint32_t *pRecord, uint16_t count) {
+	uint16_t i;
+
+	FUNC_ENTRY;
+
+	if(NULL == pClient || (0 < count && NULL == pRecord)) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS < count) {
+		FUNC_EXIT_RC(MAX_SIZE_ERROR);
+	}
+
+	if(aws_iot_mqtt_is_client_connected(pClient)) {
+		FUNC_EXIT_RC(NETWORK_ALREADY_CONNECTED_ERROR);
+	}
+
+	pClient->clientData.sessionRecordCount = 0;
+	for(i = 0; i < count; i++) {
+		aws_iot_mqtt_internal_session_add(pClient, pRecord[i]);
+	}
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+uint16_t aws_iot_mqtt_get_session_record(AWS_IoT_Client *pClient, uint32_t *pRecord, uint16_t maxCount) {
+	uint16_t count;
+
+	if(NULL == pClient || NULL == pRecord) {
+		return 0;
+	}
+
+	count = pClient->clientData.sessionRecordCount;
+	if(count > maxCount) {
+		count = maxCount;
+	}
+
+	memcpy(pRecord, pClient->clientData.sessionRecord, count * sizeof(uint32_t));
+
+	return count;
+}
+
+#ifdef __cplusplus
+}
+#endif
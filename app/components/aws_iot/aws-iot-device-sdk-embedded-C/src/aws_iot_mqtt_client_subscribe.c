@@ -41,6 +41,8 @@ extern "C" {
 
 #include "aws_iot_mqtt_client_common_internal.h"
 
+#define MQTT_SUBACK_FAILURE 0x80
+
 /**
   * Serializes the supplied subscribe data into the supplied buffer, ready for sending
   * @param pTxBuf the buffer into which the packet will be serialized
@@ -160,7 +162,7 @@ static IoT_Error_t _aws_iot_mqtt_deserialize_suback(uint16_t *pPacketId, uint32_
 
 	*pGrantedQoSCount = 0;
 	while(curData < endData) {
-		if(*pGrantedQoSCount > maxExpectedQoSCount) {
+		if(*pGrantedQoSCount >= maxExpectedQoSCount) {
 			FUNC_EXIT_RC(FAILURE);
 		}
 		pGrantedQoSs[(*pGrantedQoSCount)++] = (QoS) aws_iot_mqtt_internal_read_char(&curData);
@@ -185,74 +187,72 @@ static uint32_t _aws_iot_mqtt_get_free_message_handler_index(AWS_IoT_Client *pCl
 }
 
 /**
- * @brief Subscribe to an MQTT topic.
+ * @brief Send a SUBSCRIBE for several topic filters and wait for its SUBACK
  *
- * Called to send a subscribe message to the broker requesting a subscription
- * to an MQTT topic. This is the internal function which is called by the
- * subscribe API to perform the operation. Not meant to be called directly as
- * it doesn't do validations or client state changes
- * @note Call is blocking.  The call returns after the receipt of the SUBACK control packet.
- * @warning pTopicName and pApplicationHandlerData need to be static in memory.
+ * The acknowledged subscriptions are added to the session record.
  *
  * @param pClient Reference to the IoT Client
- * @param pTopicName Topic Name to publish to. pTopicName needs to be static in memory since 
- *     no malloc are performed by the SDK
- * @param topicNameLen Length of the topic name
- * @param pApplicationHandler_t Reference to the handler function for this subscription
- * @param pApplicationHandlerData Point to data passed to the callback. 
- *    pApplicationHandlerData also needs to be static in memory  since no malloc are performed by the SDK
+ * @param count Number of topic filters, at most AWS_IOT_MQTT_SUBSCRIBE_BATCH_MAX
+ * @param pTopicNameList Topic filters to subscribe to
+ * @param pTopicNameLenList Length of each topic filter
+ * @param pQoSList Requested QoS of each topic filter
+ * @param pRefusedList Returned, true for each topic filter refused by the broker
+ * @param pTimer Timer for the whole subscribe operation
  *
- * @return An IoT Error Type defining successful/failed subscription
+ * @return An IoT Error Type defining successful/failed subscription,
+ *     MQTT_SUBSCRIBE_REFUSED_ERROR if the broker refused some filters
  */
-static IoT_Error_t _aws_iot_mqtt_internal_subscribe(AWS_IoT_Client *pClient, const char *pTopicName,
-													uint16_t topicNameLen, QoS qos,
-													pApplicationHandler_t pApplicationHandler,
-													void *pApplicationHandlerData) {
+static IoT_Error_t _aws_iot_mqtt_internal_send_subscribe(AWS_IoT_Client *pClient, uint32_t count,
+														 const char **pTopicNameList, uint16_t *pTopicNameLenList,
+														 QoS *pQoSList, bool *pRefusedList, Timer *pTimer) {
 	uint16_t txPacketId, rxPacketId;
-	uint32_t serializedLen, indexOfFreeMessageHandler, count;
+	uint32_t serializedLen, grantedCount, itr;
 	IoT_Error_t rc;
-	Timer timer;
-	QoS grantedQoS[3] = {QOS0, QOS0, QOS0};
+	QoS grantedQoS[AWS_IOT_MQTT_SUBSCRIBE_BATCH_MAX];
 
 	FUNC_ENTRY;
-	init_timer(&timer);
-	countdown_ms(&timer, pClient->clientData.commandTimeoutMs);
 
 	serializedLen = 0;
-	count = 0;
-	txPacketId = aws_iot_mqtt_get_next_packet_id(pClient);
+	grantedCount = 0;
 	rxPacketId = 0;
 
-	rc = _aws_iot_mqtt_serialize_subscribe(pClient->clientData.writeBuf, pClient->clientData.writeBufSize, 0,
-										   txPacketId, 1, &pTopicName, &topicNameLen, &qos, &serializedLen);
+	rc = aws_iot_mqtt_internal_write_buf_lock(pClient);
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
 
-	indexOfFreeMessageHandler = _aws_iot_mqtt_get_free_message_handler_index(pClient);
-	if(AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS <= indexOfFreeMessageHandler) {
-		FUNC_EXIT_RC(MQTT_MAX_SUBSCRIPTIONS_REACHED_ERROR);
+	txPacketId = aws_iot_mqtt_get_next_packet_id(pClient);
+	rc = _aws_iot_mqtt_serialize_subscribe(pClient->clientData.writeBuf, pClient->clientData.writeBufSize, 0,
+										   txPacketId, count, pTopicNameList, pTopicNameLenList, pQoSList,
+										   &serializedLen);
+	if(SUCCESS == rc) {
+		/* send the subscribe packet */
+		rc = aws_iot_mqtt_internal_send_packet(pClient, serializedLen, pTimer);
 	}
 
-	/* send the subscribe packet */
-	rc = aws_iot_mqtt_internal_send_packet(pClient, serializedLen, &timer);
+	aws_iot_mqtt_internal_write_buf_unlock(pClient);
+
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
 
 	/* wait for suback */
-	rc = aws_iot_mqtt_internal_wait_for_read(pClient, SUBACK, &timer);
+	rc = aws_iot_mqtt_internal_wait_for_read(pClient, SUBACK, pTimer);
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
 
-	/* Granted QoS can be 0, 1 or 2 */
-	rc = _aws_iot_mqtt_deserialize_suback(&rxPacketId, 1, &count, grantedQoS, pClient->clientData.readBuf,
-										  pClient->clientData.readBufSize);
+	/* Granted QoS can be 0, 1 or 2, one return code per topic filter in the order of the SUBSCRIBE */
+	rc = _aws_iot_mqtt_deserialize_suback(&rxPacketId, count, &grantedCount, grantedQoS,
+										  pClient->clientData.readBuf, pClient->clientData.readBufSize);
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
 
+	if(count != grantedCount) {
+		FUNC_EXIT_RC(FAILURE);
+	}
+
 	/* TODO : Figure out how to test this before activating this check */
 	//if(txPacketId != rxPacketId) {
 	/* Different SUBACK received than expected. Return error
@@ -260,17 +260,174 @@ static IoT_Error_t _aws_iot_mqtt_internal_subscribe(AWS_IoT_Client *pClient, con
 	//	return RX_MESSAGE_INVALID_ERROR;
 	//}
 
-	pClient->clientData.messageHandlers[indexOfFreeMessageHandler].topicName =
-			pTopicName;
-	pClient->clientData.messageHandlers[indexOfFreeMessageHandler].topicNameLen =
-			topicNameLen;
-	pClient->clientData.messageHandlers[indexOfFreeMessageHandler].pApplicationHandler =
-			pApplicationHandler;
-	pClient->clientData.messageHandlers[indexOfFreeMessageHandler].pApplicationHandlerData =
-			pApplicationHandlerData;
-	pClient->clientData.messageHandlers[indexOfFreeMessageHandler].qos = qos;
+	for(itr = 0; itr < count; itr++) {
+		pRefusedList[itr] = (MQTT_SUBACK_FAILURE == (unsigned char) grantedQoS[itr]);
+		if(pRefusedList[itr]) {
+			rc = MQTT_SUBSCRIBE_REFUSED_ERROR;
+			continue;
+		}
 
-	FUNC_EXIT_RC(SUCCESS);
+		aws_iot_mqtt_internal_session_add(pClient, aws_iot_mqtt_internal_session_hash(pTopicNameList[itr],
+																					  pTopicNameLenList[itr],
+																					  pQoSList[itr]));
+	}
+
+	FUNC_EXIT_RC(rc);
+}
+
+/**
+ * @brief Subscribe to several MQTT topics.
+ *
+ * Called to send a subscribe message to the broker requesting subscriptions
+ * to MQTT topics. This is the internal function which is called by the
+ * subscribe APIs to perform the operation. Not meant to be called directly as
+ * it doesn't do validations or client state changes
+ * @note Call is blocking.  The call returns after the receipt of the SUBACK control packet,
+ * or right away when the resumed session already holds all the subscriptions.
+ * @warning The topic names and handler data of the filters need to be static in memory.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pFilters Topic filters to subscribe to
+ * @param count Number of filters, at most AWS_IOT_MQTT_SUBSCRIBE_BATCH_MAX
+ *
+ * @return An IoT Error Type defining successful/failed subscription
+ */
+static IoT_Error_t _aws_iot_mqtt_internal_subscribe(AWS_IoT_Client *pClient, const IoT_Subscribe_Filter *pFilters,
+													uint8_t count) {
+	uint32_t handlerIndex[AWS_IOT_MQTT_SUBSCRIBE_BATCH_MAX];
+	const char *pTopicNameList[AWS_IOT_MQTT_SUBSCRIBE_BATCH_MAX];
+	uint16_t topicNameLenList[AWS_IOT_MQTT_SUBSCRIBE_BATCH_MAX];
+	QoS qosList[AWS_IOT_MQTT_SUBSCRIBE_BATCH_MAX];
+	bool refusedList[AWS_IOT_MQTT_SUBSCRIBE_BATCH_MAX] = {false};
+	uint8_t sendIndex[AWS_IOT_MQTT_SUBSCRIBE_BATCH_MAX];
+	uint8_t itr, sendCount = 0;
+	uint32_t freeIndex = 0;
+	IoT_Error_t rc = SUCCESS;
+	Timer timer;
+
+	FUNC_ENTRY;
+	init_timer(&timer);
+	countdown_ms(&timer, pClient->clientData.commandTimeoutMs);
+
+	/* Reserve the trie paths before subscribing, the handlers stay inactive until topicName is set */
+	for(itr = 0; itr < count && SUCCESS == rc; itr++) {
+		while(AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS > freeIndex &&
+			  NULL != pClient->clientData.messageHandlers[freeIndex].topicName) {
+			freeIndex++;
+		}
+
+		if(AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS <= freeIndex) {
+			rc = MQTT_MAX_SUBSCRIPTIONS_REACHED_ERROR;
+			break;
+		}
+
+		handlerIndex[itr] = freeIndex++;
+		rc = aws_iot_mqtt_topic_trie_insert(&(pClient->clientData.topicTrie), (uint16_t) handlerIndex[itr],
+											pFilters[itr].pTopicName, pFilters[itr].topicNameLen);
+	}
+
+	if(SUCCESS != rc) {
+		/* Entry itr was not inserted, whatever the reason */
+		while(0 < itr--) {
+			aws_iot_mqtt_topic_trie_remove(&(pClient->clientData.topicTrie), (uint16_t) handlerIndex[itr]);
+		}
+		FUNC_EXIT_RC(rc);
+	}
+
+	/* A resumed session already holds the recorded subscriptions, only the handlers are registered */
+	for(itr = 0; itr < count; itr++) {
+		if(pClient->clientStatus.isSessionPresent &&
+		   aws_iot_mqtt_internal_session_find(pClient, aws_iot_mqtt_internal_session_hash(pFilters[itr].pTopicName,
+																						  pFilters[itr].topicNameLen,
+																						  pFilters[itr].qos))) {
+			continue;
+		}
+
+		sendIndex[sendCount] = itr;
+		pTopicNameList[sendCount] = pFilters[itr].pTopicName;
+		topicNameLenList[sendCount] = pFilters[itr].topicNameLen;
+		qosList[sendCount] = pFilters[itr].qos;
+		sendCount++;
+	}
+
+	if(0 < sendCount) {
+		rc = _aws_iot_mqtt_internal_send_subscribe(pClient, sendCount, pTopicNameList, topicNameLenList, qosList,
+												   refusedList, &timer);
+		if(SUCCESS != rc && MQTT_SUBSCRIBE_REFUSED_ERROR != rc) {
+			for(itr = 0; itr < count; itr++) {
+				aws_iot_mqtt_topic_trie_remove(&(pClient->clientData.topicTrie), (uint16_t) handlerIndex[itr]);
+			}
+			FUNC_EXIT_RC(rc);
+		}
+
+		/* Refused filters are not registered, the other ones are subscribed */
+		for(itr = 0; itr < sendCount; itr++) {
+			if(refusedList[itr]) {
+				aws_iot_mqtt_topic_trie_remove(&(pClient->clientData.topicTrie),
+											   (uint16_t) handlerIndex[sendIndex[itr]]);
+				handlerIndex[sendIndex[itr]] = AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS;
+			}
+		}
+	}
+
+	for(itr = 0; itr < count; itr++) {
+		if(AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS <= handlerIndex[itr]) {
+			continue;
+		}
+
+		pClient->clientData.messageHandlers[handlerIndex[itr]].topicName = pFilters[itr].pTopicName;
+		pClient->clientData.messageHandlers[handlerIndex[itr]].topicNameLen = pFilters[itr].topicNameLen;
+		pClient->clientData.messageHandlers[handlerIndex[itr]].pApplicationHandler =
+				pFilters[itr].pApplicationHandler;
+		pClient->clientData.messageHandlers[handlerIndex[itr]].pApplicationHandlerData =
+				pFilters[itr].pApplicationHandlerData;
+		pClient->clientData.messageHandlers[handlerIndex[itr]].qos = pFilters[itr].qos;
+	}
+
+	FUNC_EXIT_RC(rc);
+}
+
+/**
+ * @brief Subscribe to MQTT topics.
+ *
+ * This is the outer function which does the client state changes and calls the
+ * internal subscribe above to perform the actual operation.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pFilters Topic filters to subscribe to
+ * @param count Number of filters
+ *
+ * @return An IoT Error Type defining successful/failed subscription
+ */
+static IoT_Error_t _aws_iot_mqtt_subscribe_filters(AWS_IoT_Client *pClient, const IoT_Subscribe_Filter *pFilters,
+												   uint8_t count) {
+	ClientState clientState;
+	IoT_Error_t rc, subRc;
+
+	FUNC_ENTRY;
+
+	if(!aws_iot_mqtt_is_client_connected(pClient)) {
+		FUNC_EXIT_RC(NETWORK_DISCONNECTED_ERROR);
+	}
+
+	clientState = aws_iot_mqtt_get_client_state(pClient);
+	if(CLIENT_STATE_CONNECTED_IDLE != clientState && CLIENT_STATE_CONNECTED_WAIT_FOR_CB_RETURN != clientState) {
+		FUNC_EXIT_RC(MQTT_CLIENT_NOT_IDLE_ERROR);
+	}
+
+	rc = aws_iot_mqtt_set_client_state(pClient, clientState, CLIENT_STATE_CONNECTED_SUBSCRIBE_IN_PROGRESS);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	subRc = _aws_iot_mqtt_internal_subscribe(pClient, pFilters, count);
+
+	rc = aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_CONNECTED_SUBSCRIBE_IN_PROGRESS, clientState);
+	if(SUCCESS == subRc && SUCCESS != rc) {
+		subRc = rc;
+	}
+
+	FUNC_EXIT_RC(subRc);
 }
 
 /**
@@ -295,8 +452,7 @@ static IoT_Error_t _aws_iot_mqtt_internal_subscribe(AWS_IoT_Client *pClient, con
  */
 IoT_Error_t aws_iot_mqtt_subscribe(AWS_IoT_Client *pClient, const char *pTopicName, uint16_t topicNameLen,
 								   QoS qos, pApplicationHandler_t pApplicationHandler, void *pApplicationHandlerData) {
-	ClientState clientState;
-	IoT_Error_t rc, subRc;
+	IoT_Subscribe_Filter filter;
 
 	FUNC_ENTRY;
 
@@ -304,29 +460,36 @@ IoT_Error_t aws_iot_mqtt_subscribe(AWS_IoT_Client *pClient, const char *pTopicNa
 		FUNC_EXIT_RC(NULL_VALUE_ERROR);
 	}
 
-	if(!aws_iot_mqtt_is_client_connected(pClient)) {
-		FUNC_EXIT_RC(NETWORK_DISCONNECTED_ERROR);
-	}
+	filter.pTopicName = pTopicName;
+	filter.topicNameLen = topicNameLen;
+	filter.qos = qos;
+	filter.pApplicationHandler = pApplicationHandler;
+	filter.pApplicationHandlerData = pApplicationHandlerData;
 
-	clientState = aws_iot_mqtt_get_client_state(pClient);
-	if(CLIENT_STATE_CONNECTED_IDLE != clientState && CLIENT_STATE_CONNECTED_WAIT_FOR_CB_RETURN != clientState) {
-		FUNC_EXIT_RC(MQTT_CLIENT_NOT_IDLE_ERROR);
-	}
+	FUNC_EXIT_RC(_aws_iot_mqtt_subscribe_filters(pClient, &filter, 1));
+}
 
-	rc = aws_iot_mqtt_set_client_state(pClient, clientState, CLIENT_STATE_CONNECTED_SUBSCRIBE_IN_PROGRESS);
-	if(SUCCESS != rc) {
-		FUNC_EXIT_RC(rc);
+IoT_Error_t aws_iot_mqtt_subscribe_batch(AWS_IoT_Client *pClient, const IoT_Subscribe_Filter *pFilters,
+										 uint8_t count) {
+	uint8_t itr;
+
+	FUNC_ENTRY;
+
+	if(NULL == pClient || NULL == pFilters) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
 	}
 
-	subRc = _aws_iot_mqtt_internal_subscribe(pClient, pTopicName, topicNameLen, qos,
-											 pApplicationHandler, pApplicationHandlerData);
+	if(0 == count || AWS_IOT_MQTT_SUBSCRIBE_BATCH_MAX < count) {
+		FUNC_EXIT_RC(MAX_SIZE_ERROR);
+	}
 
-	rc = aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_CONNECTED_SUBSCRIBE_IN_PROGRESS, clientState);
-	if(SUCCESS == subRc && SUCCESS != rc) {
-		subRc = rc;
+	for(itr = 0; itr < count; itr++) {
+		if(NULL == pFilters[itr].pTopicName || NULL == pFilters[itr].pApplicationHandler) {
+			FUNC_EXIT_RC(NULL_VALUE_ERROR);
+		}
 	}
 
-	FUNC_EXIT_RC(subRc);
+	FUNC_EXIT_RC(_aws_iot_mqtt_subscribe_filters(pClient, pFilters, count));
 }
 
 /**
@@ -343,57 +506,48 @@ IoT_Error_t aws_iot_mqtt_subscribe(AWS_IoT_Client *pClient, const char *pTopicNa
  * @return An IoT Error Type defining successful/failed subscription
  */
 static IoT_Error_t _aws_iot_mqtt_internal_resubscribe(AWS_IoT_Client *pClient) {
-	uint16_t packetId;
-	uint32_t len, count, existingSubCount, itr;
-	IoT_Error_t rc;
+	const char *pTopicNameList[AWS_IOT_MQTT_SUBSCRIBE_BATCH_MAX];
+	uint16_t topicNameLenList[AWS_IOT_MQTT_SUBSCRIBE_BATCH_MAX];
+	QoS qosList[AWS_IOT_MQTT_SUBSCRIBE_BATCH_MAX];
+	bool refusedList[AWS_IOT_MQTT_SUBSCRIBE_BATCH_MAX];
+	uint32_t existingSubCount, itr, batchCount;
+	IoT_Error_t rc, resubRc = SUCCESS;
 	Timer timer;
-	QoS grantedQoS[3] = {QOS0, QOS0, QOS0};
 
 	FUNC_ENTRY;
 
-	packetId = 0;
-	len = 0;
-	count = 0;
 	existingSubCount = _aws_iot_mqtt_get_free_message_handler_index(pClient);
+	batchCount = 0;
 
+	/* Subscriptions are packed AWS_IOT_MQTT_SUBSCRIBE_BATCH_MAX per SUBSCRIBE */
 	for(itr = 0; itr < existingSubCount; itr++) {
-		if(pClient->clientData.messageHandlers[itr].topicName == NULL) {
+		if(pClient->clientData.messageHandlers[itr].topicName != NULL) {
+			pTopicNameList[batchCount] = pClient->clientData.messageHandlers[itr].topicName;
+			topicNameLenList[batchCount] = pClient->clientData.messageHandlers[itr].topicNameLen;
+			qosList[batchCount] = pClient->clientData.messageHandlers[itr].qos;
+			batchCount++;
+		}
+
+		if(0 == batchCount || (AWS_IOT_MQTT_SUBSCRIBE_BATCH_MAX > batchCount && itr + 1 < existingSubCount)) {
 			continue;
 		}
 
 		init_timer(&timer);
 		countdown_ms(&timer, pClient->clientData.commandTimeoutMs);
 
-		rc = _aws_iot_mqtt_serialize_subscribe(pClient->clientData.writeBuf, pClient->clientData.writeBufSize, 0,
-											   aws_iot_mqtt_get_next_packet_id(pClient), 1,
-											   &(pClient->clientData.messageHandlers[itr].topicName),
-											   &(pClient->clientData.messageHandlers[itr].topicNameLen),
-											   &(pClient->clientData.messageHandlers[itr].qos), &len);
-		if(SUCCESS != rc) {
-			FUNC_EXIT_RC(rc);
-		}
-
-		/* send the subscribe packet */
-		rc = aws_iot_mqtt_internal_send_packet(pClient, len, &timer);
-		if(SUCCESS != rc) {
-			FUNC_EXIT_RC(rc);
-		}
-
-		/* wait for suback */
-		rc = aws_iot_mqtt_internal_wait_for_read(pClient, SUBACK, &timer);
-		if(SUCCESS != rc) {
+		/* A refused filter keeps its handler, the remaining batches are still sent */
+		rc = _aws_iot_mqtt_internal_send_subscribe(pClient, batchCount, pTopicNameList, topicNameLenList, qosList,
+												   refusedList, &timer);
+		if(MQTT_SUBSCRIBE_REFUSED_ERROR == rc) {
+			resubRc = rc;
+		} else if(SUCCESS != rc) {
 			FUNC_EXIT_RC(rc);
 		}
 
-		/* Granted QoS can be 0, 1 or 2 */
-		rc = _aws_iot_mqtt_deserialize_suback(&packetId, 1, &count, grantedQoS, pClient->clientData.readBuf,
-											  pClient->clientData.readBufSize);
-		if(SUCCESS != rc) {
-			FUNC_EXIT_RC(rc);
-		}
+		batchCount = 0;
 	}
 
-	FUNC_EXIT_RC(SUCCESS);
+	FUNC_EXIT_RC(resubRc);
 }
 
 /**
@@ -0,0 +1,245 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_mqtt_client_topic_trie.c
+ * @brief Topic filter trie used to find the message handlers of an incoming PUBLISH
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <string.h>
+
+#include "aws_iot_mqtt_client_topic_trie.h"
+
+#define TRIE_NONE (-1)
+
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME 16777619u
+
+static uint32_t _aws_iot_mqtt_topic_trie_hash(const char *pLevel, uint16_t levelLen) {
+	uint32_t hash = FNV_OFFSET_BASIS;
+	uint16_t i;
+
+	for(i = 0; i < levelLen; i++) {
+		hash = (hash ^ (uint8_t) pLevel[i]) * FNV_PRIME;
+	}
+
+	return hash;
+}
+
+/* Returns the length of the level starting at pLevel */
+static uint16_t _aws_iot_mqtt_topic_trie_level_len(const char *pLevel, const char *pEnd) {
+	const char *pSep = memchr(pLevel, '/', (size_t) (pEnd - pLevel));
+
+	return (uint16_t) (((NULL != pSep) ? pSep : pEnd) - pLevel);
+}
+
+static void _aws_iot_mqtt_topic_trie_mark(const AWS_IoT_Topic_Trie *pTrie, int16_t node, uint32_t *pMatched,
+										  uint32_t *pCount) {
+	int16_t handler;
+
+	for(handler = pTrie->nodes[node].firstHandler; TRIE_NONE != handler; handler = pTrie->nextHandler[handler]) {
+		if(0 == (pMatched[handler / 32] & (1u << (handler % 32)))) {
+			pMatched[handler / 32] |= (1u << (handler % 32));
+			(*pCount)++;
+		}
+	}
+}
+
+/* Drops one reference from node and its parents, unlinking nodes no filter goes through anymore */
+static void _aws_iot_mqtt_topic_trie_release(AWS_IoT_Topic_Trie *pTrie, int16_t node) {
+	int16_t parent;
+	int16_t *pLink;
+
+	while(TRIE_NONE != node) {
+		parent = pTrie->nodes[node].parent;
+
+		if(0 == --pTrie->nodes[node].refCount) {
+			pLink = (TRIE_NONE == parent) ? &pTrie->firstRoot : &pTrie->nodes[parent].firstChild;
+			while(*pLink != node) {
+				pLink = &pTrie->nodes[*pLink].nextSibling;
+			}
+			*pLink = pTrie->nodes[node].nextSibling;
+		}
+
+		node = parent;
+	}
+}
+
+static int16_t _aws_iot_mqtt_topic_trie_alloc(AWS_IoT_Topic_Trie *pTrie) {
+	int16_t i;
+
+	for(i = 0; i < AWS_IOT_MQTT_TOPIC_TRIE_NUM_NODES; i++) {
+		if(0 == pTrie->nodes[i].refCount) {
+			return i;
+		}
+	}
+
+	return TRIE_NONE;
+}
+
+static void _aws_iot_mqtt_topic_trie_match_level(const AWS_IoT_Topic_Trie *pTrie, int16_t first,
+												 const char *pLevel, const char *pEnd,
+												 uint32_t *pMatched, uint32_t *pCount) {
+	uint16_t levelLen = _aws_iot_mqtt_topic_trie_level_len(pLevel, pEnd);
+	uint32_t levelHash = _aws_iot_mqtt_topic_trie_hash(pLevel, levelLen);
+	bool isLast = (pLevel + levelLen == pEnd);
+	const AWS_IoT_Topic_Trie_Node *pNode;
+	int16_t node;
+
+	for(node = first; TRIE_NONE != node; node = pNode->nextSibling) {
+		pNode = &pTrie->nodes[node];
+
+		if('#' == pNode->wildcard) {
+			/* Matches this level and all the levels below */
+			_aws_iot_mqtt_topic_trie_mark(pTrie, node, pMatched, pCount);
+		} else if('+' == pNode->wildcard || (levelHash == pNode->levelHash && levelLen == pNode->levelLen)) {
+			if(isLast) {
+				_aws_iot_mqtt_topic_trie_mark(pTrie, node, pMatched, pCount);
+			} else {
+				_aws_iot_mqtt_topic_trie_match_level(pTrie, pNode->firstChild, pLevel + levelLen + 1, pEnd,
+													 pMatched, pCount);
+			}
+		}
+	}
+}
+
+void aws_iot_mqtt_topic_trie_init(AWS_IoT_Topic_Trie *pTrie) {
+	uint32_t i;
+
+	if(NULL == pTrie) {
+		return;
+	}
+
+	memset(pTrie->nodes, 0, sizeof(pTrie->nodes));
+	for(i = 0; i < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; i++) {
+		pTrie->handlerNode[i] = TRIE_NONE;
+		pTrie->nextHandler[i] = TRIE_NONE;
+	}
+	pTrie->firstRoot = TRIE_NONE;
+}
+
+IoT_Error_t aws_iot_mqtt_topic_trie_insert(AWS_IoT_Topic_Trie *pTrie, uint16_t handlerIndex,
+										   const char *pTopicFilter, uint16_t topicFilterLen) {
+	const char *pLevel, *pEnd;
+	uint16_t levelLen;
+	uint32_t levelHash;
+	char wildcard;
+	int16_t parent, node, *pFirst;
+
+	if(NULL == pTrie || NULL == pTopicFilter || AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS <= handlerIndex) {
+		return NULL_VALUE_ERROR;
+	}
+
+	aws_iot_mqtt_topic_trie_remove(pTrie, handlerIndex);
+
+	/* The filter is matched as a C string, a length covering the terminating NUL is accepted */
+	pLevel = pTopicFilter;
+	pEnd = pTopicFilter + strnlen(pTopicFilter, topicFilterLen);
+	parent = TRIE_NONE;
+
+	while(1) {
+		levelLen = _aws_iot_mqtt_topic_trie_level_len(pLevel, pEnd);
+		levelHash = _aws_iot_mqtt_topic_trie_hash(pLevel, levelLen);
+		wildcard = (1 == levelLen && ('+' == pLevel[0] || '#' == pLevel[0])) ? pLevel[0] : 0;
+		pFirst = (TRIE_NONE == parent) ? &pTrie->firstRoot : &pTrie->nodes[parent].firstChild;
+
+		for(node = *pFirst; TRIE_NONE != node; node = pTrie->nodes[node].nextSibling) {
+			if(wildcard == pTrie->nodes[node].wildcard && levelHash == pTrie->nodes[node].levelHash &&
+			   levelLen == pTrie->nodes[node].levelLen) {
+				break;
+			}
+		}
+
+		if(TRIE_NONE == node) {
+			node = _aws_iot_mqtt_topic_trie_alloc(pTrie);
+			if(TRIE_NONE == node) {
+				/* Undo the levels added so far */
+				_aws_iot_mqtt_topic_trie_release(pTrie, parent);
+				return MQTT_MAX_SUBSCRIPTIONS_REACHED_ERROR;
+			}
+
+			pTrie->nodes[node].levelHash = levelHash;
+			pTrie->nodes[node].levelLen = levelLen;
+			pTrie->nodes[node].wildcard = wildcard;
+			pTrie->nodes[node].parent = parent;
+			pTrie->nodes[node].firstChild = TRIE_NONE;
+			pTrie->nodes[node].firstHandler = TRIE_NONE;
+			pTrie->nodes[node].nextSibling = *pFirst;
+			*pFirst = node;
+		}
+
+		pTrie->nodes[node].refCount++;
+		parent = node;
+
+		if(pLevel + levelLen == pEnd) {
+			break;
+		}
+		pLevel += levelLen + 1;
+	}
+
+	pTrie->handlerNode[handlerIndex] = node;
+	pTrie->nextHandler[handlerIndex] = pTrie->nodes[node].firstHandler;
+	pTrie->nodes[node].firstHandler = (int16_t) handlerIndex;
+
+	return SUCCESS;
+}
+
+void aws_iot_mqtt_topic_trie_remove(AWS_IoT_Topic_Trie *pTrie, uint16_t handlerIndex) {
+	int16_t node, *pLink;
+
+	if(NULL == pTrie || AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS <= handlerIndex) {
+		return;
+	}
+
+	node = pTrie->handlerNode[handlerIndex];
+	if(TRIE_NONE == node) {
+		return;
+	}
+
+	pLink = &pTrie->nodes[node].firstHandler;
+	while(*pLink != (int16_t) handlerIndex) {
+		pLink = &pTrie->nextHandler[*pLink];
+	}
+	*pLink = pTrie->nextHandler[handlerIndex];
+
+	pTrie->handlerNode[handlerIndex] = TRIE_NONE;
+	pTrie->nextHandler[handlerIndex] = TRIE_NONE;
+
+	_aws_iot_mqtt_topic_trie_release(pTrie, node);
+}
+
+uint32_t aws_iot_mqtt_topic_trie_match(const AWS_IoT_Topic_Trie *pTrie, const char *pTopicName,
+									   uint16_t topicNameLen, uint32_t *pMatched) {
+	uint32_t count = 0;
+
+	if(NULL == pTrie || NULL == pTopicName || NULL == pMatched) {
+		return 0;
+	}
+
+	memset(pMatched, 0, AWS_IOT_MQTT_TOPIC_TRIE_MATCH_WORDS * sizeof(uint32_t));
+	_aws_iot_mqtt_topic_trie_match_level(pTrie, pTrie->firstRoot, pTopicName, pTopicName + topicNameLen,
+										 pMatched, &count);
+
+	return count;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -160,15 +160,21 @@ static IoT_Error_t _aws_iot_mqtt_internal_unsubscribe(AWS_IoT_Client *pClient, c
 	init_timer(&timer);
 	countdown_ms(&timer, pClient->clientData.commandTimeoutMs);
 
+	rc = aws_iot_mqtt_internal_write_buf_lock(pClient);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
 	rc = _aws_iot_mqtt_serialize_unsubscribe(pClient->clientData.writeBuf, pClient->clientData.writeBufSize, 0,
 											 aws_iot_mqtt_get_next_packet_id(pClient), 1, &pTopicFilter,
 											 &topicFilterLen, &serializedLen);
-	if(SUCCESS != rc) {
-		FUNC_EXIT_RC(rc);
+	if(SUCCESS == rc) {
+		/* send the unsubscribe packet */
+		rc = aws_iot_mqtt_internal_send_packet(pClient, serializedLen, &timer);
 	}
 
-	/* send the unsubscribe packet */
-	rc = aws_iot_mqtt_internal_send_packet(pClient, serializedLen, &timer);
+	aws_iot_mqtt_internal_write_buf_unlock(pClient);
+
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
@@ -187,7 +193,10 @@ static IoT_Error_t _aws_iot_mqtt_internal_unsubscribe(AWS_IoT_Client *pClient, c
 	for(i = 0; i < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; ++i) {
 		if(pClient->clientData.messageHandlers[i].topicName != NULL &&
 		   (strcmp(pClient->clientData.messageHandlers[i].topicName, pTopicFilter) == 0)) {
+			aws_iot_mqtt_internal_session_remove(pClient, aws_iot_mqtt_internal_session_hash(
+					pTopicFilter, topicFilterLen, pClient->clientData.messageHandlers[i].qos));
 			pClient->clientData.messageHandlers[i].topicName = NULL;
+			aws_iot_mqtt_topic_trie_remove(&(pClient->clientData.topicTrie), (uint16_t) i);
 			/* We don't want to break here, in case the same topic is registered
              * with 2 callbacks. Unlikely scenario */
 		}
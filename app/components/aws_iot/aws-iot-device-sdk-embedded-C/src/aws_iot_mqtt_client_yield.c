@@ -46,8 +46,10 @@ extern "C" {
   */
 static void _aws_iot_mqtt_force_client_disconnect(AWS_IoT_Client *pClient) {
 	pClient->clientStatus.clientState = CLIENT_STATE_DISCONNECTED_ERROR;
+	(void)aws_iot_mqtt_internal_write_buf_lock(pClient);
 	pClient->networkStack.disconnect(&(pClient->networkStack));
 	pClient->networkStack.destroy(&(pClient->networkStack));
+	aws_iot_mqtt_internal_write_buf_unlock(pClient);
 }
 
 static IoT_Error_t _aws_iot_mqtt_handle_disconnect(AWS_IoT_Client *pClient) {
@@ -137,14 +139,22 @@ static IoT_Error_t _aws_iot_mqtt_keep_alive(AWS_IoT_Client *pClient) {
 
 	countdown_ms(&timer, pClient->clientData.commandTimeoutMs);
 	serialized_len = 0;
+
+	rc = aws_iot_mqtt_internal_write_buf_lock(pClient);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
 	rc = aws_iot_mqtt_internal_serialize_zero(pClient->clientData.writeBuf, pClient->clientData.writeBufSize,
 											  PINGREQ, &serialized_len);
 	if(SUCCESS != rc) {
+		aws_iot_mqtt_internal_write_buf_unlock(pClient);
 		FUNC_EXIT_RC(rc);
 	}
 
 	/* send the ping packet */
 	rc = aws_iot_mqtt_internal_send_packet(pClient, serialized_len, &timer);
+	aws_iot_mqtt_internal_write_buf_unlock(pClient);
 	if(SUCCESS != rc) {
 		//If sending a PING fails we can no longer determine if we are connected.  In this case we decide we are disconnected and begin reconnection attempts
 		rc = _aws_iot_mqtt_handle_disconnect(pClient);
@@ -206,6 +216,10 @@ static IoT_Error_t _aws_iot_mqtt_internal_yield(AWS_IoT_Client *pClient, uint32_
 		yieldRc = aws_iot_mqtt_internal_cycle_read(pClient, &timer, &packet_type);
 		if(SUCCESS == yieldRc) {
 			yieldRc = _aws_iot_mqtt_keep_alive(pClient);
+			if(SUCCESS == yieldRc && SUCCESS != aws_iot_mqtt_internal_inflight_retry(pClient)) {
+				/* Same as a failed ping, the connection is considered lost */
+				yieldRc = _aws_iot_mqtt_handle_disconnect(pClient);
+			}
 		} else {
 			// SSL read and write errors are terminal, connection must be closed and retried
 			if(NETWORK_SSL_READ_ERROR == yieldRc || NETWORK_SSL_WRITE_ERROR == yieldRc || NETWORK_SSL_WRITE_TIMEOUT_ERROR == yieldRc) {
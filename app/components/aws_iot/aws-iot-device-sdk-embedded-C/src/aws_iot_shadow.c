@@ -36,7 +36,7 @@ const ShadowInitParameters_t ShadowInitParametersDefault = {(char *) AWS_IOT_MQT
 															NULL, false, NULL};
 
 const ShadowConnectParameters_t ShadowConnectParametersDefault = {(char *) AWS_IOT_MY_THING_NAME, (char *) "toybox",
-								  (char *) AWS_IOT_MQTT_CLIENT_ID, 0, NULL};
+								  (char *) AWS_IOT_MQTT_CLIENT_ID, 0, NULL, true};
 
 static char deleteAcceptedTopic[MAX_SHADOW_TOPIC_LENGTH_BYTES];
 
@@ -121,7 +121,7 @@ IoT_Error_t aws_iot_shadow_connect(AWS_IoT_Client *pClient, const ShadowConnectP
 
 	ConnectParams.keepAliveIntervalInSec = 60; // NOTE: Temporary fix
 	ConnectParams.MQTTVersion = MQTT_3_1_1;
-	ConnectParams.isCleanSession = true;
+	ConnectParams.isCleanSession = pParams->isCleanSession;
 	ConnectParams.isWillMsgPresent = false;
 	ConnectParams.pClientID = pParams->pMqttClientId;
 	ConnectParams.clientIDLen = pParams->mqttClientIdLen;
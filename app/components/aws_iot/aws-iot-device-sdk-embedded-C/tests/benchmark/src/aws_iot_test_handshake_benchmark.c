@@ -0,0 +1,197 @@
+/*
+* Copyright 2015-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_test_handshake_benchmark.c
+ * @brief TLS handshake cost of a set of device credentials against a local TLS server
+ *
+ * Runs full handshakes with the cipher suites and curve offered by the device and
+ * reports the average wall time, client CPU time and bytes on the wire. Run it once
+ * with RSA and once with ECC credentials to compare them.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mbedtls/net_sockets.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/x509_crt.h"
+#include "mbedtls/pk.h"
+#include "mbedtls/error.h"
+
+#define BENCHMARK_DEFAULT_ITERATIONS 20
+
+/* Same offer as the device, see network_mbedtls_wrapper.c of the port */
+static const int benchmarkCiphersuites[] = {
+	MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256,
+	MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256,
+	0
+};
+
+static const mbedtls_ecp_group_id benchmarkCurves[] = {
+	MBEDTLS_ECP_DP_SECP256R1,
+	MBEDTLS_ECP_DP_NONE
+};
+
+/* Socket that counts the bytes of the handshake */
+typedef struct {
+	mbedtls_net_context fd;
+	size_t sent;
+	size_t received;
+} BenchmarkBio;
+
+static int benchmark_send(void *ctx, const unsigned char *buf, size_t len) {
+	BenchmarkBio *pBio = (BenchmarkBio *) ctx;
+	int ret = mbedtls_net_send(&(pBio->fd), buf, len);
+
+	if(0 < ret) {
+		pBio->sent += (size_t) ret;
+	}
+	return ret;
+}
+
+static int benchmark_recv(void *ctx, unsigned char *buf, size_t len) {
+	BenchmarkBio *pBio = (BenchmarkBio *) ctx;
+	int ret = mbedtls_net_recv(&(pBio->fd), buf, len);
+
+	if(0 < ret) {
+		pBio->received += (size_t) ret;
+	}
+	return ret;
+}
+
+static double benchmark_elapsed_ms(const struct timespec *pStart, const struct timespec *pEnd) {
+	return (double) (pEnd->tv_sec - pStart->tv_sec) * 1000.0 + (double) (pEnd->tv_nsec - pStart->tv_nsec) / 1000000.0;
+}
+
+static void benchmark_print_error(const char *pWhat, int ret) {
+	char buf[128];
+
+	mbedtls_strerror(ret, buf, sizeof(buf));
+	printf("%s failed: -0x%04x %s\n", pWhat, (unsigned int) -ret, buf);
+}
+
+int main(int argc, char **argv) {
+	mbedtls_entropy_context entropy;
+	mbedtls_ctr_drbg_context ctrDrbg;
+	mbedtls_ssl_config conf;
+	mbedtls_ssl_context ssl;
+	mbedtls_x509_crt cacert;
+	mbedtls_x509_crt clicert;
+	mbedtls_pk_context pkey;
+	BenchmarkBio bio;
+	struct timespec wallStart, wallEnd, cpuStart, cpuEnd;
+	double wallMs = 0, cpuMs = 0;
+	size_t sent = 0, received = 0;
+	const char *pSuite = "none";
+	int iterations = BENCHMARK_DEFAULT_ITERATIONS;
+	int i, ret;
+
+	if(6 > argc) {
+		printf("Usage: %s <host> <port> <rootCA> <deviceCert> <deviceKey> [iterations]\n", argv[0]);
+		return 1;
+	}
+	if(7 <= argc) {
+		iterations = atoi(argv[6]);
+	}
+
+	mbedtls_entropy_init(&entropy);
+	mbedtls_ctr_drbg_init(&ctrDrbg);
+	mbedtls_ssl_config_init(&conf);
+	mbedtls_x509_crt_init(&cacert);
+	mbedtls_x509_crt_init(&clicert);
+	mbedtls_pk_init(&pkey);
+
+	/* Credentials are parsed once, as the device credential cache does */
+	if(0 != (ret = mbedtls_ctr_drbg_seed(&ctrDrbg, mbedtls_entropy_func, &entropy, NULL, 0)) ||
+	   0 > (ret = mbedtls_x509_crt_parse_file(&cacert, argv[3])) ||
+	   0 != (ret = mbedtls_x509_crt_parse_file(&clicert, argv[4])) ||
+	   0 != (ret = mbedtls_pk_parse_keyfile(&pkey, argv[5], ""))) {
+		benchmark_print_error("Setup", ret);
+		return 1;
+	}
+
+	if(0 != (ret = mbedtls_ssl_config_defaults(&conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+											   MBEDTLS_SSL_PRESET_DEFAULT)) ||
+	   0 != (ret = mbedtls_ssl_conf_own_cert(&conf, &clicert, &pkey))) {
+		benchmark_print_error("Config", ret);
+		return 1;
+	}
+	mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+	mbedtls_ssl_conf_ca_chain(&conf, &cacert, NULL);
+	mbedtls_ssl_conf_rng(&conf, mbedtls_ctr_drbg_random, &ctrDrbg);
+	mbedtls_ssl_conf_min_version(&conf, MBEDTLS_SSL_MAJOR_VERSION_3, MBEDTLS_SSL_MINOR_VERSION_3);
+	mbedtls_ssl_conf_ciphersuites(&conf, benchmarkCiphersuites);
+	mbedtls_ssl_conf_curves(&conf, benchmarkCurves);
+
+	for(i = 0; i < iterations; i++) {
+		memset(&bio, 0, sizeof(bio));
+		mbedtls_net_init(&(bio.fd));
+		mbedtls_ssl_init(&ssl);
+
+		if(0 != (ret = mbedtls_net_connect(&(bio.fd), argv[1], argv[2], MBEDTLS_NET_PROTO_TCP)) ||
+		   0 != (ret = mbedtls_ssl_setup(&ssl, &conf)) ||
+		   0 != (ret = mbedtls_ssl_set_hostname(&ssl, argv[1]))) {
+			benchmark_print_error("Connect", ret);
+			return 1;
+		}
+		mbedtls_ssl_set_bio(&ssl, &bio, benchmark_send, benchmark_recv, NULL);
+
+		/* A new context each time, no session is resumed */
+		clock_gettime(CLOCK_MONOTONIC, &wallStart);
+		clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpuStart);
+		while(0 != (ret = mbedtls_ssl_handshake(&ssl))) {
+			if(MBEDTLS_ERR_SSL_WANT_READ != ret && MBEDTLS_ERR_SSL_WANT_WRITE != ret) {
+				benchmark_print_error("Handshake", ret);
+				return 1;
+			}
+		}
+		clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpuEnd);
+		clock_gettime(CLOCK_MONOTONIC, &wallEnd);
+
+		wallMs += benchmark_elapsed_ms(&wallStart, &wallEnd);
+		cpuMs += benchmark_elapsed_ms(&cpuStart, &cpuEnd);
+		sent += bio.sent;
+		received += bio.received;
+		pSuite = mbedtls_ssl_get_ciphersuite(&ssl);
+
+		mbedtls_ssl_close_notify(&ssl);
+		mbedtls_ssl_free(&ssl);
+		mbedtls_net_free(&(bio.fd));
+	}
+
+	printf("Credentials : %s (%s)\n", argv[4], mbedtls_pk_get_name(&pkey));
+	printf("Ciphersuite : %s\n", pSuite);
+	printf("Handshakes  : %d\n", iterations);
+	if(0 < iterations) {
+		printf("Wall time   : %.2f ms\n", wallMs / iterations);
+		printf("CPU time    : %.2f ms\n", cpuMs / iterations);
+		printf("Bytes sent  : %lu\n", (unsigned long) (sent / iterations));
+		printf("Bytes recv  : %lu\n", (unsigned long) (received / iterations));
+	}
+
+	mbedtls_pk_free(&pkey);
+	mbedtls_x509_crt_free(&clicert);
+	mbedtls_x509_crt_free(&cacert);
+	mbedtls_ssl_config_free(&conf);
+	mbedtls_ctr_drbg_free(&ctrDrbg);
+	mbedtls_entropy_free(&entropy);
+
+	return 0;
+}
@@ -61,6 +61,8 @@ void setTLSRxBufferForDoubleSuback(char *topicName, size_t topicNameLen, QoS qos
 
 void setTLSRxBufferForSubFail(void);
 
+void setTLSRxBufferForMultiSuback(const unsigned char *pReturnCodes, uint8_t count);
+
 void setTLSRxBufferWithMsgOnSubscribedTopic(char *topicName, size_t topicNameLen, QoS qos,
 											IoT_Publish_Message_Params params, char *pMsg);
 
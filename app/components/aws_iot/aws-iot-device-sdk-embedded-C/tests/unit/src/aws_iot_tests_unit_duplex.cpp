@@ -0,0 +1,34 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_duplex.cpp
+ * @brief IoT Client Unit Testing - Full Duplex Multi-threaded Stress Tests
+ */
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness_c.h>
+
+TEST_GROUP_C(DuplexTests){
+	TEST_GROUP_C_SETUP_WRAPPER(DuplexTests)
+	TEST_GROUP_C_TEARDOWN_WRAPPER(DuplexTests)
+};
+
+/* L:1 - QoS0 publishes of several threads run beside yield */
+TEST_GROUP_C_WRAPPER(DuplexTests, Qos0PublishBesideYield)
+/* L:2 - In flight QoS1 publishes run beside yield, yield completes them */
+TEST_GROUP_C_WRAPPER(DuplexTests, InflightPublishBesideYield)
+/* L:3 - Subscribe takes turns with yield while publishes go on */
+TEST_GROUP_C_WRAPPER(DuplexTests, SubscribeTakesTurnsWithYield)
@@ -0,0 +1,524 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_duplex_helper.c
+ * @brief IoT Client Unit Testing - Full Duplex Multi-threaded Stress Tests Helper
+ *
+ * Based on the multithreading integration test. A yield thread reads the network and calls
+ * the subscribe handler while several threads publish. The network is a loopback broker:
+ * it answers CONNECT, SUBSCRIBE, PINGREQ and QoS1 PUBLISH, and echoes every PUBLISH back.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <CppUTest/TestHarness_c.h>
+
+#include "aws_iot_mqtt_client_interface.h"
+#include "aws_iot_mqtt_client_common_internal.h"
+#include "aws_iot_tests_unit_helper_functions.h"
+#include "aws_iot_tests_unit_mock_tls_params.h"
+#include "aws_iot_log.h"
+
+#define DUPLEX_PUB_THREAD_COUNT 4
+#define DUPLEX_PUBLISH_COUNT 500
+#define DUPLEX_PAYLOAD_LEN 32
+#define DUPLEX_WIRE_LEN (64 * 1024)
+#define DUPLEX_DRAIN_TIMEOUT_MS 5000
+
+typedef struct ThreadData {
+	int threadId;
+	QoS qos;
+} ThreadData;
+
+static IoT_Client_Init_Params initParams;
+static IoT_Client_Connect_Params connectParams;
+static AWS_IoT_Client iotClient;
+
+static char duplexTopicFilter[] = "sdk/duplex/#";
+static char otherTopicFilter[] = "sdk/other/#";
+
+/* Loopback broker, bytes on their way to the client */
+static pthread_mutex_t wireMutex = PTHREAD_MUTEX_INITIALIZER;
+static unsigned char wireBuf[DUPLEX_WIRE_LEN];
+static size_t wireStart;
+static size_t wireEnd;
+
+static volatile bool terminateYieldThread;
+static int writersInside;
+static uint32_t concurrentWriteCount;
+static uint32_t malformedCount;
+static uint32_t wireOverflowCount;
+static uint32_t brokerSubscribeCount;
+static uint32_t brokerPublishCount;
+static uint32_t notIdleCount;
+static uint32_t publishErrorCount;
+static uint32_t yieldErrorCount;
+static uint32_t receivedCount;
+static uint32_t unexpectedCount;
+static uint32_t completeCount;
+static uint32_t completeErrorCount;
+static unsigned int countArray[DUPLEX_PUB_THREAD_COUNT][DUPLEX_PUBLISH_COUNT];
+
+static void wirePush(const unsigned char *pData, size_t len) {
+	pthread_mutex_lock(&wireMutex);
+	if(wireEnd + len > DUPLEX_WIRE_LEN) {
+		wireOverflowCount++;
+	} else {
+		memcpy(&wireBuf[wireEnd], pData, len);
+		wireEnd += len;
+	}
+	pthread_mutex_unlock(&wireMutex);
+}
+
+static size_t wirePop(unsigned char *pDest, size_t len) {
+	size_t count;
+
+	pthread_mutex_lock(&wireMutex);
+	count = wireEnd - wireStart;
+	if(count > len) {
+		count = len;
+	}
+	memcpy(pDest, &wireBuf[wireStart], count);
+	wireStart += count;
+	if(wireStart == wireEnd) {
+		wireStart = 0;
+		wireEnd = 0;
+	}
+	pthread_mutex_unlock(&wireMutex);
+
+	return count;
+}
+
+/* Payload is "Thread <t> Msg <i>", the topic ends with the same thread number */
+static bool parseDuplexPayload(const char *pPayload, size_t payloadLen, int *pThread, int *pMsg) {
+	char buf[DUPLEX_PAYLOAD_LEN];
+
+	if(payloadLen >= sizeof(buf)) {
+		return false;
+	}
+	memcpy(buf, pPayload, payloadLen);
+	buf[payloadLen] = '\0';
+
+	return 2 == sscanf(buf, "Thread %d Msg %d", pThread, pMsg) && 0 <= *pThread &&
+		   DUPLEX_PUB_THREAD_COUNT > *pThread && 0 <= *pMsg && DUPLEX_PUBLISH_COUNT > *pMsg;
+}
+
+static void brokerPublish(const unsigned char *pMsg, size_t len, size_t varHeaderStart) {
+	unsigned char echo[128];
+	unsigned char ack[4];
+	uint16_t topicLen, packetId = 0;
+	size_t payloadStart, payloadLen, echoLen;
+	QoS qos = (QoS) ((pMsg[0] >> 1) & 0x03);
+	int thread, msg;
+
+	topicLen = (uint16_t) ((pMsg[varHeaderStart] << 8) | pMsg[varHeaderStart + 1]);
+	payloadStart = varHeaderStart + 2 + topicLen;
+	if(QOS0 != qos) {
+		packetId = (uint16_t) ((pMsg[payloadStart] << 8) | pMsg[payloadStart + 1]);
+		payloadStart += 2;
+	}
+	payloadLen = len - payloadStart;
+
+	/* The payload must belong to the topic, a mix of two packets shows a shared buffer overwritten */
+	if(0 == strncmp((const char *) &pMsg[varHeaderStart + 2], "sdk/duplex/", 11)) {
+		if(!parseDuplexPayload((const char *) &pMsg[payloadStart], payloadLen, &thread, &msg) ||
+		   thread != atoi((const char *) &pMsg[varHeaderStart + 2 + 11])) {
+			malformedCount++;
+			return;
+		}
+	}
+	brokerPublishCount++;
+
+	if(QOS1 == qos) {
+		ack[0] = 0x40;
+		ack[1] = 0x02;
+		ack[2] = (unsigned char) (packetId >> 8);
+		ack[3] = (unsigned char) (packetId & 0xFF);
+		wirePush(ack, sizeof(ack));
+	}
+
+	/* Echo as QoS0, the client subscribed to what it publishes */
+	echoLen = 2 + 2 + topicLen + payloadLen;
+	if(echoLen > sizeof(echo) || 127 < echoLen - 2) {
+		malformedCount++;
+		return;
+	}
+	echo[0] = 0x30;
+	echo[1] = (unsigned char) (echoLen - 2);
+	memcpy(&echo[2], &pMsg[varHeaderStart], 2 + topicLen);
+	memcpy(&echo[4 + topicLen], &pMsg[payloadStart], payloadLen);
+	wirePush(echo, echoLen);
+}
+
+static void brokerSubscribe(const unsigned char *pMsg, size_t len, size_t varHeaderStart) {
+	unsigned char suback[4 + AWS_IOT_MQTT_SUBSCRIBE_BATCH_MAX];
+	size_t pos = varHeaderStart + 2;
+	size_t count = 0;
+	uint16_t filterLen;
+
+	while(pos + 2 < len && AWS_IOT_MQTT_SUBSCRIBE_BATCH_MAX > count) {
+		filterLen = (uint16_t) ((pMsg[pos] << 8) | pMsg[pos + 1]);
+		pos += 2 + filterLen;
+		suback[4 + count] = pMsg[pos]; /* grant the requested QoS */
+		pos++;
+		count++;
+	}
+	brokerSubscribeCount++;
+
+	suback[0] = 0x90;
+	suback[1] = (unsigned char) (2 + count);
+	suback[2] = pMsg[varHeaderStart];
+	suback[3] = pMsg[varHeaderStart + 1];
+	wirePush(suback, 4 + count);
+}
+
+static IoT_Error_t brokerWrite(Network *pNetwork, unsigned char *pMsg, size_t len, Timer *pTimer,
+							   size_t *written_len) {
+	static const unsigned char connack[] = {0x20, 0x02, 0x00, 0x00};
+	static const unsigned char pingresp[] = {0xD0, 0x00};
+	size_t remLen = 0, multiplier = 1, pos = 1;
+
+	IOT_UNUSED(pNetwork);
+	IOT_UNUSED(pTimer);
+
+	if(1 < __sync_add_and_fetch(&writersInside, 1)) {
+		__sync_fetch_and_add(&concurrentWriteCount, 1);
+	}
+
+	do {
+		remLen += (pMsg[pos] & 0x7F) * multiplier;
+		multiplier *= 128;
+	} while(0 != (pMsg[pos++] & 0x80) && pos < len);
+
+	/* One write per packet, the SDK sends the whole packet from the write buffer */
+	if(pos + remLen != len) {
+		malformedCount++;
+	} else {
+		switch(pMsg[0] >> 4) {
+			case CONNECT:
+				wirePush(connack, sizeof(connack));
+				break;
+			case SUBSCRIBE:
+				brokerSubscribe(pMsg, len, pos);
+				break;
+			case PUBLISH:
+				brokerPublish(pMsg, len, pos);
+				break;
+			case PINGREQ:
+				wirePush(pingresp, sizeof(pingresp));
+				break;
+			default:
+				break;
+		}
+	}
+
+	__sync_sub_and_fetch(&writersInside, 1);
+
+	*written_len = len;
+	return SUCCESS;
+}
+
+static IoT_Error_t brokerReadAvailable(Network *pNetwork, unsigned char *pMsg, size_t len, Timer *pTimer,
+									   size_t *read_len) {
+	IOT_UNUSED(pNetwork);
+	IOT_UNUSED(pTimer);
+
+	*read_len = wirePop(pMsg, len);
+	if(0 == *read_len) {
+		/* Like a socket read timeout, do not spin */
+		usleep(100);
+		return NETWORK_SSL_NOTHING_TO_READ;
+	}
+
+	return SUCCESS;
+}
+
+static IoT_Error_t brokerRead(Network *pNetwork, unsigned char *pMsg, size_t len, Timer *pTimer, size_t *read_len) {
+	IOT_UNUSED(pNetwork);
+
+	*read_len = 0;
+	while(*read_len < len && !has_timer_expired(pTimer)) {
+		*read_len += wirePop(pMsg + *read_len, len - *read_len);
+	}
+
+	return (0 == *read_len) ? NETWORK_SSL_NOTHING_TO_READ : SUCCESS;
+}
+
+static void duplexCallbackHandler(AWS_IoT_Client *pClient, char *topicName, uint16_t topicNameLen,
+								  IoT_Publish_Message_Params *params, void *pData) {
+	int thread, msg;
+
+	IOT_UNUSED(pClient);
+	IOT_UNUSED(topicName);
+	IOT_UNUSED(topicNameLen);
+	IOT_UNUSED(pData);
+
+	if(parseDuplexPayload((const char *) params->payload, params->payloadLen, &thread, &msg)) {
+		countArray[thread][msg]++;
+		receivedCount++;
+	} else {
+		unexpectedCount++;
+	}
+}
+
+static void duplexCompleteHandler(AWS_IoT_Client *pClient, uint16_t packetId, IoT_Error_t result, void *pData) {
+	IOT_UNUSED(pClient);
+	IOT_UNUSED(packetId);
+	IOT_UNUSED(pData);
+
+	if(SUCCESS == result) {
+		completeCount++;
+	} else {
+		completeErrorCount++;
+	}
+}
+
+static void *yieldThread(void *pArg) {
+	IoT_Error_t rc;
+
+	IOT_UNUSED(pArg);
+
+	while(!terminateYieldThread) {
+		rc = aws_iot_mqtt_yield(&iotClient, 5);
+		if(MQTT_CLIENT_NOT_IDLE_ERROR == rc) {
+			/* A blocking call of another thread reads the network */
+			usleep(100);
+		} else if(SUCCESS != rc) {
+			__sync_fetch_and_add(&yieldErrorCount, 1);
+		}
+	}
+
+	return NULL;
+}
+
+static void *publishThread(void *pArg) {
+	ThreadData *pData = (ThreadData *) pArg;
+	IoT_Publish_Message_Params params;
+	char topic[DUPLEX_PAYLOAD_LEN];
+	char payload[DUPLEX_PAYLOAD_LEN];
+	IoT_Error_t rc;
+	int i;
+
+	snprintf(topic, sizeof(topic), "sdk/duplex/%d", pData->threadId);
+
+	for(i = 0; i < DUPLEX_PUBLISH_COUNT; i++) {
+		snprintf(payload, sizeof(payload), "Thread %d Msg %d", pData->threadId, i);
+		params.qos = pData->qos;
+		params.isRetained = 0;
+		params.payload = (void *) payload;
+		params.payloadLen = strlen(payload);
+
+		do {
+			rc = aws_iot_mqtt_publish(&iotClient, topic, (uint16_t) strlen(topic), &params);
+			if(MQTT_INFLIGHT_WINDOW_FULL_ERROR == rc) {
+				usleep(100);
+			}
+		} while(MQTT_INFLIGHT_WINDOW_FULL_ERROR == rc);
+
+		if(MQTT_CLIENT_NOT_IDLE_ERROR == rc) {
+			__sync_fetch_and_add(&notIdleCount, 1);
+		} else if(SUCCESS != rc) {
+			__sync_fetch_and_add(&publishErrorCount, 1);
+		}
+	}
+
+	return NULL;
+}
+
+static void connectDuplex(void) {
+	IoT_Error_t rc;
+
+	rc = aws_iot_mqtt_init(&iotClient, &initParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	iotClient.networkStack.write = brokerWrite;
+	iotClient.networkStack.read = brokerRead;
+	iotClient.networkStack.readAvailable = brokerReadAvailable;
+
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	rc = aws_iot_mqtt_subscribe(&iotClient, duplexTopicFilter, (uint16_t) strlen(duplexTopicFilter), QOS0,
+								duplexCallbackHandler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	rc = aws_iot_mqtt_set_full_duplex(&iotClient, true);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+}
+
+/* Start the yield thread and the publish threads, wait for the publishes to come back */
+static void runPublishers(QoS qos, pthread_t *pYieldThread) {
+	pthread_t pubThread[DUPLEX_PUB_THREAD_COUNT];
+	ThreadData threadData[DUPLEX_PUB_THREAD_COUNT];
+	Timer drainTimer;
+	int i;
+
+	terminateYieldThread = false;
+	CHECK_EQUAL_C_INT(0, pthread_create(pYieldThread, NULL, yieldThread, NULL));
+
+	for(i = 0; i < DUPLEX_PUB_THREAD_COUNT; i++) {
+		threadData[i].threadId = i;
+		threadData[i].qos = qos;
+		CHECK_EQUAL_C_INT(0, pthread_create(&pubThread[i], NULL, publishThread, &threadData[i]));
+	}
+
+	for(i = 0; i < DUPLEX_PUB_THREAD_COUNT; i++) {
+		pthread_join(pubThread[i], NULL);
+	}
+
+	init_timer(&drainTimer);
+	countdown_ms(&drainTimer, DUPLEX_DRAIN_TIMEOUT_MS);
+	while((DUPLEX_PUB_THREAD_COUNT * DUPLEX_PUBLISH_COUNT > receivedCount ||
+		   0 < aws_iot_mqtt_get_inflight_count(&iotClient)) && !has_timer_expired(&drainTimer)) {
+		usleep(1000);
+	}
+}
+
+static void stopYield(pthread_t yieldThreadId) {
+	terminateYieldThread = true;
+	pthread_join(yieldThreadId, NULL);
+}
+
+static void checkEveryMessageOnce(void) {
+	int i, j;
+
+	CHECK_EQUAL_C_INT(0, concurrentWriteCount);
+	CHECK_EQUAL_C_INT(0, malformedCount);
+	CHECK_EQUAL_C_INT(0, wireOverflowCount);
+	CHECK_EQUAL_C_INT(0, notIdleCount);
+	CHECK_EQUAL_C_INT(0, publishErrorCount);
+	CHECK_EQUAL_C_INT(0, yieldErrorCount);
+	CHECK_EQUAL_C_INT(0, unexpectedCount);
+	CHECK_EQUAL_C_INT(DUPLEX_PUB_THREAD_COUNT * DUPLEX_PUBLISH_COUNT, receivedCount);
+
+	for(i = 0; i < DUPLEX_PUB_THREAD_COUNT; i++) {
+		for(j = 0; j < DUPLEX_PUBLISH_COUNT; j++) {
+			CHECK_EQUAL_C_INT(1, countArray[i][j]);
+		}
+	}
+}
+
+TEST_GROUP_C_SETUP(DuplexTests) {
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+
+	ResetTLSBuffer();
+	wireStart = 0;
+	wireEnd = 0;
+	writersInside = 0;
+	concurrentWriteCount = 0;
+	malformedCount = 0;
+	wireOverflowCount = 0;
+	brokerSubscribeCount = 0;
+	brokerPublishCount = 0;
+	notIdleCount = 0;
+	publishErrorCount = 0;
+	yieldErrorCount = 0;
+	receivedCount = 0;
+	unexpectedCount = 0;
+	completeCount = 0;
+	completeErrorCount = 0;
+	memset(countArray, 0, sizeof(countArray));
+}
+
+TEST_GROUP_C_TEARDOWN(DuplexTests) {
+	/* Clean up. Not checking return code here because this is common to all tests.
+	 * A test might have already caused a disconnect by this point.
+	 */
+	IoT_Error_t rc = aws_iot_mqtt_disconnect(&iotClient);
+	IOT_UNUSED(rc);
+	rc = aws_iot_mqtt_free(&iotClient);
+	IOT_UNUSED(rc);
+}
+
+/* L:1 - QoS0 publishes of several threads run beside yield */
+TEST_C(DuplexTests, Qos0PublishBesideYield) {
+	pthread_t yieldThreadId;
+
+	IOT_DEBUG("-->Running Duplex Tests - L:1 - QoS0 publishes of several threads run beside yield \n");
+
+	connectDuplex();
+	runPublishers(QOS0, &yieldThreadId);
+	stopYield(yieldThreadId);
+
+	checkEveryMessageOnce();
+	CHECK_EQUAL_C_INT(DUPLEX_PUB_THREAD_COUNT * DUPLEX_PUBLISH_COUNT, brokerPublishCount);
+}
+
+/* L:2 - In flight QoS1 publishes run beside yield, yield completes them */
+TEST_C(DuplexTests, InflightPublishBesideYield) {
+	pthread_t yieldThreadId;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Duplex Tests - L:2 - In flight QoS1 publishes run beside yield, yield completes them \n");
+
+	connectDuplex();
+	rc = aws_iot_mqtt_set_inflight_window(&iotClient, AWS_IOT_MQTT_INFLIGHT_WINDOW_MAX, 5000, duplexCompleteHandler,
+										  NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	runPublishers(QOS1, &yieldThreadId);
+	stopYield(yieldThreadId);
+
+	checkEveryMessageOnce();
+	CHECK_EQUAL_C_INT(0, aws_iot_mqtt_get_inflight_count(&iotClient));
+	CHECK_EQUAL_C_INT(DUPLEX_PUB_THREAD_COUNT * DUPLEX_PUBLISH_COUNT, completeCount);
+	CHECK_EQUAL_C_INT(0, completeErrorCount);
+}
+
+/* L:3 - Subscribe takes turns with yield while publishes go on */
+TEST_C(DuplexTests, SubscribeTakesTurnsWithYield) {
+	pthread_t yieldThreadId, pubThread;
+	ThreadData threadData;
+	Timer timer;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Duplex Tests - L:3 - Subscribe takes turns with yield while publishes go on \n");
+
+	connectDuplex();
+
+	terminateYieldThread = false;
+	CHECK_EQUAL_C_INT(0, pthread_create(&yieldThreadId, NULL, yieldThread, NULL));
+	threadData.threadId = 0;
+	threadData.qos = QOS0;
+	CHECK_EQUAL_C_INT(0, pthread_create(&pubThread, NULL, publishThread, &threadData));
+
+	/* Subscribe reads its SUBACK itself, it waits for yield to leave the client idle */
+	init_timer(&timer);
+	countdown_ms(&timer, DUPLEX_DRAIN_TIMEOUT_MS);
+	do {
+		rc = aws_iot_mqtt_subscribe(&iotClient, otherTopicFilter, (uint16_t) strlen(otherTopicFilter), QOS0,
+									duplexCallbackHandler, NULL);
+	} while(MQTT_CLIENT_NOT_IDLE_ERROR == rc && !has_timer_expired(&timer));
+
+	pthread_join(pubThread, NULL);
+	init_timer(&timer);
+	countdown_ms(&timer, DUPLEX_DRAIN_TIMEOUT_MS);
+	while(DUPLEX_PUBLISH_COUNT > receivedCount && !has_timer_expired(&timer)) {
+		usleep(1000);
+	}
+	stopYield(yieldThreadId);
+
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(2, brokerSubscribeCount);
+	CHECK_EQUAL_C_INT(0, concurrentWriteCount);
+	CHECK_EQUAL_C_INT(0, malformedCount);
+	CHECK_EQUAL_C_INT(0, notIdleCount);
+	CHECK_EQUAL_C_INT(0, publishErrorCount);
+	CHECK_EQUAL_C_INT(DUPLEX_PUBLISH_COUNT, receivedCount);
+}
@@ -183,6 +183,24 @@ void setTLSRxBufferForSubFail(void) {
 	RxIndex = 0;
 }
 
+void setTLSRxBufferForMultiSuback(const unsigned char *pReturnCodes, uint8_t count) {
+	uint8_t i;
+
+	RxBuffer.NoMsgFlag = false;
+	RxBuffer.pBuffer[0] = (unsigned char) (0x90);
+	RxBuffer.pBuffer[1] = (unsigned char) (0x2 + count);
+	// Variable header - packet identifier
+	RxBuffer.pBuffer[2] = (unsigned char) (2);
+	RxBuffer.pBuffer[3] = (unsigned char) (0);
+	// payload, one return code per topic filter
+	for(i = 0; i < count; i++) {
+		RxBuffer.pBuffer[4 + i] = pReturnCodes[i];
+	}
+
+	RxBuffer.len = (size_t) (4 + count);
+	RxIndex = 0;
+}
+
 void setTLSRxBufferForDoubleSuback(char *topicName, size_t topicNameLen, QoS qos, IoT_Publish_Message_Params params) {
 	IOT_UNUSED(topicName);
 	IOT_UNUSED(topicNameLen);
@@ -313,7 +331,7 @@ void setTLSRxBufferWithMsgOnSubscribedTopic(char *topicName, size_t topicNameLen
 		RxBuffer.pBuffer[payloadStartLoc + i] = (unsigned char) pMsg[i];
 	}
 
-	RxBuffer.len = VariableLen + PayloadLen + 2; // 2 for fixed header
+	RxBuffer.len = cursor + VariableLen + PayloadLen; // cursor is past the fixed header
 	RxIndex = 0;
 	//printBuffer(RxBuffer.pBuffer, RxBuffer.len);
 }
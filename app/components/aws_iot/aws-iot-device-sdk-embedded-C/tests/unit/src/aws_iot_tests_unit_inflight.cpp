@@ -0,0 +1,44 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_inflight.cpp
+ * @brief IoT Client Unit Testing - QoS1 In Flight Window Tests
+ */
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness_c.h>
+
+TEST_GROUP_C(InflightTests){
+	TEST_GROUP_C_SETUP_WRAPPER(InflightTests)
+	TEST_GROUP_C_TEARDOWN_WRAPPER(InflightTests)
+};
+
+/* J:1 - Window size is validated */
+TEST_GROUP_C_WRAPPER(InflightTests, SetWindowInvalidParams)
+/* J:2 - Publish to a full window fails without sending */
+TEST_GROUP_C_WRAPPER(InflightTests, PublishWindowFull)
+/* J:3 - PUBACKs in reverse order complete the matching publishes */
+TEST_GROUP_C_WRAPPER(InflightTests, PubackOutOfOrder)
+/* J:4 - Publish without PUBACK is sent again with the DUP flag */
+TEST_GROUP_C_WRAPPER(InflightTests, RetransmitWithDup)
+/* J:5 - Publish completes with a timeout after the last retry */
+TEST_GROUP_C_WRAPPER(InflightTests, TimeoutAfterMaxRetries)
+/* J:6 - Packet longer than a window slot is refused */
+TEST_GROUP_C_WRAPPER(InflightTests, PacketTooLongForSlot)
+/* J:7 - Window 0 keeps the blocking QoS1 publish */
+TEST_GROUP_C_WRAPPER(InflightTests, BlockingPublishWindowZero)
+/* J:8 - Throughput grows with the window size */
+TEST_GROUP_C_WRAPPER(InflightTests, ThroughputVsWindowSize)
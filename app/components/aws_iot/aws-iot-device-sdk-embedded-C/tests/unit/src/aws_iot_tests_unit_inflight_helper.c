@@ -0,0 +1,459 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_inflight_helper.c
+ * @brief IoT Client Unit Testing - QoS1 In Flight Window Tests Helper
+ *
+ * The network stack is replaced after connect by a broker stand-in that answers
+ * every QoS1 PUBLISH with a PUBACK after a fixed round trip time.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <CppUTest/TestHarness_c.h>
+
+#include "aws_iot_mqtt_client_interface.h"
+#include "aws_iot_tests_unit_helper_functions.h"
+#include "aws_iot_tests_unit_mock_tls_params.h"
+#include "aws_iot_log.h"
+
+#define BROKER_MAX_ACKS 64
+#define BROKER_HOLD UINT64_MAX
+#define BENCH_MSG_COUNT 100
+#define BENCH_RTT_MS 5
+
+typedef struct {
+	uint16_t packetId;
+	uint64_t due_ms;
+} BrokerAck;
+
+static IoT_Client_Init_Params initParams;
+static IoT_Client_Connect_Params connectParams;
+static IoT_Publish_Message_Params testPubMsgParams;
+static AWS_IoT_Client iotClient;
+
+static char pubTopic[] = "sdk/inflight";
+
+/* Broker stand-in state */
+static BrokerAck brokerAcks[BROKER_MAX_ACKS];
+static size_t brokerAckCount;
+static uint32_t brokerRttMs;
+static bool brokerHold;
+static uint32_t brokerDropCount;
+static uint32_t brokerPublishCount;
+static uint32_t brokerDupCount;
+static uint16_t brokerLastPacketId;
+
+/* Completion handler state */
+static uint16_t completeIds[BROKER_MAX_ACKS];
+static uint32_t completeCount;
+static IoT_Error_t completeResult;
+
+static uint64_t nowMs(void) {
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (uint64_t) tv.tv_sec * 1000 + (uint64_t) tv.tv_usec / 1000;
+}
+
+static IoT_Error_t brokerWrite(Network *pNetwork, unsigned char *pMsg, size_t len, Timer *pTimer,
+							   size_t *written_len) {
+	size_t pos = 1, topicLen;
+	uint32_t remLen = 0, multiplier = 1;
+	uint16_t packetId;
+
+	IOT_UNUSED(pNetwork);
+	IOT_UNUSED(pTimer);
+
+	*written_len = len;
+
+	/* Only QoS1 PUBLISH is answered */
+	if(0x30 != (pMsg[0] & 0xF0) || 1 != ((pMsg[0] >> 1) & 0x03)) {
+		return SUCCESS;
+	}
+
+	do {
+		remLen += (pMsg[pos] & 0x7F) * multiplier;
+		multiplier *= 128;
+	} while(0 != (pMsg[pos++] & 0x80));
+	IOT_UNUSED(remLen);
+
+	topicLen = ((size_t) pMsg[pos] << 8) | pMsg[pos + 1];
+	pos += 2 + topicLen;
+	packetId = (uint16_t) ((pMsg[pos] << 8) | pMsg[pos + 1]);
+
+	brokerPublishCount++;
+	brokerLastPacketId = packetId;
+	if(0 != (pMsg[0] & 0x08)) {
+		brokerDupCount++;
+	}
+
+	if(0 < brokerDropCount) {
+		brokerDropCount--;
+		return SUCCESS;
+	}
+
+	if(BROKER_MAX_ACKS > brokerAckCount) {
+		brokerAcks[brokerAckCount].packetId = packetId;
+		brokerAcks[brokerAckCount].due_ms = brokerHold ? BROKER_HOLD : nowMs() + brokerRttMs;
+		brokerAckCount++;
+	}
+
+	return SUCCESS;
+}
+
+/* Hand out all due PUBACKs, wait for the next one until the timer expires */
+static IoT_Error_t brokerReadAvailable(Network *pNetwork, unsigned char *pMsg, size_t len, Timer *pTimer,
+									   size_t *read_len) {
+	uint64_t now, nextDue;
+	size_t i, kept;
+
+	IOT_UNUSED(pNetwork);
+
+	*read_len = 0;
+
+	for(;;) {
+		now = nowMs();
+		nextDue = BROKER_HOLD;
+		kept = 0;
+
+		for(i = 0; i < brokerAckCount; i++) {
+			if(brokerAcks[i].due_ms <= now && *read_len + 4 <= len) {
+				pMsg[(*read_len)++] = 0x40;
+				pMsg[(*read_len)++] = 0x02;
+				pMsg[(*read_len)++] = (unsigned char) (brokerAcks[i].packetId >> 8);
+				pMsg[(*read_len)++] = (unsigned char) (brokerAcks[i].packetId & 0xFF);
+				continue;
+			}
+
+			if(brokerAcks[i].due_ms < nextDue) {
+				nextDue = brokerAcks[i].due_ms;
+			}
+			brokerAcks[kept++] = brokerAcks[i];
+		}
+		brokerAckCount = kept;
+
+		if(0 < *read_len) {
+			return SUCCESS;
+		}
+
+		if(has_timer_expired(pTimer)) {
+			return NETWORK_SSL_NOTHING_TO_READ;
+		}
+
+		if(BROKER_HOLD == nextDue || nextDue - now > left_ms(pTimer)) {
+			usleep(left_ms(pTimer) * 1000);
+		} else {
+			usleep((useconds_t) (nextDue - now) * 1000);
+		}
+	}
+}
+
+/* Release the held PUBACKs, last publish first */
+static void brokerReleaseReversed(void) {
+	size_t i;
+	uint64_t now = nowMs();
+	BrokerAck tmp;
+
+	for(i = 0; i < brokerAckCount / 2; i++) {
+		tmp = brokerAcks[i];
+		brokerAcks[i] = brokerAcks[brokerAckCount - 1 - i];
+		brokerAcks[brokerAckCount - 1 - i] = tmp;
+	}
+
+	for(i = 0; i < brokerAckCount; i++) {
+		brokerAcks[i].due_ms = now;
+	}
+	brokerHold = false;
+}
+
+static void publishCompleteHandler(AWS_IoT_Client *pClient, uint16_t packetId, IoT_Error_t result, void *pData) {
+	IOT_UNUSED(pClient);
+	IOT_UNUSED(pData);
+
+	if(BROKER_MAX_ACKS > completeCount) {
+		completeIds[completeCount] = packetId;
+	}
+	completeCount++;
+	completeResult = result;
+}
+
+/* Yield until nothing is in flight or timeout_ms passed */
+static void yieldUntilIdle(uint32_t timeout_ms) {
+	uint64_t end = nowMs() + timeout_ms;
+
+	while(0 < aws_iot_mqtt_get_inflight_count(&iotClient) && nowMs() < end) {
+		aws_iot_mqtt_yield(&iotClient, 1);
+	}
+}
+
+static IoT_Error_t publishQos1(void) {
+	testPubMsgParams.qos = QOS1;
+	testPubMsgParams.isRetained = 0;
+	testPubMsgParams.payload = (void *) "inflight";
+	testPubMsgParams.payloadLen = 8;
+
+	return aws_iot_mqtt_publish(&iotClient, pubTopic, (uint16_t) strlen(pubTopic), &testPubMsgParams);
+}
+
+/* Publish count messages with the given window, return messages per second */
+static double runBenchmark(uint8_t windowSize, uint32_t count) {
+	IoT_Error_t rc;
+	uint64_t start;
+	uint32_t sent = 0;
+	double elapsed_ms;
+
+	rc = aws_iot_mqtt_set_inflight_window(&iotClient, windowSize, 1000, publishCompleteHandler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	completeCount = 0;
+	start = nowMs();
+	while(sent < count) {
+		rc = publishQos1();
+		if(SUCCESS == rc) {
+			sent++;
+		} else {
+			CHECK_EQUAL_C_INT(MQTT_INFLIGHT_WINDOW_FULL_ERROR, rc);
+			aws_iot_mqtt_yield(&iotClient, 1);
+		}
+	}
+	yieldUntilIdle(1000);
+	elapsed_ms = (double) (nowMs() - start);
+
+	CHECK_EQUAL_C_INT(0, aws_iot_mqtt_get_inflight_count(&iotClient));
+	CHECK_EQUAL_C_INT(count, completeCount);
+
+	return (1000.0 * count) / (elapsed_ms > 0 ? elapsed_ms : 1);
+}
+
+TEST_GROUP_C_SETUP(InflightTests) {
+	IoT_Error_t rc;
+
+	ResetTLSBuffer();
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	rc = aws_iot_mqtt_init(&iotClient, &initParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	rc = aws_iot_mqtt_autoreconnect_set_status(&iotClient, false);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	iotClient.networkStack.read = brokerReadAvailable;
+	iotClient.networkStack.readAvailable = brokerReadAvailable;
+	iotClient.networkStack.write = brokerWrite;
+
+	brokerAckCount = 0;
+	brokerRttMs = BENCH_RTT_MS;
+	brokerHold = false;
+	brokerDropCount = 0;
+	brokerPublishCount = 0;
+	brokerDupCount = 0;
+	brokerLastPacketId = 0;
+
+	memset(completeIds, 0, sizeof(completeIds));
+	completeCount = 0;
+	completeResult = FAILURE;
+}
+
+TEST_GROUP_C_TEARDOWN(InflightTests) {
+	/* Clean up. Not checking return code here because this is common to all tests.
+	 * A test might have already caused a disconnect by this point.
+	 */
+	IoT_Error_t rc = aws_iot_mqtt_disconnect(&iotClient);
+	IOT_UNUSED(rc);
+}
+
+/* J:1 - Window size is validated */
+TEST_C(InflightTests, SetWindowInvalidParams) {
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running In Flight Tests - J:1 - Window size is validated \n");
+
+	rc = aws_iot_mqtt_set_inflight_window(NULL, 2, 100, NULL, NULL);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+
+	rc = aws_iot_mqtt_set_inflight_window(&iotClient, AWS_IOT_MQTT_INFLIGHT_WINDOW_MAX + 1, 100, NULL, NULL);
+	CHECK_EQUAL_C_INT(MAX_SIZE_ERROR, rc);
+
+	rc = aws_iot_mqtt_set_inflight_window(&iotClient, 2, 0, NULL, NULL);
+	CHECK_EQUAL_C_INT(MAX_SIZE_ERROR, rc);
+
+	/* Shrinking is refused while publishes are in flight */
+	rc = aws_iot_mqtt_set_inflight_window(&iotClient, 2, 1000, NULL, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	brokerHold = true;
+	CHECK_EQUAL_C_INT(SUCCESS, publishQos1());
+	rc = aws_iot_mqtt_set_inflight_window(&iotClient, 0, 0, NULL, NULL);
+	CHECK_EQUAL_C_INT(MQTT_CLIENT_NOT_IDLE_ERROR, rc);
+	rc = aws_iot_mqtt_set_inflight_window(&iotClient, 3, 1000, NULL, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(UINT32_MAX != aws_iot_mqtt_get_inflight_wait_ms(&iotClient), true);
+}
+
+/* J:2 - Publish to a full window fails without sending */
+TEST_C(InflightTests, PublishWindowFull) {
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running In Flight Tests - J:2 - Publish to a full window fails without sending \n");
+
+	rc = aws_iot_mqtt_set_inflight_window(&iotClient, 2, 1000, publishCompleteHandler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(UINT32_MAX, aws_iot_mqtt_get_inflight_wait_ms(&iotClient));
+
+	brokerHold = true;
+	CHECK_EQUAL_C_INT(SUCCESS, publishQos1());
+	CHECK_EQUAL_C_INT(SUCCESS, publishQos1());
+	CHECK_EQUAL_C_INT(MQTT_INFLIGHT_WINDOW_FULL_ERROR, publishQos1());
+	CHECK_EQUAL_C_INT(2, brokerPublishCount);
+	CHECK_EQUAL_C_INT(2, aws_iot_mqtt_get_inflight_count(&iotClient));
+	CHECK_EQUAL_C_INT(0, completeCount);
+
+	/* QoS0 does not use the window */
+	testPubMsgParams.qos = QOS0;
+	rc = aws_iot_mqtt_publish(&iotClient, pubTopic, (uint16_t) strlen(pubTopic), &testPubMsgParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+}
+
+/* J:3 - PUBACKs in reverse order complete the matching publishes */
+TEST_C(InflightTests, PubackOutOfOrder) {
+	IoT_Error_t rc;
+	uint16_t ids[3];
+	uint8_t i;
+
+	IOT_DEBUG("-->Running In Flight Tests - J:3 - PUBACKs in reverse order complete the matching publishes \n");
+
+	rc = aws_iot_mqtt_set_inflight_window(&iotClient, 3, 1000, publishCompleteHandler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	brokerHold = true;
+	for(i = 0; i < 3; i++) {
+		CHECK_EQUAL_C_INT(SUCCESS, publishQos1());
+		ids[i] = testPubMsgParams.id;
+	}
+
+	brokerReleaseReversed();
+	rc = aws_iot_mqtt_yield(&iotClient, 10);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	CHECK_EQUAL_C_INT(3, completeCount);
+	CHECK_EQUAL_C_INT(SUCCESS, completeResult);
+	for(i = 0; i < 3; i++) {
+		CHECK_EQUAL_C_INT(ids[2 - i], completeIds[i]);
+	}
+	CHECK_EQUAL_C_INT(0, aws_iot_mqtt_get_inflight_count(&iotClient));
+	CHECK_EQUAL_C_INT(0, brokerDupCount);
+}
+
+/* J:4 - Publish without PUBACK is sent again with the DUP flag */
+TEST_C(InflightTests, RetransmitWithDup) {
+	IoT_Error_t rc;
+	uint16_t id;
+
+	IOT_DEBUG("-->Running In Flight Tests - J:4 - Publish without PUBACK is sent again with the DUP flag \n");
+
+	rc = aws_iot_mqtt_set_inflight_window(&iotClient, 1, 20, publishCompleteHandler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	brokerDropCount = 1;
+	CHECK_EQUAL_C_INT(SUCCESS, publishQos1());
+	id = testPubMsgParams.id;
+
+	yieldUntilIdle(500);
+
+	CHECK_EQUAL_C_INT(2, brokerPublishCount);
+	CHECK_EQUAL_C_INT(1, brokerDupCount);
+	CHECK_EQUAL_C_INT(id, brokerLastPacketId);
+	CHECK_EQUAL_C_INT(1, completeCount);
+	CHECK_EQUAL_C_INT(id, completeIds[0]);
+	CHECK_EQUAL_C_INT(SUCCESS, completeResult);
+}
+
+/* J:5 - Publish completes with a timeout after the last retry */
+TEST_C(InflightTests, TimeoutAfterMaxRetries) {
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running In Flight Tests - J:5 - Publish completes with a timeout after the last retry \n");
+
+	rc = aws_iot_mqtt_set_inflight_window(&iotClient, 1, 10, publishCompleteHandler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	brokerDropCount = UINT32_MAX;
+	CHECK_EQUAL_C_INT(SUCCESS, publishQos1());
+
+	yieldUntilIdle(1000);
+
+	CHECK_EQUAL_C_INT(1 + AWS_IOT_MQTT_INFLIGHT_MAX_RETRIES, brokerPublishCount);
+	CHECK_EQUAL_C_INT(AWS_IOT_MQTT_INFLIGHT_MAX_RETRIES, brokerDupCount);
+	CHECK_EQUAL_C_INT(1, completeCount);
+	CHECK_EQUAL_C_INT(MQTT_REQUEST_TIMEOUT_ERROR, completeResult);
+	CHECK_EQUAL_C_INT(0, aws_iot_mqtt_get_inflight_count(&iotClient));
+}
+
+/* J:6 - Packet longer than a window slot is refused */
+TEST_C(InflightTests, PacketTooLongForSlot) {
+	IoT_Error_t rc;
+	char payload[AWS_IOT_MQTT_INFLIGHT_PACKET_LEN];
+
+	IOT_DEBUG("-->Running In Flight Tests - J:6 - Packet longer than a window slot is refused \n");
+
+	rc = aws_iot_mqtt_set_inflight_window(&iotClient, 2, 1000, publishCompleteHandler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	memset(payload, 'x', sizeof(payload));
+	testPubMsgParams.qos = QOS1;
+	testPubMsgParams.isRetained = 0;
+	testPubMsgParams.payload = payload;
+	testPubMsgParams.payloadLen = sizeof(payload);
+	rc = aws_iot_mqtt_publish(&iotClient, pubTopic, (uint16_t) strlen(pubTopic), &testPubMsgParams);
+	CHECK_EQUAL_C_INT(MQTT_TX_BUFFER_TOO_SHORT_ERROR, rc);
+	CHECK_EQUAL_C_INT(0, brokerPublishCount);
+	CHECK_EQUAL_C_INT(0, aws_iot_mqtt_get_inflight_count(&iotClient));
+}
+
+/* J:7 - Window 0 keeps the blocking QoS1 publish */
+TEST_C(InflightTests, BlockingPublishWindowZero) {
+	IOT_DEBUG("-->Running In Flight Tests - J:7 - Window 0 keeps the blocking QoS1 publish \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, publishQos1());
+	CHECK_EQUAL_C_INT(1, brokerPublishCount);
+	CHECK_EQUAL_C_INT(0, brokerAckCount);
+	CHECK_EQUAL_C_INT(0, aws_iot_mqtt_get_inflight_count(&iotClient));
+	CHECK_EQUAL_C_INT(0, completeCount);
+}
+
+/* J:8 - Throughput grows with the window size */
+TEST_C(InflightTests, ThroughputVsWindowSize) {
+	double rate1, rate2, rate4, rate8;
+
+	IOT_DEBUG("-->Running In Flight Tests - J:8 - Throughput grows with the window size \n");
+
+	rate1 = runBenchmark(1, BENCH_MSG_COUNT);
+	rate2 = runBenchmark(2, BENCH_MSG_COUNT);
+	rate4 = runBenchmark(4, BENCH_MSG_COUNT);
+	rate8 = runBenchmark(8, BENCH_MSG_COUNT);
+
+	printf("\nQoS1 publish, %d ms round trip: window 1 %.0f msg/s, 2 %.0f msg/s, 4 %.0f msg/s, 8 %.0f msg/s\n",
+		   BENCH_RTT_MS, rate1, rate2, rate4, rate8);
+
+	CHECK_C(rate2 > rate1);
+	CHECK_C(rate4 > 2 * rate1);
+}
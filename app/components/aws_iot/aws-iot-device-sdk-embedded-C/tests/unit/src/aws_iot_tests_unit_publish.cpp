@@ -46,3 +46,9 @@ TEST_GROUP_C_WRAPPER(PublishTests, publishQoS1Success10msDelayedPuback)
 TEST_GROUP_C_WRAPPER(PublishTests, publishQoS0NoPubackSuccess)
 /* E:10 - Publish with QoS1 send success, Puback received */
 TEST_GROUP_C_WRAPPER(PublishTests, publishQoS1Success)
+/* E:11 - Publish in place QoS0, packet on the wire matches regular publish */
+TEST_GROUP_C_WRAPPER(PublishTests, publishInPlaceQoS0MatchesPublish)
+/* E:12 - Publish in place with failing payload writer */
+TEST_GROUP_C_WRAPPER(PublishTests, publishInPlaceWriterFailure)
+/* E:13 - Publish in place with QoS1 send success, Puback received */
+TEST_GROUP_C_WRAPPER(PublishTests, publishInPlaceQoS1Success)
@@ -24,6 +24,7 @@
 
 #include "aws_iot_mqtt_client_interface.h"
 #include "aws_iot_tests_unit_helper_functions.h"
+#include "aws_iot_tests_unit_mock_tls_params.h"
 #include "aws_iot_log.h"
 
 static IoT_Client_Init_Params initParams;
@@ -60,6 +61,24 @@ TEST_GROUP_C_SETUP(PublishTests) {
 
 TEST_GROUP_C_TEARDOWN(PublishTests) { }
 
+static size_t copyPayloadWriter(unsigned char *pBuf, size_t bufLen, void *pWriterData) {
+	size_t len = strlen((char *) pWriterData);
+
+	if(len > bufLen) {
+		return 0;
+	}
+
+	memcpy(pBuf, pWriterData, len);
+	return len;
+}
+
+static size_t failingPayloadWriter(unsigned char *pBuf, size_t bufLen, void *pWriterData) {
+	IOT_UNUSED(pBuf);
+	IOT_UNUSED(bufLen);
+	IOT_UNUSED(pWriterData);
+	return 0;
+}
+
 /* E:1 - Publish with Null/empty client instance */
 TEST_C(PublishTests, PublishNullClient) {
 	IoT_Error_t rc = SUCCESS;
@@ -203,3 +222,82 @@ TEST_C(PublishTests, publishQoS1Success) {
 
 	IOT_DEBUG("-->Success - E:10 - Publish with QoS1 send success, Puback received \n");
 }
+
+/* E:11 - Publish in place QoS0, packet on the wire matches regular publish */
+TEST_C(PublishTests, publishInPlaceQoS0MatchesPublish) {
+	IoT_Error_t rc = SUCCESS;
+	unsigned char expectedPacket[TLSMaxBufferSize];
+	size_t expectedLen;
+	char longPayload[300];
+
+	IOT_DEBUG("-->Running Publish Tests - E:11 - Publish in place QoS0, packet on the wire matches regular publish \n");
+
+	/* Short payload uses a one byte remaining length, long payload uses two */
+	memset(longPayload, 'x', sizeof(longPayload) - 1);
+	longPayload[sizeof(longPayload) - 1] = '\0';
+
+	testPubMsgParams.qos = QOS0;
+	testPubMsgParams.payload = (void *) longPayload;
+	testPubMsgParams.payloadLen = strlen(longPayload);
+	rc = aws_iot_mqtt_publish(&iotClient, subTopic, subTopicLen, &testPubMsgParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	expectedLen = TxBuffer.len;
+	memcpy(expectedPacket, TxBuffer.pBuffer, expectedLen);
+
+	ResetTLSBuffer();
+	rc = aws_iot_mqtt_publish_in_place(&iotClient, subTopic, subTopicLen, &testPubMsgParams, copyPayloadWriter,
+									   longPayload);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(strlen(longPayload), testPubMsgParams.payloadLen);
+	CHECK_EQUAL_C_INT(expectedLen, TxBuffer.len);
+	CHECK_EQUAL_C_INT(0, memcmp(expectedPacket, TxBuffer.pBuffer, expectedLen));
+
+	ResetTLSBuffer();
+	testPubMsgParams.payload = (void *) cPayload;
+	testPubMsgParams.payloadLen = strlen(cPayload);
+	rc = aws_iot_mqtt_publish(&iotClient, subTopic, subTopicLen, &testPubMsgParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	expectedLen = TxBuffer.len;
+	memcpy(expectedPacket, TxBuffer.pBuffer, expectedLen);
+
+	ResetTLSBuffer();
+	rc = aws_iot_mqtt_publish_in_place(&iotClient, subTopic, subTopicLen, &testPubMsgParams, copyPayloadWriter,
+									   cPayload);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(expectedLen, TxBuffer.len);
+	CHECK_EQUAL_C_INT(0, memcmp(expectedPacket, TxBuffer.pBuffer, expectedLen));
+
+	IOT_DEBUG("-->Success - E:11 - Publish in place QoS0, packet on the wire matches regular publish \n");
+}
+
+/* E:12 - Publish in place with failing payload writer */
+TEST_C(PublishTests, publishInPlaceWriterFailure) {
+	IoT_Error_t rc = SUCCESS;
+
+	IOT_DEBUG("-->Running Publish Tests - E:12 - Publish in place with failing payload writer \n");
+
+	rc = aws_iot_mqtt_publish_in_place(&iotClient, subTopic, subTopicLen, &testPubMsgParams, NULL, NULL);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+
+	rc = aws_iot_mqtt_publish_in_place(&iotClient, subTopic, subTopicLen, &testPubMsgParams, failingPayloadWriter,
+									   NULL);
+	CHECK_EQUAL_C_INT(MQTT_TX_BUFFER_TOO_SHORT_ERROR, rc);
+	CHECK_EQUAL_C_INT(0, TxBuffer.len);
+	CHECK_EQUAL_C_INT(CLIENT_STATE_CONNECTED_IDLE, aws_iot_mqtt_get_client_state(&iotClient));
+
+	IOT_DEBUG("-->Success - E:12 - Publish in place with failing payload writer \n");
+}
+
+/* E:13 - Publish in place with QoS1 send success, Puback received */
+TEST_C(PublishTests, publishInPlaceQoS1Success) {
+	IoT_Error_t rc = SUCCESS;
+
+	IOT_DEBUG("-->Running Publish Tests - E:13 - Publish in place with QoS1 send success, Puback received \n");
+
+	setTLSRxBufferForPuback();
+	rc = aws_iot_mqtt_publish_in_place(&iotClient, subTopic, subTopicLen, &testPubMsgParams, copyPayloadWriter,
+									   cPayload);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	IOT_DEBUG("-->Success - E:13 - Publish in place with QoS1 send success, Puback received \n");
+}
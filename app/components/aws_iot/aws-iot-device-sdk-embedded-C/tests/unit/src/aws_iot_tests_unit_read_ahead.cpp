@@ -0,0 +1,38 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_read_ahead.cpp
+ * @brief IoT Client Unit Testing - Read Ahead Tests
+ */
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness_c.h>
+
+TEST_GROUP_C(ReadAheadTests){
+	TEST_GROUP_C_SETUP_WRAPPER(ReadAheadTests)
+	TEST_GROUP_C_TEARDOWN_WRAPPER(ReadAheadTests)
+};
+
+/* I:1 - Several packets in one network read are all dispatched */
+TEST_GROUP_C_WRAPPER(ReadAheadTests, SeveralPacketsOneRead)
+/* I:2 - Packet split across two refills of the read-ahead buffer */
+TEST_GROUP_C_WRAPPER(ReadAheadTests, PacketAcrossRefill)
+/* I:3 - Oversize packet is dropped without eating the packet after it */
+TEST_GROUP_C_WRAPPER(ReadAheadTests, OversizePacketKeepsNextPacket)
+/* I:4 - Connect drops bytes left over from the previous connection */
+TEST_GROUP_C_WRAPPER(ReadAheadTests, ConnectFlushesReadAhead)
+/* I:5 - Short yields report buffered packets until all are parsed */
+TEST_GROUP_C_WRAPPER(ReadAheadTests, ShortYieldRxPending)
@@ -0,0 +1,207 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_read_ahead_helper.c
+ * @brief IoT Client Unit Testing - Read Ahead Tests Helper
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <CppUTest/TestHarness_c.h>
+
+#include "aws_iot_mqtt_client_interface.h"
+#include "aws_iot_tests_unit_helper_functions.h"
+#include "aws_iot_tests_unit_mock_tls_params.h"
+#include "aws_iot_log.h"
+
+static IoT_Client_Init_Params initParams;
+static IoT_Client_Connect_Params connectParams;
+static IoT_Publish_Message_Params testPubMsgParams;
+static AWS_IoT_Client iotClient;
+
+static char subTopic[] = "sdk/read";
+static char callbackOrder[16];
+
+static void orderedCallbackHandler(AWS_IoT_Client *pClient, char *topicName, uint16_t topicNameLen,
+								   IoT_Publish_Message_Params *params, void *pData) {
+	size_t len = strlen(callbackOrder);
+
+	IOT_UNUSED(pClient);
+	IOT_UNUSED(topicName);
+	IOT_UNUSED(topicNameLen);
+	IOT_UNUSED(pData);
+
+	if(len < sizeof(callbackOrder) - 1) {
+		callbackOrder[len] = ((char *) params->payload)[0];
+		callbackOrder[len + 1] = '\0';
+	}
+}
+
+/* Append a QoS0 PUBLISH on subTopic to the mock receive buffer, payload is payloadLen copies of tag */
+static void appendPublish(char tag, size_t payloadLen) {
+	size_t cursor = RxBuffer.len;
+	size_t topicLen = strlen(subTopic);
+
+	RxBuffer.NoMsgFlag = false;
+	RxBuffer.pBuffer[cursor++] = (unsigned char) 0x30;
+	encodeRemainingLength(RxBuffer.pBuffer, &cursor, 2 + topicLen + payloadLen);
+	RxBuffer.pBuffer[cursor++] = (unsigned char) ((topicLen & 0xFF00) >> 8);
+	RxBuffer.pBuffer[cursor++] = (unsigned char) (topicLen & 0xFF);
+	memcpy(&RxBuffer.pBuffer[cursor], subTopic, topicLen);
+	cursor += topicLen;
+	memset(&RxBuffer.pBuffer[cursor], tag, payloadLen);
+	cursor += payloadLen;
+
+	RxBuffer.len = cursor;
+}
+
+TEST_GROUP_C_SETUP(ReadAheadTests) {
+	IoT_Error_t rc;
+
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	rc = aws_iot_mqtt_init(&iotClient, &initParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	rc = aws_iot_mqtt_autoreconnect_set_status(&iotClient, false);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	testPubMsgParams.qos = QOS0;
+	testPubMsgParams.isRetained = 0;
+	testPubMsgParams.payload = (void *) "x";
+	testPubMsgParams.payloadLen = 1;
+
+	ResetTLSBuffer();
+	setTLSRxBufferForSuback(subTopic, strlen(subTopic), QOS0, testPubMsgParams);
+	rc = aws_iot_mqtt_subscribe(&iotClient, subTopic, (uint16_t) strlen(subTopic), QOS0, orderedCallbackHandler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	memset(callbackOrder, 0, sizeof(callbackOrder));
+	ResetTLSBuffer();
+}
+
+TEST_GROUP_C_TEARDOWN(ReadAheadTests) {
+	/* Clean up. Not checking return code here because this is common to all tests.
+	 * A test might have already caused a disconnect by this point.
+	 */
+	IoT_Error_t rc = aws_iot_mqtt_disconnect(&iotClient);
+	IOT_UNUSED(rc);
+}
+
+/* I:1 - Several packets in one network read are all dispatched */
+TEST_C(ReadAheadTests, SeveralPacketsOneRead) {
+	IoT_Error_t rc;
+	size_t readCount;
+
+	IOT_DEBUG("-->Running Read Ahead Tests - I:1 - Several packets in one network read are all dispatched \n");
+
+	appendPublish('a', 10);
+	appendPublish('b', 20);
+	appendPublish('c', 30);
+
+	readCount = RxReadCount;
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_STRING("abc", callbackOrder);
+	CHECK_EQUAL_C_INT(1, (int) (RxReadCount - readCount));
+}
+
+/* I:2 - Packet split across two refills of the read-ahead buffer */
+TEST_C(ReadAheadTests, PacketAcrossRefill) {
+	IoT_Error_t rc;
+	size_t readCount;
+	size_t payloadLen = (AWS_IOT_MQTT_READ_AHEAD_LEN / 3) - 8;
+
+	IOT_DEBUG("-->Running Read Ahead Tests - I:2 - Packet split across two refills of the read-ahead buffer \n");
+
+	appendPublish('a', payloadLen);
+	appendPublish('b', payloadLen);
+	appendPublish('c', payloadLen);
+	appendPublish('d', payloadLen);
+	CHECK_C(RxBuffer.len > AWS_IOT_MQTT_READ_AHEAD_LEN);
+
+	readCount = RxReadCount;
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_STRING("abcd", callbackOrder);
+	CHECK_EQUAL_C_INT(2, (int) (RxReadCount - readCount));
+}
+
+/* I:3 - Oversize packet is dropped without eating the packet after it */
+TEST_C(ReadAheadTests, OversizePacketKeepsNextPacket) {
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Read Ahead Tests - I:3 - Oversize packet is dropped without eating the packet after it \n");
+
+	appendPublish('a', AWS_IOT_MQTT_RX_BUF_LEN + 16);
+	appendPublish('b', 10);
+
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(MQTT_RX_BUFFER_TOO_SHORT_ERROR, rc);
+	CHECK_EQUAL_C_STRING("", callbackOrder);
+
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_STRING("b", callbackOrder);
+}
+
+/* I:4 - Connect drops bytes left over from the previous connection */
+TEST_C(ReadAheadTests, ConnectFlushesReadAhead) {
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Read Ahead Tests - I:4 - Connect drops bytes left over from the previous connection \n");
+
+	/* Stale half packet from the old connection */
+	iotClient.clientData.readAheadBuf[0] = (unsigned char) 0x30;
+	iotClient.clientData.readAheadBuf[1] = (unsigned char) 0x7F;
+	iotClient.clientData.readAheadStart = 0;
+	iotClient.clientData.readAheadEnd = 2;
+
+	rc = aws_iot_mqtt_disconnect(&iotClient);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(0, (int) (iotClient.clientData.readAheadEnd - iotClient.clientData.readAheadStart));
+}
+
+/* I:5 - Short yields report buffered packets until all are parsed */
+TEST_C(ReadAheadTests, ShortYieldRxPending) {
+	IoT_Error_t rc;
+	uint8_t yieldCount = 0;
+
+	IOT_DEBUG("-->Running Read Ahead Tests - I:5 - Short yields report buffered packets until all are parsed \n");
+
+	CHECK_EQUAL_C_INT(false, aws_iot_mqtt_is_rx_pending(&iotClient));
+
+	appendPublish('a', 10);
+	appendPublish('b', 10);
+	appendPublish('c', 10);
+
+	do {
+		rc = aws_iot_mqtt_yield(&iotClient, 1);
+		CHECK_EQUAL_C_INT(SUCCESS, rc);
+		yieldCount++;
+	} while(aws_iot_mqtt_is_rx_pending(&iotClient) && yieldCount < 10);
+
+	CHECK_EQUAL_C_STRING("abc", callbackOrder);
+	CHECK_EQUAL_C_INT(false, aws_iot_mqtt_is_rx_pending(&iotClient));
+}
@@ -0,0 +1,46 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_session.cpp
+ * @brief IoT Client Unit Testing - Persistent Session Tests
+ */
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness_c.h>
+
+TEST_GROUP_C(SessionTests){
+	TEST_GROUP_C_SETUP_WRAPPER(SessionTests)
+	TEST_GROUP_C_TEARDOWN_WRAPPER(SessionTests)
+};
+
+/* K:1 - Clean session records acknowledged subscriptions */
+TEST_GROUP_C_WRAPPER(SessionTests, CleanSessionRecordsSubscription)
+/* K:2 - Resumed session registers recorded subscriptions without SUBSCRIBE */
+TEST_GROUP_C_WRAPPER(SessionTests, ResumedSessionSkipsSubscribe)
+/* K:3 - Subscription with another QoS than recorded is sent */
+TEST_GROUP_C_WRAPPER(SessionTests, ResumedSessionQosChangeSubscribes)
+/* K:4 - New session drops the loaded record */
+TEST_GROUP_C_WRAPPER(SessionTests, NewSessionDropsRecord)
+/* K:5 - Reconnect to a resumed session skips the resubscribe */
+TEST_GROUP_C_WRAPPER(SessionTests, ReconnectResumedSkipsResubscribe)
+/* K:6 - Reconnect to a new session resubscribes */
+TEST_GROUP_C_WRAPPER(SessionTests, ReconnectNewSessionResubscribes)
+/* K:7 - Unsubscribe removes the subscription from the record */
+TEST_GROUP_C_WRAPPER(SessionTests, UnsubscribeRemovesRecord)
+/* K:8 - Session record can only be loaded while disconnected */
+TEST_GROUP_C_WRAPPER(SessionTests, SetRecordInvalidParams)
+/* K:9 - Reconnect to a new session resubscribes all filters in one SUBSCRIBE */
+TEST_GROUP_C_WRAPPER(SessionTests, ReconnectNewSessionBatchesResubscribe)
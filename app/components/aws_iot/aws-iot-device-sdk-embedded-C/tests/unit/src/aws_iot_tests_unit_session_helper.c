@@ -0,0 +1,333 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_session_helper.c
+ * @brief IoT Client Unit Testing - Persistent Session Tests Helper
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <CppUTest/TestHarness_c.h>
+
+#include "aws_iot_mqtt_client_interface.h"
+#include "aws_iot_tests_unit_helper_functions.h"
+#include "aws_iot_tests_unit_mock_tls_params.h"
+#include "aws_iot_log.h"
+
+static IoT_Client_Init_Params initParams;
+static IoT_Client_Connect_Params connectParams;
+static IoT_Publish_Message_Params testPubMsgParams;
+static AWS_IoT_Client iotClient;
+
+static char topicA[] = "sdk/session/a";
+static char topicB[] = "sdk/session/b";
+static char callbackMsg[32];
+static uint32_t subscribeCount;
+
+static IoT_Error_t countingWrite(Network *pNetwork, unsigned char *pMsg, size_t len, Timer *pTimer,
+								 size_t *written_len) {
+	if(0x82 == pMsg[0]) {
+		subscribeCount++;
+	}
+
+	return iot_tls_write(pNetwork, pMsg, len, pTimer, written_len);
+}
+
+static void sessionCallbackHandler(AWS_IoT_Client *pClient, char *topicName, uint16_t topicNameLen,
+								   IoT_Publish_Message_Params *params, void *pData) {
+	IOT_UNUSED(pClient);
+	IOT_UNUSED(topicName);
+	IOT_UNUSED(topicNameLen);
+	IOT_UNUSED(pData);
+
+	snprintf(callbackMsg, sizeof(callbackMsg), "%.*s", (int) params->payloadLen, (char *) params->payload);
+}
+
+/* Init the client as after a reboot and connect, CONNACK carries sessionPresent */
+static void connectSession(bool isCleanSession, unsigned char sessionPresent, const uint32_t *pRecord,
+						   uint16_t recordCount) {
+	IoT_Error_t rc;
+
+	ResetTLSBuffer();
+	rc = aws_iot_mqtt_init(&iotClient, &initParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	iotClient.networkStack.write = countingWrite;
+
+	rc = aws_iot_mqtt_set_session_record(&iotClient, pRecord, recordCount);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	connectParams.isCleanSession = isCleanSession;
+	setTLSRxBufferForConnack(&connectParams, sessionPresent, 0);
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	subscribeCount = 0;
+}
+
+static IoT_Error_t subscribe(char *pTopic, QoS qos) {
+	ResetTLSBuffer();
+	setTLSRxBufferForSuback(pTopic, strlen(pTopic), qos, testPubMsgParams);
+
+	return aws_iot_mqtt_subscribe(&iotClient, pTopic, (uint16_t) strlen(pTopic), qos, sessionCallbackHandler, NULL);
+}
+
+TEST_GROUP_C_SETUP(SessionTests) {
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+
+	testPubMsgParams.qos = QOS1;
+	testPubMsgParams.isRetained = 0;
+	testPubMsgParams.payload = (void *) "msg";
+	testPubMsgParams.payloadLen = 3;
+
+	memset(callbackMsg, 0, sizeof(callbackMsg));
+	subscribeCount = 0;
+}
+
+TEST_GROUP_C_TEARDOWN(SessionTests) {
+	/* Clean up. Not checking return code here because this is common to all tests.
+	 * A test might have already caused a disconnect by this point.
+	 */
+	IoT_Error_t rc = aws_iot_mqtt_disconnect(&iotClient);
+	IOT_UNUSED(rc);
+}
+
+/* K:1 - Clean session records acknowledged subscriptions */
+TEST_C(SessionTests, CleanSessionRecordsSubscription) {
+	uint32_t record[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+
+	IOT_DEBUG("-->Running Session Tests - K:1 - Clean session records acknowledged subscriptions \n");
+
+	/* The broker may not claim a session for a clean connect */
+	connectSession(true, 1, NULL, 0);
+	CHECK_EQUAL_C_INT(false, aws_iot_mqtt_is_session_present(&iotClient));
+
+	CHECK_EQUAL_C_INT(SUCCESS, subscribe(topicA, QOS1));
+	CHECK_EQUAL_C_INT(1, subscribeCount);
+	CHECK_EQUAL_C_INT(1, aws_iot_mqtt_get_session_record(&iotClient, record, AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS));
+
+	/* Same subscription again is sent, a clean session never skips */
+	CHECK_EQUAL_C_INT(SUCCESS, subscribe(topicA, QOS1));
+	CHECK_EQUAL_C_INT(2, subscribeCount);
+	CHECK_EQUAL_C_INT(1, aws_iot_mqtt_get_session_record(&iotClient, record, AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS));
+
+	/* Copy is limited to the destination size */
+	CHECK_EQUAL_C_INT(SUCCESS, subscribe(topicB, QOS0));
+	CHECK_EQUAL_C_INT(1, aws_iot_mqtt_get_session_record(&iotClient, record, 1));
+	CHECK_EQUAL_C_INT(2, aws_iot_mqtt_get_session_record(&iotClient, record, AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS));
+}
+
+/* K:2 - Resumed session registers recorded subscriptions without SUBSCRIBE */
+TEST_C(SessionTests, ResumedSessionSkipsSubscribe) {
+	uint32_t record[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+	uint16_t count;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Session Tests - K:2 - Resumed session registers recorded subscriptions without SUBSCRIBE \n");
+
+	connectSession(false, 0, NULL, 0);
+	CHECK_EQUAL_C_INT(SUCCESS, subscribe(topicA, QOS1));
+	CHECK_EQUAL_C_INT(1, subscribeCount);
+	count = aws_iot_mqtt_get_session_record(&iotClient, record, AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS);
+	CHECK_EQUAL_C_INT(1, count);
+
+	/* Reboot, the broker resumes the session */
+	connectSession(false, 1, record, count);
+	CHECK_EQUAL_C_INT(true, aws_iot_mqtt_is_session_present(&iotClient));
+
+	ResetTLSBuffer();
+	rc = aws_iot_mqtt_subscribe(&iotClient, topicA, (uint16_t) strlen(topicA), QOS1, sessionCallbackHandler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(0, subscribeCount);
+
+	/* Message queued by the broker while offline reaches the handler */
+	setTLSRxBufferWithMsgOnSubscribedTopic(topicA, strlen(topicA), QOS1, testPubMsgParams, "queued");
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_STRING("queued", callbackMsg);
+
+	/* Filter not in the record is subscribed */
+	CHECK_EQUAL_C_INT(SUCCESS, subscribe(topicB, QOS1));
+	CHECK_EQUAL_C_INT(1, subscribeCount);
+	CHECK_EQUAL_C_INT(2, aws_iot_mqtt_get_session_record(&iotClient, record, AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS));
+}
+
+/* K:3 - Subscription with another QoS than recorded is sent */
+TEST_C(SessionTests, ResumedSessionQosChangeSubscribes) {
+	uint32_t record[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+	uint16_t count;
+
+	IOT_DEBUG("-->Running Session Tests - K:3 - Subscription with another QoS than recorded is sent \n");
+
+	connectSession(false, 0, NULL, 0);
+	CHECK_EQUAL_C_INT(SUCCESS, subscribe(topicA, QOS0));
+	count = aws_iot_mqtt_get_session_record(&iotClient, record, AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS);
+
+	connectSession(false, 1, record, count);
+	CHECK_EQUAL_C_INT(SUCCESS, subscribe(topicA, QOS1));
+	CHECK_EQUAL_C_INT(1, subscribeCount);
+}
+
+/* K:4 - New session drops the loaded record */
+TEST_C(SessionTests, NewSessionDropsRecord) {
+	uint32_t record[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+	uint16_t count;
+
+	IOT_DEBUG("-->Running Session Tests - K:4 - New session drops the loaded record \n");
+
+	connectSession(false, 0, NULL, 0);
+	CHECK_EQUAL_C_INT(SUCCESS, subscribe(topicA, QOS1));
+	CHECK_EQUAL_C_INT(SUCCESS, subscribe(topicB, QOS1));
+	count = aws_iot_mqtt_get_session_record(&iotClient, record, AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS);
+	CHECK_EQUAL_C_INT(2, count);
+
+	/* Session expired on the broker */
+	connectSession(false, 0, record, count);
+	CHECK_EQUAL_C_INT(false, aws_iot_mqtt_is_session_present(&iotClient));
+	CHECK_EQUAL_C_INT(0, aws_iot_mqtt_get_session_record(&iotClient, record, AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS));
+
+	CHECK_EQUAL_C_INT(SUCCESS, subscribe(topicA, QOS1));
+	CHECK_EQUAL_C_INT(1, subscribeCount);
+	CHECK_EQUAL_C_INT(1, aws_iot_mqtt_get_session_record(&iotClient, record, AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS));
+}
+
+/* K:5 - Reconnect to a resumed session skips the resubscribe */
+TEST_C(SessionTests, ReconnectResumedSkipsResubscribe) {
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Session Tests - K:5 - Reconnect to a resumed session skips the resubscribe \n");
+
+	connectSession(false, 0, NULL, 0);
+	CHECK_EQUAL_C_INT(SUCCESS, subscribe(topicA, QOS1));
+	CHECK_EQUAL_C_INT(SUCCESS, subscribe(topicB, QOS1));
+	CHECK_EQUAL_C_INT(2, subscribeCount);
+
+	rc = aws_iot_mqtt_disconnect(&iotClient);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	subscribeCount = 0;
+	ResetTLSBuffer();
+	setTLSRxBufferForConnack(&connectParams, 1, 0);
+	rc = aws_iot_mqtt_attempt_reconnect(&iotClient);
+	CHECK_EQUAL_C_INT(NETWORK_RECONNECTED, rc);
+	CHECK_EQUAL_C_INT(0, subscribeCount);
+
+	/* Handlers are still registered */
+	setTLSRxBufferWithMsgOnSubscribedTopic(topicB, strlen(topicB), QOS1, testPubMsgParams, "resumed");
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_STRING("resumed", callbackMsg);
+}
+
+/* K:6 - Reconnect to a new session resubscribes */
+TEST_C(SessionTests, ReconnectNewSessionResubscribes) {
+	uint32_t record[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Session Tests - K:6 - Reconnect to a new session resubscribes \n");
+
+	connectSession(false, 0, NULL, 0);
+	CHECK_EQUAL_C_INT(SUCCESS, subscribe(topicA, QOS1));
+
+	rc = aws_iot_mqtt_disconnect(&iotClient);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	subscribeCount = 0;
+	ResetTLSBuffer();
+	setTLSRxBufferForConnackAndSuback(&connectParams, 0, topicA, strlen(topicA), QOS1);
+	rc = aws_iot_mqtt_attempt_reconnect(&iotClient);
+	CHECK_EQUAL_C_INT(NETWORK_RECONNECTED, rc);
+	CHECK_EQUAL_C_INT(1, subscribeCount);
+	CHECK_EQUAL_C_INT(1, aws_iot_mqtt_get_session_record(&iotClient, record, AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS));
+}
+
+/* K:7 - Unsubscribe removes the subscription from the record */
+TEST_C(SessionTests, UnsubscribeRemovesRecord) {
+	uint32_t record[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+	uint16_t count;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Session Tests - K:7 - Unsubscribe removes the subscription from the record \n");
+
+	connectSession(false, 0, NULL, 0);
+	CHECK_EQUAL_C_INT(SUCCESS, subscribe(topicA, QOS1));
+	CHECK_EQUAL_C_INT(SUCCESS, subscribe(topicB, QOS1));
+
+	ResetTLSBuffer();
+	setTLSRxBufferForUnsuback();
+	rc = aws_iot_mqtt_unsubscribe(&iotClient, topicA, (uint16_t) strlen(topicA));
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	count = aws_iot_mqtt_get_session_record(&iotClient, record, AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS);
+	CHECK_EQUAL_C_INT(1, count);
+
+	/* After a reboot only the remaining filter is skipped */
+	connectSession(false, 1, record, count);
+	CHECK_EQUAL_C_INT(SUCCESS, subscribe(topicB, QOS1));
+	CHECK_EQUAL_C_INT(0, subscribeCount);
+	CHECK_EQUAL_C_INT(SUCCESS, subscribe(topicA, QOS1));
+	CHECK_EQUAL_C_INT(1, subscribeCount);
+}
+
+/* K:8 - Session record can only be loaded while disconnected */
+TEST_C(SessionTests, SetRecordInvalidParams) {
+	uint32_t record[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS + 1] = {0};
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Session Tests - K:8 - Session record can only be loaded while disconnected \n");
+
+	rc = aws_iot_mqtt_init(&iotClient, &initParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	rc = aws_iot_mqtt_set_session_record(NULL, record, 1);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+	rc = aws_iot_mqtt_set_session_record(&iotClient, NULL, 1);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+	rc = aws_iot_mqtt_set_session_record(&iotClient, record, AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS + 1);
+	CHECK_EQUAL_C_INT(MAX_SIZE_ERROR, rc);
+	CHECK_EQUAL_C_INT(0, aws_iot_mqtt_get_session_record(NULL, record, 1));
+	CHECK_EQUAL_C_INT(false, aws_iot_mqtt_is_session_present(NULL));
+
+	connectSession(false, 0, NULL, 0);
+	rc = aws_iot_mqtt_set_session_record(&iotClient, record, 1);
+	CHECK_EQUAL_C_INT(NETWORK_ALREADY_CONNECTED_ERROR, rc);
+}
+
+/* K:9 - Reconnect to a new session resubscribes all filters in one SUBSCRIBE */
+TEST_C(SessionTests, ReconnectNewSessionBatchesResubscribe) {
+	unsigned char connackAndSuback[] = {0x20, 0x02, 0x00, 0x00, 0x90, 0x04, 0x02, 0x00, QOS1, QOS1};
+	uint32_t record[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Session Tests - K:9 - Reconnect to a new session resubscribes in one SUBSCRIBE \n");
+
+	connectSession(false, 0, NULL, 0);
+	CHECK_EQUAL_C_INT(SUCCESS, subscribe(topicA, QOS1));
+	CHECK_EQUAL_C_INT(SUCCESS, subscribe(topicB, QOS1));
+
+	rc = aws_iot_mqtt_disconnect(&iotClient);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	subscribeCount = 0;
+	ResetTLSBuffer();
+	memcpy(RxBuffer.pBuffer, connackAndSuback, sizeof(connackAndSuback));
+	RxBuffer.len = sizeof(connackAndSuback);
+	RxBuffer.NoMsgFlag = false;
+	RxIndex = 0;
+	rc = aws_iot_mqtt_attempt_reconnect(&iotClient);
+	CHECK_EQUAL_C_INT(NETWORK_RECONNECTED, rc);
+	CHECK_EQUAL_C_INT(1, subscribeCount);
+	CHECK_EQUAL_C_INT(2, aws_iot_mqtt_get_session_record(&iotClient, record, AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS));
+}
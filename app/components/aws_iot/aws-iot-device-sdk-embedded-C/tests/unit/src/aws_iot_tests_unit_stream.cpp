@@ -0,0 +1,38 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_stream.cpp
+ * @brief IoT Client Unit Testing - Streaming Receive Tests
+ */
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness_c.h>
+
+TEST_GROUP_C(StreamTests){
+	TEST_GROUP_C_SETUP_WRAPPER(StreamTests)
+	TEST_GROUP_C_TEARDOWN_WRAPPER(StreamTests)
+};
+
+/* M:1 - Payload larger than the read buffer comes in ordered chunks */
+TEST_GROUP_C_WRAPPER(StreamTests, LargePayloadInChunks)
+/* M:2 - Packet after a streamed payload goes to the subscribe handler */
+TEST_GROUP_C_WRAPPER(StreamTests, NextPacketAfterStream)
+/* M:3 - Streamed QoS1 publish is acknowledged after its last chunk */
+TEST_GROUP_C_WRAPPER(StreamTests, Qos1AckedAfterLastChunk)
+/* M:4 - Topic name too long for the read buffer is dropped */
+TEST_GROUP_C_WRAPPER(StreamTests, TopicTooLongDropped)
+/* M:5 - Payload put together by the stream handler goes to the subscribe handler */
+TEST_GROUP_C_WRAPPER(StreamTests, ReassembledToSubscribeHandler)
@@ -0,0 +1,281 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_stream_helper.c
+ * @brief IoT Client Unit Testing - Streaming Receive Tests Helper
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <CppUTest/TestHarness_c.h>
+
+#include "aws_iot_mqtt_client_interface.h"
+#include "aws_iot_tests_unit_helper_functions.h"
+#include "aws_iot_tests_unit_mock_tls_params.h"
+#include "aws_iot_log.h"
+
+#define STREAM_PAYLOAD_MAX 2048
+
+static IoT_Client_Init_Params initParams;
+static IoT_Client_Connect_Params connectParams;
+static IoT_Publish_Message_Params testPubMsgParams;
+static AWS_IoT_Client iotClient;
+
+static char subTopic[] = "sdk/stream";
+static char callbackOrder[16];
+
+/* Payload put together from the chunks */
+static unsigned char streamPayload[STREAM_PAYLOAD_MAX];
+static size_t streamLen;
+static size_t streamTotalLen;
+static size_t streamChunkCount;
+static size_t streamFirstChunkLen;
+static QoS streamQos;
+static bool streamTopicMatched;
+static bool streamOrderError;
+static bool streamDeliver;			/* Pass the whole payload to the subscribe handlers */
+static size_t deliveredLen;
+
+static void orderedCallbackHandler(AWS_IoT_Client *pClient, char *topicName, uint16_t topicNameLen,
+								   IoT_Publish_Message_Params *params, void *pData) {
+	size_t len = strlen(callbackOrder);
+
+	IOT_UNUSED(pClient);
+	IOT_UNUSED(topicName);
+	IOT_UNUSED(topicNameLen);
+	IOT_UNUSED(pData);
+
+	if(len < sizeof(callbackOrder) - 1) {
+		callbackOrder[len] = ((char *) params->payload)[0];
+		callbackOrder[len + 1] = '\0';
+	}
+	deliveredLen = params->payloadLen;
+}
+
+static void streamCallbackHandler(AWS_IoT_Client *pClient, char *topicName, uint16_t topicNameLen,
+								  IoT_Publish_Message_Params *params, size_t payloadOffset, size_t payloadTotalLen,
+								  void *pData) {
+	IOT_UNUSED(pData);
+
+	if(payloadOffset != streamLen || payloadOffset + params->payloadLen > STREAM_PAYLOAD_MAX) {
+		streamOrderError = true;
+		return;
+	}
+
+	if(0 == streamChunkCount) {
+		streamFirstChunkLen = params->payloadLen;
+	}
+
+	memcpy(&streamPayload[payloadOffset], params->payload, params->payloadLen);
+	streamLen += params->payloadLen;
+	streamTotalLen = payloadTotalLen;
+	streamChunkCount++;
+	streamQos = params->qos;
+	streamTopicMatched = (strlen(subTopic) == topicNameLen) && (0 == strncmp(subTopic, topicName, topicNameLen));
+
+	if(streamDeliver && streamLen == payloadTotalLen) {
+		IoT_Publish_Message_Params msg = *params;
+
+		msg.payload = streamPayload;
+		msg.payloadLen = streamLen;
+		if(SUCCESS != aws_iot_mqtt_deliver_message(pClient, topicName, topicNameLen, &msg)) {
+			streamOrderError = true;
+		}
+	}
+}
+
+/* Append a PUBLISH to the mock receive buffer, payload byte i is (tag + i) */
+static void appendPublish(const char *topic, size_t topicLen, QoS qos, uint16_t packetId, char tag,
+						  size_t payloadLen) {
+	size_t cursor = RxBuffer.len;
+	size_t i;
+
+	RxBuffer.NoMsgFlag = false;
+	RxBuffer.pBuffer[cursor++] = (unsigned char) (0x30 | (qos << 1));
+	encodeRemainingLength(RxBuffer.pBuffer, &cursor, 2 + topicLen + ((QOS0 != qos) ? 2 : 0) + payloadLen);
+	RxBuffer.pBuffer[cursor++] = (unsigned char) ((topicLen & 0xFF00) >> 8);
+	RxBuffer.pBuffer[cursor++] = (unsigned char) (topicLen & 0xFF);
+	memcpy(&RxBuffer.pBuffer[cursor], topic, topicLen);
+	cursor += topicLen;
+	if(QOS0 != qos) {
+		RxBuffer.pBuffer[cursor++] = (unsigned char) ((packetId & 0xFF00) >> 8);
+		RxBuffer.pBuffer[cursor++] = (unsigned char) (packetId & 0xFF);
+	}
+	for(i = 0; i < payloadLen; i++) {
+		RxBuffer.pBuffer[cursor++] = (unsigned char) (tag + i);
+	}
+
+	RxBuffer.len = cursor;
+}
+
+static bool isStreamPayload(char tag, size_t payloadLen) {
+	size_t i;
+
+	if(streamLen != payloadLen) {
+		return false;
+	}
+
+	for(i = 0; i < payloadLen; i++) {
+		if(streamPayload[i] != (unsigned char) (tag + i)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+TEST_GROUP_C_SETUP(StreamTests) {
+	IoT_Error_t rc;
+
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	rc = aws_iot_mqtt_init(&iotClient, &initParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	rc = aws_iot_mqtt_autoreconnect_set_status(&iotClient, false);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	testPubMsgParams.qos = QOS1;
+	testPubMsgParams.isRetained = 0;
+	testPubMsgParams.payload = (void *) "x";
+	testPubMsgParams.payloadLen = 1;
+
+	ResetTLSBuffer();
+	setTLSRxBufferForSuback(subTopic, strlen(subTopic), QOS1, testPubMsgParams);
+	rc = aws_iot_mqtt_subscribe(&iotClient, subTopic, (uint16_t) strlen(subTopic), QOS1, orderedCallbackHandler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	rc = aws_iot_mqtt_set_stream_handler(&iotClient, streamCallbackHandler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	memset(callbackOrder, 0, sizeof(callbackOrder));
+	memset(streamPayload, 0, sizeof(streamPayload));
+	streamLen = 0;
+	streamTotalLen = 0;
+	streamChunkCount = 0;
+	streamFirstChunkLen = 0;
+	streamQos = QOS0;
+	streamTopicMatched = false;
+	streamOrderError = false;
+	streamDeliver = false;
+	deliveredLen = 0;
+	ResetTLSBuffer();
+}
+
+TEST_GROUP_C_TEARDOWN(StreamTests) {
+	/* Clean up. Not checking return code here because this is common to all tests.
+	 * A test might have already caused a disconnect by this point.
+	 */
+	IoT_Error_t rc = aws_iot_mqtt_disconnect(&iotClient);
+	IOT_UNUSED(rc);
+}
+
+/* M:1 - Payload larger than the read buffer comes in ordered chunks */
+TEST_C(StreamTests, LargePayloadInChunks) {
+	IoT_Error_t rc;
+	size_t payloadLen = (AWS_IOT_MQTT_RX_BUF_LEN * 3) + 17;
+	/* Fixed header with two remaining length bytes, then the topic */
+	size_t headerLen = 3 + 2 + strlen(subTopic);
+
+	IOT_DEBUG("-->Running Stream Tests - M:1 - Payload larger than the read buffer comes in ordered chunks \n");
+
+	appendPublish(subTopic, strlen(subTopic), QOS0, 0, 'a', payloadLen);
+
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(false, streamOrderError);
+	CHECK_EQUAL_C_INT(true, streamTopicMatched);
+	CHECK_EQUAL_C_INT(true, isStreamPayload('a', payloadLen));
+	CHECK_EQUAL_C_INT((int) payloadLen, (int) streamTotalLen);
+	CHECK_EQUAL_C_INT(AWS_IOT_MQTT_RX_BUF_LEN - (int) headerLen, (int) streamFirstChunkLen);
+	CHECK_EQUAL_C_INT((int) ((payloadLen + streamFirstChunkLen - 1) / streamFirstChunkLen), (int) streamChunkCount);
+	CHECK_EQUAL_C_STRING("", callbackOrder);
+}
+
+/* M:2 - Packet after a streamed payload goes to the subscribe handler */
+TEST_C(StreamTests, NextPacketAfterStream) {
+	IoT_Error_t rc;
+	size_t payloadLen = AWS_IOT_MQTT_RX_BUF_LEN + 1;
+
+	IOT_DEBUG("-->Running Stream Tests - M:2 - Packet after a streamed payload goes to the subscribe handler \n");
+
+	appendPublish(subTopic, strlen(subTopic), QOS0, 0, 'a', payloadLen);
+	appendPublish(subTopic, strlen(subTopic), QOS0, 0, 'b', 10);
+
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(true, isStreamPayload('a', payloadLen));
+	CHECK_EQUAL_C_STRING("b", callbackOrder);
+}
+
+/* M:3 - Streamed QoS1 publish is acknowledged after its last chunk */
+TEST_C(StreamTests, Qos1AckedAfterLastChunk) {
+	IoT_Error_t rc;
+	size_t payloadLen = (AWS_IOT_MQTT_RX_BUF_LEN * 2) + 3;
+
+	IOT_DEBUG("-->Running Stream Tests - M:3 - Streamed QoS1 publish is acknowledged after its last chunk \n");
+
+	appendPublish(subTopic, strlen(subTopic), QOS1, 7, 'c', payloadLen);
+
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(true, isStreamPayload('c', payloadLen));
+	CHECK_EQUAL_C_INT(QOS1, streamQos);
+	CHECK_EQUAL_C_INT(1, isLastTLSTxMessagePuback());
+	CHECK_EQUAL_C_INT(7, (TxBuffer.pBuffer[2] << 8) | TxBuffer.pBuffer[3]);
+}
+
+/* M:4 - Topic name too long for the read buffer is dropped */
+TEST_C(StreamTests, TopicTooLongDropped) {
+	IoT_Error_t rc;
+	char longTopic[AWS_IOT_MQTT_RX_BUF_LEN];
+
+	IOT_DEBUG("-->Running Stream Tests - M:4 - Topic name too long for the read buffer is dropped \n");
+
+	memset(longTopic, 't', sizeof(longTopic));
+	appendPublish(longTopic, sizeof(longTopic), QOS0, 0, 'a', 10);
+	appendPublish(subTopic, strlen(subTopic), QOS0, 0, 'b', 10);
+
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(MQTT_RX_BUFFER_TOO_SHORT_ERROR, rc);
+	CHECK_EQUAL_C_INT(0, (int) streamChunkCount);
+
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_STRING("b", callbackOrder);
+}
+
+/* M:5 - Payload put together by the stream handler goes to the subscribe handler */
+TEST_C(StreamTests, ReassembledToSubscribeHandler) {
+	IoT_Error_t rc;
+	size_t payloadLen = (AWS_IOT_MQTT_RX_BUF_LEN * 2) + 5;
+
+	IOT_DEBUG("-->Running Stream Tests - M:5 - Payload put together by the stream handler goes to the subscribe handler \n");
+
+	streamDeliver = true;
+	appendPublish(subTopic, strlen(subTopic), QOS0, 0, 'd', payloadLen);
+
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(false, streamOrderError);
+	CHECK_EQUAL_C_INT(true, isStreamPayload('d', payloadLen));
+	CHECK_EQUAL_C_STRING("d", callbackOrder);
+	CHECK_EQUAL_C_INT((int) payloadLen, (int) deliveredLen);
+}
@@ -77,3 +77,14 @@ TEST_GROUP_C_WRAPPER(SubscribeTests, subscribeTopicHashkeyMustBeTheLastFail)
 TEST_GROUP_C_WRAPPER(SubscribeTests, subscribeTopicWithPluskeySuccess)
 /* C:22 - Subscribe with '+' as last character in topic name, Success */
 TEST_GROUP_C_WRAPPER(SubscribeTests, subscribeTopicPluskeyComesLastSuccess)
+
+/* C:23 - Subscribe batch, one SUBSCRIBE and one SUBACK, messages on each topic */
+TEST_GROUP_C_WRAPPER(SubscribeTests, SubscribeBatchSuccess)
+/* C:24 - Subscribe batch, filter refused by the broker is not registered */
+TEST_GROUP_C_WRAPPER(SubscribeTests, SubscribeBatchPartiallyRefused)
+/* C:25 - Subscribe batch, invalid parameters */
+TEST_GROUP_C_WRAPPER(SubscribeTests, SubscribeBatchInvalidParams)
+/* C:26 - Subscribe, refused by the broker, handler not registered */
+TEST_GROUP_C_WRAPPER(SubscribeTests, subscribeRefusedFailure)
+/* C:27 - Subscribe batch, SUBACK with missing return codes */
+TEST_GROUP_C_WRAPPER(SubscribeTests, SubscribeBatchShortSuback)
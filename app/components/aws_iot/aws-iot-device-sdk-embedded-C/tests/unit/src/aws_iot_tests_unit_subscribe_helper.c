@@ -23,6 +23,7 @@
 #include <CppUTest/TestHarness_c.h>
 
 #include "aws_iot_tests_unit_helper_functions.h"
+#include "aws_iot_tests_unit_mock_tls_params.h"
 #include "aws_iot_log.h"
 
 static IoT_Client_Init_Params initParams;
@@ -155,6 +156,23 @@ static void iot_subscribe_callback_handler6(AWS_IoT_Client *pClient, char *topic
 	}
 }
 
+/* Number of topic filters in the last SUBSCRIBE sent, remaining length fits in one byte */
+static uint8_t getLastSubscribeFilterCount(void) {
+	size_t cursor = 4; /* header, remaining length, packet id */
+	uint8_t count = 0;
+
+	if(0x82 != TxBuffer.pBuffer[0]) {
+		return 0;
+	}
+
+	while(cursor < (size_t) (2 + TxBuffer.pBuffer[1])) {
+		cursor += (size_t) (2 + ((TxBuffer.pBuffer[cursor] << 8) | TxBuffer.pBuffer[cursor + 1]) + 1);
+		count++;
+	}
+
+	return count;
+}
+
 TEST_GROUP_C_SETUP(SubscribeTests) {
 	IoT_Error_t rc;
 	ResetTLSBuffer();
@@ -604,3 +622,131 @@ TEST_C(SubscribeTests, subscribeTopicPluskeyComesLastSuccess) {
 
 	IOT_DEBUG("-->Success - C:22 - Subscribe with '+' as last character in topic name, Success \n");
 }
+
+/* C:23 - Subscribe batch, one SUBSCRIBE and one SUBACK, messages on each topic */
+TEST_C(SubscribeTests, SubscribeBatchSuccess) {
+	IoT_Error_t rc = SUCCESS;
+	unsigned char returnCodes[3] = {QOS1, QOS0, QOS1};
+	IoT_Subscribe_Filter filters[3] = {
+			{"sdk/Test/batch1", 15, QOS1, iot_subscribe_callback_handler1, NULL},
+			{"sdk/Test/batch2", 15, QOS0, iot_subscribe_callback_handler2, NULL},
+			{"sdk/Test/batch3", 15, QOS1, iot_subscribe_callback_handler3, NULL}
+	};
+
+	IOT_DEBUG("-->Running Subscribe Tests - C:23 - Subscribe batch, one SUBSCRIBE and one SUBACK \n");
+
+	setTLSRxBufferForMultiSuback(returnCodes, 3);
+	rc = aws_iot_mqtt_subscribe_batch(&iotClient, filters, 3);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(3, getLastSubscribeFilterCount());
+	CHECK_EQUAL_C_STRING("sdk/Test/batch1", LastSubscribeMessage);
+	CHECK_EQUAL_C_INT(CLIENT_STATE_CONNECTED_IDLE, aws_iot_mqtt_get_client_state(&iotClient));
+
+	snprintf(CallbackMsgString2, 100, "XXXX");
+	setTLSRxBufferWithMsgOnSubscribedTopic("sdk/Test/batch2", 15, QOS1, testPubMsgParams, "batch2");
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_STRING("batch2", CallbackMsgString2);
+
+	snprintf(CallbackMsgString3, 100, "XXXX");
+	setTLSRxBufferWithMsgOnSubscribedTopic("sdk/Test/batch3", 15, QOS1, testPubMsgParams, "batch3");
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_STRING("batch3", CallbackMsgString3);
+
+	IOT_DEBUG("-->Success - C:23 - Subscribe batch, one SUBSCRIBE and one SUBACK \n");
+}
+
+/* C:24 - Subscribe batch, filter refused by the broker is not registered */
+TEST_C(SubscribeTests, SubscribeBatchPartiallyRefused) {
+	IoT_Error_t rc = SUCCESS;
+	unsigned char returnCodes[2] = {0x80, QOS0};
+	IoT_Subscribe_Filter filters[2] = {
+			{"sdk/Test/refused", 16, QOS0, iot_subscribe_callback_handler1, NULL},
+			{"sdk/Test/granted", 16, QOS0, iot_subscribe_callback_handler2, NULL}
+	};
+
+	IOT_DEBUG("-->Running Subscribe Tests - C:24 - Subscribe batch, refused filter is not registered \n");
+
+	setTLSRxBufferForMultiSuback(returnCodes, 2);
+	rc = aws_iot_mqtt_subscribe_batch(&iotClient, filters, 2);
+	CHECK_EQUAL_C_INT(MQTT_SUBSCRIBE_REFUSED_ERROR, rc);
+	CHECK_EQUAL_C_INT(CLIENT_STATE_CONNECTED_IDLE, aws_iot_mqtt_get_client_state(&iotClient));
+
+	snprintf(CallbackMsgString1, 100, "XXXX");
+	setTLSRxBufferWithMsgOnSubscribedTopic("sdk/Test/refused", 16, QOS1, testPubMsgParams, "refused");
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_STRING("XXXX", CallbackMsgString1);
+
+	snprintf(CallbackMsgString2, 100, "XXXX");
+	setTLSRxBufferWithMsgOnSubscribedTopic("sdk/Test/granted", 16, QOS1, testPubMsgParams, "granted");
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_STRING("granted", CallbackMsgString2);
+
+	IOT_DEBUG("-->Success - C:24 - Subscribe batch, refused filter is not registered \n");
+}
+
+/* C:25 - Subscribe batch, invalid parameters */
+TEST_C(SubscribeTests, SubscribeBatchInvalidParams) {
+	IoT_Subscribe_Filter filters[AWS_IOT_MQTT_SUBSCRIBE_BATCH_MAX + 1] = {
+			{"sdk/Test/batch1", 15, QOS0, iot_subscribe_callback_handler1, NULL},
+			{NULL, 0, QOS0, iot_subscribe_callback_handler2, NULL}
+	};
+
+	IOT_DEBUG("-->Running Subscribe Tests - C:25 - Subscribe batch, invalid parameters \n");
+
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_subscribe_batch(NULL, filters, 1));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_subscribe_batch(&iotClient, NULL, 1));
+	CHECK_EQUAL_C_INT(MAX_SIZE_ERROR, aws_iot_mqtt_subscribe_batch(&iotClient, filters, 0));
+	CHECK_EQUAL_C_INT(MAX_SIZE_ERROR,
+					  aws_iot_mqtt_subscribe_batch(&iotClient, filters, AWS_IOT_MQTT_SUBSCRIBE_BATCH_MAX + 1));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_subscribe_batch(&iotClient, filters, 2));
+	CHECK_EQUAL_C_INT(0, getLastSubscribeFilterCount());
+
+	IOT_DEBUG("-->Success - C:25 - Subscribe batch, invalid parameters \n");
+}
+
+/* C:26 - Subscribe, refused by the broker, handler not registered */
+TEST_C(SubscribeTests, subscribeRefusedFailure) {
+	IoT_Error_t rc = SUCCESS;
+
+	IOT_DEBUG("-->Running Subscribe Tests - C:26 - Subscribe, refused by the broker \n");
+
+	setTLSRxBufferForSubFail();
+	rc = aws_iot_mqtt_subscribe(&iotClient, subTopic, subTopicLen, QOS0, iot_subscribe_callback_handler, NULL);
+	CHECK_EQUAL_C_INT(MQTT_SUBSCRIBE_REFUSED_ERROR, rc);
+
+	snprintf(CallbackMsgString, 100, "NOT_VISITED");
+	setTLSRxBufferWithMsgOnSubscribedTopic(subTopic, subTopicLen, QOS1, testPubMsgParams, "refused");
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_STRING("NOT_VISITED", CallbackMsgString);
+
+	IOT_DEBUG("-->Success - C:26 - Subscribe, refused by the broker \n");
+}
+
+/* C:27 - Subscribe batch, SUBACK with missing return codes */
+TEST_C(SubscribeTests, SubscribeBatchShortSuback) {
+	IoT_Error_t rc = SUCCESS;
+	unsigned char returnCodes[1] = {QOS0};
+	IoT_Subscribe_Filter filters[2] = {
+			{"sdk/Test/batch1", 15, QOS0, iot_subscribe_callback_handler1, NULL},
+			{"sdk/Test/batch2", 15, QOS0, iot_subscribe_callback_handler2, NULL}
+	};
+
+	IOT_DEBUG("-->Running Subscribe Tests - C:27 - Subscribe batch, SUBACK with missing return codes \n");
+
+	setTLSRxBufferForMultiSuback(returnCodes, 1);
+	rc = aws_iot_mqtt_subscribe_batch(&iotClient, filters, 2);
+	CHECK_EQUAL_C_INT(FAILURE, rc);
+
+	snprintf(CallbackMsgString1, 100, "XXXX");
+	setTLSRxBufferWithMsgOnSubscribedTopic("sdk/Test/batch1", 15, QOS1, testPubMsgParams, "batch1");
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_STRING("XXXX", CallbackMsgString1);
+
+	IOT_DEBUG("-->Success - C:27 - Subscribe batch, SUBACK with missing return codes \n");
+}
@@ -0,0 +1,42 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_topic_trie.cpp
+ * @brief IoT Client Unit Testing - Topic Trie Tests
+ */
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness_c.h>
+
+TEST_GROUP_C(TopicTrieTests){
+	TEST_GROUP_C_SETUP_WRAPPER(TopicTrieTests)
+	TEST_GROUP_C_TEARDOWN_WRAPPER(TopicTrieTests)
+};
+
+/* H:1 - Exact topic filters match only their own topic */
+TEST_GROUP_C_WRAPPER(TopicTrieTests, ExactMatch)
+/* H:2 - Single level wildcard matches exactly one level */
+TEST_GROUP_C_WRAPPER(TopicTrieTests, SingleLevelWildcard)
+/* H:3 - Multi level wildcard matches all remaining levels */
+TEST_GROUP_C_WRAPPER(TopicTrieTests, MultiLevelWildcard)
+/* H:4 - Remove one of two handlers on the same filter */
+TEST_GROUP_C_WRAPPER(TopicTrieTests, RemoveSharedFilter)
+/* H:5 - Insert into a full trie fails and leaves the trie unchanged */
+TEST_GROUP_C_WRAPPER(TopicTrieTests, InsertFullTrie)
+/* H:6 - Overlapping subscriptions, all matching handlers called in index order */
+TEST_GROUP_C_WRAPPER(TopicTrieTests, DispatchOverlappingFilters)
+/* H:7 - Micro benchmark, trie against a scan of all handlers */
+TEST_GROUP_C_WRAPPER(TopicTrieTests, DispatchBenchmark)
@@ -0,0 +1,344 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_topic_trie_helper.c
+ * @brief IoT Client Unit Testing - Topic Trie Tests Helper
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <CppUTest/TestHarness_c.h>
+
+#include "aws_iot_mqtt_client_interface.h"
+#include "aws_iot_mqtt_client_topic_trie.h"
+#include "aws_iot_tests_unit_helper_functions.h"
+#include "aws_iot_log.h"
+
+#define BENCHMARK_ROUNDS 200000
+
+static AWS_IoT_Topic_Trie trie;
+static uint32_t matched[AWS_IOT_MQTT_TOPIC_TRIE_MATCH_WORDS];
+
+static IoT_Client_Init_Params initParams;
+static IoT_Client_Connect_Params connectParams;
+static IoT_Publish_Message_Params testPubMsgParams;
+static AWS_IoT_Client iotClient;
+static char callbackOrder[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS + 1];
+
+static bool isMatched(uint16_t handlerIndex) {
+	return 0 != (matched[handlerIndex / 32] & (1u << (handlerIndex % 32)));
+}
+
+static uint32_t matchTopic(const char *pTopicName) {
+	return aws_iot_mqtt_topic_trie_match(&trie, pTopicName, (uint16_t) strlen(pTopicName), matched);
+}
+
+static IoT_Error_t insertFilter(uint16_t handlerIndex, const char *pTopicFilter) {
+	return aws_iot_mqtt_topic_trie_insert(&trie, handlerIndex, pTopicFilter, (uint16_t) strlen(pTopicFilter));
+}
+
+/* Reference matcher, same rules as the scan of all handlers the trie replaces */
+static bool referenceMatch(const char *pTopicFilter, const char *pTopicName, uint16_t topicNameLen) {
+	const char *curf = pTopicFilter;
+	const char *curn = pTopicName;
+	const char *curn_end = curn + topicNameLen;
+
+	if(strlen(pTopicFilter) == topicNameLen && 0 == strncmp(pTopicFilter, pTopicName, topicNameLen)) {
+		return true;
+	}
+
+	while(*curf && (curn < curn_end)) {
+		if(*curn == '/' && *curf != '/') {
+			break;
+		}
+		if(*curf != '+' && *curf != '#' && *curf != *curn) {
+			break;
+		}
+		if(*curf == '+') {
+			const char *nextpos = curn + 1;
+			while(nextpos < curn_end && *nextpos != '/')
+				nextpos = ++curn + 1;
+		} else if(*curf == '#') {
+			curn = curn_end - 1;
+		}
+		curf++;
+		curn++;
+	}
+
+	return (curn == curn_end) && (*curf == '\0');
+}
+
+static double elapsedNs(struct timespec *pStart, struct timespec *pEnd) {
+	return (double) (pEnd->tv_sec - pStart->tv_sec) * 1e9 + (double) (pEnd->tv_nsec - pStart->tv_nsec);
+}
+
+static void orderedCallbackHandler(AWS_IoT_Client *pClient, char *topicName, uint16_t topicNameLen,
+								   IoT_Publish_Message_Params *params, void *pData) {
+	size_t len = strlen(callbackOrder);
+
+	IOT_UNUSED(pClient);
+	IOT_UNUSED(topicName);
+	IOT_UNUSED(topicNameLen);
+	IOT_UNUSED(params);
+
+	if(len < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS) {
+		callbackOrder[len] = *(char *) pData;
+		callbackOrder[len + 1] = '\0';
+	}
+}
+
+TEST_GROUP_C_SETUP(TopicTrieTests) {
+	aws_iot_mqtt_topic_trie_init(&trie);
+	memset(callbackOrder, 0, sizeof(callbackOrder));
+	ResetTLSBuffer();
+}
+
+TEST_GROUP_C_TEARDOWN(TopicTrieTests) { }
+
+/* H:1 - Exact topic filters match only their own topic */
+TEST_C(TopicTrieTests, ExactMatch) {
+	IOT_DEBUG("-->Running Topic Trie Tests - H:1 - Exact topic filters match only their own topic \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, insertFilter(0, "$aws/things/dev/shadow/update/delta"));
+	CHECK_EQUAL_C_INT(SUCCESS, insertFilter(1, "$aws/things/dev/shadow/get/accepted"));
+	CHECK_EQUAL_C_INT(SUCCESS, insertFilter(2, "lox/dev/down"));
+
+	CHECK_EQUAL_C_INT(1, matchTopic("$aws/things/dev/shadow/get/accepted"));
+	CHECK_EQUAL_C_INT(1, isMatched(1));
+	CHECK_EQUAL_C_INT(1, matchTopic("lox/dev/down"));
+	CHECK_EQUAL_C_INT(1, isMatched(2));
+	CHECK_EQUAL_C_INT(0, matchTopic("lox/dev"));
+	CHECK_EQUAL_C_INT(0, matchTopic("lox/dev/down/more"));
+	CHECK_EQUAL_C_INT(0, matchTopic("$aws/things/dev/shadow/get/rejected"));
+
+	IOT_DEBUG("-->Success - H:1 - Exact topic filters match only their own topic \n");
+}
+
+/* H:2 - Single level wildcard matches exactly one level */
+TEST_C(TopicTrieTests, SingleLevelWildcard) {
+	IOT_DEBUG("-->Running Topic Trie Tests - H:2 - Single level wildcard matches exactly one level \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, insertFilter(0, "$aws/things/+/shadow/update/delta"));
+	CHECK_EQUAL_C_INT(SUCCESS, insertFilter(1, "lox/+"));
+
+	CHECK_EQUAL_C_INT(1, matchTopic("$aws/things/dev/shadow/update/delta"));
+	CHECK_EQUAL_C_INT(1, isMatched(0));
+	CHECK_EQUAL_C_INT(1, matchTopic("lox/dev"));
+	CHECK_EQUAL_C_INT(1, isMatched(1));
+	CHECK_EQUAL_C_INT(0, matchTopic("lox/dev/down"));
+	CHECK_EQUAL_C_INT(0, matchTopic("$aws/things/shadow/update/delta"));
+
+	IOT_DEBUG("-->Success - H:2 - Single level wildcard matches exactly one level \n");
+}
+
+/* H:3 - Multi level wildcard matches all remaining levels */
+TEST_C(TopicTrieTests, MultiLevelWildcard) {
+	IOT_DEBUG("-->Running Topic Trie Tests - H:3 - Multi level wildcard matches all remaining levels \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, insertFilter(0, "$aws/things/dev/jobs/#"));
+	CHECK_EQUAL_C_INT(SUCCESS, insertFilter(1, "#"));
+
+	CHECK_EQUAL_C_INT(2, matchTopic("$aws/things/dev/jobs/notify-next"));
+	CHECK_EQUAL_C_INT(1, isMatched(0));
+	CHECK_EQUAL_C_INT(1, isMatched(1));
+	CHECK_EQUAL_C_INT(2, matchTopic("$aws/things/dev/jobs/a/b/c"));
+	CHECK_EQUAL_C_INT(1, matchTopic("$aws/things/dev/shadow"));
+	CHECK_EQUAL_C_INT(1, isMatched(1));
+
+	IOT_DEBUG("-->Success - H:3 - Multi level wildcard matches all remaining levels \n");
+}
+
+/* H:4 - Remove one of two handlers on the same filter */
+TEST_C(TopicTrieTests, RemoveSharedFilter) {
+	IOT_DEBUG("-->Running Topic Trie Tests - H:4 - Remove one of two handlers on the same filter \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, insertFilter(0, "sdk/Test"));
+	CHECK_EQUAL_C_INT(SUCCESS, insertFilter(3, "sdk/Test"));
+	CHECK_EQUAL_C_INT(2, matchTopic("sdk/Test"));
+
+	aws_iot_mqtt_topic_trie_remove(&trie, 0);
+	CHECK_EQUAL_C_INT(1, matchTopic("sdk/Test"));
+	CHECK_EQUAL_C_INT(1, isMatched(3));
+
+	/* Removing twice is harmless */
+	aws_iot_mqtt_topic_trie_remove(&trie, 0);
+	aws_iot_mqtt_topic_trie_remove(&trie, 3);
+	CHECK_EQUAL_C_INT(0, matchTopic("sdk/Test"));
+	CHECK_EQUAL_C_INT(-1, trie.firstRoot);
+
+	IOT_DEBUG("-->Success - H:4 - Remove one of two handlers on the same filter \n");
+}
+
+/* H:5 - Insert into a full trie fails and leaves the trie unchanged */
+TEST_C(TopicTrieTests, InsertFullTrie) {
+	char longFilter[2 * AWS_IOT_MQTT_TOPIC_TRIE_NUM_NODES + 1];
+	uint32_t i;
+
+	IOT_DEBUG("-->Running Topic Trie Tests - H:5 - Insert into a full trie fails and leaves the trie unchanged \n");
+
+	/* One level less than the trie can hold */
+	for(i = 0; i < AWS_IOT_MQTT_TOPIC_TRIE_NUM_NODES - 1; i++) {
+		longFilter[2 * i] = (char) ('a' + (i % 26));
+		longFilter[2 * i + 1] = '/';
+	}
+	longFilter[2 * i - 1] = '\0';
+	CHECK_EQUAL_C_INT(SUCCESS, insertFilter(0, longFilter));
+
+	/* Shares no level with the first filter, needs two nodes */
+	CHECK_EQUAL_C_INT(MQTT_MAX_SUBSCRIPTIONS_REACHED_ERROR, insertFilter(1, "x/y"));
+	CHECK_EQUAL_C_INT(0, matchTopic("x"));
+	CHECK_EQUAL_C_INT(1, matchTopic(longFilter));
+
+	/* The last free node is still available */
+	CHECK_EQUAL_C_INT(SUCCESS, insertFilter(1, "x"));
+	CHECK_EQUAL_C_INT(1, matchTopic("x"));
+
+	aws_iot_mqtt_topic_trie_remove(&trie, 0);
+	CHECK_EQUAL_C_INT(SUCCESS, insertFilter(2, "x/y"));
+	CHECK_EQUAL_C_INT(1, matchTopic("x/y"));
+
+	IOT_DEBUG("-->Success - H:5 - Insert into a full trie fails and leaves the trie unchanged \n");
+}
+
+/* H:6 - Overlapping subscriptions, all matching handlers called in index order */
+TEST_C(TopicTrieTests, DispatchOverlappingFilters) {
+	static char topics[3][20] = {"sdk/+/data", "sdk/#", "sdk/dev/data"};
+	static char ids[3] = {'a', 'b', 'c'};
+	char expectedCallbackString[] = "payload";
+	IoT_Error_t rc;
+	uint32_t i;
+
+	IOT_DEBUG("-->Running Topic Trie Tests - H:6 - Overlapping subscriptions, all matching handlers called in index order \n");
+
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	rc = aws_iot_mqtt_init(&iotClient, &initParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	testPubMsgParams.qos = QOS0;
+	testPubMsgParams.isRetained = 0;
+	testPubMsgParams.payload = (void *) expectedCallbackString;
+	testPubMsgParams.payloadLen = strlen(expectedCallbackString);
+
+	for(i = 0; i < 3; i++) {
+		ResetTLSBuffer();
+		setTLSRxBufferForSuback(topics[i], strlen(topics[i]), QOS0, testPubMsgParams);
+		rc = aws_iot_mqtt_subscribe(&iotClient, topics[i], (uint16_t) strlen(topics[i]), QOS0,
+									orderedCallbackHandler, &ids[i]);
+		CHECK_EQUAL_C_INT(SUCCESS, rc);
+	}
+
+	ResetTLSBuffer();
+	setTLSRxBufferWithMsgOnSubscribedTopic("sdk/dev/data", strlen("sdk/dev/data"), QOS0, testPubMsgParams,
+										   expectedCallbackString);
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_STRING("abc", callbackOrder);
+
+	memset(callbackOrder, 0, sizeof(callbackOrder));
+	ResetTLSBuffer();
+	setTLSRxBufferWithMsgOnSubscribedTopic("sdk/dev/status", strlen("sdk/dev/status"), QOS0, testPubMsgParams,
+										   expectedCallbackString);
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_STRING("b", callbackOrder);
+
+	IOT_DEBUG("-->Success - H:6 - Overlapping subscriptions, all matching handlers called in index order \n");
+}
+
+/* H:7 - Micro benchmark, trie against a scan of all handlers
+ * Fills every handler with a shadow or jobs style filter and dispatches a mix of
+ * topic names. Both methods must find the same handlers. Timings are printed, the
+ * gap grows with AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS in aws_iot_config.h.
+ */
+TEST_C(TopicTrieTests, DispatchBenchmark) {
+	static char filters[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS][64];
+	static const char *names[] = {
+		"$aws/things/dev/shadow/update/delta",
+		"$aws/things/dev/jobs/notify-next",
+		"$aws/things/other/shadow/get/accepted",
+		"lox/dev/down",
+	};
+	const uint32_t nameCount = sizeof(names) / sizeof(names[0]);
+	struct timespec start, end;
+	uint32_t i, n, scanCount, trieCount, sink = 0;
+	uint16_t nameLen;
+	double scanNs, trieNs;
+
+	IOT_DEBUG("-->Running Topic Trie Tests - H:7 - Micro benchmark, trie against a scan of all handlers \n");
+
+	for(i = 0; i < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; i++) {
+		switch(i % 3) {
+			case 0:
+				snprintf(filters[i], sizeof(filters[i]), "$aws/things/dev%u/shadow/update/delta", (unsigned) i);
+				break;
+			case 1:
+				snprintf(filters[i], sizeof(filters[i]), "$aws/things/dev/jobs/%u/#", (unsigned) i);
+				break;
+			default:
+				snprintf(filters[i], sizeof(filters[i]), "lox/+/down%u", (unsigned) i);
+				break;
+		}
+	}
+	/* Last handlers match the benchmark topics */
+	snprintf(filters[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS - 1], 64, "$aws/things/+/shadow/#");
+	snprintf(filters[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS - 2], 64, "lox/dev/down");
+
+	for(i = 0; i < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; i++) {
+		CHECK_EQUAL_C_INT(SUCCESS, insertFilter((uint16_t) i, filters[i]));
+	}
+
+	/* Same result as the reference scan */
+	for(n = 0; n < nameCount; n++) {
+		nameLen = (uint16_t) strlen(names[n]);
+		trieCount = matchTopic(names[n]);
+		scanCount = 0;
+		for(i = 0; i < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; i++) {
+			bool ref = referenceMatch(filters[i], names[n], nameLen);
+			scanCount += ref ? 1 : 0;
+			CHECK_EQUAL_C_INT(ref, isMatched((uint16_t) i));
+		}
+		CHECK_EQUAL_C_INT(scanCount, trieCount);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(i = 0; i < BENCHMARK_ROUNDS; i++) {
+		const char *pName = names[i % nameCount];
+		nameLen = (uint16_t) strlen(pName);
+		for(n = 0; n < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; n++) {
+			sink += referenceMatch(filters[n], pName, nameLen) ? 1 : 0;
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	scanNs = elapsedNs(&start, &end) / BENCHMARK_ROUNDS;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(i = 0; i < BENCHMARK_ROUNDS; i++) {
+		sink += matchTopic(names[i % nameCount]);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	trieNs = elapsedNs(&start, &end) / BENCHMARK_ROUNDS;
+
+	printf("\nTopic dispatch, %d handlers: scan %.1f ns, trie %.1f ns per message (%u)\n",
+		   AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS, scanNs, trieNs, (unsigned) (sink & 1));
+
+	IOT_DEBUG("-->Success - H:7 - Micro benchmark, trie against a scan of all handlers \n");
+}
@@ -6,8 +6,8 @@
 #include "aws_iot_tests_unit_mock_tls_params.h"
 
 
-void _iot_tls_set_connect_params(Network *pNetwork, char *pRootCALocation, char *pDeviceCertLocation,
-								 char *pDevicePrivateKeyLocation, char *pDestinationURL,
+void _iot_tls_set_connect_params(Network *pNetwork, const char *pRootCALocation, const char *pDeviceCertLocation,
+								 const char *pDevicePrivateKeyLocation, const char *pDestinationURL,
 								 uint16_t destinationPort, uint32_t timeout_ms, bool ServerVerificationFlag) {
 	pNetwork->tlsConnectParams.DestinationPort = destinationPort;
 	pNetwork->tlsConnectParams.pDestinationURL = pDestinationURL;
@@ -18,14 +18,15 @@ void _iot_tls_set_connect_params(Network *pNetwork, char *pRootCALocation, char
 	pNetwork->tlsConnectParams.ServerVerificationFlag = ServerVerificationFlag;
 }
 
-IoT_Error_t iot_tls_init(Network *pNetwork, char *pRootCALocation, char *pDeviceCertLocation,
-						 char *pDevicePrivateKeyLocation, char *pDestinationURL,
+IoT_Error_t iot_tls_init(Network *pNetwork, const char *pRootCALocation, const char *pDeviceCertLocation,
+						 const char *pDevicePrivateKeyLocation, const char *pDestinationURL,
 						 uint16_t destinationPort, uint32_t timeout_ms, bool ServerVerificationFlag) {
 	_iot_tls_set_connect_params(pNetwork, pRootCALocation, pDeviceCertLocation, pDevicePrivateKeyLocation,
 								pDestinationURL, destinationPort, timeout_ms, ServerVerificationFlag);
 
 	pNetwork->connect = iot_tls_connect;
 	pNetwork->read = iot_tls_read;
+	pNetwork->readAvailable = iot_tls_read_available;
 	pNetwork->write = iot_tls_write;
 	pNetwork->disconnect = iot_tls_disconnect;
 	pNetwork->isConnected = iot_tls_is_connected;
@@ -187,6 +188,32 @@ IoT_Error_t iot_tls_read(Network *pNetwork, unsigned char *pMsg, size_t len, Tim
 		RxIndex += len;
 		*read_len = len;
 	}
+	RxReadCount++;
+
+	return SUCCESS;
+}
+
+IoT_Error_t iot_tls_read_available(Network *pNetwork, unsigned char *pMsg, size_t len, Timer *pTimer, size_t *read_len) {
+	IOT_UNUSED(pNetwork);
+	IOT_UNUSED(pTimer);
+
+	if(RxIndex > TLSMaxBufferSize - 1) {
+		RxIndex = TLSMaxBufferSize - 1;
+	}
+
+	if(RxBuffer.len <= RxIndex || !isTimerExpired(RxBuffer.expiry_time)) {
+		return NETWORK_SSL_NOTHING_TO_READ;
+	}
+
+	if((false == RxBuffer.NoMsgFlag) && (RxIndex < RxBuffer.len)) {
+		if(len > RxBuffer.len - RxIndex) {
+			len = RxBuffer.len - RxIndex;
+		}
+		memcpy(pMsg, &(RxBuffer.pBuffer[RxIndex]), len);
+		RxIndex += len;
+		*read_len = len;
+	}
+	RxReadCount++;
 
 	return SUCCESS;
 }
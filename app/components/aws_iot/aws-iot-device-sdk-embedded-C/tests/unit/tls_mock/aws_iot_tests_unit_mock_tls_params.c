@@ -39,6 +39,7 @@ TlsBuffer RxBuffer = {.pBuffer = RxBuf,.len = 512, .NoMsgFlag=1, .expiry_time =
 TlsBuffer TxBuffer = {.pBuffer = TxBuf,.len = 512, .NoMsgFlag=1, .expiry_time = {0, 0}, .BufMaxSize = TLSMaxBufferSize};
 
 size_t RxIndex = 0;
+size_t RxReadCount = 0;
 
 char *invalidEndpointFilter;
 char *invalidRootCAPathFilter;
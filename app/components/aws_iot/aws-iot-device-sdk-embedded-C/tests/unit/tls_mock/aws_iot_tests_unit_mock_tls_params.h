@@ -43,6 +43,7 @@ extern TlsBuffer RxBuffer;
 extern TlsBuffer TxBuffer;
 
 extern size_t RxIndex;
+extern size_t RxReadCount;
 extern unsigned char RxBuf[TLSMaxBufferSize];
 extern unsigned char TxBuf[TLSMaxBufferSize];
 extern char LastSubscribeMessage[TLSMaxBufferSize];
@@ -38,14 +38,19 @@
 
 // MQTT PubSub
 #define AWS_IOT_MQTT_TX_BUF_LEN 2048 ///< Any time a message is sent out through the MQTT layer. The message is copied into this buffer anytime a publish is done. This will also be used in the case of Thing Shadow
-#define AWS_IOT_MQTT_RX_BUF_LEN 5120 ///< Any message that comes into the device should be less than this buffer size. If a received message is bigger than this buffer size the message will be dropped.
+#define AWS_IOT_MQTT_RX_BUF_LEN 1024 ///< Any message that comes into the device should be less than this buffer size. A bigger PUBLISH is passed in chunks to the handler of aws_iot_mqtt_set_stream_handler, or dropped without one.
 #define AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS 50 ///< Maximum number of topic filters the MQTT client can handle at any given time. This should be increased appropriately when using Thing Shadow
+#define AWS_IOT_MQTT_READ_AHEAD_LEN 1024 ///< Bytes pulled from TLS in one read, small packets arriving together are parsed from here without another TLS read
+
+// TLS
+#define AWS_IOT_TLS_MAX_FRAGMENT_LEN 4096 ///< Record size asked from the server with the max_fragment_length extension, 512, 1024, 2048 or 4096. 0 does not ask. A server that ignores the extension still sends up to 16 KB records
 
 // Thing Shadow specific configs
+#define AWS_IOT_SHADOW_RX_BUF_LEN 5120 ///< Largest shadow document received. Documents larger than AWS_IOT_MQTT_RX_BUF_LEN are put together by the stream handler of sys_aws.c
 #ifdef CONFIG_AWS_IOT_OVERRIDE_THING_SHADOW_RX_BUFFER
 #define SHADOW_MAX_SIZE_OF_RX_BUFFER CONFIG_AWS_IOT_SHADOW_MAX_SIZE_OF_RX_BUFFER ///< Maximum size of the SHADOW buffer to store the received Shadow message, including NULL terminating byte
 #else
-#define SHADOW_MAX_SIZE_OF_RX_BUFFER (AWS_IOT_MQTT_RX_BUF_LEN + 1)
+#define SHADOW_MAX_SIZE_OF_RX_BUFFER (AWS_IOT_SHADOW_RX_BUF_LEN + 1)
 #endif
 
 #define MAX_SIZE_OF_UNIQUE_CLIENT_ID_BYTES 80  ///< Maximum size of the Unique Client Id. For More info on the Client Id refer \ref response "Acknowledgments"
@@ -33,10 +33,37 @@
 #include "mbedtls/debug.h"
 #include "mbedtls/timing.h"
 
+#include <stdbool.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * @brief Phases of a TLS connect, in order
+ */
+typedef enum {
+    TLS_CONNECT_PHASE_DNS,              /* Resolve the server name */
+    TLS_CONNECT_PHASE_TCP_CONNECT,      /* TCP three way handshake */
+    TLS_CONNECT_PHASE_SERVER_HELLO,     /* ClientHello out until ServerHello in, one round trip */
+    TLS_CONNECT_PHASE_CERT_VERIFY,      /* Parse and verify the server chain */
+    TLS_CONNECT_PHASE_KEY_EXCHANGE,     /* ServerKeyExchange until the client CertificateVerify */
+    TLS_CONNECT_PHASE_FINISHED,         /* ChangeCipherSpec and Finished both ways */
+    TLS_CONNECT_PHASE_DONE
+} TLSConnectPhase;
+
+/**
+ * @brief Timings of the last TLS connect
+ */
+typedef struct {
+    uint32_t phaseMs[TLS_CONNECT_PHASE_DONE];   /* Time spent in each phase */
+    uint32_t totalMs;                           /* DNS until Finished */
+    TLSConnectPhase phase;                      /* Phase reached, the failing phase if the connect failed */
+    bool isSessionResumed;
+    uint32_t heapPeakBytes;                     /* Most internal heap taken during the handshake */
+    uint32_t heapHeldBytes;                     /* Internal heap still taken once the handshake is over */
+} TLSConnectMetrics;
+
 /**
  * @brief TLS Connection Parameters
  *
@@ -49,12 +76,67 @@ typedef struct _TLSDataParams {
     mbedtls_ssl_context ssl;
     mbedtls_ssl_config conf;
     uint32_t flags;
-    mbedtls_x509_crt cacert;
-    mbedtls_x509_crt clicert;
-    mbedtls_pk_context pkey;
+    mbedtls_x509_crt *pCacert;      /* Credentials of the connection, held in the shared credential cache */
+    mbedtls_x509_crt *pClicert;
+    mbedtls_pk_context *pPkey;
     mbedtls_net_context server_fd;
+
+    /* Session of the last handshake, kept across disconnects to resume the next connection */
+    mbedtls_ssl_session session;
+    bool isSessionValid;
+    bool isSessionResumed;          /* Last handshake resumed the session */
+    uint32_t fullHandshakeMs;       /* Duration of the last full handshake, 0 if none yet */
+    uint32_t resumedHandshakeMs;    /* Duration of the last resumed handshake, 0 if none yet */
+
+    TLSConnectMetrics metrics;      /* Timings of the last connect */
 }TLSDataParams;
 
+/**
+ * @brief Get the socket of the TLS connection, to wait for it with select()
+ *
+ * @param pTlsData TLS data of the connection
+ * @return Socket descriptor, -1 if the connection is closed
+ */
+int iot_tls_get_fd(TLSDataParams *pTlsData);
+
+/**
+ * @brief Check if mbedTLS holds received bytes that are not read yet
+ *
+ * The socket is not readable for bytes mbedTLS already took from it, so they
+ * must be read before waiting for the socket again.
+ *
+ * @param pTlsData TLS data of the connection
+ * @return true if a read will return data without waiting
+ */
+bool iot_tls_is_rx_pending(TLSDataParams *pTlsData);
+
+/**
+ * @brief Forget the cached TLS session, the next connect does a full handshake
+ *
+ * @param pTlsData TLS data of the connection
+ */
+void iot_tls_session_clear(TLSDataParams *pTlsData);
+
+/**
+ * @brief Get the timings of the last TLS connect, to tune the connect behaviour to the link
+ *
+ * @param pTlsData TLS data of the connection
+ * @param pMetrics Timings of the last connect, filled in
+ */
+void iot_tls_get_connect_metrics(TLSDataParams *pTlsData, TLSConnectMetrics *pMetrics);
+
+/**
+ * @brief Drop a credential from the shared credential cache
+ *
+ * Certificates and keys are parsed once and shared by all connections. A
+ * credential file that is written again must be flushed so the next connect
+ * parses the new content. Connections still using the old credential keep it
+ * until they are destroyed.
+ *
+ * @param pLocation Location of the credential as given to iot_tls_init, NULL flushes all
+ */
+void iot_tls_credential_flush(const char *pLocation);
+
 #define IOTSDKC_NETWORK_MBEDTLS_PLATFORM_H_H
 
 #ifdef __cplusplus
@@ -16,6 +16,7 @@
 #include <sys/param.h>
 #include <stdbool.h>
 #include <string.h>
+#include <sys/lock.h>
 #include <timer_platform.h>
 #include <network_interface.h>
 
@@ -28,12 +29,74 @@
 
 #include "esp_log.h"
 #include "esp_vfs.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+
+#include "lwip/sockets.h"
+#include "lwip/netdb.h"
+#include <errno.h>
 
 static const char *TAG = "aws_iot";
 
 /* This is the value used for ssl read timeout */
 #define IOT_SSL_READ_TIMEOUT 10
 
+/*
+ * Cipher suites offered, one AEAD suite per server key type. ECDHE-ECDSA comes first for endpoints
+ * with an ECC certificate, ECDHE-RSA serves the RSA certificates of the default AWS IoT endpoints.
+ * The client key, RSA or P-256, signs with either suite.
+ */
+static const int _iot_tls_ciphersuites[] = {
+    MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256,
+    MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256,
+    0
+};
+
+#if defined(MBEDTLS_ECP_C)
+/* P-256 only, for ECDHE and for ECDSA signatures */
+static const mbedtls_ecp_group_id _iot_tls_curves[] = {
+    MBEDTLS_ECP_DP_SECP256R1,
+    MBEDTLS_ECP_DP_NONE
+};
+#endif
+
+#ifndef AWS_IOT_TLS_MAX_FRAGMENT_LEN
+#define AWS_IOT_TLS_MAX_FRAGMENT_LEN 0
+#endif
+
+#if AWS_IOT_TLS_MAX_FRAGMENT_LEN == 512
+#define IOT_TLS_MAX_FRAG_LEN_CODE MBEDTLS_SSL_MAX_FRAG_LEN_512
+#elif AWS_IOT_TLS_MAX_FRAGMENT_LEN == 1024
+#define IOT_TLS_MAX_FRAG_LEN_CODE MBEDTLS_SSL_MAX_FRAG_LEN_1024
+#elif AWS_IOT_TLS_MAX_FRAGMENT_LEN == 2048
+#define IOT_TLS_MAX_FRAG_LEN_CODE MBEDTLS_SSL_MAX_FRAG_LEN_2048
+#elif AWS_IOT_TLS_MAX_FRAGMENT_LEN == 4096
+#define IOT_TLS_MAX_FRAG_LEN_CODE MBEDTLS_SSL_MAX_FRAG_LEN_4096
+#elif AWS_IOT_TLS_MAX_FRAGMENT_LEN != 0
+#error "AWS_IOT_TLS_MAX_FRAGMENT_LEN must be 0, 512, 1024, 2048 or 4096"
+#endif
+
+/* Number of parsed credentials kept, the root CA plus a certificate and key for each client identity */
+#define IOT_TLS_CREDENTIAL_MAX 6
+
+/*
+ * Credential parsed once and shared by all connections using the same location.
+ * Embedded credentials are matched by address, files by path.
+ */
+typedef struct {
+    const char *pLocation;
+    bool isKey;
+    bool isStale;           /* Flushed, freed when the last connection releases it */
+    uint16_t refs;          /* Connections using the credential */
+    union {
+        mbedtls_x509_crt crt;
+        mbedtls_pk_context pk;
+    } u;
+} _iot_tls_credential_t;
+
+static _iot_tls_credential_t _iot_tls_credentials[IOT_TLS_CREDENTIAL_MAX];
+static _lock_t _iot_tls_credential_lock;
+
 /*
  * This is a function to do further verification if needed on the cert received.
  *
@@ -58,6 +121,300 @@ static int _iot_tls_verify_cert(void *data, mbedtls_x509_crt *crt, int depth, ui
     return 0;
 }
 
+static bool _iot_tls_credential_match(const _iot_tls_credential_t *pCred, const char *pLocation) {
+    return pCred->pLocation == pLocation ||
+           (pLocation[0] == '/' && pCred->pLocation[0] == '/' && strcmp(pCred->pLocation, pLocation) == 0);
+}
+
+static void _iot_tls_credential_free(_iot_tls_credential_t *pCred) {
+    if (pCred->isKey) {
+        mbedtls_pk_free(&(pCred->u.pk));
+    } else {
+        mbedtls_x509_crt_free(&(pCred->u.crt));
+    }
+    pCred->pLocation = NULL;
+    pCred->isStale = false;
+    pCred->refs = 0;
+}
+
+/*
+ * Parse a credential into a free slot.
+ *
+ * Certs/keys can be paths or they can be raw data. These use a
+ * very basic heuristic: if the cert starts with '/' then it's a
+ * path, if it's longer than this then it's raw cert data (PEM or DER,
+ * neither of which can start with a slash. Files may hold PEM or DER,
+ * mbedTLS detects the format and DER skips the base64 decoding.
+ */
+static int _iot_tls_credential_parse(_iot_tls_credential_t *pCred, const char *pLocation, bool isKey) {
+    int ret;
+
+    pCred->pLocation = pLocation;
+    pCred->isKey = isKey;
+    pCred->isStale = false;
+    pCred->refs = 0;
+
+    if (isKey) {
+        mbedtls_pk_init(&(pCred->u.pk));
+        if (pLocation[0] == '/') {
+            ESP_LOGD(TAG, "Loading private key from file %s ...", pLocation);
+            ret = mbedtls_pk_parse_keyfile(&(pCred->u.pk), pLocation, "");
+        } else {
+            ESP_LOGD(TAG, "Loading embedded private key ...");
+            ret = mbedtls_pk_parse_key(&(pCred->u.pk), (const unsigned char *)pLocation, strlen(pLocation)+1,
+                                       (const unsigned char *)"", 0);
+        }
+    } else {
+        mbedtls_x509_crt_init(&(pCred->u.crt));
+        if (pLocation[0] == '/') {
+            ESP_LOGD(TAG, "Loading certificate from file %s ...", pLocation);
+            ret = mbedtls_x509_crt_parse_file(&(pCred->u.crt), pLocation);
+        } else {
+            ESP_LOGD(TAG, "Loading embedded certificate ...");
+            ret = mbedtls_x509_crt_parse(&(pCred->u.crt), (const unsigned char *)pLocation, strlen(pLocation)+1);
+        }
+        if (ret > 0) {
+            /* A bundle is usable when some of its certificates parse */
+            ESP_LOGW(TAG, "%d certificates skipped", ret);
+            ret = 0;
+        }
+    }
+
+    if (ret != 0) {
+        _iot_tls_credential_free(pCred);
+    }
+
+    return ret;
+}
+
+/*
+ * Take a reference on the parsed credential of a location, parsing it on first use.
+ *
+ * Returns the mbedTLS return value of the parse, the credential in ppCred on success.
+ */
+static int _iot_tls_credential_acquire(const char *pLocation, bool isKey, _iot_tls_credential_t **ppCred) {
+    _iot_tls_credential_t *pFree = NULL;
+    _iot_tls_credential_t *pCred;
+    int ret = 0;
+    int i;
+
+    *ppCred = NULL;
+
+    _lock_acquire(&_iot_tls_credential_lock);
+
+    for (i = 0; i < IOT_TLS_CREDENTIAL_MAX; i++) {
+        pCred = &_iot_tls_credentials[i];
+        if (pCred->pLocation == NULL) {
+            if (pFree == NULL) {
+                pFree = pCred;
+            }
+        } else if (!pCred->isStale && pCred->isKey == isKey && _iot_tls_credential_match(pCred, pLocation)) {
+            *ppCred = pCred;
+            break;
+        }
+    }
+
+    /* A full cache drops the first credential no connection uses */
+    for (i = 0; *ppCred == NULL && pFree == NULL && i < IOT_TLS_CREDENTIAL_MAX; i++) {
+        if (_iot_tls_credentials[i].refs == 0) {
+            pFree = &_iot_tls_credentials[i];
+            _iot_tls_credential_free(pFree);
+        }
+    }
+
+    if (*ppCred == NULL) {
+        if (pFree == NULL) {
+            ESP_LOGE(TAG, "Credential cache full");
+            ret = MBEDTLS_ERR_X509_ALLOC_FAILED;
+        } else if ((ret = _iot_tls_credential_parse(pFree, pLocation, isKey)) == 0) {
+            *ppCred = pFree;
+        }
+    }
+
+    if (*ppCred != NULL) {
+        (*ppCred)->refs++;
+    }
+
+    _lock_release(&_iot_tls_credential_lock);
+
+    return ret;
+}
+
+/*
+ * Drop the reference of a connection on the credential holding pObject.
+ */
+static void _iot_tls_credential_release(const void *pObject) {
+    _iot_tls_credential_t *pCred;
+    int i;
+
+    if (pObject == NULL) {
+        return;
+    }
+
+    _lock_acquire(&_iot_tls_credential_lock);
+
+    for (i = 0; i < IOT_TLS_CREDENTIAL_MAX; i++) {
+        pCred = &_iot_tls_credentials[i];
+        if (pCred->pLocation != NULL && (const void *)&(pCred->u) == pObject) {
+            if (pCred->refs > 0) {
+                pCred->refs--;
+            }
+            if (pCred->isStale && pCred->refs == 0) {
+                _iot_tls_credential_free(pCred);
+            }
+            break;
+        }
+    }
+
+    _lock_release(&_iot_tls_credential_lock);
+}
+
+static void _iot_tls_credential_release_all(TLSDataParams *tlsDataParams) {
+    _iot_tls_credential_release(tlsDataParams->pCacert);
+    _iot_tls_credential_release(tlsDataParams->pClicert);
+    _iot_tls_credential_release(tlsDataParams->pPkey);
+    tlsDataParams->pCacert = NULL;
+    tlsDataParams->pClicert = NULL;
+    tlsDataParams->pPkey = NULL;
+}
+
+void iot_tls_credential_flush(const char *pLocation) {
+    _iot_tls_credential_t *pCred;
+    int i;
+
+    _lock_acquire(&_iot_tls_credential_lock);
+
+    for (i = 0; i < IOT_TLS_CREDENTIAL_MAX; i++) {
+        pCred = &_iot_tls_credentials[i];
+        if (pCred->pLocation != NULL && (pLocation == NULL || _iot_tls_credential_match(pCred, pLocation))) {
+            if (pCred->refs == 0) {
+                _iot_tls_credential_free(pCred);
+            } else {
+                pCred->isStale = true;
+            }
+        }
+    }
+
+    _lock_release(&_iot_tls_credential_lock);
+}
+
+static uint32_t _iot_tls_ms_since(int64_t startUs) {
+    return (uint32_t) ((esp_timer_get_time() - startUs) / 1000);
+}
+
+/*
+ * Track the most internal heap the connection took since startFree.
+ * Sampled between handshake steps, allocations of other tasks in between add to it.
+ */
+static void _iot_tls_heap_sample(TLSDataParams *tlsDataParams, size_t startFree) {
+    size_t freeNow = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+
+    if (freeNow < startFree && startFree - freeNow > tlsDataParams->metrics.heapPeakBytes) {
+        tlsDataParams->metrics.heapPeakBytes = (uint32_t) (startFree - freeNow);
+    }
+}
+
+/*
+ * Handshake phase of the step that handles a state of the mbedTLS client state machine
+ */
+static TLSConnectPhase _iot_tls_handshake_phase(int state) {
+    if (state <= MBEDTLS_SSL_SERVER_HELLO) {
+        return TLS_CONNECT_PHASE_SERVER_HELLO;
+    } else if (state == MBEDTLS_SSL_SERVER_CERTIFICATE) {
+        return TLS_CONNECT_PHASE_CERT_VERIFY;
+    } else if (state <= MBEDTLS_SSL_CERTIFICATE_VERIFY) {
+        return TLS_CONNECT_PHASE_KEY_EXCHANGE;
+    }
+    return TLS_CONNECT_PHASE_FINISHED;
+}
+
+/*
+ * Resolve the server and open the TCP connection before the deadline.
+ *
+ * Like mbedtls_net_connect, but the connect is non-blocking and waited for with select
+ * so a bad link fails at the deadline instead of the TCP retransmission timeout.
+ */
+static IoT_Error_t _iot_tls_net_connect(TLSDataParams *tlsDataParams, const char *pHost, const char *pPort,
+                                        Timer *pDeadline) {
+    struct addrinfo hints;
+    struct addrinfo *addrList = NULL;
+    struct addrinfo *cur;
+    struct timeval tv;
+    fd_set writeSet;
+    socklen_t errLen;
+    int64_t startUs;
+    uint32_t leftMs;
+    int sockErr;
+    int fd = -1;
+    int ret;
+    IoT_Error_t rc = NETWORK_ERR_NET_CONNECT_FAILED;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+
+    /* The resolver keeps its own timeouts, the deadline is checked when it returns */
+    tlsDataParams->metrics.phase = TLS_CONNECT_PHASE_DNS;
+    startUs = esp_timer_get_time();
+    ret = getaddrinfo(pHost, pPort, &hints, &addrList);
+    tlsDataParams->metrics.phaseMs[TLS_CONNECT_PHASE_DNS] = _iot_tls_ms_since(startUs);
+    if (ret != 0 || addrList == NULL) {
+        ESP_LOGE(TAG, "failed! getaddrinfo returned %d", ret);
+        return NETWORK_ERR_NET_UNKNOWN_HOST;
+    }
+
+    tlsDataParams->metrics.phase = TLS_CONNECT_PHASE_TCP_CONNECT;
+    startUs = esp_timer_get_time();
+    for (cur = addrList; cur != NULL && fd < 0 && !has_timer_expired(pDeadline); cur = cur->ai_next) {
+        fd = socket(cur->ai_family, cur->ai_socktype, cur->ai_protocol);
+        if (fd < 0) {
+            rc = NETWORK_ERR_NET_SOCKET_FAILED;
+            continue;
+        }
+
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+        ret = connect(fd, cur->ai_addr, cur->ai_addrlen);
+        if (ret != 0 && errno == EINPROGRESS) {
+            leftMs = left_ms(pDeadline);
+            tv.tv_sec = leftMs / 1000;
+            tv.tv_usec = (leftMs % 1000) * 1000;
+            FD_ZERO(&writeSet);
+            FD_SET(fd, &writeSet);
+
+            ret = -1;
+            if (select(fd + 1, NULL, &writeSet, NULL, &tv) > 0) {
+                errLen = sizeof(sockErr);
+                if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &sockErr, &errLen) == 0) {
+                    ret = sockErr;
+                }
+            }
+        }
+
+        if (ret != 0) {
+            rc = NETWORK_ERR_NET_CONNECT_FAILED;
+            close(fd);
+            fd = -1;
+        }
+    }
+    tlsDataParams->metrics.phaseMs[TLS_CONNECT_PHASE_TCP_CONNECT] = _iot_tls_ms_since(startUs);
+
+    freeaddrinfo(addrList);
+
+    if (fd < 0) {
+        if (has_timer_expired(pDeadline)) {
+            rc = NETWORK_SSL_CONNECT_TIMEOUT_ERROR;
+        }
+        ESP_LOGE(TAG, "failed! TCP connect to %s:%s, %s", pHost, pPort,
+                 rc == NETWORK_SSL_CONNECT_TIMEOUT_ERROR ? "timed out" : "refused or unreachable");
+        return rc;
+    }
+
+    tlsDataParams->server_fd.fd = fd;
+
+    return SUCCESS;
+}
+
 static void _iot_tls_set_connect_params(Network *pNetwork, const char *pRootCALocation, const char *pDeviceCertLocation,
                                  const char *pDevicePrivateKeyLocation, const char *pDestinationURL,
                                  uint16_t destinationPort, uint32_t timeout_ms, bool ServerVerificationFlag) {
@@ -73,11 +430,25 @@ static void _iot_tls_set_connect_params(Network *pNetwork, const char *pRootCALo
 IoT_Error_t iot_tls_init(Network *pNetwork, const char *pRootCALocation, const char *pDeviceCertLocation,
                          const char *pDevicePrivateKeyLocation, const char *pDestinationURL,
                          uint16_t destinationPort, uint32_t timeout_ms, bool ServerVerificationFlag) {
+    /* A client initialized again for the same server and identity, as the provisioning client on each attempt,
+       keeps its session. The Network must be zeroed before its first init, a zeroed session is safe to free. */
+    if (!pNetwork->tlsDataParams.isSessionValid ||
+        pNetwork->tlsConnectParams.DestinationPort != destinationPort ||
+        pNetwork->tlsConnectParams.pDestinationURL != pDestinationURL ||
+        pNetwork->tlsConnectParams.pDeviceCertLocation != pDeviceCertLocation) {
+        /* Frees the peer certificate and ticket of the old session before they are dropped */
+        iot_tls_session_clear(&(pNetwork->tlsDataParams));
+        pNetwork->tlsDataParams.isSessionResumed = false;
+        pNetwork->tlsDataParams.fullHandshakeMs = 0;
+        pNetwork->tlsDataParams.resumedHandshakeMs = 0;
+    }
+
     _iot_tls_set_connect_params(pNetwork, pRootCALocation, pDeviceCertLocation, pDevicePrivateKeyLocation,
                                 pDestinationURL, destinationPort, timeout_ms, ServerVerificationFlag);
 
     pNetwork->connect = iot_tls_connect;
     pNetwork->read = iot_tls_read;
+    pNetwork->readAvailable = iot_tls_read_available;
     pNetwork->write = iot_tls_write;
     pNetwork->disconnect = iot_tls_disconnect;
     pNetwork->isConnected = iot_tls_is_connected;
@@ -98,12 +469,30 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
     TLSDataParams *tlsDataParams = NULL;
     char portBuffer[6];
     char info_buf[256];
+    int64_t handshakeStartUs;
+    int64_t connectStartUs;
+    int64_t stepStartUs;
+    uint32_t handshakeMs;
+    uint32_t readTimeout;
+    size_t heapStartFree;
+    size_t heapFree;
+    TLSConnectPhase phase;
+    Timer deadline;
+    _iot_tls_credential_t *credential;
 
     if(NULL == pNetwork) {
         return NULL_VALUE_ERROR;
     }
 
     if(NULL != params) {
+        /* A session belongs to one server and one client identity */
+        if (pNetwork->tlsDataParams.isSessionValid &&
+            (pNetwork->tlsConnectParams.DestinationPort != params->DestinationPort ||
+             pNetwork->tlsConnectParams.pDestinationURL != params->pDestinationURL ||
+             pNetwork->tlsConnectParams.pDeviceCertLocation != params->pDeviceCertLocation)) {
+            iot_tls_session_clear(&(pNetwork->tlsDataParams));
+        }
+
         _iot_tls_set_connect_params(pNetwork, params->pRootCALocation, params->pDeviceCertLocation,
                                     params->pDevicePrivateKeyLocation, params->pDestinationURL,
                                     params->DestinationPort, params->timeout_ms, params->ServerVerificationFlag);
@@ -120,9 +509,9 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
 #endif
 
     mbedtls_ctr_drbg_init(&(tlsDataParams->ctr_drbg));
-    mbedtls_x509_crt_init(&(tlsDataParams->cacert));
-    mbedtls_x509_crt_init(&(tlsDataParams->clicert));
-    mbedtls_pk_init(&(tlsDataParams->pkey));
+
+    /* A connect without destroy since the last one still holds its credentials */
+    _iot_tls_credential_release_all(tlsDataParams);
 
     ESP_LOGD(TAG, "Seeding the random number generator...");
     mbedtls_entropy_init(&(tlsDataParams->entropy));
@@ -132,77 +521,43 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
         return NETWORK_MBEDTLS_ERR_CTR_DRBG_ENTROPY_SOURCE_FAILED;
     }
 
-   /*  Load root CA...
-
-       Certs/keys can be paths or they can be raw data. These use a
-       very basic heuristic: if the cert starts with '/' then it's a
-       path, if it's longer than this then it's raw cert data (PEM or DER,
-       neither of which can start with a slash. */
-    if (pNetwork->tlsConnectParams.pRootCALocation[0] == '/') {
-        ESP_LOGD(TAG, "Loading CA root certificate from file ...");
-        ret = mbedtls_x509_crt_parse_file(&(tlsDataParams->cacert), pNetwork->tlsConnectParams.pRootCALocation);
-    } else {
-        ESP_LOGD(TAG, "Loading embedded CA root certificate ...");
-        ret = mbedtls_x509_crt_parse(&(tlsDataParams->cacert), (const unsigned char *)pNetwork->tlsConnectParams.pRootCALocation,
-                                 strlen(pNetwork->tlsConnectParams.pRootCALocation)+1);
-    }
-
-    if(ret < 0) {
+    /* Credentials are parsed by the first connection using them, later connections and reconnects share them */
+    ret = _iot_tls_credential_acquire(pNetwork->tlsConnectParams.pRootCALocation, false, &credential);
+    if(ret != 0) {
         ESP_LOGE(TAG, "failed!  mbedtls_x509_crt_parse returned -0x%x while parsing root cert", -ret);
         return NETWORK_X509_ROOT_CRT_PARSE_ERROR;
     }
-    ESP_LOGD(TAG, "ok (%d skipped)", ret);
+    tlsDataParams->pCacert = &(credential->u.crt);
 
-    /* Load client certificate... */
-    if (pNetwork->tlsConnectParams.pDeviceCertLocation[0] == '/') {
-        ESP_LOGD(TAG, "Loading client cert from file...");
-        ret = mbedtls_x509_crt_parse_file(&(tlsDataParams->clicert),
-                                          pNetwork->tlsConnectParams.pDeviceCertLocation);
-    } else {
-        ESP_LOGD(TAG, "Loading embedded client certificate...");
-        ret = mbedtls_x509_crt_parse(&(tlsDataParams->clicert),
-                                     (const unsigned char *)pNetwork->tlsConnectParams.pDeviceCertLocation,
-                                     strlen(pNetwork->tlsConnectParams.pDeviceCertLocation)+1);
-    }
+    ret = _iot_tls_credential_acquire(pNetwork->tlsConnectParams.pDeviceCertLocation, false, &credential);
     if(ret != 0) {
         ESP_LOGE(TAG, "failed!  mbedtls_x509_crt_parse returned -0x%x while parsing device cert", -ret);
         return NETWORK_X509_DEVICE_CRT_PARSE_ERROR;
     }
+    tlsDataParams->pClicert = &(credential->u.crt);
 
-    /* Parse client private key... */
-    if (pNetwork->tlsConnectParams.pDevicePrivateKeyLocation[0] == '/') {
-        ESP_LOGD(TAG, "Loading client private key from file...");
-        ret = mbedtls_pk_parse_keyfile(&(tlsDataParams->pkey),
-                                       pNetwork->tlsConnectParams.pDevicePrivateKeyLocation,
-                                       "");
-    } else {
-        ESP_LOGD(TAG, "Loading embedded client private key...");
-        ret = mbedtls_pk_parse_key(&(tlsDataParams->pkey),
-                                   (const unsigned char *)pNetwork->tlsConnectParams.pDevicePrivateKeyLocation,
-                                   strlen(pNetwork->tlsConnectParams.pDevicePrivateKeyLocation)+1,
-                                   (const unsigned char *)"", 0);
-    }
+    ret = _iot_tls_credential_acquire(pNetwork->tlsConnectParams.pDevicePrivateKeyLocation, true, &credential);
     if(ret != 0) {
         ESP_LOGE(TAG, "failed!  mbedtls_pk_parse_key returned -0x%x while parsing private key", -ret);
         return NETWORK_PK_PRIVATE_KEY_PARSE_ERROR;
     }
+    tlsDataParams->pPkey = &(credential->u.pk);
 
     /* Done parsing certs */
     ESP_LOGD(TAG, "ok");
     snprintf(portBuffer, 6, "%d", pNetwork->tlsConnectParams.DestinationPort);
     ESP_LOGD(TAG, "Connecting to %s/%s...", pNetwork->tlsConnectParams.pDestinationURL, portBuffer);
-    if((ret = mbedtls_net_connect(&(tlsDataParams->server_fd), pNetwork->tlsConnectParams.pDestinationURL,
-                                  portBuffer, MBEDTLS_NET_PROTO_TCP)) != 0) {
-        ESP_LOGE(TAG, "failed! mbedtls_net_connect returned -0x%x", -ret);
-        switch(ret) {
-            case MBEDTLS_ERR_NET_SOCKET_FAILED:
-                return NETWORK_ERR_NET_SOCKET_FAILED;
-            case MBEDTLS_ERR_NET_UNKNOWN_HOST:
-                return NETWORK_ERR_NET_UNKNOWN_HOST;
-            case MBEDTLS_ERR_NET_CONNECT_FAILED:
-            default:
-                return NETWORK_ERR_NET_CONNECT_FAILED;
-        };
+
+    /* The handshake timeout bounds the whole connect, from DNS to Finished */
+    memset(&(tlsDataParams->metrics), 0, sizeof(tlsDataParams->metrics));
+    init_timer(&deadline);
+    countdown_ms(&deadline, pNetwork->tlsConnectParams.timeout_ms);
+    connectStartUs = esp_timer_get_time();
+
+    if((ret = _iot_tls_net_connect(tlsDataParams, pNetwork->tlsConnectParams.pDestinationURL, portBuffer,
+                                   &deadline)) != SUCCESS) {
+        tlsDataParams->metrics.totalMs = _iot_tls_ms_since(connectStartUs);
+        return (IoT_Error_t) ret;
     }
 
     ret = mbedtls_net_set_block(&(tlsDataParams->server_fd));
@@ -227,8 +582,20 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
     }
     mbedtls_ssl_conf_rng(&(tlsDataParams->conf), mbedtls_ctr_drbg_random, &(tlsDataParams->ctr_drbg));
 
-    mbedtls_ssl_conf_ca_chain(&(tlsDataParams->conf), &(tlsDataParams->cacert), NULL);
-    ret = mbedtls_ssl_conf_own_cert(&(tlsDataParams->conf), &(tlsDataParams->clicert), &(tlsDataParams->pkey));
+    /* A short suite list keeps the ClientHello small and the handshake on the cheapest key exchange */
+    mbedtls_ssl_conf_min_version(&(tlsDataParams->conf), MBEDTLS_SSL_MAJOR_VERSION_3, MBEDTLS_SSL_MINOR_VERSION_3);
+    mbedtls_ssl_conf_ciphersuites(&(tlsDataParams->conf), _iot_tls_ciphersuites);
+#if defined(MBEDTLS_ECP_C)
+    mbedtls_ssl_conf_curves(&(tlsDataParams->conf), _iot_tls_curves);
+#endif
+
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH) && defined(IOT_TLS_MAX_FRAG_LEN_CODE)
+    /* Smaller records from the server, with dynamic buffers the record buffers take less RAM */
+    mbedtls_ssl_conf_max_frag_len(&(tlsDataParams->conf), IOT_TLS_MAX_FRAG_LEN_CODE);
+#endif
+
+    mbedtls_ssl_conf_ca_chain(&(tlsDataParams->conf), tlsDataParams->pCacert, NULL);
+    ret = mbedtls_ssl_conf_own_cert(&(tlsDataParams->conf), tlsDataParams->pClicert, tlsDataParams->pPkey);
     if(ret != 0) {
         ESP_LOGE(TAG, "failed! mbedtls_ssl_conf_own_cert returned %d", ret);
         return SSL_CONNECTION_ERROR;
@@ -236,6 +603,10 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
 
     mbedtls_ssl_conf_read_timeout(&(tlsDataParams->conf), pNetwork->tlsConnectParams.timeout_ms);
 
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    mbedtls_ssl_conf_session_tickets(&(tlsDataParams->conf), MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+
 #ifdef CONFIG_MBEDTLS_SSL_ALPN
     /* Use the AWS IoT ALPN extension for MQTT, if port 443 is requested */
     if (pNetwork->tlsConnectParams.DestinationPort == 443) {
@@ -247,14 +618,25 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
     }
 #endif
 
+    /* The record buffers and handshake state of this connection are counted from here */
+    heapStartFree = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
     if((ret = mbedtls_ssl_setup(&(tlsDataParams->ssl), &(tlsDataParams->conf))) != 0) {
         ESP_LOGE(TAG, "failed! mbedtls_ssl_setup returned -0x%x", -ret);
         return SSL_CONNECTION_ERROR;
     }
+    _iot_tls_heap_sample(tlsDataParams, heapStartFree);
     if((ret = mbedtls_ssl_set_hostname(&(tlsDataParams->ssl), pNetwork->tlsConnectParams.pDestinationURL)) != 0) {
         ESP_LOGE(TAG, "failed! mbedtls_ssl_set_hostname returned %d", ret);
         return SSL_CONNECTION_ERROR;
     }
+    /* Offer the session of the last connection, by ticket or by session ID */
+    if (tlsDataParams->isSessionValid) {
+        if ((ret = mbedtls_ssl_set_session(&(tlsDataParams->ssl), &(tlsDataParams->session))) != 0) {
+            ESP_LOGW(TAG, "mbedtls_ssl_set_session returned -0x%x, full handshake", -ret);
+            iot_tls_session_clear(tlsDataParams);
+        }
+    }
+
     ESP_LOGD(TAG, "SSL state connect : %d ", tlsDataParams->ssl.state);
     mbedtls_ssl_set_bio(&(tlsDataParams->ssl), &(tlsDataParams->server_fd), mbedtls_net_send, NULL,
                         mbedtls_net_recv_timeout);
@@ -262,15 +644,74 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
 
     ESP_LOGD(TAG, "SSL state connect : %d ", tlsDataParams->ssl.state);
     ESP_LOGD(TAG, "Performing the SSL/TLS handshake...");
-    while((ret = mbedtls_ssl_handshake(&(tlsDataParams->ssl))) != 0) {
-        if(ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
-            ESP_LOGE(TAG, "failed! mbedtls_ssl_handshake returned -0x%x", -ret);
+    handshakeStartUs = esp_timer_get_time();
+    readTimeout = tlsDataParams->conf.read_timeout;
+
+    /* Step the handshake so each phase is timed and no read waits past the deadline */
+    while(tlsDataParams->ssl.state != MBEDTLS_SSL_HANDSHAKE_OVER) {
+        phase = _iot_tls_handshake_phase(tlsDataParams->ssl.state);
+        tlsDataParams->metrics.phase = phase;
+
+        if(has_timer_expired(&deadline)) {
+            ret = MBEDTLS_ERR_SSL_TIMEOUT;
+        } else {
+            mbedtls_ssl_conf_read_timeout(&(tlsDataParams->conf), MAX(1, MIN(readTimeout, left_ms(&deadline))));
+            stepStartUs = esp_timer_get_time();
+            ret = mbedtls_ssl_handshake_step(&(tlsDataParams->ssl));
+            tlsDataParams->metrics.phaseMs[phase] += _iot_tls_ms_since(stepStartUs);
+            _iot_tls_heap_sample(tlsDataParams, heapStartFree);
+        }
+
+        if(ret != 0 && ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+            mbedtls_ssl_conf_read_timeout(&(tlsDataParams->conf), readTimeout);
+            tlsDataParams->metrics.totalMs = _iot_tls_ms_since(connectStartUs);
+            if(ret == MBEDTLS_ERR_SSL_TIMEOUT) {
+                ESP_LOGE(TAG, "failed! TLS handshake timed out after %u ms in phase %d",
+                         (unsigned) tlsDataParams->metrics.totalMs, phase);
+                return NETWORK_SSL_CONNECT_TIMEOUT_ERROR;
+            }
+            ESP_LOGE(TAG, "failed! mbedtls_ssl_handshake_step returned -0x%x in phase %d", -ret, phase);
             if(ret == MBEDTLS_ERR_X509_CERT_VERIFY_FAILED) {
                 ESP_LOGE(TAG, "    Unable to verify the server's certificate. ");
             }
+            /* The server may have dropped the session, do not offer it again */
+            iot_tls_session_clear(tlsDataParams);
             return SSL_CONNECTION_ERROR;
         }
     }
+    mbedtls_ssl_conf_read_timeout(&(tlsDataParams->conf), readTimeout);
+    handshakeMs = _iot_tls_ms_since(handshakeStartUs);
+
+    /* The server echoes the offered session ID when it resumes the session */
+    tlsDataParams->isSessionResumed = tlsDataParams->isSessionValid &&
+                                      tlsDataParams->session.id_len != 0 &&
+                                      tlsDataParams->ssl.session->id_len == tlsDataParams->session.id_len &&
+                                      memcmp(tlsDataParams->ssl.session->id, tlsDataParams->session.id,
+                                             tlsDataParams->session.id_len) == 0;
+    if (tlsDataParams->isSessionResumed) {
+        tlsDataParams->resumedHandshakeMs = handshakeMs;
+    } else {
+        tlsDataParams->fullHandshakeMs = handshakeMs;
+    }
+    tlsDataParams->metrics.phase = TLS_CONNECT_PHASE_DONE;
+    tlsDataParams->metrics.isSessionResumed = tlsDataParams->isSessionResumed;
+    tlsDataParams->metrics.totalMs = _iot_tls_ms_since(connectStartUs);
+    heapFree = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    tlsDataParams->metrics.heapHeldBytes = heapFree < heapStartFree ? (uint32_t) (heapStartFree - heapFree) : 0;
+    ESP_LOGI(TAG, "TLS handshake %u ms, session %s (last full %u ms, last resumed %u ms)",
+             (unsigned) handshakeMs, tlsDataParams->isSessionResumed ? "resumed" : "new",
+             (unsigned) tlsDataParams->fullHandshakeMs, (unsigned) tlsDataParams->resumedHandshakeMs);
+    ESP_LOGI(TAG, "TLS connect %u ms: dns %u, tcp %u, server hello %u, cert verify %u, key exchange %u, finished %u",
+             (unsigned) tlsDataParams->metrics.totalMs,
+             (unsigned) tlsDataParams->metrics.phaseMs[TLS_CONNECT_PHASE_DNS],
+             (unsigned) tlsDataParams->metrics.phaseMs[TLS_CONNECT_PHASE_TCP_CONNECT],
+             (unsigned) tlsDataParams->metrics.phaseMs[TLS_CONNECT_PHASE_SERVER_HELLO],
+             (unsigned) tlsDataParams->metrics.phaseMs[TLS_CONNECT_PHASE_CERT_VERIFY],
+             (unsigned) tlsDataParams->metrics.phaseMs[TLS_CONNECT_PHASE_KEY_EXCHANGE],
+             (unsigned) tlsDataParams->metrics.phaseMs[TLS_CONNECT_PHASE_FINISHED]);
+    ESP_LOGI(TAG, "TLS heap peak %u bytes, held %u bytes, max record out %d bytes",
+             (unsigned) tlsDataParams->metrics.heapPeakBytes, (unsigned) tlsDataParams->metrics.heapHeldBytes,
+             mbedtls_ssl_get_max_out_record_payload(&(tlsDataParams->ssl)));
 
     ESP_LOGD(TAG, "ok    [ Protocol is %s ]    [ Ciphersuite is %s ]", mbedtls_ssl_get_version(&(tlsDataParams->ssl)),
           mbedtls_ssl_get_ciphersuite(&(tlsDataParams->ssl)));
@@ -305,6 +746,18 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
         }
     }
 
+    /* Keep the session of a verified server, a new ticket may have come with this handshake */
+    iot_tls_session_clear(tlsDataParams);
+    if (ret == SUCCESS) {
+        if ((ret = mbedtls_ssl_get_session(&(tlsDataParams->ssl), &(tlsDataParams->session))) == 0) {
+            tlsDataParams->isSessionValid = true;
+        } else {
+            ESP_LOGW(TAG, "mbedtls_ssl_get_session returned -0x%x, next handshake is full", -ret);
+            iot_tls_session_clear(tlsDataParams);
+            ret = SUCCESS;
+        }
+    }
+
     return (IoT_Error_t) ret;
 }
 
@@ -389,6 +842,68 @@ IoT_Error_t iot_tls_read(Network *pNetwork, unsigned char *pMsg, size_t len, Tim
     }
 }
 
+IoT_Error_t iot_tls_read_available(Network *pNetwork, unsigned char *pMsg, size_t len, Timer *timer, size_t *read_len) {
+    TLSDataParams *tlsDataParams = &(pNetwork->tlsDataParams);
+    mbedtls_ssl_context *ssl = &(tlsDataParams->ssl);
+    mbedtls_ssl_config *ssl_conf = &(tlsDataParams->conf);
+    uint32_t read_timeout;
+    size_t rxLen = 0;
+    int ret;
+
+    read_timeout = ssl_conf->read_timeout;
+
+    /* Block only until the first record arrives */
+    while (rxLen == 0 && len > 0) {
+        mbedtls_ssl_conf_read_timeout(ssl_conf, MAX(1, MIN(read_timeout, left_ms(timer))));
+
+        ret = mbedtls_ssl_read(ssl, pMsg, len);
+
+        mbedtls_ssl_conf_read_timeout(ssl_conf, read_timeout);
+
+        if (ret > 0) {
+            rxLen = ret;
+        } else if (ret == 0 || (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE && ret != MBEDTLS_ERR_SSL_TIMEOUT)) {
+            return NETWORK_SSL_READ_ERROR;
+        } else if (has_timer_expired(timer)) {
+            break;
+        }
+    }
+
+    /* Then take the records mbedTLS already holds, without waiting on the socket */
+    while (rxLen < len && mbedtls_ssl_check_pending(ssl)) {
+        ret = mbedtls_ssl_read(ssl, pMsg + rxLen, len - rxLen);
+        if (ret <= 0) {
+            break;
+        }
+        rxLen += ret;
+    }
+
+    if (rxLen == 0) {
+        return NETWORK_SSL_NOTHING_TO_READ;
+    }
+
+    *read_len = rxLen;
+    return SUCCESS;
+}
+
+int iot_tls_get_fd(TLSDataParams *pTlsData) {
+    return pTlsData->server_fd.fd;
+}
+
+bool iot_tls_is_rx_pending(TLSDataParams *pTlsData) {
+    return mbedtls_ssl_check_pending(&(pTlsData->ssl)) != 0;
+}
+
+void iot_tls_get_connect_metrics(TLSDataParams *pTlsData, TLSConnectMetrics *pMetrics) {
+    *pMetrics = pTlsData->metrics;
+}
+
+void iot_tls_session_clear(TLSDataParams *pTlsData) {
+    mbedtls_ssl_session_free(&(pTlsData->session));
+    mbedtls_ssl_session_init(&(pTlsData->session));
+    pTlsData->isSessionValid = false;
+}
+
 IoT_Error_t iot_tls_disconnect(Network *pNetwork) {
     mbedtls_ssl_context *ssl = &(pNetwork->tlsDataParams.ssl);
     int ret = 0;
@@ -407,9 +922,8 @@ IoT_Error_t iot_tls_destroy(Network *pNetwork) {
 
     mbedtls_net_free(&(tlsDataParams->server_fd));
 
-    mbedtls_x509_crt_free(&(tlsDataParams->clicert));
-    mbedtls_x509_crt_free(&(tlsDataParams->cacert));
-    mbedtls_pk_free(&(tlsDataParams->pkey));
+    /* The credentials stay parsed for the next connection */
+    _iot_tls_credential_release_all(tlsDataParams);
     mbedtls_ssl_free(&(tlsDataParams->ssl));
     mbedtls_ssl_config_free(&(tlsDataParams->conf));
     mbedtls_ctr_drbg_free(&(tlsDataParams->ctr_drbg));
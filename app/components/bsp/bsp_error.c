@@ -22,6 +22,8 @@ static const char *TAG = "bsp_error";
 /* Private enumerate/structure ---------------------------------------------- */
 /* Public variables --------------------------------------------------------- */
 /* Private variables -------------------------------------------------------- */
+static uint32_t m_err_overwritten;
+
 /* Private function prototypes ---------------------------------------------- */
 /* Function definitions ----------------------------------------------------- */
 void bsp_error_init(void)
@@ -32,13 +34,16 @@ void bsp_error_init(void)
 
   ESP_LOGE(TAG, "Error index: %d", g_nvs_setting_data.bsp_error.nvs.err_idx);
   ESP_LOGE(TAG, "Error count: %d", g_nvs_setting_data.bsp_error.nvs.err_cnt);
+  ESP_LOGE(TAG, "Error head : %d", g_nvs_setting_data.bsp_error.nvs.err_head);
 }
 
 void bsp_error_add(bsp_error_code_t err)
 {
   ESP_LOGE(TAG, "Error add: %d", err);
 
-  if (g_nvs_setting_data.bsp_error.nvs.code[g_nvs_setting_data.bsp_error.nvs.err_idx - 1] == err)
+  uint16_t prev = (g_nvs_setting_data.bsp_error.nvs.err_idx + BSP_ERROR_CNT_MAX - 1) % BSP_ERROR_CNT_MAX;
+
+  if ((g_nvs_setting_data.bsp_error.nvs.err_cnt != 0) && (g_nvs_setting_data.bsp_error.nvs.code[prev] == err))
   {
     ESP_LOGE(TAG, "The same with previous error -->ignore");
   }
@@ -51,16 +56,28 @@ void bsp_error_add(bsp_error_code_t err)
       g_nvs_setting_data.bsp_error.nvs.err_idx = 0;
 
     if (g_nvs_setting_data.bsp_error.nvs.err_cnt < BSP_ERROR_CNT_MAX)
+    {
       g_nvs_setting_data.bsp_error.nvs.err_cnt++;
+    }
+    else
+    {
+      // Database is full, the oldest error is overwritten
+      g_nvs_setting_data.bsp_error.nvs.err_head = g_nvs_setting_data.bsp_error.nvs.err_idx;
+      m_err_overwritten++;
+    }
 
     // Save error structure to nvs
     bsp_error_sync();
   }
 }
 
-void bsp_error_remove(void)
+void bsp_error_remove(uint16_t cnt)
 {
-  g_nvs_setting_data.bsp_error.nvs.err_cnt--;
+  if (cnt > g_nvs_setting_data.bsp_error.nvs.err_cnt)
+    cnt = g_nvs_setting_data.bsp_error.nvs.err_cnt;
+
+  g_nvs_setting_data.bsp_error.nvs.err_cnt -= cnt;
+  g_nvs_setting_data.bsp_error.nvs.err_head = (g_nvs_setting_data.bsp_error.nvs.err_head + cnt) % BSP_ERROR_CNT_MAX;
 
   // Save error structure to nvs
   bsp_error_sync();
@@ -70,7 +87,7 @@ void bsp_error_remove(void)
 
 uint16_t bsp_error_read_start(void)
 {
-  g_nvs_setting_data.bsp_error.err_start = (g_nvs_setting_data.bsp_error.nvs.err_cnt >= BSP_ERROR_CNT_MAX) ? g_nvs_setting_data.bsp_error.nvs.err_idx : 0;
+  g_nvs_setting_data.bsp_error.err_start = g_nvs_setting_data.bsp_error.nvs.err_head;
 
   return  g_nvs_setting_data.bsp_error.nvs.err_cnt;
 }
@@ -88,6 +105,11 @@ uint32_t bsp_error_read(void)
   return err;
 }
 
+uint32_t bsp_error_overwritten(void)
+{
+  return m_err_overwritten;
+}
+
 void bsp_error_sync(void)
 {
   SYS_NVS_STORE(bsp_error);
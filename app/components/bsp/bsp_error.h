@@ -26,8 +26,9 @@ typedef struct
   struct
   {
     uint32_t code[BSP_ERROR_CNT_MAX];
-    uint16_t err_idx;
+    uint16_t err_idx;     // Position of the next error
     uint16_t err_cnt;
+    uint16_t err_head;    // Position of the oldest error
   }
   nvs;
 
@@ -81,16 +82,16 @@ void bsp_error_init(void);
 void bsp_error_add(bsp_error_code_t err);
 
 /**
- * @brief         Remove error in database
+ * @brief         Remove the oldest errors in database
  * 
- * @param[in]     None
+ * @param[in]     cnt   Number of errors
  * 
  * @return        None
  */
-void bsp_error_remove(void);
+void bsp_error_remove(uint16_t cnt);
 
 /**
- * @brief         Calculate error start read position
+ * @brief         Start reading at the oldest error
  * 
  * @param[in]     None
  * 
@@ -98,6 +99,18 @@ void bsp_error_remove(void);
  */
 uint16_t bsp_error_read_start(void);
 
+/**
+ * @brief         Number of errors overwritten by new ones while database was full
+ * 
+ * @param[in]     None
+ * 
+ * @attention     Counts from boot, a reader subtracts two values to know how many
+ *                of the errors it read are gone already
+ * 
+ * @return        Number of overwritten errors
+ */
+uint32_t bsp_error_overwritten(void);
+
 /**
  * @brief         Read error
  * 
@@ -0,0 +1,112 @@
+/**
+* @file       bsp_msg_ring.c
+* @copyright  Copyright (C) 2020 Hydratech. All rights reserved.
+* @license    This project is released under the Hydratech License.
+* @version    01.00.00
+* @date       2022-04-10
+* @author     Thuan Le
+* @brief      Lock-free multi producer, single consumer ring of fixed size message slots
+* @note       Each slot carries a sequence number (bounded queue by D. Vyukov):
+*             - seq == pos            : slot is free for the producer reserving position pos
+*             - seq == pos + 1        : slot is committed and ready for the consumer
+*             - seq == pos + count    : slot is released and free for the next lap
+* @example    None
+*/
+
+/* Includes ----------------------------------------------------------------- */
+#include "bsp_msg_ring.h"
+
+/* Private defines ---------------------------------------------------------- */
+/* Private enumerate/structure ---------------------------------------------- */
+/* Private Constants -------------------------------------------------------- */
+/* Private variables -------------------------------------------------------- */
+/* Private macros ----------------------------------------------------------- */
+#define SLOT_AT(_ring, _pos)      (&(_ring)->data[((_pos) & (_ring)->mask) * (_ring)->slot_size])
+#define SLOT_INDEX(_ring, _slot)  (((uint8_t *)(_slot) - (_ring)->data) / (_ring)->slot_size)
+
+/* Private prototypes ------------------------------------------------------- */
+/* Public APIs -------------------------------------------------------------- */
+bool bsp_msg_ring_init(bsp_msg_ring_t *ring, void *data, uint32_t *seq, uint32_t slot_size, uint32_t count)
+{
+  if ((ring == NULL) || (data == NULL) || (seq == NULL) || (slot_size == 0))
+    return false;
+
+  if ((count == 0) || ((count & (count - 1)) != 0))
+    return false;
+
+  for (uint32_t i = 0; i < count; i++)
+    seq[i] = i;
+
+  ring->data      = data;
+  ring->seq       = seq;
+  ring->slot_size = slot_size;
+  ring->mask      = count - 1;
+  ring->head      = 0;
+  ring->tail      = 0;
+
+  return true;
+}
+
+void *bsp_msg_ring_reserve(bsp_msg_ring_t *ring)
+{
+  uint32_t pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+
+  while (1)
+  {
+    uint32_t seq = __atomic_load_n(&ring->seq[pos & ring->mask], __ATOMIC_ACQUIRE);
+    int32_t  dif = (int32_t)(seq - pos);
+
+    if (dif == 0)
+    {
+      // Slot is free, claim the position. On failure pos is reloaded with the current head.
+      if (__atomic_compare_exchange_n(&ring->head, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        return SLOT_AT(ring, pos);
+    }
+    else if (dif < 0)
+    {
+      // Slot of the previous lap is not released yet
+      return NULL;
+    }
+    else
+    {
+      // Another producer got this position first
+      pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+void bsp_msg_ring_commit(bsp_msg_ring_t *ring, void *slot)
+{
+  uint32_t idx = SLOT_INDEX(ring, slot);
+
+  // Only the reserving producer owns the slot now, so its sequence is still the reserved position
+  __atomic_store_n(&ring->seq[idx], ring->seq[idx] + 1, __ATOMIC_RELEASE);
+}
+
+void *bsp_msg_ring_peek(bsp_msg_ring_t *ring)
+{
+  uint32_t pos = ring->tail;
+  uint32_t seq = __atomic_load_n(&ring->seq[pos & ring->mask], __ATOMIC_ACQUIRE);
+
+  if (seq != pos + 1)
+    return NULL;
+
+  return SLOT_AT(ring, pos);
+}
+
+void bsp_msg_ring_release(bsp_msg_ring_t *ring)
+{
+  uint32_t pos = ring->tail;
+
+  __atomic_store_n(&ring->seq[pos & ring->mask], pos + ring->mask + 1, __ATOMIC_RELEASE);
+  __atomic_store_n(&ring->tail, pos + 1, __ATOMIC_RELEASE);
+}
+
+uint32_t bsp_msg_ring_count(bsp_msg_ring_t *ring)
+{
+  uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+  return __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - tail;
+}
+
+/* End of file -------------------------------------------------------------- */
@@ -0,0 +1,128 @@
+/**
+* @file       bsp_msg_ring.h
+* @copyright  Copyright (C) 2020 Hydratech. All rights reserved.
+* @license    This project is released under the Hydratech License.
+* @version    01.00.00
+* @date       2022-04-10
+* @author     Thuan Le
+* @brief      Lock-free multi producer, single consumer ring of fixed size message slots
+* @note       Producers reserve a slot, fill it in place then commit it.
+*             The consumer peeks the oldest committed slot, handles it in place then releases it.
+* @example    None
+*/
+
+/* Define to prevent recursive inclusion ------------------------------------ */
+#ifndef __BSP_MSG_RING_H
+#define __BSP_MSG_RING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ----------------------------------------------------------------- */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Public defines ----------------------------------------------------------- */
+/* Public enumerate/structure ----------------------------------------------- */
+/**
+ * @brief Message ring
+ */
+typedef struct
+{
+  uint8_t  *data;       // Slot storage, count * slot_size bytes
+  uint32_t *seq;        // Sequence number of each slot
+  uint32_t slot_size;
+  uint32_t mask;        // Number of slots - 1
+  uint32_t head;        // Next position to be reserved, shared by producers
+  uint32_t tail;        // Next position to be consumed, owned by consumer
+}
+bsp_msg_ring_t;
+
+/* Public Constants --------------------------------------------------------- */
+/* Public variables --------------------------------------------------------- */
+/* Public macros ------------------------------------------------------------ */
+/* Public APIs -------------------------------------------------------------- */
+/**
+ * @brief         Message ring init
+ *
+ * @param[in]     ring        Pointer to ring
+ * @param[in]     data        Pointer to slot storage, count * slot_size bytes
+ * @param[in]     seq         Pointer to sequence storage, count words
+ * @param[in]     slot_size   Size of one slot
+ * @param[in]     count       Number of slots, must be a power of 2
+ *
+ * @attention     Must be called before any producer or consumer runs
+ *
+ * @return
+ *  - true:   Success
+ *  - false:  Invalid params
+ */
+bool bsp_msg_ring_init(bsp_msg_ring_t *ring, void *data, uint32_t *seq, uint32_t slot_size, uint32_t count);
+
+/**
+ * @brief         Message ring reserve a free slot, safe to call from many tasks
+ *
+ * @param[in]     ring    Pointer to ring
+ *
+ * @attention     Slot is not visible to the consumer until bsp_msg_ring_commit()
+ *
+ * @return        Pointer to slot, NULL if ring is full
+ */
+void *bsp_msg_ring_reserve(bsp_msg_ring_t *ring);
+
+/**
+ * @brief         Message ring publish a reserved slot to the consumer
+ *
+ * @param[in]     ring    Pointer to ring
+ * @param[in]     slot    Pointer to slot returned by bsp_msg_ring_reserve()
+ *
+ * @attention     None
+ *
+ * @return        None
+ */
+void bsp_msg_ring_commit(bsp_msg_ring_t *ring, void *slot);
+
+/**
+ * @brief         Message ring get the oldest committed slot
+ *
+ * @param[in]     ring    Pointer to ring
+ *
+ * @attention     Single consumer only. Slots are consumed in reservation order, so a
+ *                reserved but not yet committed slot holds back the ones after it.
+ *
+ * @return        Pointer to slot, NULL if there is nothing to consume
+ */
+void *bsp_msg_ring_peek(bsp_msg_ring_t *ring);
+
+/**
+ * @brief         Message ring give the slot returned by bsp_msg_ring_peek() back to producers
+ *
+ * @param[in]     ring    Pointer to ring
+ *
+ * @attention     Single consumer only
+ *
+ * @return        None
+ */
+void bsp_msg_ring_release(bsp_msg_ring_t *ring);
+
+/**
+ * @brief         Message ring get number of slots in use
+ *
+ * @param[in]     ring    Pointer to ring
+ *
+ * @attention     Includes reserved slots not yet committed. Value is a snapshot.
+ *
+ * @return        Number of slots in use
+ */
+uint32_t bsp_msg_ring_count(bsp_msg_ring_t *ring);
+
+/* -------------------------------------------------------------------------- */
+#ifdef __cplusplus
+} // extern "C" {
+#endif
+
+#endif // __BSP_MSG_RING_H
+
+/* End of file -------------------------------------------------------------- */
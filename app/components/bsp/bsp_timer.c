@@ -66,6 +66,21 @@ bool bsp_tmr_is_expired(tmr_t *tm)
   }
 }
 
+/**
+ * @brief Time left before the simple timer expires, BSP_TMR_FOREVER when it is stopped
+ */
+tick_t bsp_tmr_remaining(tmr_t *tm)
+{
+  tick_t elapsed;
+
+  if (tm->interval == 0)
+    return BSP_TMR_FOREVER;
+
+  elapsed = bsp_get_sys_tick_ms() - tm->start;
+
+  return (elapsed >= tm->interval) ? 0 : (tm->interval - elapsed);
+}
+
 /**
  * @brief Initialize auto timer
  */
@@ -24,6 +24,8 @@ extern "C" {
 /* Public defines ----------------------------------------------------------- */
 typedef uint32_t tick_t;    //!< Count of system tick
 
+#define BSP_TMR_FOREVER   (UINT32_MAX)    //!< Remaining time of a stopped timer
+
 /* Public enumerate/structure ----------------------------------------------- */
 /**
  * @brief Simple timer
@@ -54,6 +56,7 @@ void bsp_tmr_start     (tmr_t *tm, tick_t interval);
 void bsp_tmr_restart   (tmr_t *tm, tick_t interval);
 void bsp_tmr_stop      (tmr_t *tm);
 bool bsp_tmr_is_expired(tmr_t *tm);
+tick_t bsp_tmr_remaining(tmr_t *tm);
 
 void bsp_tmr_auto_init   (auto_timer_t *atm, esp_timer_cb_t callback);
 void bsp_tmr_auto_start  (auto_timer_t *atm, tick_t interval);
@@ -0,0 +1,331 @@
+/**
+ * @file       bsp-error-fifo.c
+ * @copyright  Copyright (C) 2020 Hydratech. All rights reserved.
+ * @license    This project is released under the Hydratech License.
+ * @version    1.0.0
+ * @date       2022-04-20
+ * @author     Thuan Le
+ * @brief      Host test of the error database as the error code shadow drains it: chunks of
+ *             the oldest codes are read, and removed when the update is accepted. Checks
+ *             that every stored code is sent exactly once and in order, across several
+ *             chunks, a full wrapped database, codes added while a chunk waits for its ack,
+ *             and a reboot between two chunks.
+ * @note       Each code added is one higher than the previous, so order and duplicates show
+ *             in the sequence sent.
+ * @example    cd app/components/bsp/tests
+ *             gcc -std=gnu11 -O2 -Ihost -I.. bsp-error-fifo.c ../bsp_error.c -o bsp-error-fifo
+ *             ./bsp-error-fifo
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "bsp_error.h"
+#include "sys_nvs.h"
+
+/* Private defines ---------------------------------------------------- */
+#define TEST_CHUNK_MAX          (17)    // Smaller than the database, as AWS_SHADOW_ERROR_CODE_CNT_MAX with a smaller shadow RX buffer
+#define TEST_CODE_MAX           (2048)
+
+/* Private macros ----------------------------------------------------- */
+#define TEST_EXPECT(_expr)                                                \
+  do                                                                      \
+  {                                                                       \
+    m_test_checks++;                                                      \
+    if (!(_expr))                                                         \
+    {                                                                     \
+      m_test_failures++;                                                  \
+      printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #_expr);           \
+    }                                                                     \
+  }                                                                       \
+  while (0)
+
+/* Public variables --------------------------------------------------- */
+nvs_data_t g_nvs_setting_data;
+nvs_data_t g_nvs_flash_data;
+
+/* Private variables -------------------------------------------------- */
+static uint32_t m_test_checks;
+static uint32_t m_test_failures;
+
+static uint32_t m_next;                     // Last code added
+static uint32_t m_last_sent;                // Last code sent
+static uint8_t  m_sent[TEST_CODE_MAX];      // Times each code was sent
+static bool     m_out_of_order;
+
+/* Private function prototypes ---------------------------------------- */
+static void m_test_reset(void);
+static void m_test_reboot(void);
+static void m_test_add(uint32_t cnt);
+static void m_test_upload_chunk(uint32_t add_in_flight);
+static void m_test_upload_all(void);
+static bool m_test_sent_once(uint32_t first, uint32_t last);
+static bool m_test_sent_at_most_once(void);
+
+static void m_test_more_than_one_chunk(void);
+static void m_test_full_wrapped(void);
+static void m_test_add_in_flight(void);
+static void m_test_full_add_in_flight(void);
+static void m_test_repeated_code(void);
+
+/* Function definitions ----------------------------------------------- */
+int main(void)
+{
+  m_test_more_than_one_chunk();
+  m_test_full_wrapped();
+  m_test_add_in_flight();
+  m_test_full_add_in_flight();
+  m_test_repeated_code();
+
+  printf("%u checks, %u failures\n", m_test_checks, m_test_failures);
+  printf("%s\n", (m_test_failures == 0) ? "PASS" : "FAIL");
+
+  return (m_test_failures == 0) ? 0 : 1;
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief         Empty database and sent record
+ *
+ * @param[in]     None
+ *
+ * @attention     None
+ *
+ * @return        None
+ */
+static void m_test_reset(void)
+{
+  memset(&g_nvs_setting_data, 0, sizeof(g_nvs_setting_data));
+  memset(&g_nvs_flash_data, 0, sizeof(g_nvs_flash_data));
+  memset(m_sent, 0, sizeof(m_sent));
+
+  m_next         = 0;
+  m_last_sent    = 0;
+  m_out_of_order = false;
+
+  bsp_error_init();
+}
+
+/**
+ * @brief         Restart from what was last stored to NVS
+ *
+ * @param[in]     None
+ *
+ * @attention     None
+ *
+ * @return        None
+ */
+static void m_test_reboot(void)
+{
+  memset(&g_nvs_setting_data, 0xA5, sizeof(g_nvs_setting_data));
+  g_nvs_setting_data.bsp_error.nvs = g_nvs_flash_data.bsp_error.nvs;
+
+  bsp_error_init();
+}
+
+/**
+ * @brief         Add new codes
+ *
+ * @param[in]     cnt     Number of codes
+ *
+ * @attention     None
+ *
+ * @return        None
+ */
+static void m_test_add(uint32_t cnt)
+{
+  for (uint32_t i = 0; i < cnt; i++)
+    bsp_error_add((bsp_error_code_t)++m_next);
+}
+
+/**
+ * @brief         Send one chunk and accept it, as sys_aws_shadow.c does
+ *
+ * @param[in]     add_in_flight   Codes added while the chunk waits for its ack
+ *
+ * @attention     None
+ *
+ * @return        None
+ */
+static void m_test_upload_chunk(uint32_t add_in_flight)
+{
+  uint16_t cnt = bsp_error_read_start();
+  uint32_t overwritten, gone;
+
+  if (cnt > TEST_CHUNK_MAX)
+    cnt = TEST_CHUNK_MAX;
+  overwritten = bsp_error_overwritten();
+
+  bsp_error_read_start();
+  for (uint16_t i = 0; i < cnt; i++)
+  {
+    uint32_t code = bsp_error_read();
+
+    if (code < TEST_CODE_MAX)
+      m_sent[code]++;
+    if (code <= m_last_sent)
+      m_out_of_order = true;
+    m_last_sent = code;
+  }
+
+  m_test_add(add_in_flight);
+
+  gone = bsp_error_overwritten() - overwritten;
+  bsp_error_remove((gone < cnt) ? (uint16_t)(cnt - gone) : 0);
+}
+
+/**
+ * @brief         Send chunks until the database is empty
+ *
+ * @param[in]     None
+ *
+ * @attention     None
+ *
+ * @return        None
+ */
+static void m_test_upload_all(void)
+{
+  for (uint32_t i = 0; (i < 100) && (bsp_error_read_start() != 0); i++)
+    m_test_upload_chunk(0);
+}
+
+/**
+ * @brief         Check a range of codes was sent exactly once
+ *
+ * @param[in]     first     First code
+ * @param[in]     last      Last code
+ *
+ * @attention     None
+ *
+ * @return        true if every code of the range was sent once
+ */
+static bool m_test_sent_once(uint32_t first, uint32_t last)
+{
+  for (uint32_t code = first; code <= last; code++)
+  {
+    if (m_sent[code] != 1)
+    {
+      printf("  Code %u sent %u times\n", code, m_sent[code]);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * @brief         Check no code was sent twice
+ *
+ * @param[in]     None
+ *
+ * @attention     None
+ *
+ * @return        true if no code was sent twice
+ */
+static bool m_test_sent_at_most_once(void)
+{
+  for (uint32_t code = 0; code < TEST_CODE_MAX; code++)
+  {
+    if (m_sent[code] > 1)
+      return false;
+  }
+
+  return true;
+}
+
+static void m_test_more_than_one_chunk(void)
+{
+  printf("More than one chunk\n");
+
+  m_test_reset();
+  m_test_add(40);
+  TEST_EXPECT(bsp_error_read_start() == 40);
+
+  m_test_upload_chunk(0);
+  TEST_EXPECT(bsp_error_read_start() == 40 - TEST_CHUNK_MAX);
+
+  m_test_upload_all();
+  TEST_EXPECT(bsp_error_read_start() == 0);
+  TEST_EXPECT(m_test_sent_once(1, 40));
+  TEST_EXPECT(!m_out_of_order);
+}
+
+static void m_test_full_wrapped(void)
+{
+  uint32_t overwritten = bsp_error_overwritten();
+
+  printf("Full wrapped database\n");
+
+  m_test_reset();
+  m_test_add(250);
+  TEST_EXPECT(bsp_error_read_start() == BSP_ERROR_CNT_MAX);
+  TEST_EXPECT(bsp_error_overwritten() - overwritten == 250 - BSP_ERROR_CNT_MAX);
+
+  // Head is persisted, the next chunk after a reboot starts where the accepted one ended
+  m_test_upload_chunk(0);
+  m_test_reboot();
+  TEST_EXPECT(bsp_error_read_start() == BSP_ERROR_CNT_MAX - TEST_CHUNK_MAX);
+
+  m_test_upload_all();
+  TEST_EXPECT(bsp_error_read_start() == 0);
+  TEST_EXPECT(m_test_sent_once(251 - BSP_ERROR_CNT_MAX, 250));
+  TEST_EXPECT(m_sent[250 - BSP_ERROR_CNT_MAX] == 0);
+  TEST_EXPECT(!m_out_of_order);
+
+  // Database keeps working after being emptied at a wrapped position
+  m_test_add(30);
+  m_test_upload_all();
+  TEST_EXPECT(m_test_sent_once(251, 280));
+  TEST_EXPECT(!m_out_of_order);
+}
+
+static void m_test_add_in_flight(void)
+{
+  printf("Codes added while waiting for the ack\n");
+
+  m_test_reset();
+  m_test_add(30);
+
+  for (uint32_t i = 0; i < 10; i++)
+    m_test_upload_chunk(5);
+  m_test_upload_all();
+
+  TEST_EXPECT(bsp_error_read_start() == 0);
+  TEST_EXPECT(m_test_sent_once(1, 80));
+  TEST_EXPECT(!m_out_of_order);
+}
+
+static void m_test_full_add_in_flight(void)
+{
+  printf("Full database, codes overwritten while waiting for the ack\n");
+
+  m_test_reset();
+  m_test_add(BSP_ERROR_CNT_MAX);
+
+  for (uint32_t i = 0; i < 5; i++)
+    m_test_upload_chunk(20);
+  m_test_upload_all();
+
+  // Codes overwritten before they were read are lost, any other is sent once
+  TEST_EXPECT(bsp_error_read_start() == 0);
+  TEST_EXPECT(m_test_sent_at_most_once());
+  TEST_EXPECT(m_test_sent_once(m_next + 1 - BSP_ERROR_CNT_MAX, m_next));
+  TEST_EXPECT(!m_out_of_order);
+}
+
+static void m_test_repeated_code(void)
+{
+  printf("Repeated code\n");
+
+  m_test_reset();
+  bsp_error_add(BSP_ERR_SD_INIT);
+  bsp_error_add(BSP_ERR_SD_INIT);
+  TEST_EXPECT(bsp_error_read_start() == 1);
+
+  // Same code again once the first one is sent is a new occurrence
+  m_test_upload_all();
+  bsp_error_add(BSP_ERR_SD_INIT);
+  TEST_EXPECT(bsp_error_read_start() == 1);
+  bsp_error_read_start();
+  TEST_EXPECT(bsp_error_read() == BSP_ERR_SD_INIT);
+}
+
+/* End of file -------------------------------------------------------- */
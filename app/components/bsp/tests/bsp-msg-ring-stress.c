@@ -0,0 +1,220 @@
+/**
+ * @file       bsp-msg-ring-stress.c
+ * @copyright  Copyright (C) 2020 Hydratech. All rights reserved.
+ * @license    This project is released under the Hydratech License.
+ * @version    1.0.0
+ * @date       2022-04-20
+ * @author     Thuan Le
+ * @brief      Host stress test of the message ring. Several pthread producers reserve,
+ *             fill and commit slots as fast as they can while one consumer checks
+ *             every message: none lost, none seen twice, each producer's messages in
+ *             order and every slot filled completely before it was seen.
+ * @note       Slots are filled byte by byte between reserve and commit, so a slot seen
+ *             before its commit shows up as a torn message.
+ * @example    cd app/components/bsp/tests
+ *             gcc -std=gnu11 -O2 -pthread -I.. bsp-msg-ring-stress.c ../bsp_msg_ring.c -o bsp-msg-ring-stress
+ *             ./bsp-msg-ring-stress [producers] [messages per producer] [slots]
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "bsp_msg_ring.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Private defines ---------------------------------------------------- */
+#define STRESS_PRODUCERS_DEFAULT    (4)
+#define STRESS_MESSAGES_DEFAULT     (1000000)
+#define STRESS_SLOTS_DEFAULT        (8)     // Same as AWS_SERVICE_LANE_SIZE, keeps the ring full most of the time
+#define STRESS_PRODUCERS_MAX        (32)
+#define STRESS_PAYLOAD_SIZE         (48)
+
+/* Private enumerate/structure ---------------------------------------- */
+/**
+ * @brief Message of the test, payload is derived from producer and sequence
+ */
+typedef struct
+{
+  uint32_t producer;
+  uint32_t seq;
+  uint8_t  payload[STRESS_PAYLOAD_SIZE];
+}
+stress_msg_t;
+
+/* Private variables -------------------------------------------------- */
+static bsp_msg_ring_t m_ring;
+static uint32_t m_messages;
+static uint32_t m_full_cnt;   // Reserves that found the ring full
+
+/* Private function prototypes ---------------------------------------- */
+static void *m_stress_producer(void *arg);
+static uint8_t m_stress_payload_byte(uint32_t producer, uint32_t seq, uint32_t i);
+
+/* Function definitions ----------------------------------------------- */
+int main(int argc, char **argv)
+{
+  pthread_t thread[STRESS_PRODUCERS_MAX];
+  uint32_t next_seq[STRESS_PRODUCERS_MAX] = { 0 };
+  uint32_t producers = STRESS_PRODUCERS_DEFAULT;
+  uint32_t slots     = STRESS_SLOTS_DEFAULT;
+  uint64_t received  = 0, total, errors = 0;
+  uint32_t max_count = 0;
+  struct timespec start, end;
+  stress_msg_t *data;
+  uint32_t *seq;
+  double sec;
+
+  m_messages = STRESS_MESSAGES_DEFAULT;
+
+  if (argc > 1)
+    producers = (uint32_t)strtoul(argv[1], NULL, 0);
+  if (argc > 2)
+    m_messages = (uint32_t)strtoul(argv[2], NULL, 0);
+  if (argc > 3)
+    slots = (uint32_t)strtoul(argv[3], NULL, 0);
+
+  data = malloc(slots * sizeof(stress_msg_t));
+  seq  = malloc(slots * sizeof(uint32_t));
+
+  if ((producers == 0) || (producers > STRESS_PRODUCERS_MAX) || (data == NULL) || (seq == NULL) ||
+      !bsp_msg_ring_init(&m_ring, data, seq, sizeof(stress_msg_t), slots))
+  {
+    printf("Usage: %s [producers <= %d] [messages per producer] [slots, power of 2]\n", argv[0], STRESS_PRODUCERS_MAX);
+    return 1;
+  }
+
+  total = (uint64_t)producers * m_messages;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  for (uintptr_t i = 0; i < producers; i++)
+    pthread_create(&thread[i], NULL, m_stress_producer, (void *)i);
+
+  // Single consumer, handles each slot in place like the AWS TX task
+  while (received < total)
+  {
+    stress_msg_t *msg = bsp_msg_ring_peek(&m_ring);
+    uint32_t count;
+
+    if (msg == NULL)
+    {
+      sched_yield();
+      continue;
+    }
+
+    count = bsp_msg_ring_count(&m_ring);
+    if (count > max_count)
+      max_count = count;
+
+    if ((msg->producer >= producers) || (msg->seq != next_seq[msg->producer]))
+    {
+      if (errors++ < 10)
+        printf("Order error: producer %u seq %u, expected %u\n", msg->producer, msg->seq,
+               (msg->producer < producers) ? next_seq[msg->producer] : 0);
+    }
+    else
+    {
+      for (uint32_t i = 0; i < STRESS_PAYLOAD_SIZE; i++)
+      {
+        if (msg->payload[i] != m_stress_payload_byte(msg->producer, msg->seq, i))
+        {
+          if (errors++ < 10)
+            printf("Torn message: producer %u seq %u byte %u\n", msg->producer, msg->seq, i);
+          break;
+        }
+      }
+      next_seq[msg->producer]++;
+    }
+
+    bsp_msg_ring_release(&m_ring);
+    received++;
+  }
+
+  for (uint32_t i = 0; i < producers; i++)
+    pthread_join(thread[i], NULL);
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  sec = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+
+  // Nothing may be left once every producer is done
+  if (bsp_msg_ring_peek(&m_ring) != NULL)
+  {
+    printf("Ring not empty after the last message\n");
+    errors++;
+  }
+
+  if (max_count > slots)
+  {
+    printf("Count %u above %u slots\n", max_count, slots);
+    errors++;
+  }
+
+  printf("Producers   : %u\n", producers);
+  printf("Slots       : %u\n", slots);
+  printf("Messages    : %llu\n", (unsigned long long)received);
+  printf("Ring full   : %u reserves\n", __atomic_load_n(&m_full_cnt, __ATOMIC_RELAXED));
+  printf("Throughput  : %.2f M msg/s\n", received / sec / 1e6);
+  printf("Errors      : %llu\n", (unsigned long long)errors);
+  printf("%s\n", (errors == 0) ? "PASS" : "FAIL");
+
+  free(data);
+  free(seq);
+
+  return (errors == 0) ? 0 : 1;
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief         Producer thread, sends m_messages messages in order
+ *
+ * @param[in]     arg     Producer index
+ *
+ * @attention     None
+ *
+ * @return        NULL
+ */
+static void *m_stress_producer(void *arg)
+{
+  uint32_t producer = (uint32_t)(uintptr_t)arg;
+
+  for (uint32_t seq = 0; seq < m_messages; seq++)
+  {
+    stress_msg_t *msg;
+
+    while ((msg = bsp_msg_ring_reserve(&m_ring)) == NULL)
+    {
+      __atomic_fetch_add(&m_full_cnt, 1, __ATOMIC_RELAXED);
+      sched_yield();
+    }
+
+    msg->producer = producer;
+    msg->seq      = seq;
+    for (uint32_t i = 0; i < STRESS_PAYLOAD_SIZE; i++)
+      msg->payload[i] = m_stress_payload_byte(producer, seq, i);
+
+    bsp_msg_ring_commit(&m_ring, msg);
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief         Expected payload byte of a message
+ *
+ * @param[in]     producer  Producer index
+ * @param[in]     seq       Message sequence of the producer
+ * @param[in]     i         Byte index
+ *
+ * @attention     None
+ *
+ * @return        Payload byte
+ */
+static uint8_t m_stress_payload_byte(uint32_t producer, uint32_t seq, uint32_t i)
+{
+  return (uint8_t)((seq * 31u) ^ (producer * 7u) ^ i);
+}
+
+/* End of file -------------------------------------------------------- */
@@ -0,0 +1,21 @@
+/**
+* @file       bsp.h
+* @copyright  Copyright (C) 2020 Hydratech. All rights reserved.
+* @license    This project is released under the Hydratech License.
+* @version    1.0.0
+* @date       2022-04-20
+* @author     Thuan Le
+* @brief      Host stand-in of platform/bsp.h for the board support tests
+* @note       None
+* @example    None
+*/
+/* Define to prevent recursive inclusion ------------------------------------ */
+#ifndef __BSP_H
+#define __BSP_H
+
+/* Includes ----------------------------------------------------------------- */
+#include "platform_common.h"
+
+#endif // __BSP_H
+
+/* End of file -------------------------------------------------------------- */
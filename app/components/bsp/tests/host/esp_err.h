@@ -0,0 +1,20 @@
+/**
+* @file       esp_err.h
+* @copyright  Copyright (C) 2020 Hydratech. All rights reserved.
+* @license    This project is released under the Hydratech License.
+* @version    1.0.0
+* @date       2022-04-20
+* @author     Thuan Le
+* @brief      Host stand-in of esp_err.h for the board support tests
+* @note       None
+* @example    None
+*/
+/* Define to prevent recursive inclusion ------------------------------------ */
+#ifndef __ESP_ERR_H
+#define __ESP_ERR_H
+
+typedef int esp_err_t;
+
+#endif // __ESP_ERR_H
+
+/* End of file -------------------------------------------------------------- */
@@ -0,0 +1,31 @@
+/**
+* @file       platform_common.h
+* @copyright  Copyright (C) 2020 Hydratech. All rights reserved.
+* @license    This project is released under the Hydratech License.
+* @version    1.0.0
+* @date       2022-04-20
+* @author     Thuan Le
+* @brief      Host stand-in of platform/platform_common.h for the board support tests
+* @note       None
+* @example    None
+*/
+/* Define to prevent recursive inclusion ------------------------------------ */
+#ifndef __PLATFORM_COMMON_H
+#define __PLATFORM_COMMON_H
+
+/* Includes ----------------------------------------------------------------- */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/* Public defines ----------------------------------------------------------- */
+#define ESP_LOGE(tag, ...)      do { (void)(tag); } while (0)
+#define ESP_LOGW(tag, ...)      do { (void)(tag); } while (0)
+#define ESP_LOGI(tag, ...)      do { (void)(tag); } while (0)
+#define ESP_LOGD(tag, ...)      do { (void)(tag); } while (0)
+
+#endif // __PLATFORM_COMMON_H
+
+/* End of file -------------------------------------------------------------- */
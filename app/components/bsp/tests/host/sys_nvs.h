@@ -0,0 +1,37 @@
+/**
+* @file       sys_nvs.h
+* @copyright  Copyright (C) 2020 Hydratech. All rights reserved.
+* @license    This project is released under the Hydratech License.
+* @version    1.0.0
+* @date       2022-04-20
+* @author     Thuan Le
+* @brief      Host stand-in of sys/sys_nvs.h for the board support tests
+* @note       A store copies the member to g_nvs_flash_data, the test reboots from there
+* @example    None
+*/
+/* Define to prevent recursive inclusion ------------------------------------ */
+#ifndef __SYS_NVS_H
+#define __SYS_NVS_H
+
+/* Includes ----------------------------------------------------------------- */
+#include "platform_common.h"
+#include "bsp_error.h"
+
+/* Public enumerate/structure ----------------------------------------------- */
+typedef struct nvs_data_struct
+{
+  bsp_error_t bsp_error;
+}
+nvs_data_t;
+
+/* Public macros ------------------------------------------------------------ */
+#define SYS_NVS_STORE(name)                                                        \
+  memcpy(&g_nvs_flash_data.name, &g_nvs_setting_data.name, sizeof(g_nvs_setting_data.name))
+
+/* Public variables --------------------------------------------------------- */
+extern nvs_data_t g_nvs_setting_data;
+extern nvs_data_t g_nvs_flash_data;
+
+#endif // __SYS_NVS_H
+
+/* End of file -------------------------------------------------------------- */
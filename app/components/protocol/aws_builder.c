@@ -13,26 +13,69 @@
 
 /* Includes ----------------------------------------------------------- */
 #include "aws_builder.h"
+#include "aws_cbor.h"
 #include "frozen.h"
 #include "jsmn.h"
+#include <stddef.h>
 
 /* Private defines ---------------------------------------------------- */
 static const char *TAG = "aws_builder";
 
+#define AWS_FIELD_SIZE_U16      (sizeof(uint16_t))
+#define AWS_FIELD_SIZE_U32      (sizeof(uint32_t))
+#define AWS_FIELD_SIZE_U64      (sizeof(uint64_t))
+#define AWS_FIELD_SIZE_FLOAT    (sizeof(float))
+#define AWS_FIELD_SIZE_STR      (0)     // Any char array
+
 /* Private enumerate/structure ---------------------------------------- */
 /* Private macros ----------------------------------------------------- */
+#define MEMBER_SIZE(_t, _m)     sizeof(((_t *)0)->_m)
+
+#define FIELD(_t, _n, _k, _type, _m)                    \
+  {                                                     \
+    .name         = _n,                                 \
+    .json_key     = ", \"" _n "\": ",                   \
+    .json_key_len = sizeof(", \"" _n "\": ") - 1,       \
+    .key          = _k,                                 \
+    .type         = AWS_FIELD_##_type,                  \
+    .offset       = offsetof(_t, _m),                   \
+    .size         = MEMBER_SIZE(_t, _m)                 \
+  },
+
+#define FIELD_CHECK(_t, _n, _type, _m)                                                        \
+  _Static_assert((AWS_FIELD_SIZE_##_type == 0) || (MEMBER_SIZE(_t, _m) == AWS_FIELD_SIZE_##_type), \
+                 "Type of field \"" _n "\" does not match its member");
+
+#define NOTI_FIELD(_n, _k, _type, _m)         FIELD(aws_noti_param_t, _n, _k, _type, _m)
+#define NOTI_FIELD_CHECK(_n, _k, _type, _m)   FIELD_CHECK(aws_noti_param_t, _n, _type, _m)
+#define RESP_FIELD(_n, _k, _type, _m)         FIELD(aws_resp_param_t, _n, _k, _type, _m)
+#define RESP_FIELD_CHECK(_n, _k, _type, _m)   FIELD_CHECK(aws_resp_param_t, _n, _type, _m)
+
+#define SCHEMA(_f)              { .field = _f, .count = sizeof(_f) / sizeof(_f[0]) }
+#define SCHEMA_NONE             { .field = NULL, .count = 0 }
+
 /* Public variables --------------------------------------------------- */
 /* Private variables -------------------------------------------------- */
-#define INFO(_i, _n)[_i] = { .name = _n}
+AWS_NOTI_ALARM_FIELDS(NOTI_FIELD_CHECK)
+AWS_NOTI_DEVICE_DATA_FIELDS(NOTI_FIELD_CHECK)
+AWS_RESP_GET_DEVICE_INFO_FIELDS(RESP_FIELD_CHECK)
+
+static const aws_field_t AWS_NOTI_ALARM_FIELD[]           = { AWS_NOTI_ALARM_FIELDS(NOTI_FIELD) };
+static const aws_field_t AWS_NOTI_DEVICE_DATA_FIELD[]     = { AWS_NOTI_DEVICE_DATA_FIELDS(NOTI_FIELD) };
+static const aws_field_t AWS_RESP_GET_DEVICE_INFO_FIELD[] = { AWS_RESP_GET_DEVICE_INFO_FIELDS(RESP_FIELD) };
+
+#define INFO(_i, _n, _s)[_i] = { .name = _n, .schema = _s }
 const aws_req_info_t AWS_REQ_LIST[] =
 {
-  //    +===============================+=================+
-  //    | ID                            | Name            |
-  //    +-------------------------------+-----------------+
-   INFO ( AWS_REQ_GET_DEVICE_INFO       , "get_dev_info"  )
-  //    +===============================+=================+
+  //    +===============================+=================+=================================================+
+  //    | ID                            | Name            | Response fields                                 |
+  //    +-------------------------------+-----------------+-------------------------------------------------+
+   INFO ( AWS_REQ_GET_DEVICE_INFO       , "get_dev_info"  , SCHEMA(AWS_RESP_GET_DEVICE_INFO_FIELD)            )
+  //    +===============================+=================+=================================================+
 };
+#undef  INFO
 
+#define INFO(_i, _n)[_i] = { .name = _n}
 const aws_res_info_t AWS_RES_LIST[] =
 {
   //    +===========================+=====================+
@@ -46,87 +89,378 @@ const aws_res_info_t AWS_RES_LIST[] =
 };
 #undef  INFO
 
-#define INFO(_i, _n, _ack)[_i] = { .name = _n, .ack = _ack}
+#define INFO(_i, _n, _s)[_i] = { .name = _n, .schema = _s }
 const aws_noti_info_t AWS_NOTI_LIST[] =
 {
-  //    +===========================================+=================+=======+
-  //    | ID                                        | Name            | ACK   |
-  //    +-------------------------------------------+-----------------+-------+
-   INFO ( AWS_NOTI_ALARM                            , "alarm"         ,      1)
-  ,INFO ( AWS_NOTI_DEVICE_DATA                      , "device_data"   ,      1)
-  //    +===========================================+=================+=======+
+  //    +===========================================+=================+=========================================+
+  //    | ID                                        | Name            | Fields                                  |
+  //    +-------------------------------------------+-----------------+-----------------------------------------+
+   INFO ( AWS_NOTI_ALARM                            , "alarm"         , SCHEMA(AWS_NOTI_ALARM_FIELD)            )
+  ,INFO ( AWS_NOTI_DEVICE_DATA                      , "device_data"   , SCHEMA(AWS_NOTI_DEVICE_DATA_FIELD)      )
+  //    +===========================================+=================+=========================================+
 };
 #undef  INFO
 
 /* Private function prototypes ---------------------------------------- */
+static void m_aws_build_noti_data(struct json_out *out, aws_noti_param_t *param);
+static void m_aws_build_noti_data_cbor(aws_cbor_writer_t *w, aws_noti_param_t *param);
+static void m_aws_build_fields(struct json_out *out, const aws_schema_t *schema, const void *param);
+static void m_aws_build_fields_cbor(aws_cbor_writer_t *w, const aws_schema_t *schema, const void *param);
+static uint32_t m_aws_build_uint_str(char *str, uint64_t val);
+static uint32_t m_aws_build_json_len(struct json_out *out);
+static uint32_t m_aws_build_cbor_len(aws_cbor_writer_t *w);
+
 /* Function definitions ----------------------------------------------- */
-void aws_build_packet(aws_packet_type_t type, void *param, void *buf, uint32_t size)
+uint32_t aws_build_packet(aws_packet_encoding_t enc, aws_packet_type_t type, void *param, void *buf, uint32_t size)
 {
   switch (type)
   {
   case AWS_PKT_RESP:
-    aws_build_response(param, buf, size);
-    break;
+    return aws_build_response(enc, param, buf, size);
 
   case AWS_PKT_NOTI:
-    aws_build_notification(param, buf, size);
-    break;
+    return aws_build_notification(enc, param, buf, size);
 
   default:
-    break;
+    return 0;
   }
 }
 
-void aws_build_response(aws_resp_param_t *param, void *buf, uint32_t size)
+uint32_t aws_build_response(aws_packet_encoding_t enc, aws_resp_param_t *param, void *buf, uint32_t size)
 {
+  const aws_schema_t *schema;
+
+  CHECK((param->req_type < AWS_REQ_UNKNOWN) && (param->res_type < AWS_RES_UNKNOWN), 0);
+
+  schema = &AWS_REQ_LIST[param->req_type].schema;
+
+  if (enc == AWS_ENC_CBOR)
+  {
+    aws_cbor_writer_t w;
+
+    aws_cbor_writer_init(&w, buf, size);
+
+    aws_cbor_put_map(&w, 2);
+    aws_cbor_put_uint(&w, AWS_CBOR_KEY_TYPE);
+    aws_cbor_put_uint(&w, AWS_PKT_RESP);
+    aws_cbor_put_uint(&w, AWS_CBOR_KEY_DATA);
+
+    aws_cbor_put_map(&w, 2 + schema->count);
+    aws_cbor_put_uint(&w, AWS_CBOR_KEY_ID);
+    aws_cbor_put_uint(&w, param->req_type);
+    aws_cbor_put_uint(&w, AWS_CBOR_KEY_RESULT);
+    aws_cbor_put_uint(&w, param->res_type);
+    m_aws_build_fields_cbor(&w, schema, param);
+
+    return m_aws_build_cbor_len(&w);
+  }
+  else
+  {
+    struct json_out out = JSON_OUT_BUF(buf, size);
+
+    json_printf(&out, "{type: rs, data:{rq: %Q, rs: %Q",
+                AWS_REQ_LIST[param->req_type].name,
+                AWS_RES_LIST[param->res_type].name);
+
+    m_aws_build_fields(&out, schema, param);
+    json_printf(&out, "}}");
+
+    return m_aws_build_json_len(&out);
+  }
 }
 
-void aws_build_notification(aws_noti_param_t *param, void *buf, uint32_t size)
+uint32_t aws_build_notification(aws_packet_encoding_t enc, aws_noti_param_t *param, void *buf, uint32_t size)
 {
-  #define DEV_DATA param->info.device_data
+  if (enc == AWS_ENC_CBOR)
+  {
+    aws_cbor_writer_t w;
 
-  struct json_out out = JSON_OUT_BUF(buf, size);
+    aws_cbor_writer_init(&w, buf, size);
 
-  json_printf(&out, "{type: nt, data:");
+    aws_cbor_put_map(&w, 2);
+    aws_cbor_put_uint(&w, AWS_CBOR_KEY_TYPE);
+    aws_cbor_put_uint(&w, AWS_PKT_NOTI);
+    aws_cbor_put_uint(&w, AWS_CBOR_KEY_DATA);
+    m_aws_build_noti_data_cbor(&w, param);
 
-  switch (param->noti_type)
+    return m_aws_build_cbor_len(&w);
+  }
+  else
   {
-  case AWS_NOTI_ALARM:
-    json_printf(&out, "{nt: %Q, time: %d, alarm_code: %d}}",
-                AWS_NOTI_LIST[param->noti_type].name,
-                param->info.time,
-                param->info.alarm_code);
-    break;
-
-  case AWS_NOTI_DEVICE_DATA:
-    ESP_LOGI(TAG, "Noti name       : %s", AWS_NOTI_LIST[param->noti_type].name);
-    ESP_LOGI(TAG, "Time            : %d", param->info.time);
-    ESP_LOGI(TAG, "Serial number   : %s", DEV_DATA.serial_number);
-    ESP_LOGI(TAG, "Battery         : %d", DEV_DATA.battery);
-    ESP_LOGI(TAG, "Weight scale    : %d", DEV_DATA.weight_scale);
-    ESP_LOGI(TAG, "Alarm code      : %d", DEV_DATA.alarm_code);
-    ESP_LOGI(TAG, "Temperature     : %d", DEV_DATA.temp);
-    ESP_LOGI(TAG, "Longitude       : %f", DEV_DATA.longitude);
-    ESP_LOGI(TAG, "Lattitude       : %f", DEV_DATA.lattitude);
-
-    json_printf(&out, "{nt: %Q, time: %%llu, serial_number: %Q, battery: %d, weight_scale: %d, alarm_code: %d, temp: %d, longitude: %f, lattitude: %f}}",
-                AWS_NOTI_LIST[param->noti_type].name,
-                param->info.time,
-                DEV_DATA.serial_number,
-                DEV_DATA.battery,
-                DEV_DATA.weight_scale,
-                DEV_DATA.alarm_code,
-                DEV_DATA.temp,
-                DEV_DATA.longitude,
-                DEV_DATA.lattitude);
-
-    break;
-  
-  default:
-    break;
+    struct json_out out = JSON_OUT_BUF(buf, size);
+
+    json_printf(&out, "{type: nt, data:");
+    m_aws_build_noti_data(&out, param);
+    json_printf(&out, "}");
+
+    return m_aws_build_json_len(&out);
+  }
+}
+
+uint32_t aws_build_notification_batch(aws_packet_encoding_t enc, aws_noti_param_t *param, uint8_t count, void *buf, uint32_t size)
+{
+  if (enc == AWS_ENC_CBOR)
+  {
+    aws_cbor_writer_t w;
+
+    aws_cbor_writer_init(&w, buf, size);
+
+    aws_cbor_put_map(&w, 2);
+    aws_cbor_put_uint(&w, AWS_CBOR_KEY_TYPE);
+    aws_cbor_put_uint(&w, AWS_PKT_NOTI);
+    aws_cbor_put_uint(&w, AWS_CBOR_KEY_DATA);
+    aws_cbor_put_array(&w, count);
+
+    for (uint8_t i = 0; i < count; i++)
+      m_aws_build_noti_data_cbor(&w, &param[i]);
+
+    return m_aws_build_cbor_len(&w);
+  }
+  else
+  {
+    struct json_out out = JSON_OUT_BUF(buf, size);
+
+    json_printf(&out, "{type: nt, data: [");
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+      if (i != 0)
+        json_printf(&out, ",");
+
+      m_aws_build_noti_data(&out, &param[i]);
+    }
+
+    json_printf(&out, "]}");
+
+    return m_aws_build_json_len(&out);
+  }
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief         AWS build notification data object
+ *
+ * @param[in]     out     Pointer to json output
+ * @param[in]     param   Pointer to notification param
+ *
+ * @attention     None
+ *
+ * @return        None
+ */
+static void m_aws_build_noti_data(struct json_out *out, aws_noti_param_t *param)
+{
+  if (param->noti_type >= AWS_NOTI_UNKNOWN)
+  {
+    json_printf(out, "{}");
+    return;
+  }
+
+  json_printf(out, "{nt: %Q", AWS_NOTI_LIST[param->noti_type].name);
+  m_aws_build_fields(out, &AWS_NOTI_LIST[param->noti_type].schema, param);
+  json_printf(out, "}");
+}
+
+/**
+ * @brief         AWS build notification data object in CBOR
+ *
+ * @param[in]     w       Pointer to CBOR writer
+ * @param[in]     param   Pointer to notification param
+ *
+ * @attention     None
+ *
+ * @return        None
+ */
+static void m_aws_build_noti_data_cbor(aws_cbor_writer_t *w, aws_noti_param_t *param)
+{
+  const aws_schema_t *schema = NULL;
+
+  if (param->noti_type < AWS_NOTI_UNKNOWN)
+    schema = &AWS_NOTI_LIST[param->noti_type].schema;
+
+  aws_cbor_put_map(w, 1 + ((schema != NULL) ? schema->count : 0));
+  aws_cbor_put_uint(w, AWS_CBOR_KEY_ID);
+  aws_cbor_put_uint(w, param->noti_type);
+
+  if (schema != NULL)
+    m_aws_build_fields_cbor(w, schema, param);
+}
+
+/**
+ * @brief         AWS build JSON members of all fields in schema
+ *
+ * @param[in]     out     Pointer to json output
+ * @param[in]     schema  Pointer to schema
+ * @param[in]     param   Pointer to param struct described by schema
+ *
+ * @attention     Each member is preceded by a comma
+ *
+ * @return        None
+ */
+static void m_aws_build_fields(struct json_out *out, const aws_schema_t *schema, const void *param)
+{
+  const aws_field_t *field;
+  const uint8_t *member;
+  char num[48];
+  uint32_t len;
+
+  for (uint8_t i = 0; i < schema->count; i++)
+  {
+    field  = &schema->field[i];
+    member = (const uint8_t *)param + field->offset;
+
+    out->printer(out, field->json_key, field->json_key_len);
+
+    switch (field->type)
+    {
+    case AWS_FIELD_U16:
+      len = m_aws_build_uint_str(num, *(const uint16_t *)member);
+      out->printer(out, num, len);
+      break;
+
+    case AWS_FIELD_U32:
+      len = m_aws_build_uint_str(num, *(const uint32_t *)member);
+      out->printer(out, num, len);
+      break;
+
+    case AWS_FIELD_U64:
+      len = m_aws_build_uint_str(num, *(const uint64_t *)member);
+      out->printer(out, num, len);
+      break;
+
+    case AWS_FIELD_FLOAT:
+      len = snprintf(num, sizeof(num), "%f", (double)*(const float *)member);
+      out->printer(out, num, (len < sizeof(num)) ? len : sizeof(num) - 1);
+      break;
+
+    case AWS_FIELD_STR:
+      // String is escaped by json_printf
+      json_printf(out, "%.*Q", (int)strnlen((const char *)member, field->size), member);
+      break;
+
+    default:
+      out->printer(out, "null", 4);
+      break;
+    }
+  }
+}
+
+/**
+ * @brief         AWS build CBOR map entries of all fields in schema
+ *
+ * @param[in]     w       Pointer to CBOR writer
+ * @param[in]     schema  Pointer to schema
+ * @param[in]     param   Pointer to param struct described by schema
+ *
+ * @attention     Map head must be written by caller, counting schema->count entries
+ *
+ * @return        None
+ */
+static void m_aws_build_fields_cbor(aws_cbor_writer_t *w, const aws_schema_t *schema, const void *param)
+{
+  const aws_field_t *field;
+  const uint8_t *member;
+
+  for (uint8_t i = 0; i < schema->count; i++)
+  {
+    field  = &schema->field[i];
+    member = (const uint8_t *)param + field->offset;
+
+    aws_cbor_put_uint(w, field->key);
+
+    switch (field->type)
+    {
+    case AWS_FIELD_U16:
+      aws_cbor_put_uint(w, *(const uint16_t *)member);
+      break;
+
+    case AWS_FIELD_U32:
+      aws_cbor_put_uint(w, *(const uint32_t *)member);
+      break;
+
+    case AWS_FIELD_U64:
+      aws_cbor_put_uint(w, *(const uint64_t *)member);
+      break;
+
+    case AWS_FIELD_FLOAT:
+      aws_cbor_put_float(w, *(const float *)member);
+      break;
+
+    case AWS_FIELD_STR:
+      aws_cbor_put_text(w, (const char *)member, strnlen((const char *)member, field->size));
+      break;
+
+    default:
+      aws_cbor_put_uint(w, 0);
+      break;
+    }
+  }
+}
+
+/**
+ * @brief         Convert unsigned integer to decimal string
+ *
+ * @param[out]    str     Pointer to output string, at least 20 bytes
+ * @param[in]     val     Value
+ *
+ * @attention     Output is not null terminated
+ *
+ * @return        String length
+ */
+static uint32_t m_aws_build_uint_str(char *str, uint64_t val)
+{
+  char tmp[20];
+  uint32_t len = 0;
+
+  do
+  {
+    tmp[len++] = '0' + (val % 10);
+    val /= 10;
+  } while (val != 0);
+
+  for (uint32_t i = 0; i < len; i++)
+    str[i] = tmp[len - 1 - i];
+
+  return len;
+}
+
+/**
+ * @brief         Get length of built JSON packet
+ *
+ * @param[in]     out     Pointer to json output
+ *
+ * @attention     Last byte of buffer is kept for the null terminator
+ *
+ * @return        Packet length, 0 if buffer is too small
+ */
+static uint32_t m_aws_build_json_len(struct json_out *out)
+{
+  if (out->u.buf.len >= out->u.buf.size)
+  {
+    ESP_LOGE(TAG, "Packet buffer overflow");
+    return 0;
+  }
+
+  return (uint32_t)out->u.buf.len;
+}
+
+/**
+ * @brief         Get length of built CBOR packet
+ *
+ * @param[in]     w       Pointer to CBOR writer
+ *
+ * @attention     None
+ *
+ * @return        Packet length, 0 if buffer is too small
+ */
+static uint32_t m_aws_build_cbor_len(aws_cbor_writer_t *w)
+{
+  if (!aws_cbor_writer_is_ok(w))
+  {
+    ESP_LOGE(TAG, "Packet buffer overflow");
+    return 0;
   }
 
-  #undef DEV_DATA
+  return w->len;
 }
 
 /* End of file -------------------------------------------------------- */
@@ -33,6 +33,38 @@ typedef enum
 }
 aws_packet_type_t;
 
+/**
+ * @brief AWS packet encoding enum
+ */
+typedef enum
+{
+   AWS_ENC_JSON = 0 // JSON text
+  ,AWS_ENC_CBOR     // CBOR binary, map keys are @ref aws_cbor_key_t
+}
+aws_packet_encoding_t;
+
+/**
+ * @brief AWS CBOR map key enum, the integer keys replace the JSON key names
+ */
+typedef enum
+{
+   AWS_CBOR_KEY_TYPE          = 0   // Packet type
+  ,AWS_CBOR_KEY_DATA          = 1   // Packet data
+  ,AWS_CBOR_KEY_ID            = 2   // Notification or request type
+  ,AWS_CBOR_KEY_TIME          = 3
+  ,AWS_CBOR_KEY_ALARM_CODE    = 4
+  ,AWS_CBOR_KEY_SERIAL_NUMBER = 5
+  ,AWS_CBOR_KEY_BATTERY       = 6
+  ,AWS_CBOR_KEY_WEIGHT_SCALE  = 7
+  ,AWS_CBOR_KEY_TEMP          = 8
+  ,AWS_CBOR_KEY_LONGITUDE     = 9
+  ,AWS_CBOR_KEY_LATTITUDE     = 10
+  ,AWS_CBOR_KEY_RESULT        = 11
+  ,AWS_CBOR_KEY_HW            = 12
+  ,AWS_CBOR_KEY_FW            = 13
+}
+aws_cbor_key_t;
+
 typedef enum
 {
    QUES_YES = 0
@@ -79,13 +111,51 @@ typedef enum
 }
 aws_noti_type_t;
 
+/**
+ * @brief AWS packet field type enum
+ */
+typedef enum
+{
+   AWS_FIELD_U16
+  ,AWS_FIELD_U32
+  ,AWS_FIELD_U64
+  ,AWS_FIELD_FLOAT
+  ,AWS_FIELD_STR      // Null terminated char array
+}
+aws_field_type_t;
+
+/**
+ * @brief AWS packet field info, generated from the field lists below
+ */
+typedef struct
+{
+  const char *name;         // JSON key
+  const char *json_key;     // JSON key with its separators, ready to be copied to output
+  uint8_t json_key_len;
+  aws_cbor_key_t key;       // CBOR key
+  aws_field_type_t type;
+  uint16_t offset;          // Offset of member in param struct
+  uint16_t size;            // Size of member in param struct
+}
+aws_field_t;
+
+/**
+ * @brief AWS packet schema, the fields following the packet ID
+ */
+typedef struct
+{
+  const aws_field_t *field;
+  uint8_t count;
+}
+aws_schema_t;
+
 /**
  * @brief AWS notification info
  */
 typedef struct
 {
-  bool ack;
   char * const name;
+  aws_schema_t schema;
 }
 aws_noti_info_t;
 
@@ -95,6 +165,7 @@ aws_noti_info_t;
 typedef struct
 {
   char * const name;
+  aws_schema_t schema;      // Fields of the response
 }
 aws_req_info_t;
 
@@ -173,11 +244,40 @@ typedef struct
 aws_noti_param_t;
 
 /* Public macros ------------------------------------------------------ */
+/**
+ * @brief AWS packet field lists, encoders and decoders walk the tables generated from them.
+ *        Adding a field to a packet is one line here, type must match the member type.
+ *
+ *        X ( JSON name, CBOR key, Type, Member of aws_noti_param_t or aws_resp_param_t )
+ */
+#define AWS_NOTI_ALARM_FIELDS(X)                                                              \
+  X ( "time"          , AWS_CBOR_KEY_TIME           , U64   , info.time                       ) \
+  X ( "alarm_code"    , AWS_CBOR_KEY_ALARM_CODE     , U32   , info.alarm_code                 )
+
+#define AWS_NOTI_DEVICE_DATA_FIELDS(X)                                                        \
+  X ( "time"          , AWS_CBOR_KEY_TIME           , U64   , info.time                       ) \
+  X ( "serial_number" , AWS_CBOR_KEY_SERIAL_NUMBER  , STR   , info.device_data.serial_number  ) \
+  X ( "battery"       , AWS_CBOR_KEY_BATTERY        , U16   , info.device_data.battery        ) \
+  X ( "weight_scale"  , AWS_CBOR_KEY_WEIGHT_SCALE   , U16   , info.device_data.weight_scale   ) \
+  X ( "alarm_code"    , AWS_CBOR_KEY_ALARM_CODE     , U32   , info.device_data.alarm_code     ) \
+  X ( "temp"          , AWS_CBOR_KEY_TEMP           , U16   , info.device_data.temp           ) \
+  X ( "longitude"     , AWS_CBOR_KEY_LONGITUDE      , FLOAT , info.device_data.longitude      ) \
+  X ( "lattitude"     , AWS_CBOR_KEY_LATTITUDE      , FLOAT , info.device_data.lattitude      )
+
+#define AWS_RESP_GET_DEVICE_INFO_FIELDS(X)                                                    \
+  X ( "hw"            , AWS_CBOR_KEY_HW             , STR   , info.dev_info.hw                ) \
+  X ( "fw"            , AWS_CBOR_KEY_FW             , STR   , info.dev_info.fw                )
+
 /* Public variables --------------------------------------------------- */
+extern const aws_req_info_t  AWS_REQ_LIST[];
+extern const aws_res_info_t  AWS_RES_LIST[];
+extern const aws_noti_info_t AWS_NOTI_LIST[];
+
 /* Public function prototypes ----------------------------------------- */
 /**
  * @brief         AWS build packet
  *
+ * @param[in]     enc     Packet encoding
  * @param[in]     type    Packet type
  * @param[in]     param   Pointer to packet param
  * @param[out]    buf     Point to paket buf
@@ -185,35 +285,52 @@ aws_noti_param_t;
  *
  * @attention     None
  *
- * @return        None
+ * @return        Packet length, 0 if the packet could not be built
  */
-void aws_build_packet(aws_packet_type_t type, void *param, void *buf, uint32_t size);
+uint32_t aws_build_packet(aws_packet_encoding_t enc, aws_packet_type_t type, void *param, void *buf, uint32_t size);
 
 /**
  * @brief         AWS build response packet
  *
+ * @param[in]     enc     Packet encoding
  * @param[in]     param   Pointer to packet param
  * @param[out]    buf     Point to paket buf
  * @param[in]     size    Size of packet buf
  *
  * @attention     None
  *
- * @return        None
+ * @return        Packet length, 0 if the packet could not be built
  */
-void aws_build_response(aws_resp_param_t *param, void *buf, uint32_t size);
+uint32_t aws_build_response(aws_packet_encoding_t enc, aws_resp_param_t *param, void *buf, uint32_t size);
 
 /**
  * @brief         AWS build notification packet
  *
+ * @param[in]     enc     Packet encoding
  * @param[in]     param   Pointer to packet param
  * @param[out]    buf     Point to paket buf
  * @param[in]     size    Size of packet buf
  *
  * @attention     None
  *
- * @return        None
+ * @return        Packet length, 0 if the packet could not be built
+ */
+uint32_t aws_build_notification(aws_packet_encoding_t enc, aws_noti_param_t *param, void *buf, uint32_t size);
+
+/**
+ * @brief         AWS build batched notification packet
+ *
+ * @param[in]     enc     Packet encoding
+ * @param[in]     param   Pointer to array of notification params
+ * @param[in]     count   Number of notification params
+ * @param[out]    buf     Point to paket buf
+ * @param[in]     size    Size of packet buf
+ *
+ * @attention     All notifications are put into one "data" array
+ *
+ * @return        Packet length, 0 if the packet could not be built
  */
-void aws_build_notification(aws_noti_param_t *param, void *buf, uint32_t size);
+uint32_t aws_build_notification_batch(aws_packet_encoding_t enc, aws_noti_param_t *param, uint8_t count, void *buf, uint32_t size);
 
 #endif // __AWS_BUILDER_H
 
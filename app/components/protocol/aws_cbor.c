@@ -0,0 +1,376 @@
+/**
+* @file       aws_cbor.c
+* @copyright  Copyright (C) 2021 Hydratech. All rights reserved.
+* @license    This project is released under the Hydratech License.
+* @version    01.00.00
+* @date       2022-03-10
+* @author     Thuan Le
+* @brief      Minimal CBOR (RFC 8949) encoder and decoder for AWS packets.
+*             Only definite length items are supported.
+* @note       None
+* @example    None
+*/
+
+/* Includes ----------------------------------------------------------- */
+#include "aws_cbor.h"
+
+/* Private defines ---------------------------------------------------- */
+#define AWS_CBOR_NESTING_MAX      (8)     // Max depth of nested array/map when skipping
+
+#define AWS_CBOR_AI_1BYTE         (24)    // Additional info: 1 byte argument follows
+#define AWS_CBOR_AI_2BYTE         (25)    // Additional info: 2 bytes argument follows
+#define AWS_CBOR_AI_4BYTE         (26)    // Additional info: 4 bytes argument follows
+#define AWS_CBOR_AI_8BYTE         (27)    // Additional info: 8 bytes argument follows
+
+#define AWS_CBOR_FLOAT32          (0xFA)  // Initial byte of single precision float
+#define AWS_CBOR_FLOAT64          (0xFB)  // Initial byte of double precision float
+
+/* Private enumerate/structure ---------------------------------------- */
+/* Private macros ----------------------------------------------------- */
+/* Public variables --------------------------------------------------- */
+/* Private variables -------------------------------------------------- */
+/* Private function prototypes ---------------------------------------- */
+static void m_aws_cbor_put_byte(aws_cbor_writer_t *w, uint8_t byte);
+static void m_aws_cbor_put_head(aws_cbor_writer_t *w, aws_cbor_major_t major, uint64_t val);
+static bool m_aws_cbor_get_head(aws_cbor_reader_t *r, aws_cbor_major_t *major, uint64_t *val);
+static bool m_aws_cbor_skip(aws_cbor_reader_t *r, uint8_t depth);
+
+/* Function definitions ----------------------------------------------- */
+void aws_cbor_writer_init(aws_cbor_writer_t *w, void *buf, uint32_t size)
+{
+  w->buf  = buf;
+  w->size = size;
+  w->len  = 0;
+}
+
+void aws_cbor_put_uint(aws_cbor_writer_t *w, uint64_t val)
+{
+  m_aws_cbor_put_head(w, AWS_CBOR_UINT, val);
+}
+
+void aws_cbor_put_int(aws_cbor_writer_t *w, int64_t val)
+{
+  if (val < 0)
+    m_aws_cbor_put_head(w, AWS_CBOR_NINT, (uint64_t)(-1 - val));
+  else
+    m_aws_cbor_put_head(w, AWS_CBOR_UINT, (uint64_t)val);
+}
+
+void aws_cbor_put_text(aws_cbor_writer_t *w, const char *str, uint32_t len)
+{
+  m_aws_cbor_put_head(w, AWS_CBOR_TEXT, len);
+
+  if (w->len + len <= w->size)
+    memcpy(&w->buf[w->len], str, len);
+
+  w->len += len;
+}
+
+void aws_cbor_put_float(aws_cbor_writer_t *w, float val)
+{
+  uint32_t bits;
+
+  memcpy(&bits, &val, sizeof(bits));
+
+  m_aws_cbor_put_byte(w, AWS_CBOR_FLOAT32);
+  for (int8_t i = 3; i >= 0; i--)
+    m_aws_cbor_put_byte(w, (uint8_t)(bits >> (i * 8)));
+}
+
+void aws_cbor_put_array(aws_cbor_writer_t *w, uint32_t count)
+{
+  m_aws_cbor_put_head(w, AWS_CBOR_ARRAY, count);
+}
+
+void aws_cbor_put_map(aws_cbor_writer_t *w, uint32_t count)
+{
+  m_aws_cbor_put_head(w, AWS_CBOR_MAP, count);
+}
+
+bool aws_cbor_writer_is_ok(aws_cbor_writer_t *w)
+{
+  return (w->len <= w->size);
+}
+
+void aws_cbor_reader_init(aws_cbor_reader_t *r, const void *buf, uint32_t len)
+{
+  r->buf = buf;
+  r->len = len;
+  r->pos = 0;
+}
+
+bool aws_cbor_get_uint(aws_cbor_reader_t *r, uint64_t *val)
+{
+  aws_cbor_major_t major;
+
+  CHECK(m_aws_cbor_get_head(r, &major, val), false);
+  CHECK(major == AWS_CBOR_UINT, false);
+
+  return true;
+}
+
+bool aws_cbor_get_int(aws_cbor_reader_t *r, int64_t *val)
+{
+  aws_cbor_major_t major;
+  uint64_t arg;
+
+  CHECK(m_aws_cbor_get_head(r, &major, &arg), false);
+  CHECK((major == AWS_CBOR_UINT) || (major == AWS_CBOR_NINT), false);
+
+  *val = (major == AWS_CBOR_UINT) ? (int64_t)arg : (-1 - (int64_t)arg);
+
+  return true;
+}
+
+bool aws_cbor_get_text(aws_cbor_reader_t *r, const char **str, uint32_t *len)
+{
+  aws_cbor_major_t major;
+  uint64_t arg;
+
+  CHECK(m_aws_cbor_get_head(r, &major, &arg), false);
+  CHECK(major == AWS_CBOR_TEXT, false);
+  CHECK(arg <= r->len - r->pos, false);
+
+  *str    = (const char *)&r->buf[r->pos];
+  *len    = (uint32_t)arg;
+  r->pos += (uint32_t)arg;
+
+  return true;
+}
+
+bool aws_cbor_get_float(aws_cbor_reader_t *r, float *val)
+{
+  uint64_t bits = 0;
+  uint8_t size;
+
+  CHECK(r->pos < r->len, false);
+
+  switch (r->buf[r->pos])
+  {
+  case AWS_CBOR_FLOAT32:
+    size = 4;
+    break;
+
+  case AWS_CBOR_FLOAT64:
+    size = 8;
+    break;
+
+  default:
+  {
+    // Integer value is also accepted for a float field
+    int64_t ival;
+
+    CHECK(aws_cbor_get_int(r, &ival), false);
+    *val = (float)ival;
+    return true;
+  }
+  }
+
+  CHECK(r->len - r->pos > size, false);
+
+  for (uint8_t i = 1; i <= size; i++)
+    bits = (bits << 8) | r->buf[r->pos + i];
+
+  r->pos += size + 1;
+
+  if (size == 4)
+  {
+    uint32_t bits32 = (uint32_t)bits;
+    memcpy(val, &bits32, sizeof(*val));
+  }
+  else
+  {
+    double dval;
+    memcpy(&dval, &bits, sizeof(dval));
+    *val = (float)dval;
+  }
+
+  return true;
+}
+
+bool aws_cbor_get_array(aws_cbor_reader_t *r, uint32_t *count)
+{
+  aws_cbor_major_t major;
+  uint64_t arg;
+
+  CHECK(m_aws_cbor_get_head(r, &major, &arg), false);
+  CHECK(major == AWS_CBOR_ARRAY, false);
+
+  *count = (uint32_t)arg;
+
+  return true;
+}
+
+bool aws_cbor_get_map(aws_cbor_reader_t *r, uint32_t *count)
+{
+  aws_cbor_major_t major;
+  uint64_t arg;
+
+  CHECK(m_aws_cbor_get_head(r, &major, &arg), false);
+  CHECK(major == AWS_CBOR_MAP, false);
+
+  *count = (uint32_t)arg;
+
+  return true;
+}
+
+bool aws_cbor_skip(aws_cbor_reader_t *r)
+{
+  return m_aws_cbor_skip(r, 0);
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief         CBOR write one byte
+ *
+ * @param[in]     w       Pointer to writer
+ * @param[in]     byte    Byte to be written
+ *
+ * @attention     None
+ *
+ * @return        None
+ */
+static void m_aws_cbor_put_byte(aws_cbor_writer_t *w, uint8_t byte)
+{
+  if (w->len < w->size)
+    w->buf[w->len] = byte;
+
+  w->len++;
+}
+
+/**
+ * @brief         CBOR write item head with the shortest argument encoding
+ *
+ * @param[in]     w       Pointer to writer
+ * @param[in]     major   Major type
+ * @param[in]     val     Argument value
+ *
+ * @attention     None
+ *
+ * @return        None
+ */
+static void m_aws_cbor_put_head(aws_cbor_writer_t *w, aws_cbor_major_t major, uint64_t val)
+{
+  uint8_t ib = (uint8_t)(major << 5);
+  uint8_t size;
+
+  if (val < AWS_CBOR_AI_1BYTE)
+  {
+    m_aws_cbor_put_byte(w, ib | (uint8_t)val);
+    return;
+  }
+  else if (val <= UINT8_MAX)
+  {
+    m_aws_cbor_put_byte(w, ib | AWS_CBOR_AI_1BYTE);
+    size = 1;
+  }
+  else if (val <= UINT16_MAX)
+  {
+    m_aws_cbor_put_byte(w, ib | AWS_CBOR_AI_2BYTE);
+    size = 2;
+  }
+  else if (val <= UINT32_MAX)
+  {
+    m_aws_cbor_put_byte(w, ib | AWS_CBOR_AI_4BYTE);
+    size = 4;
+  }
+  else
+  {
+    m_aws_cbor_put_byte(w, ib | AWS_CBOR_AI_8BYTE);
+    size = 8;
+  }
+
+  for (int8_t i = size - 1; i >= 0; i--)
+    m_aws_cbor_put_byte(w, (uint8_t)(val >> (i * 8)));
+}
+
+/**
+ * @brief         CBOR read item head
+ *
+ * @param[in]     r       Pointer to reader
+ * @param[out]    major   Major type
+ * @param[out]    val     Argument value
+ *
+ * @attention     Indefinite length items are rejected
+ *
+ * @return
+ *  - true:   Head is decoded
+ *  - false:  Malformed head or end of buffer
+ */
+static bool m_aws_cbor_get_head(aws_cbor_reader_t *r, aws_cbor_major_t *major, uint64_t *val)
+{
+  uint8_t ib, ai, size;
+
+  CHECK(r->pos < r->len, false);
+
+  ib     = r->buf[r->pos++];
+  *major = (aws_cbor_major_t)(ib >> 5);
+  ai     = ib & 0x1F;
+
+  if (ai < AWS_CBOR_AI_1BYTE)
+  {
+    *val = ai;
+    return true;
+  }
+
+  CHECK(ai <= AWS_CBOR_AI_8BYTE, false);
+
+  size = 1 << (ai - AWS_CBOR_AI_1BYTE);
+  CHECK(r->len - r->pos >= size, false);
+
+  *val = 0;
+  for (uint8_t i = 0; i < size; i++)
+    *val = (*val << 8) | r->buf[r->pos++];
+
+  return true;
+}
+
+/**
+ * @brief         CBOR skip one item
+ *
+ * @param[in]     r       Pointer to reader
+ * @param[in]     depth   Current nesting depth
+ *
+ * @attention     None
+ *
+ * @return
+ *  - true:   Item is skipped
+ *  - false:  Malformed item, too deep nesting or end of buffer
+ */
+static bool m_aws_cbor_skip(aws_cbor_reader_t *r, uint8_t depth)
+{
+  aws_cbor_major_t major;
+  uint64_t arg;
+
+  CHECK(depth < AWS_CBOR_NESTING_MAX, false);
+  CHECK(m_aws_cbor_get_head(r, &major, &arg), false);
+
+  switch (major)
+  {
+  case AWS_CBOR_BYTES:
+  case AWS_CBOR_TEXT:
+    CHECK(arg <= r->len - r->pos, false);
+    r->pos += (uint32_t)arg;
+    break;
+
+  case AWS_CBOR_MAP:
+    arg *= 2;
+    // fall through
+  case AWS_CBOR_ARRAY:
+    for (uint64_t i = 0; i < arg; i++)
+      CHECK(m_aws_cbor_skip(r, depth + 1), false);
+    break;
+
+  case AWS_CBOR_TAG:
+    CHECK(m_aws_cbor_skip(r, depth + 1), false);
+    break;
+
+  default:
+    // Unsigned/negative integer and simple/float values carry no payload beyond the head
+    break;
+  }
+
+  return true;
+}
+
+/* End of file -------------------------------------------------------- */
@@ -0,0 +1,154 @@
+/**
+* @file       aws_cbor.h
+* @copyright  Copyright (C) 2021 Hydratech. All rights reserved.
+* @license    This project is released under the Hydratech License.
+* @version    01.00.00
+* @date       2022-03-10
+* @author     Thuan Le
+* @brief      Minimal CBOR (RFC 8949) encoder and decoder for AWS packets.
+*             Only definite length items are supported.
+* @note       None
+* @example    None
+*/
+
+/* Define to prevent recursive inclusion ------------------------------ */
+#ifndef __AWS_CBOR_H
+#define __AWS_CBOR_H
+
+/* Includes ----------------------------------------------------------- */
+#include "platform_common.h"
+
+/* Public defines ----------------------------------------------------- */
+/* Public enumerate/structure ----------------------------------------- */
+/**
+ * @brief CBOR major type enum
+ */
+typedef enum
+{
+   AWS_CBOR_UINT   = 0
+  ,AWS_CBOR_NINT   = 1
+  ,AWS_CBOR_BYTES  = 2
+  ,AWS_CBOR_TEXT   = 3
+  ,AWS_CBOR_ARRAY  = 4
+  ,AWS_CBOR_MAP    = 5
+  ,AWS_CBOR_TAG    = 6
+  ,AWS_CBOR_SIMPLE = 7
+}
+aws_cbor_major_t;
+
+/**
+ * @brief CBOR writer struct
+ */
+typedef struct
+{
+  uint8_t *buf;
+  uint32_t size;
+  uint32_t len;     // Number of bytes needed, greater than size when overflow
+}
+aws_cbor_writer_t;
+
+/**
+ * @brief CBOR reader struct
+ */
+typedef struct
+{
+  const uint8_t *buf;
+  uint32_t len;
+  uint32_t pos;
+}
+aws_cbor_reader_t;
+
+/* Public macros ------------------------------------------------------ */
+/* Public variables --------------------------------------------------- */
+/* Public function prototypes ----------------------------------------- */
+/**
+ * @brief         CBOR writer init
+ *
+ * @param[in]     w       Pointer to writer
+ * @param[out]    buf     Pointer to output buffer
+ * @param[in]     size    Size of output buffer
+ *
+ * @attention     None
+ *
+ * @return        None
+ */
+void aws_cbor_writer_init(aws_cbor_writer_t *w, void *buf, uint32_t size);
+
+/**
+ * @brief         CBOR encode items
+ *
+ * @param[in]     w       Pointer to writer
+ * @param[in]     ...     Item value
+ *
+ * @attention     Writing stops at the end of buffer, check with aws_cbor_writer_is_ok()
+ *
+ * @return        None
+ */
+void aws_cbor_put_uint(aws_cbor_writer_t *w, uint64_t val);
+void aws_cbor_put_int(aws_cbor_writer_t *w, int64_t val);
+void aws_cbor_put_text(aws_cbor_writer_t *w, const char *str, uint32_t len);
+void aws_cbor_put_float(aws_cbor_writer_t *w, float val);
+void aws_cbor_put_array(aws_cbor_writer_t *w, uint32_t count);
+void aws_cbor_put_map(aws_cbor_writer_t *w, uint32_t count);
+
+/**
+ * @brief         CBOR check writer status
+ *
+ * @param[in]     w       Pointer to writer
+ *
+ * @attention     None
+ *
+ * @return
+ *  - true:   All items fit in buffer
+ *  - false:  Buffer overflow
+ */
+bool aws_cbor_writer_is_ok(aws_cbor_writer_t *w);
+
+/**
+ * @brief         CBOR reader init
+ *
+ * @param[in]     r       Pointer to reader
+ * @param[in]     buf     Pointer to input buffer
+ * @param[in]     len     Length of input buffer
+ *
+ * @attention     None
+ *
+ * @return        None
+ */
+void aws_cbor_reader_init(aws_cbor_reader_t *r, const void *buf, uint32_t len);
+
+/**
+ * @brief         CBOR decode items
+ *
+ * @param[in]     r       Pointer to reader
+ * @param[out]    ...     Pointer to item value
+ *
+ * @attention     Text is not copied, str points into the input buffer and is not null terminated
+ *
+ * @return
+ *  - true:   Item is decoded
+ *  - false:  Wrong item type or end of buffer
+ */
+bool aws_cbor_get_uint(aws_cbor_reader_t *r, uint64_t *val);
+bool aws_cbor_get_int(aws_cbor_reader_t *r, int64_t *val);
+bool aws_cbor_get_text(aws_cbor_reader_t *r, const char **str, uint32_t *len);
+bool aws_cbor_get_float(aws_cbor_reader_t *r, float *val);
+bool aws_cbor_get_array(aws_cbor_reader_t *r, uint32_t *count);
+bool aws_cbor_get_map(aws_cbor_reader_t *r, uint32_t *count);
+
+/**
+ * @brief         CBOR skip one item, including all nested items
+ *
+ * @param[in]     r       Pointer to reader
+ *
+ * @attention     None
+ *
+ * @return
+ *  - true:   Item is skipped
+ *  - false:  Malformed item or end of buffer
+ */
+bool aws_cbor_skip(aws_cbor_reader_t *r);
+
+#endif // __AWS_CBOR_H
+
+/* End of file -------------------------------------------------------- */
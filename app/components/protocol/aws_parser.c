@@ -13,12 +13,27 @@
 
 /* Includes ----------------------------------------------------------- */
 #include "aws_parser.h"
+#include "aws_cbor.h"
 #include "frozen.h"
 
 /* Private defines ---------------------------------------------------- */
 static const char *TAG = "aws_parser";
 
+#define AWS_PARSE_JSON_PATH     ".data."  // Path prefix of packet data members
+#define AWS_PARSE_NUM_LEN_MAX   (32)      // Max length of a JSON number
+
 /* Private enumerate/structure ---------------------------------------- */
+/**
+ * @brief JSON field walk context
+ */
+typedef struct
+{
+  const aws_schema_t *schema;
+  void *param;
+  bool ok;
+}
+aws_parse_walk_t;
+
 /* Private macros ----------------------------------------------------- */
 /* Public variables --------------------------------------------------- */
 /* Private variables -------------------------------------------------- */
@@ -26,6 +41,15 @@ static char data[500] = "";
 
 /* Private function prototypes ---------------------------------------- */
 static void scan_array(const char *str, int len, void *user_data);
+static bool m_aws_parse_fields(const void *buf, uint32_t len, const aws_schema_t *schema, void *param);
+static void m_aws_parse_fields_cb(void *callback_data, const char *name, size_t name_len,
+                                  const char *path, const struct json_token *token);
+static bool m_aws_parse_noti_data_cbor(aws_cbor_reader_t *r, aws_noti_param_t *param);
+static bool m_aws_parse_resp_data_cbor(aws_cbor_reader_t *r, aws_resp_param_t *param);
+static bool m_aws_parse_cbor_packet(aws_packet_type_t type, const void *buf, uint32_t len, void *param);
+static bool m_aws_parse_cbor_find(aws_cbor_reader_t r, aws_cbor_key_t key, uint64_t *val);
+static bool m_aws_parse_fields_cbor(aws_cbor_reader_t *r, const aws_schema_t *schema, void *param);
+static void m_aws_parse_cbor_text(aws_cbor_reader_t *r, char *dst, uint32_t size, bool *ok);
 
 /* Function definitions ----------------------------------------------- */
 bool aws_parse_shadow_packet(sys_aws_shadow_name_t name, const void *buf, uint16_t buf_len, void *p_data)
@@ -59,6 +83,76 @@ bool aws_parse_shadow_packet(sys_aws_shadow_name_t name, const void *buf, uint16
   return true;
 }
 
+bool aws_parse_notification(aws_packet_encoding_t enc, const void *buf, uint32_t len, aws_noti_param_t *param)
+{
+  char *nt = NULL;
+  int res;
+
+  memset(param, 0, sizeof(aws_noti_param_t));
+  param->noti_type = AWS_NOTI_UNKNOWN;
+
+  if (enc == AWS_ENC_CBOR)
+    return m_aws_parse_cbor_packet(AWS_PKT_NOTI, buf, len, param);
+
+  res = json_scanf((const char *)buf, (int)len, "{data:{nt:%Q}}", &nt);
+
+  for (uint8_t i = 0; (nt != NULL) && (i < AWS_NOTI_UNKNOWN); i++)
+  {
+    if (strcmp(nt, AWS_NOTI_LIST[i].name) == 0)
+      param->noti_type = (aws_noti_type_t)i;
+  }
+  free(nt);
+
+  if ((0 == res) || (param->noti_type == AWS_NOTI_UNKNOWN) ||
+      !m_aws_parse_fields(buf, len, &AWS_NOTI_LIST[param->noti_type].schema, param))
+  {
+    ESP_LOGW(TAG, "Json parsing fail!");
+    return false;
+  }
+
+  return true;
+}
+
+bool aws_parse_response(aws_packet_encoding_t enc, const void *buf, uint32_t len, aws_resp_param_t *param)
+{
+  char *rq = NULL;
+  char *rs = NULL;
+  int res;
+
+  memset(param, 0, sizeof(aws_resp_param_t));
+  param->req_type = AWS_REQ_UNKNOWN;
+  param->res_type = AWS_RES_UNKNOWN;
+
+  if (enc == AWS_ENC_CBOR)
+    return m_aws_parse_cbor_packet(AWS_PKT_RESP, buf, len, param);
+
+  res = json_scanf((const char *)buf, (int)len, "{data:{rq:%Q, rs:%Q}}", &rq, &rs);
+
+  for (uint8_t i = 0; (rq != NULL) && (i < AWS_REQ_UNKNOWN); i++)
+  {
+    if (strcmp(rq, AWS_REQ_LIST[i].name) == 0)
+      param->req_type = (aws_req_type_t)i;
+  }
+
+  for (uint8_t i = 0; (rs != NULL) && (i < AWS_RES_UNKNOWN); i++)
+  {
+    if (strcmp(rs, AWS_RES_LIST[i].name) == 0)
+      param->res_type = (aws_res_type_t)i;
+  }
+
+  free(rq);
+  free(rs);
+
+  if ((0 == res) || (param->req_type == AWS_REQ_UNKNOWN) ||
+      !m_aws_parse_fields(buf, len, &AWS_REQ_LIST[param->req_type].schema, param))
+  {
+    ESP_LOGW(TAG, "Json parsing fail!");
+    return false;
+  }
+
+  return true;
+}
+
 /* Private function definitions --------------------------------------------- */
 /**
  * @brief         Parse standard data
@@ -77,4 +171,364 @@ static void scan_array(const char *str, int len, void *user_data)
  
 }
 
+/**
+ * @brief         Parse JSON members of packet data into fields of schema
+ *
+ * @param[in]     buf         Pointer to buffer
+ * @param[in]     len         Buffer length
+ * @param[in]     schema      Pointer to schema
+ * @param[out]    param       Pointer to param struct described by schema
+ *
+ * @attention     Members not in schema are ignored, fields without member are left zero
+ *
+ * @return
+ *  - true:   Parse success
+ *  - false:  Malformed JSON or wrong member type
+ */
+static bool m_aws_parse_fields(const void *buf, uint32_t len, const aws_schema_t *schema, void *param)
+{
+  aws_parse_walk_t walk =
+  {
+    .schema = schema,
+    .param  = param,
+    .ok     = true
+  };
+
+  CHECK(json_walk((const char *)buf, (int)len, m_aws_parse_fields_cb, &walk) > 0, false);
+
+  return walk.ok;
+}
+
+/**
+ * @brief         JSON walk callback to store one packet data member
+ *
+ * @param[in]     callback_data   Pointer to walk context
+ * @param[in]     name            Member name
+ * @param[in]     name_len        Member name length
+ * @param[in]     path            Member path
+ * @param[in]     token           Member value
+ *
+ * @attention     None
+ *
+ * @return        None
+ */
+static void m_aws_parse_fields_cb(void *callback_data, const char *name, size_t name_len,
+                                  const char *path, const struct json_token *token)
+{
+  aws_parse_walk_t *walk = (aws_parse_walk_t *)callback_data;
+  const aws_field_t *field = NULL;
+  uint8_t *member;
+  char num[AWS_PARSE_NUM_LEN_MAX + 1];
+  int n;
+
+  // Only direct members of data object
+  if ((name == NULL) || (token->ptr == NULL) ||
+      (strlen(path) != sizeof(AWS_PARSE_JSON_PATH) - 1 + name_len) ||
+      (strncmp(path, AWS_PARSE_JSON_PATH, sizeof(AWS_PARSE_JSON_PATH) - 1) != 0))
+    return;
+
+  for (uint8_t i = 0; i < walk->schema->count; i++)
+  {
+    if ((strncmp(walk->schema->field[i].name, name, name_len) == 0) && (walk->schema->field[i].name[name_len] == '\0'))
+      field = &walk->schema->field[i];
+  }
+
+  if (field == NULL)
+    return;
+
+  member = (uint8_t *)walk->param + field->offset;
+
+  if (field->type == AWS_FIELD_STR)
+  {
+    if (token->type != JSON_TYPE_STRING)
+    {
+      walk->ok = false;
+      return;
+    }
+
+    n = json_unescape(token->ptr, token->len, (char *)member, field->size - 1);
+    if (n < 0)
+    {
+      walk->ok = false;
+      return;
+    }
+
+    member[(n < field->size - 1) ? n : field->size - 1] = '\0';
+    return;
+  }
+
+  if ((token->type != JSON_TYPE_NUMBER) || (token->len > AWS_PARSE_NUM_LEN_MAX))
+  {
+    walk->ok = false;
+    return;
+  }
+
+  memcpy(num, token->ptr, token->len);
+  num[token->len] = '\0';
+
+  switch (field->type)
+  {
+  case AWS_FIELD_U16:
+    *(uint16_t *)member = (uint16_t)strtoul(num, NULL, 10);
+    break;
+
+  case AWS_FIELD_U32:
+    *(uint32_t *)member = (uint32_t)strtoul(num, NULL, 10);
+    break;
+
+  case AWS_FIELD_U64:
+    *(uint64_t *)member = (uint64_t)strtoull(num, NULL, 10);
+    break;
+
+  case AWS_FIELD_FLOAT:
+    *(float *)member = strtof(num, NULL);
+    break;
+
+  default:
+    break;
+  }
+}
+
+/**
+ * @brief         Parse CBOR packet envelope
+ *
+ * @param[in]     type        Expected packet type
+ * @param[in]     buf         Pointer to buffer
+ * @param[in]     len         Buffer length
+ * @param[out]    param       Pointer to notification or response param
+ *
+ * @attention     None
+ *
+ * @return
+ *  - true:   Parse success
+ *  - false:  Parse failed
+ */
+static bool m_aws_parse_cbor_packet(aws_packet_type_t type, const void *buf, uint32_t len, void *param)
+{
+  aws_cbor_reader_t r;
+  uint32_t count;
+  uint64_t key, val;
+  bool has_data = false;
+
+  aws_cbor_reader_init(&r, buf, len);
+
+  CHECK(aws_cbor_get_map(&r, &count), false);
+
+  while (count--)
+  {
+    CHECK(aws_cbor_get_uint(&r, &key), false);
+
+    switch (key)
+    {
+    case AWS_CBOR_KEY_TYPE:
+      CHECK(aws_cbor_get_uint(&r, &val), false);
+      CHECK(val == type, false);
+      break;
+
+    case AWS_CBOR_KEY_DATA:
+      if (type == AWS_PKT_NOTI)
+        has_data = m_aws_parse_noti_data_cbor(&r, param);
+      else
+        has_data = m_aws_parse_resp_data_cbor(&r, param);
+
+      CHECK(has_data, false);
+      break;
+
+    default:
+      CHECK(aws_cbor_skip(&r), false);
+      break;
+    }
+  }
+
+  if (!has_data)
+    ESP_LOGW(TAG, "Cbor parsing fail!");
+
+  return has_data;
+}
+
+/**
+ * @brief         Parse CBOR notification data
+ *
+ * @param[in]     r           Pointer to CBOR reader
+ * @param[out]    param       Pointer to notification param
+ *
+ * @attention     Unknown keys are skipped
+ *
+ * @return
+ *  - true:   Parse success
+ *  - false:  Parse failed
+ */
+static bool m_aws_parse_noti_data_cbor(aws_cbor_reader_t *r, aws_noti_param_t *param)
+{
+  uint64_t val;
+
+  // Notification ID selects the schema, it may be anywhere in the map
+  CHECK(m_aws_parse_cbor_find(*r, AWS_CBOR_KEY_ID, &val) && (val < AWS_NOTI_UNKNOWN), false);
+
+  param->noti_type = (aws_noti_type_t)val;
+
+  return m_aws_parse_fields_cbor(r, &AWS_NOTI_LIST[param->noti_type].schema, param);
+}
+
+/**
+ * @brief         Parse CBOR response data
+ *
+ * @param[in]     r           Pointer to CBOR reader
+ * @param[out]    param       Pointer to response param
+ *
+ * @attention     Unknown keys are skipped
+ *
+ * @return
+ *  - true:   Parse success
+ *  - false:  Parse failed
+ */
+static bool m_aws_parse_resp_data_cbor(aws_cbor_reader_t *r, aws_resp_param_t *param)
+{
+  uint64_t val;
+
+  CHECK(m_aws_parse_cbor_find(*r, AWS_CBOR_KEY_ID, &val) && (val < AWS_REQ_UNKNOWN), false);
+  param->req_type = (aws_req_type_t)val;
+
+  if (m_aws_parse_cbor_find(*r, AWS_CBOR_KEY_RESULT, &val) && (val < AWS_RES_UNKNOWN))
+    param->res_type = (aws_res_type_t)val;
+
+  return m_aws_parse_fields_cbor(r, &AWS_REQ_LIST[param->req_type].schema, param);
+}
+
+/**
+ * @brief         Find unsigned integer value of a key in CBOR map
+ *
+ * @param[in]     r           CBOR reader at the map, passed by value so it is not moved
+ * @param[in]     key         Key to find
+ * @param[out]    val         Value
+ *
+ * @attention     None
+ *
+ * @return
+ *  - true:   Key is found
+ *  - false:  Key is not found or malformed map
+ */
+static bool m_aws_parse_cbor_find(aws_cbor_reader_t r, aws_cbor_key_t key, uint64_t *val)
+{
+  uint32_t count;
+  uint64_t k;
+
+  CHECK(aws_cbor_get_map(&r, &count), false);
+
+  while (count--)
+  {
+    CHECK(aws_cbor_get_uint(&r, &k), false);
+
+    if (k == key)
+      return aws_cbor_get_uint(&r, val);
+
+    CHECK(aws_cbor_skip(&r), false);
+  }
+
+  return false;
+}
+
+/**
+ * @brief         Parse CBOR map entries into fields of schema
+ *
+ * @param[in]     r           Pointer to CBOR reader
+ * @param[in]     schema      Pointer to schema
+ * @param[out]    param       Pointer to param struct described by schema
+ *
+ * @attention     Keys not in schema are skipped
+ *
+ * @return
+ *  - true:   Parse success
+ *  - false:  Malformed map or wrong value type
+ */
+static bool m_aws_parse_fields_cbor(aws_cbor_reader_t *r, const aws_schema_t *schema, void *param)
+{
+  const aws_field_t *field;
+  uint8_t *member;
+  uint32_t count;
+  uint64_t key, val;
+  bool ok = true;
+
+  CHECK(aws_cbor_get_map(r, &count), false);
+
+  while (ok && count--)
+  {
+    CHECK(aws_cbor_get_uint(r, &key), false);
+
+    field = NULL;
+    for (uint8_t i = 0; i < schema->count; i++)
+    {
+      if (schema->field[i].key == key)
+        field = &schema->field[i];
+    }
+
+    if (field == NULL)
+    {
+      ok = aws_cbor_skip(r);
+      continue;
+    }
+
+    member = (uint8_t *)param + field->offset;
+
+    switch (field->type)
+    {
+    case AWS_FIELD_U16:
+      ok = aws_cbor_get_uint(r, &val);
+      *(uint16_t *)member = (uint16_t)val;
+      break;
+
+    case AWS_FIELD_U32:
+      ok = aws_cbor_get_uint(r, &val);
+      *(uint32_t *)member = (uint32_t)val;
+      break;
+
+    case AWS_FIELD_U64:
+      ok = aws_cbor_get_uint(r, (uint64_t *)member);
+      break;
+
+    case AWS_FIELD_FLOAT:
+      ok = aws_cbor_get_float(r, (float *)member);
+      break;
+
+    case AWS_FIELD_STR:
+      m_aws_parse_cbor_text(r, (char *)member, field->size, &ok);
+      break;
+
+    default:
+      ok = aws_cbor_skip(r);
+      break;
+    }
+  }
+
+  return ok;
+}
+
+/**
+ * @brief         Parse CBOR text into a fixed size string
+ *
+ * @param[in]     r           Pointer to CBOR reader
+ * @param[out]    dst         Pointer to destination string
+ * @param[in]     size        Size of destination string
+ * @param[out]    ok          Parse status
+ *
+ * @attention     Text longer than the destination is truncated
+ *
+ * @return        None
+ */
+static void m_aws_parse_cbor_text(aws_cbor_reader_t *r, char *dst, uint32_t size, bool *ok)
+{
+  const char *str;
+  uint32_t len;
+
+  *ok = aws_cbor_get_text(r, &str, &len);
+  if (!*ok)
+    return;
+
+  if (len >= size)
+    len = size - 1;
+
+  memcpy(dst, str, len);
+  dst[len] = '\0';
+}
+
 /* End of file -------------------------------------------------------- */
@@ -18,6 +18,7 @@
 /* Includes ----------------------------------------------------------- */
 #include "platform_common.h"
 #include "sys_aws_shadow.h"
+#include "aws_builder.h"
 
 /* Public defines ----------------------------------------------------- */
 /* Public enumerate/structure ----------------------------------------- */
@@ -50,6 +51,38 @@ aws_schedule_t;
  */
 bool aws_parse_shadow_packet(sys_aws_shadow_name_t name, const void *buf, uint16_t buf_len, void *p_data);
 
+/**
+ * @brief         AWS parse notification packet
+ *
+ * @param[in]     enc      Packet encoding
+ * @param[in]     buf      Point to paket buf
+ * @param[in]     len      Length of packet
+ * @param[out]    param    Pointer to notification param
+ *
+ * @attention     Only a single notification is parsed, not a batch
+ *
+ * @return
+ *  - true:   Parse success
+ *  - false:  Parse failed
+ */
+bool aws_parse_notification(aws_packet_encoding_t enc, const void *buf, uint32_t len, aws_noti_param_t *param);
+
+/**
+ * @brief         AWS parse response packet
+ *
+ * @param[in]     enc      Packet encoding
+ * @param[in]     buf      Point to paket buf
+ * @param[in]     len      Length of packet
+ * @param[out]    param    Pointer to response param
+ *
+ * @attention     None
+ *
+ * @return
+ *  - true:   Parse success
+ *  - false:  Parse failed
+ */
+bool aws_parse_response(aws_packet_encoding_t enc, const void *buf, uint32_t len, aws_resp_param_t *param);
+
 #endif // __AWS_PARSER_H
 
 /* End of file -------------------------------------------------------- */
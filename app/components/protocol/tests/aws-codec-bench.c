@@ -0,0 +1,252 @@
+/**
+ * @file       aws-codec-bench.c
+ * @copyright  Copyright (C) 2020 Hydratech. All rights reserved.
+ * @license    This project is released under the Hydratech License.
+ * @version    1.0.0
+ * @date       2022-04-20
+ * @author     Thuan Le
+ * @brief      Host benchmark of the uplink packet encoders. Builds the same packets
+ *             with the JSON and CBOR encoders of aws_builder.c, and with json_printf
+ *             as the notification builder did before the field tables, and reports
+ *             payload bytes and encode time of each.
+ * @note       Times are host times, only their ratios carry over to the ESP32
+ * @example    cd app/components/protocol/tests
+ *             gcc -std=gnu11 -O2 -Ihost -I.. -I../../frozen-1.6 \
+ *                 -I../../aws_iot/aws-iot-device-sdk-embedded-C/external_libs/jsmn \
+ *                 aws-codec-bench.c ../aws_builder.c ../aws_cbor.c ../../frozen-1.6/frozen.c \
+ *                 -o aws-codec-bench
+ *             ./aws-codec-bench [iterations]
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "aws_builder.h"
+#include "frozen.h"
+#include <time.h>
+
+/* Private defines ---------------------------------------------------- */
+#define BENCH_ITERATIONS_DEFAULT    (200000)
+#define BENCH_BATCH_SIZE            (10)
+#define BENCH_BUF_SIZE              (2048)
+
+/* Private enumerate/structure ---------------------------------------- */
+typedef uint32_t (*bench_encode_t)(const void *param, uint8_t *buf, uint32_t size);
+
+/* Private variables -------------------------------------------------- */
+static aws_noti_param_t m_device_data;
+static aws_noti_param_t m_alarm;
+static aws_resp_param_t m_resp;
+static aws_noti_param_t m_batch[BENCH_BATCH_SIZE];
+
+static uint8_t m_buf[BENCH_BUF_SIZE];
+static volatile uint32_t m_sink;
+
+/* Private function prototypes ---------------------------------------- */
+static void m_bench_fill(void);
+static double m_bench_run(bench_encode_t encode, const void *param, uint32_t iterations, uint32_t *len);
+static void m_bench_row(const char *packet, bench_encode_t json, bench_encode_t cbor, bench_encode_t ref,
+                        const void *param, uint32_t iterations);
+
+static uint32_t m_noti_json(const void *param, uint8_t *buf, uint32_t size);
+static uint32_t m_noti_cbor(const void *param, uint8_t *buf, uint32_t size);
+static uint32_t m_noti_printf(const void *param, uint8_t *buf, uint32_t size);
+static uint32_t m_resp_json(const void *param, uint8_t *buf, uint32_t size);
+static uint32_t m_resp_cbor(const void *param, uint8_t *buf, uint32_t size);
+static uint32_t m_batch_json(const void *param, uint8_t *buf, uint32_t size);
+static uint32_t m_batch_cbor(const void *param, uint8_t *buf, uint32_t size);
+
+/* Function definitions ----------------------------------------------- */
+int main(int argc, char **argv)
+{
+  uint32_t iterations = BENCH_ITERATIONS_DEFAULT;
+
+  if (argc > 1)
+    iterations = (uint32_t)strtoul(argv[1], NULL, 0);
+
+  if (iterations == 0)
+  {
+    printf("Usage: %s [iterations]\n", argv[0]);
+    return 1;
+  }
+
+  m_bench_fill();
+
+  printf("%-20s %8s %8s %8s %10s %10s %10s\n", "Packet", "JSON B", "CBOR B", "printf B", "JSON ns", "CBOR ns", "printf ns");
+
+  m_bench_row("device_data", m_noti_json, m_noti_cbor, m_noti_printf, &m_device_data, iterations);
+  m_bench_row("alarm", m_noti_json, m_noti_cbor, m_noti_printf, &m_alarm, iterations);
+  m_bench_row("get_dev_info resp", m_resp_json, m_resp_cbor, NULL, &m_resp, iterations);
+  m_bench_row("device_data x10", m_batch_json, m_batch_cbor, NULL, m_batch, iterations / BENCH_BATCH_SIZE);
+
+  return 0;
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief         Fill the packets with values seen on the fleet
+ *
+ * @param[in]     None
+ *
+ * @attention     None
+ *
+ * @return        None
+ */
+static void m_bench_fill(void)
+{
+  m_device_data.noti_type = AWS_NOTI_DEVICE_DATA;
+  m_device_data.noti_id   = 1;
+  m_device_data.info.time = 1650000000123ULL;
+
+  strcpy(m_device_data.info.device_data.serial_number, "LOX-000123456");
+  m_device_data.info.device_data.battery      = 87;
+  m_device_data.info.device_data.weight_scale = 1340;
+  m_device_data.info.device_data.alarm_code   = 0;
+  m_device_data.info.device_data.temp         = 23;
+  m_device_data.info.device_data.longitude    = -84.3067f;
+  m_device_data.info.device_data.lattitude    = 34.1351f;
+
+  m_alarm.noti_type       = AWS_NOTI_ALARM;
+  m_alarm.noti_id         = 1;
+  m_alarm.info.time       = 1650000000123ULL;
+  m_alarm.info.alarm_code = 11;
+
+  m_resp.req_type = AWS_REQ_GET_DEVICE_INFO;
+  m_resp.res_type = AWS_RES_OK;
+  strcpy(m_resp.info.dev_info.hw, "1.0");
+  strcpy(m_resp.info.dev_info.fw, "10000000");
+
+  for (uint8_t i = 0; i < BENCH_BATCH_SIZE; i++)
+  {
+    m_batch[i] = m_device_data;
+    m_batch[i].info.time += i * 30000;
+    m_batch[i].info.device_data.weight_scale += i;
+  }
+}
+
+/**
+ * @brief         Encode a packet repeatedly
+ *
+ * @param[in]     encode      Encoder
+ * @param[in]     param       Pointer to packet param
+ * @param[in]     iterations  Number of encodes
+ * @param[out]    len         Payload length
+ *
+ * @attention     None
+ *
+ * @return        Average encode time in ns
+ */
+static double m_bench_run(bench_encode_t encode, const void *param, uint32_t iterations, uint32_t *len)
+{
+  struct timespec start, end;
+  uint32_t sum = 0;
+
+  *len = encode(param, m_buf, sizeof(m_buf));
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (uint32_t i = 0; i < iterations; i++)
+    sum += encode(param, m_buf, sizeof(m_buf));
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  m_sink = sum;
+
+  return ((double)(end.tv_sec - start.tv_sec) * 1e9 + (double)(end.tv_nsec - start.tv_nsec)) / iterations;
+}
+
+/**
+ * @brief         Print bytes and encode time of one packet in all encodings
+ *
+ * @param[in]     packet      Packet name
+ * @param[in]     json        JSON encoder
+ * @param[in]     cbor        CBOR encoder
+ * @param[in]     ref         json_printf encoder, NULL if the packet had none
+ * @param[in]     param       Pointer to packet param
+ * @param[in]     iterations  Number of encodes
+ *
+ * @attention     None
+ *
+ * @return        None
+ */
+static void m_bench_row(const char *packet, bench_encode_t json, bench_encode_t cbor, bench_encode_t ref,
+                        const void *param, uint32_t iterations)
+{
+  uint32_t json_len, cbor_len, ref_len = 0;
+  double json_ns, cbor_ns, ref_ns = 0;
+
+  json_ns = m_bench_run(json, param, iterations, &json_len);
+  cbor_ns = m_bench_run(cbor, param, iterations, &cbor_len);
+  if (ref != NULL)
+    ref_ns = m_bench_run(ref, param, iterations, &ref_len);
+
+  if (ref != NULL)
+    printf("%-20s %8u %8u %8u %10.0f %10.0f %10.0f\n", packet, json_len, cbor_len, ref_len, json_ns, cbor_ns, ref_ns);
+  else
+    printf("%-20s %8u %8u %8s %10.0f %10.0f %10s\n", packet, json_len, cbor_len, "-", json_ns, cbor_ns, "-");
+}
+
+/**
+ * @brief         Encoders under test
+ */
+static uint32_t m_noti_json(const void *param, uint8_t *buf, uint32_t size)
+{
+  return aws_build_notification(AWS_ENC_JSON, (aws_noti_param_t *)param, buf, size);
+}
+
+static uint32_t m_noti_cbor(const void *param, uint8_t *buf, uint32_t size)
+{
+  return aws_build_notification(AWS_ENC_CBOR, (aws_noti_param_t *)param, buf, size);
+}
+
+static uint32_t m_resp_json(const void *param, uint8_t *buf, uint32_t size)
+{
+  return aws_build_response(AWS_ENC_JSON, (aws_resp_param_t *)param, buf, size);
+}
+
+static uint32_t m_resp_cbor(const void *param, uint8_t *buf, uint32_t size)
+{
+  return aws_build_response(AWS_ENC_CBOR, (aws_resp_param_t *)param, buf, size);
+}
+
+static uint32_t m_batch_json(const void *param, uint8_t *buf, uint32_t size)
+{
+  return aws_build_notification_batch(AWS_ENC_JSON, (aws_noti_param_t *)param, BENCH_BATCH_SIZE, buf, size);
+}
+
+static uint32_t m_batch_cbor(const void *param, uint8_t *buf, uint32_t size)
+{
+  return aws_build_notification_batch(AWS_ENC_CBOR, (aws_noti_param_t *)param, BENCH_BATCH_SIZE, buf, size);
+}
+
+/**
+ * @brief         Notification built with json_printf as before the field tables
+ */
+static uint32_t m_noti_printf(const void *param, uint8_t *buf, uint32_t size)
+{
+  const aws_noti_param_t *noti = (const aws_noti_param_t *)param;
+  struct json_out out = JSON_OUT_BUF((char *)buf, size);
+  int len;
+
+  if (noti->noti_type == AWS_NOTI_ALARM)
+  {
+    len = json_printf(&out, "{type: nt, data:{nt: %Q, time: %llu, alarm_code: %d}}",
+                      AWS_NOTI_LIST[noti->noti_type].name,
+                      (unsigned long long)noti->info.time,
+                      (int)noti->info.alarm_code);
+  }
+  else
+  {
+    len = json_printf(&out, "{type: nt, data:{nt: %Q, time: %llu, serial_number: %Q, battery: %d, weight_scale: %d, "
+                            "alarm_code: %d, temp: %d, longitude: %f, lattitude: %f}}",
+                      AWS_NOTI_LIST[noti->noti_type].name,
+                      (unsigned long long)noti->info.time,
+                      noti->info.device_data.serial_number,
+                      noti->info.device_data.battery,
+                      noti->info.device_data.weight_scale,
+                      (int)noti->info.device_data.alarm_code,
+                      noti->info.device_data.temp,
+                      noti->info.device_data.longitude,
+                      noti->info.device_data.lattitude);
+  }
+
+  return (len < 0) ? 0 : (uint32_t)len;
+}
+
+/* End of file -------------------------------------------------------- */
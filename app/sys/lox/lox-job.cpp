@@ -1,17 +1,190 @@
+/**
+ * @file       lox-job.cpp
+ * @copyright  Copyright (C) 2020 Hydratech. All rights reserved.
+ * @license    This project is released under the Hydratech License.
+ * @version    1.0.0
+ * @date       2022-04-18
+ * @author     Thuan Le
+ * @brief      LOX jobs, weight scale acquisition
+ * @note       A periodic esp_timer samples the load cell ADC into a lock-free ring.
+ *             The scale task drains the ring in batches through LoxScale and
+ *             publishes the latest reading for the telemetry job.
+ * @example    None
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "lox-job.h"
+#include "lox-ring.h"
+#include "lox-scale.h"
+
 extern "C"
 {
-    #include "sys.h"
-    #include "sys_wifi.h"
+  #include "sys.h"
+  #include "sys_nvs.h"
+  #include "esp_timer.h"
+  #include "driver/adc.h"
 }
 
+/* Private defines ---------------------------------------------------- */
+#define LOX_ADC_CHANNEL           (ADC1_CHANNEL_0)
+#define LOX_SAMPLE_RATE_HZ        (500)
+#define LOX_SAMPLE_RING_SIZE      (256)   // Samples, about 0.5 s of backlog
+#define LOX_SAMPLE_BATCH          (25)    // Samples per scale task wake up
 
+#define LOX_SCALE_TASK_STACK      (3 * 1024)
+#define LOX_SCALE_TASK_PRIORITY   (6)
+
+/* Private enumerate/structure ---------------------------------------- */
+/**
+ * @brief LOX jobs
+ */
 class LoxJobs
 {
-public : 
-    LoxJobs() {};
-    ~LoxJobs() {};
-    //IniitScales ();
-    //WeightScale();
-    // Do all LOX methods here....
+public:
+  LoxJobs();
+  ~LoxJobs() {};
+
+  void InitScales();
+  bool WeightScale(uint16_t *weight, bool *stable);
+
+private:
+  static void SampleCallback(void *arg);
+  static void ScaleTask(void *arg);
+
+  LoxRing<int32_t, LOX_SAMPLE_RING_SIZE> m_ring;
+  LoxScale m_scale;
+  TaskHandle_t m_task;
+  esp_timer_handle_t m_timer;
+  uint32_t m_sample_cnt;                  // Written by sampling callback only
+
+  std::atomic<uint32_t> m_reading;        // Packed reading: valid << 17 | stable << 16 | weight
 };
 
+/* Private macros ----------------------------------------------------- */
+#define LOX_READING_VALID         (1UL << 17)
+#define LOX_READING_STABLE        (1UL << 16)
+
+/* Private variables -------------------------------------------------- */
+static const char *TAG = "lox_jobs";
+
+// Default calibration until per-device calibration is stored in NVS
+static const LoxScaleConfig LOX_SCALE_CONFIG =
+{
+  .zero_offset  = 0,
+  .gain_q16     = (1 << 16),
+  .stable_band  = 3,
+  .stable_count = LOX_SAMPLE_RATE_HZ / 2,
+};
+
+static LoxJobs m_lox_jobs;
+
+/* Function definitions ----------------------------------------------- */
+void lox_jobs_init(void)
+{
+  m_lox_jobs.InitScales();
+}
+
+bool lox_jobs_get_weight(uint16_t *weight, bool *stable)
+{
+  return m_lox_jobs.WeightScale(weight, stable);
+}
+
+/* Private function definitions --------------------------------------- */
+LoxJobs::LoxJobs()
+  : m_scale(LOX_SCALE_CONFIG), m_task(NULL), m_timer(NULL), m_sample_cnt(0), m_reading(0)
+{
+}
+
+/**
+ * @brief         Init ADC, start the scale task and the sampling timer
+ */
+void LoxJobs::InitScales()
+{
+  esp_timer_create_args_t timer_args = {};
+
+  if (m_timer != NULL)
+    return;
+
+  adc1_config_width(ADC_WIDTH_BIT_12);
+  adc1_config_channel_atten(LOX_ADC_CHANNEL, ADC_ATTEN_DB_11);
+
+  xTaskCreate(ScaleTask, "lox_scale_task", LOX_SCALE_TASK_STACK, this, LOX_SCALE_TASK_PRIORITY, &m_task);
+
+  timer_args.callback = SampleCallback;
+  timer_args.arg      = this;
+  timer_args.name     = "lox_sample";
+
+  if ((esp_timer_create(&timer_args, &m_timer) != ESP_OK) ||
+      (esp_timer_start_periodic(m_timer, 1000000 / LOX_SAMPLE_RATE_HZ) != ESP_OK))
+  {
+    ESP_LOGE(TAG, "Sampling timer start failed");
+  }
+}
+
+/**
+ * @brief         Get latest reading
+ */
+bool LoxJobs::WeightScale(uint16_t *weight, bool *stable)
+{
+  uint32_t reading = m_reading.load(std::memory_order_acquire);
+
+  CHECK(reading & LOX_READING_VALID, false);
+
+  *weight = (uint16_t)reading;
+  if (stable != NULL)
+    *stable = ((reading & LOX_READING_STABLE) != 0);
+
+  return true;
+}
+
+/**
+ * @brief         Sampling timer callback, read one ADC sample into the ring
+ *
+ * @attention     Must not block. A full ring drops the sample.
+ */
+void LoxJobs::SampleCallback(void *arg)
+{
+  LoxJobs *self = (LoxJobs *)arg;
+
+  self->m_ring.Push(adc1_get_raw(LOX_ADC_CHANNEL));
+
+  if (++self->m_sample_cnt % LOX_SAMPLE_BATCH == 0)
+    xTaskNotifyGive(self->m_task);
+}
+
+/**
+ * @brief         Scale task, filter samples and publish the latest reading
+ */
+void LoxJobs::ScaleTask(void *arg)
+{
+  LoxJobs *self = (LoxJobs *)arg;
+  LoxScaleReading reading;
+  uint32_t dropped = 0;
+  int32_t raw;
+
+  while (1)
+  {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    // Tare can be changed by shadow or web server at any time
+    self->m_scale.SetTare(g_nvs_setting_data.properties.scale_tare);
+
+    while (self->m_ring.Pop(raw))
+      self->m_scale.Process(raw);
+
+    if (self->m_scale.Ready())
+    {
+      reading = self->m_scale.Reading();
+      self->m_reading.store(LOX_READING_VALID | (reading.stable ? LOX_READING_STABLE : 0) | reading.weight,
+                            std::memory_order_release);
+    }
+
+    if (self->m_ring.Dropped() != dropped)
+    {
+      dropped = self->m_ring.Dropped();
+      ESP_LOGW(TAG, "Samples dropped: %d", (int)dropped);
+    }
+  }
+}
+
+/* End of file -------------------------------------------------------- */
@@ -1,22 +1,58 @@
-/* Define to prevent recursive inclusion ------------------------------------ */
+/**
+ * @file       lox-job.h
+ * @copyright  Copyright (C) 2020 Hydratech. All rights reserved.
+ * @license    This project is released under the Hydratech License.
+ * @version    1.0.0
+ * @date       2022-04-18
+ * @author     Thuan Le
+ * @brief      LOX jobs, weight scale acquisition
+ * @note       C interface for the system modules, implemented by LoxJobs in lox-job.cpp
+ * @example    None
+ */
+
+/* Define to prevent recursive inclusion ------------------------------ */
 #ifndef __SYS_LOX_JOBS_H
 #define __SYS_LOX_JOBS_H
 
-/* Includes ----------------------------------------------------------------- */
-#include "sys_aws_config.h"
+/* Includes ----------------------------------------------------------- */
 #include "platform_common.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
 
-/* Private enum/structs ----------------------------------------------------- */
-/* Private defines ---------------------------------------------------------- */
-/* Private Constants -------------------------------------------------------- */
-static const char *TAG_JOB = "sys/lox_jobs";
+/* Public defines ----------------------------------------------------- */
+/* Public enumerate/structure ----------------------------------------- */
+/* Public function prototypes ----------------------------------------- */
+/**
+ * @brief         LOX jobs init, start ADC sampling and the scale filter task
+ *
+ * @param[in]     None
+ *
+ * @attention     Tare is taken from g_nvs_setting_data.properties.scale_tare
+ *
+ * @return        None
+ */
+void lox_jobs_init(void);
 
-/* Private variables -------------------------------------------------------- */
-static const char     *m_lox_name;
+/**
+ * @brief         LOX jobs get latest weight
+ *
+ * @param[out]    weight    Net weight after tare
+ * @param[out]    stable    Weight is stable, can be NULL
+ *
+ * @attention     None
+ *
+ * @return
+ *  - true:   Weight is valid
+ *  - false:  Filter is not filled yet
+ */
+bool lox_jobs_get_weight(uint16_t *weight, bool *stable);
 
+#ifdef __cplusplus
+}
+#endif
 
-/* Public variables --------------------------------------------------------- */
-/* Function prototypes ------------------------------------------------------ */
-//void sys_aws_jobs_init(AWS_IoT_Client *p_client, const char *thing_name, pApplicationHandler_t p_next_job_cb);
+#endif // __SYS_LOX_JOBS_H
 
+/* End of file -------------------------------------------------------- */
@@ -0,0 +1,100 @@
+/**
+ * @file       lox-ring.h
+ * @copyright  Copyright (C) 2020 Hydratech. All rights reserved.
+ * @license    This project is released under the Hydratech License.
+ * @version    1.0.0
+ * @date       2022-04-18
+ * @author     Thuan Le
+ * @brief      Single producer, single consumer lock-free ring buffer for LOX samples
+ * @note       Push and pop never block or take a lock, so the producer can run in an
+ *             ISR or timer callback while the consumer runs in a task.
+ * @example    None
+ */
+
+/* Define to prevent recursive inclusion ------------------------------ */
+#ifndef __LOX_RING_H
+#define __LOX_RING_H
+
+/* Includes ----------------------------------------------------------- */
+#include <atomic>
+#include <stdint.h>
+
+/* Public enumerate/structure ----------------------------------------- */
+/**
+ * @brief Lock-free ring buffer
+ *
+ * @tparam T    Item type
+ * @tparam N    Number of items, power of 2
+ */
+template <typename T, uint32_t N>
+class LoxRing
+{
+  static_assert((N != 0) && ((N & (N - 1)) == 0), "Ring size must be a power of 2");
+
+public:
+  LoxRing() : m_head(0), m_tail(0), m_drop(0) {}
+
+  /**
+   * @brief         Push one item, producer side only
+   *
+   * @param[in]     item    Item
+   *
+   * @attention     Item is dropped and counted when the ring is full
+   *
+   * @return
+   *  - true:   Item is pushed
+   *  - false:  Ring is full
+   */
+  bool Push(const T &item)
+  {
+    uint32_t head = m_head.load(std::memory_order_relaxed);
+
+    if (head - m_tail.load(std::memory_order_acquire) >= N)
+    {
+      m_drop.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+
+    m_buf[head & (N - 1)] = item;
+    m_head.store(head + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  /**
+   * @brief         Pop one item, consumer side only
+   *
+   * @param[out]    item    Item
+   *
+   * @attention     None
+   *
+   * @return
+   *  - true:   Item is popped
+   *  - false:  Ring is empty
+   */
+  bool Pop(T &item)
+  {
+    uint32_t tail = m_tail.load(std::memory_order_relaxed);
+
+    if (tail == m_head.load(std::memory_order_acquire))
+      return false;
+
+    item = m_buf[tail & (N - 1)];
+    m_tail.store(tail + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  uint32_t Count() const { return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire); }
+  uint32_t Dropped() const { return m_drop.load(std::memory_order_relaxed); }
+
+private:
+  T m_buf[N];
+  std::atomic<uint32_t> m_head;     // Written by producer
+  std::atomic<uint32_t> m_tail;     // Written by consumer
+  std::atomic<uint32_t> m_drop;     // Number of items dropped because the ring was full
+};
+
+#endif // __LOX_RING_H
+
+/* End of file -------------------------------------------------------- */
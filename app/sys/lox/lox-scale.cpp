@@ -0,0 +1,126 @@
+/**
+ * @file       lox-scale.cpp
+ * @copyright  Copyright (C) 2020 Hydratech. All rights reserved.
+ * @license    This project is released under the Hydratech License.
+ * @version    1.0.0
+ * @date       2022-04-18
+ * @author     Thuan Le
+ * @brief      LOX weight scale filter, fixed-point median and moving average,
+ *             tare and stable weight detection
+ * @note       The median removes single sample spikes, the moving average then
+ *             removes the remaining noise. Integer arithmetic only.
+ * @example    None
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "lox-scale.h"
+#include <string.h>
+
+/* Function definitions ----------------------------------------------- */
+LoxScale::LoxScale(const LoxScaleConfig &config)
+  : m_config(config), m_tare(0)
+{
+  Reset();
+}
+
+void LoxScale::Reset()
+{
+  memset(m_median_buf, 0, sizeof(m_median_buf));
+  memset(m_avg_buf, 0, sizeof(m_avg_buf));
+
+  m_median_pos  = 0;
+  m_median_fill = 0;
+  m_avg_sum     = 0;
+  m_avg_pos     = 0;
+  m_avg_fill    = 0;
+  m_stable_ref  = 0;
+  m_stable_cnt  = 0;
+
+  m_reading.weight = 0;
+  m_reading.stable = false;
+}
+
+LoxScaleReading LoxScale::Process(int32_t raw)
+{
+  int32_t median, avg, weight, diff;
+
+  // Median stage
+  m_median_buf[m_median_pos] = raw;
+  m_median_pos = (m_median_pos + 1) % LOX_SCALE_MEDIAN_SIZE;
+
+  if (m_median_fill < LOX_SCALE_MEDIAN_SIZE)
+  {
+    m_median_fill++;
+    return m_reading;
+  }
+
+  // Moving average stage, running sum over a power of 2 window
+  median = Median();
+  m_avg_sum += median - m_avg_buf[m_avg_pos];
+  m_avg_buf[m_avg_pos] = median;
+  m_avg_pos = (m_avg_pos + 1) & (LOX_SCALE_AVG_SIZE - 1);
+
+  if (m_avg_fill < LOX_SCALE_AVG_SIZE)
+  {
+    m_avg_fill++;
+    if (m_avg_fill < LOX_SCALE_AVG_SIZE)
+      return m_reading;
+  }
+
+  avg = m_avg_sum >> LOX_SCALE_AVG_SHIFT;
+
+  // Calibration and tare
+  weight = (int32_t)(((int64_t)(avg - m_config.zero_offset) * m_config.gain_q16) >> 16);
+  weight -= m_tare;
+
+  if (weight < 0)
+    weight = 0;
+  else if (weight > UINT16_MAX)
+    weight = UINT16_MAX;
+
+  // Stable when every filtered weight stays in the band around the reference
+  diff = weight - m_stable_ref;
+  if ((diff > m_config.stable_band) || (diff < -(int32_t)m_config.stable_band))
+  {
+    m_stable_ref = weight;
+    m_stable_cnt = 0;
+  }
+  else if (m_stable_cnt < m_config.stable_count)
+  {
+    m_stable_cnt++;
+  }
+
+  m_reading.weight = (uint16_t)weight;
+  m_reading.stable = (m_stable_cnt >= m_config.stable_count);
+
+  return m_reading;
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief         Median of the median window
+ *
+ * @attention     Insertion sort on a copy, the window is small
+ *
+ * @return        Median value
+ */
+int32_t LoxScale::Median() const
+{
+  int32_t sorted[LOX_SCALE_MEDIAN_SIZE];
+  int32_t v;
+  int8_t j;
+
+  for (uint8_t i = 0; i < LOX_SCALE_MEDIAN_SIZE; i++)
+  {
+    v = m_median_buf[i];
+
+    for (j = (int8_t)i - 1; (j >= 0) && (sorted[j] > v); j--)
+      sorted[j + 1] = sorted[j];
+
+    sorted[j + 1] = v;
+  }
+
+  return sorted[LOX_SCALE_MEDIAN_SIZE / 2];
+}
+
+/* End of file -------------------------------------------------------- */
@@ -0,0 +1,103 @@
+/**
+ * @file       lox-scale.h
+ * @copyright  Copyright (C) 2020 Hydratech. All rights reserved.
+ * @license    This project is released under the Hydratech License.
+ * @version    1.0.0
+ * @date       2022-04-18
+ * @author     Thuan Le
+ * @brief      LOX weight scale filter, fixed-point median and moving average,
+ *             tare and stable weight detection
+ * @note       No ESP-IDF dependency, the same code runs in the host simulator.
+ * @example    None
+ */
+
+/* Define to prevent recursive inclusion ------------------------------ */
+#ifndef __LOX_SCALE_H
+#define __LOX_SCALE_H
+
+/* Includes ----------------------------------------------------------- */
+#include <stdint.h>
+
+/* Public defines ----------------------------------------------------- */
+#define LOX_SCALE_MEDIAN_SIZE     (5)     // Median window, odd number of raw samples
+#define LOX_SCALE_AVG_SHIFT       (4)     // Moving average of (1 << shift) median outputs
+#define LOX_SCALE_AVG_SIZE        (1 << LOX_SCALE_AVG_SHIFT)
+
+/* Public enumerate/structure ----------------------------------------- */
+/**
+ * @brief LOX scale config
+ */
+struct LoxScaleConfig
+{
+  int32_t  zero_offset;       // Raw ADC count with empty scale
+  int32_t  gain_q16;          // Weight units per raw count, Q16.16
+  uint16_t stable_band;       // Max weight change of a stable reading
+  uint16_t stable_count;      // Number of filtered samples inside the band to be stable
+};
+
+/**
+ * @brief LOX scale reading
+ */
+struct LoxScaleReading
+{
+  uint16_t weight;            // Net weight after tare, clamped at 0
+  bool     stable;
+};
+
+/**
+ * @brief LOX scale filter
+ */
+class LoxScale
+{
+public:
+  explicit LoxScale(const LoxScaleConfig &config);
+
+  /**
+   * @brief         Scale reset filter state
+   */
+  void Reset();
+
+  /**
+   * @brief         Scale set tare weight, subtracted from the gross weight
+   */
+  void SetTare(uint16_t tare) { m_tare = tare; }
+
+  /**
+   * @brief         Scale process one raw ADC sample
+   *
+   * @param[in]     raw     Raw ADC count
+   *
+   * @attention     Constant time, no allocation. Output is valid once the median and
+   *                average windows are filled, see Ready().
+   *
+   * @return        Latest reading
+   */
+  LoxScaleReading Process(int32_t raw);
+
+  bool Ready() const { return m_avg_fill == LOX_SCALE_AVG_SIZE; }
+  LoxScaleReading Reading() const { return m_reading; }
+
+private:
+  int32_t Median() const;
+
+  LoxScaleConfig m_config;
+  uint16_t m_tare;
+
+  int32_t  m_median_buf[LOX_SCALE_MEDIAN_SIZE];
+  uint8_t  m_median_pos;
+  uint8_t  m_median_fill;
+
+  int32_t  m_avg_buf[LOX_SCALE_AVG_SIZE];
+  int32_t  m_avg_sum;
+  uint8_t  m_avg_pos;
+  uint8_t  m_avg_fill;
+
+  int32_t  m_stable_ref;      // Weight the stable band is centred on
+  uint16_t m_stable_cnt;
+
+  LoxScaleReading m_reading;
+};
+
+#endif // __LOX_SCALE_H
+
+/* End of file -------------------------------------------------------- */
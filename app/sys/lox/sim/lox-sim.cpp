@@ -0,0 +1,236 @@
+/**
+ * @file       lox-sim.cpp
+ * @copyright  Copyright (C) 2020 Hydratech. All rights reserved.
+ * @license    This project is released under the Hydratech License.
+ * @version    1.0.0
+ * @date       2022-04-18
+ * @author     Thuan Le
+ * @brief      Host simulator for the LOX scale filter. Replays a recorded load cell
+ *             trace through LoxRing and LoxScale and reports throughput, per sample
+ *             latency and the time from a weight change to a stable reading.
+ * @note       Trace file is text, one raw ADC count per line, '#' starts a comment.
+ *             Samples are assumed to be recorded at LOX_SIM_SAMPLE_RATE_HZ.
+ * @example    g++ -std=c++11 -O2 -I.. lox-sim.cpp ../lox-scale.cpp -o lox-sim
+ *             ./lox-sim trace.txt [tare] [zero_offset] [gain_q16] [-v]
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "lox-ring.h"
+#include "lox-scale.h"
+#include <chrono>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Private defines ---------------------------------------------------- */
+#define LOX_SIM_SAMPLE_RATE_HZ    (500)   // Same as LOX_SAMPLE_RATE_HZ in lox-job.cpp
+#define LOX_SIM_RING_SIZE         (256)
+#define LOX_SIM_BATCH             (25)
+#define LOX_SIM_REPEAT            (20)    // Replays of the trace for the throughput run
+
+/* Private variables -------------------------------------------------- */
+static const LoxScaleConfig LOX_SIM_CONFIG_DEFAULT =
+{
+  0,              // zero_offset
+  (1 << 16),      // gain_q16
+  3,              // stable_band
+  LOX_SIM_SAMPLE_RATE_HZ / 2
+};
+
+/* Private function prototypes ---------------------------------------- */
+static bool m_lox_sim_load(const char *path, std::vector<int32_t> &trace);
+static void m_lox_sim_replay(const std::vector<int32_t> &trace, const LoxScaleConfig &config, uint16_t tare, bool verbose);
+static void m_lox_sim_benchmark(const std::vector<int32_t> &trace, const LoxScaleConfig &config, uint16_t tare);
+
+/* Function definitions ----------------------------------------------- */
+int main(int argc, char **argv)
+{
+  LoxScaleConfig config = LOX_SIM_CONFIG_DEFAULT;
+  std::vector<int32_t> trace;
+  uint16_t tare = 0;
+  bool verbose  = false;
+  int pos = 0;
+
+  if (argc < 2)
+  {
+    fprintf(stderr, "Usage: %s trace.txt [tare] [zero_offset] [gain_q16] [-v]\n", argv[0]);
+    return 1;
+  }
+
+  for (int i = 2; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-v") == 0)
+      verbose = true;
+    else if (pos == 0 && ++pos)
+      tare = (uint16_t)atoi(argv[i]);
+    else if (pos == 1 && ++pos)
+      config.zero_offset = atoi(argv[i]);
+    else if (pos == 2 && ++pos)
+      config.gain_q16 = atoi(argv[i]);
+  }
+
+  if (!m_lox_sim_load(argv[1], trace) || trace.empty())
+  {
+    fprintf(stderr, "Cannot read trace: %s\n", argv[1]);
+    return 1;
+  }
+
+  printf("Trace: %zu samples, %.2f s at %d Hz\n", trace.size(),
+         (double)trace.size() / LOX_SIM_SAMPLE_RATE_HZ, LOX_SIM_SAMPLE_RATE_HZ);
+
+  m_lox_sim_replay(trace, config, tare, verbose);
+  m_lox_sim_benchmark(trace, config, tare);
+
+  return 0;
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief         Load trace file
+ *
+ * @param[in]     path    Trace file path
+ * @param[out]    trace   Raw samples
+ *
+ * @return
+ *  - true:   Trace is loaded
+ *  - false:  File cannot be opened
+ */
+static bool m_lox_sim_load(const char *path, std::vector<int32_t> &trace)
+{
+  char line[64];
+  FILE *f = fopen(path, "r");
+
+  if (f == NULL)
+    return false;
+
+  while (fgets(line, sizeof(line), f) != NULL)
+  {
+    char *p = line + strspn(line, " \t");
+
+    if ((*p == '#') || (*p == '\n') || (*p == '\r') || (*p == '\0'))
+      continue;
+
+    trace.push_back((int32_t)strtol(p, NULL, 0));
+  }
+
+  fclose(f);
+
+  return true;
+}
+
+/**
+ * @brief         Replay trace in sample time, report readiness and settling times
+ *
+ * @attention     Samples pass through the ring in batches, as on target
+ */
+static void m_lox_sim_replay(const std::vector<int32_t> &trace, const LoxScaleConfig &config, uint16_t tare, bool verbose)
+{
+  LoxRing<int32_t, LOX_SIM_RING_SIZE> ring;
+  LoxScale scale(config);
+  LoxScaleReading reading = scale.Reading();
+  bool ready = false, stable = false;
+  size_t unstable_at = 0, settle_cnt = 0, settle_max = 0, settle_sum = 0;
+  int32_t raw;
+
+  scale.SetTare(tare);
+
+  for (size_t i = 0; i < trace.size(); i++)
+  {
+    ring.Push(trace[i]);
+
+    if ((i + 1) % LOX_SIM_BATCH != 0 && (i + 1) != trace.size())
+      continue;
+
+    size_t idx = i + 1 - ring.Count();
+
+    while (ring.Pop(raw))
+    {
+      reading = scale.Process(raw);
+
+      if (!ready && scale.Ready())
+      {
+        ready = true;
+        printf("Filter ready at sample %zu (%.1f ms)\n", idx, idx * 1000.0 / LOX_SIM_SAMPLE_RATE_HZ);
+      }
+
+      if (ready && (reading.stable != stable))
+      {
+        stable = reading.stable;
+
+        if (stable)
+        {
+          size_t settle = idx - unstable_at;
+
+          settle_cnt++;
+          settle_sum += settle;
+          if (settle > settle_max)
+            settle_max = settle;
+        }
+        else
+        {
+          unstable_at = idx;
+        }
+
+        if (verbose)
+          printf("  %8.3f s  %-8s weight %u\n", (double)idx / LOX_SIM_SAMPLE_RATE_HZ,
+                 stable ? "stable" : "moving", reading.weight);
+      }
+
+      idx++;
+    }
+  }
+
+  printf("Final weight: %u (%s)\n", reading.weight, reading.stable ? "stable" : "moving");
+
+  if (settle_cnt != 0)
+  {
+    printf("Settling to stable: %zu times, avg %.1f ms, max %.1f ms\n", settle_cnt,
+           (double)settle_sum * 1000.0 / settle_cnt / LOX_SIM_SAMPLE_RATE_HZ,
+           (double)settle_max * 1000.0 / LOX_SIM_SAMPLE_RATE_HZ);
+  }
+}
+
+/**
+ * @brief         Run trace through ring and filter as fast as possible
+ */
+static void m_lox_sim_benchmark(const std::vector<int32_t> &trace, const LoxScaleConfig &config, uint16_t tare)
+{
+  typedef std::chrono::steady_clock clock;
+
+  LoxRing<int32_t, LOX_SIM_RING_SIZE> ring;
+  LoxScale scale(config);
+  volatile uint32_t sink = 0;
+  uint64_t total_ns = 0, max_ns = 0, ns;
+  size_t count = 0;
+  int32_t raw;
+
+  scale.SetTare(tare);
+
+  for (int r = 0; r < LOX_SIM_REPEAT; r++)
+  {
+    for (size_t i = 0; i < trace.size(); i += LOX_SIM_BATCH)
+    {
+      size_t end = (i + LOX_SIM_BATCH < trace.size()) ? i + LOX_SIM_BATCH : trace.size();
+      clock::time_point t0 = clock::now();
+
+      for (size_t j = i; j < end; j++)
+        ring.Push(trace[j]);
+
+      while (ring.Pop(raw))
+        sink += scale.Process(raw).weight;
+
+      ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t0).count();
+      total_ns += ns;
+      count    += end - i;
+      if (ns > max_ns)
+        max_ns = ns;
+    }
+  }
+
+  printf("Throughput: %.2f Msamples/s, %.1f ns/sample, worst batch of %d: %.1f us\n",
+         count * 1000.0 / total_ns, (double)total_ns / count, LOX_SIM_BATCH, max_ns / 1000.0);
+  (void)sink;
+}
+
+/* End of file -------------------------------------------------------- */
@@ -19,6 +19,9 @@
 #include "sys_devcfg.h"
 #include "bsp.h"
 #include "sys_aws.h"
+#include "sys_aws_spool.h"
+#include "sys_sched.h"
+#include "lox-job.h"
 #include "sys_ota.h"
 #include "sys_http_server.h"
 #include "bsp_error.h"
@@ -90,7 +93,10 @@ void sys_boot(void)
 {
   sys_nvs_init();
   bsp_spiffs_init();
+  sys_aws_spool_init();
   m_sys_evt_group_init();
+  sys_sched_init();
+  lox_jobs_init();
   bsp_error_init();
 
   // WiFi Setup ---------------------------------- {
@@ -170,52 +176,7 @@ __LBL_WIFI_SETUP_:
 
 void sys_run(void)
 {
-  switch (g_device.sys_state)
-  {
-  case SYS_STATE_POWER_ON:
-  {
-    bsp_delay_ms(1000);
-    break;
-  }
-
-  case SYS_STATE_NW_SETUP:
-  {
-    bsp_delay_ms(1000);
-    break;
-  }
-  
-  case SYS_STATE_READY:
-  {
-    bsp_delay_ms(50000);
-
-    uint32_t alarm_code = 1111;
-    sys_aws_mqtt_send_noti(AWS_NOTI_ALARM, &alarm_code);
-    bsp_delay_ms(5000);
-
-    aws_noti_dev_data_t device_data;
-    sprintf(device_data.serial_number, g_nvs_setting_data.dev.qr_code ); 
-    
-    /* active devices 
-    ESP32C3_B2A6  -  serial # "141A14191A18"
-    ESP32C3_BBC6  -  serial # "1812454ABC"
-    */
-    
-    device_data.weight_scale = 1340;
-    device_data.temp         = 101;
-    device_data.battery      = 99;
-    device_data.alarm_code   = 11;
-
-    device_data.longitude = -84.3067;
-    device_data.lattitude = 34.1351;
-    
-    sys_aws_mqtt_send_noti(AWS_NOTI_DEVICE_DATA, &device_data);
-
-    break;
-  }
-
-  default:
-    break;
-  }
+  sys_sched_process();
 }
 
 void sys_event_group_set(const EventBits_t bit_to_set)
@@ -66,7 +66,7 @@ extern EventGroupHandle_t g_sys_evt_group;
 void sys_boot(void);
 
 /**
- * @brief System run
+ * @brief System run, wait for and run scheduled jobs
  */
 void sys_run(void);
 
@@ -15,9 +15,12 @@
 #include "sys_aws.h"
 #include "sys_aws_job.h"
 #include "sys_aws_provision.h"
+#include "sys_aws_spool.h"
 #include "sys_devcfg.h"
 #include "sys_ota.h"
 #include "bsp.h"
+#include "bsp_msg_ring.h"
+#include "bsp_timer.h"
 
 #include "platform_common.h"
 #include "aws_iot_config.h"
@@ -26,6 +29,11 @@
 #include "jsmn.h"
 #include "aws_iot_json_utils.h"
 #include "frozen.h"
+#include "esp_vfs_eventfd.h"
+
+#include <sys/param.h>
+#include <sys/select.h>
+#include <unistd.h>
 
 /* Private enum/structs ----------------------------------------------------- */
 static const char *AWS_JOB_OPERATION[] =
@@ -44,6 +52,20 @@ aws_job_t;
 /* Private defines ---------------------------------------------------------- */
 #define AWS_TASK_STACK_SIZE           (8192 / sizeof(StackType_t))
 #define AWS_TASK_PRIORITY             (3)
+#if (portNUM_PROCESSORS > 1)
+#define AWS_TX_TASK_CORE              (0)
+#define AWS_RX_TASK_CORE              (1)     // Receiving never waits behind transmitting
+#else
+#define AWS_TX_TASK_CORE              (tskNO_AFFINITY)
+#define AWS_RX_TASK_CORE              (tskNO_AFFINITY)
+#endif
+#define AWS_RX_WAIT_MAX_MS            (1000)  // Shadow responses that never came are timed out at least this often
+#define AWS_RX_BUSY_DELAY_MS          (1)     // TX task is in a subscribe and reads the socket itself
+#define AWS_SERVICE_LANE_SIZE         (8)     // Number of pending services per lane, must be a power of 2
+#define AWS_SERVICE_DRAIN_MAX         (8)     // Max services handled between two MQTT yields
+#define AWS_YIELD_SLICE_MS            (1)     // Yield only parses bytes that already arrived
+#define AWS_STREAM_JOB_DOC_MAX        (4096)  // Largest job document put together from chunks larger than MQTT RX buffer
+#define AWS_STREAM_SHADOW_DOC_MAX     (SHADOW_MAX_SIZE_OF_RX_BUFFER - 1) // Largest shadow document the shadow client takes
 
 #define MAX_SIZE_OF_JOB_OPERATION (20)
 #define MAX_SIZE_OF_JOB_UPGRADE_URL (150)
@@ -60,13 +82,44 @@ static jsmn_parser    m_json_parser;
 static jsmntok_t      m_json_token_struct[MAX_JSON_TOKEN_EXPECTED];
 static int32_t        m_token_count;
 
+static TaskHandle_t   m_aws_tx_task_handle;
+static TaskHandle_t   m_aws_rx_task_handle;
+static int            m_tx_wake_fd = -1;
+static int            m_rx_wake_fd = -1;
+static bsp_msg_ring_t m_service_lane[SYS_AWS_LANE_CNT];
+static sys_aws_service_t m_service_slot[SYS_AWS_LANE_CNT][AWS_SERVICE_LANE_SIZE];
+static uint32_t       m_service_seq[SYS_AWS_LANE_CNT][AWS_SERVICE_LANE_SIZE];
+static uint32_t       m_service_drop[SYS_AWS_LANE_CNT];
+static uint8_t        *m_stream_buf;
+static bool           m_stream_shadow;     // Message put together in m_stream_buf is a shadow document
+
+static const char *SYS_AWS_LANE_NAME[] = { "alarm", "resp", "shadow", "telemetry" };
+
 static const uint8_t aws_root_ca_pem_start[]      asm("_binary_aws_root_ca_pem_start");
 static const uint8_t aws_root_ca_pem_end[]        asm("_binary_aws_root_ca_pem_end");
 
 /* Private function prototypes ---------------------------------------------- */
-static void m_sys_aws_task(void *params);
+static void m_sys_aws_tx_task(void *params);
+static void m_sys_aws_rx_task(void *params);
+static bool m_sys_aws_rx_pending(void);
+static uint32_t m_sys_aws_tx_wait_ms(void);
+static uint32_t m_sys_aws_rx_wait_ms(void);
+static bool m_sys_aws_wait(int wake_fd, bool use_sock, uint32_t wait_ms);
+static void m_sys_aws_wake(int wake_fd);
+static sys_aws_service_t *m_sys_aws_service_next(sys_aws_lane_t *lane);
+static void m_sys_aws_service_handle(sys_aws_service_t *service);
 static bool m_sys_aws_connect(void);
+static bool m_sys_aws_subscribe(void);
+static void m_sys_aws_session_save(void);
 static void m_sys_aws_disconnect_callback_handler(AWS_IoT_Client *p_client, void *data);
+static void m_sys_aws_stream_callback_handler(AWS_IoT_Client *p_client,
+                                              char *topic_name,
+                                              uint16_t topic_name_len,
+                                              IoT_Publish_Message_Params *params,
+                                              size_t payload_offset,
+                                              size_t payload_total_len,
+                                              void *p_data);
+static bool m_sys_aws_topic_ends_with(const char *topic_name, uint16_t topic_name_len, const char *suffix);
 
 static void m_sys_aws_jobs_next_job_callback(AWS_IoT_Client *p_client,
                                              char *topic_name,
@@ -117,14 +170,78 @@ void sys_aws_init(void)
 
 void sys_aws_start(void)
 {
-  g_sys_aws.evt_queue = xQueueCreate(20, sizeof(sys_aws_service_t));
-
-  xTaskCreate(m_sys_aws_task,
-              "aws_task",
-              AWS_TASK_STACK_SIZE,
-              NULL,
-              AWS_TASK_PRIORITY,
-              NULL);
+  esp_vfs_eventfd_config_t eventfd_config = ESP_VFS_EVENTD_CONFIG_DEFAULT();
+
+  for (uint8_t i = 0; i < SYS_AWS_LANE_CNT; i++)
+    bsp_msg_ring_init(&m_service_lane[i], m_service_slot[i], m_service_seq[i], sizeof(sys_aws_service_t), AWS_SERVICE_LANE_SIZE);
+
+  // Shadow records are shared by the actions of TX task and the responses handled by RX task
+  g_sys_aws.shadow_lock = xSemaphoreCreateMutex();
+  if (g_sys_aws.shadow_lock == NULL)
+  {
+    ESP_LOGE(TAG, "Create shadow lock failed");
+    return;
+  }
+
+  // Each AWS task is woken up through an eventfd, so it can wait for it and the socket in one select()
+  esp_vfs_eventfd_register(&eventfd_config);
+  m_tx_wake_fd = eventfd(0, 0);
+  m_rx_wake_fd = eventfd(0, 0);
+  if ((m_tx_wake_fd < 0) || (m_rx_wake_fd < 0))
+  {
+    ESP_LOGE(TAG, "Create wake up eventfd failed");
+    return;
+  }
+
+  // TX task connects, then starts RX task
+  xTaskCreatePinnedToCore(m_sys_aws_tx_task,
+                          "aws_tx_task",
+                          AWS_TASK_STACK_SIZE,
+                          NULL,
+                          AWS_TASK_PRIORITY,
+                          &m_aws_tx_task_handle,
+                          AWS_TX_TASK_CORE);
+}
+
+sys_aws_service_t *sys_aws_service_reserve(sys_aws_lane_t lane)
+{
+  sys_aws_service_t *service;
+
+  // Services are kept in lanes until AWS is connected
+  CHECK(lane < SYS_AWS_LANE_CNT, NULL);
+  CHECK(m_service_lane[lane].seq != NULL, NULL);
+
+  service = bsp_msg_ring_reserve(&m_service_lane[lane]);
+  if (service == NULL)
+  {
+    __atomic_fetch_add(&m_service_drop[lane], 1, __ATOMIC_RELAXED);
+    ESP_LOGW(TAG, "Service lane %s is full, service is dropped", SYS_AWS_LANE_NAME[lane]);
+  }
+
+  return service;
+}
+
+void sys_aws_service_commit(sys_aws_service_t *service)
+{
+  // Lane is found from the slot address, slots of one lane are contiguous
+  uint32_t lane = (uint32_t)(service - &m_service_slot[0][0]) / AWS_SERVICE_LANE_SIZE;
+
+  bsp_msg_ring_commit(&m_service_lane[lane], service);
+
+  // Wake TX task up from waiting for service
+  m_sys_aws_wake(m_tx_wake_fd);
+}
+
+void sys_aws_wakeup(void)
+{
+  m_sys_aws_wake(m_tx_wake_fd);
+  m_sys_aws_wake(m_rx_wake_fd);
+}
+
+void sys_aws_service_lane_stats(sys_aws_lane_t lane, sys_aws_lane_stats_t *stats)
+{
+  stats->depth = bsp_msg_ring_count(&m_service_lane[lane]);
+  stats->drop  = __atomic_load_n(&m_service_drop[lane], __ATOMIC_RELAXED);
 }
 
 void sys_aws_reconnect_manual(void)
@@ -137,9 +254,16 @@ void sys_aws_reconnect_manual(void)
   status = aws_iot_mqtt_attempt_reconnect(&g_sys_aws.client);
 
   if (NETWORK_RECONNECTED == status)
+  {
     ESP_LOGI(TAG, "Manual Reconnect Successful");
+
+    // Services were kept in lanes while disconnected
+    m_sys_aws_wake(m_tx_wake_fd);
+  }
   else
+  {
     ESP_LOGW(TAG, "Manual Reconnect Failed - %d", status);
+  }
 }
 
 void sys_aws_send_error_code(void)
@@ -153,42 +277,37 @@ void sys_aws_send_error_code(void)
     err_num = bsp_error_read_start();
 
     if (err_num == 0)
+    {
       ESP_LOGI(TAG, "No error code");
+    }
     else
-      ESP_LOGI(TAG, "Number of error code: %d", err_num);
-
-    while (err_num != 0)
     {
-      g_nvs_setting_data.bsp_error.err_code = bsp_error_read();
-      err_num--;
-
-      sys_aws_shadow_update(SYS_AWS_ERROR_CODE);
-
-      ESP_LOGW(TAG, "Send error handler: %d",  g_nvs_setting_data.bsp_error.err_code);
+      // Error codes go in chunks, each one after the previous one is accepted
+      ESP_LOGI(TAG, "Number of error code: %d", err_num);
+      sys_aws_shadow_mark_dirty(SYS_AWS_ERROR_CODE);
     }
   }
 }
 
 /* Private function definitions --------------------------------------------- */
 /**
- * @brief         AWS task
+ * @brief         AWS TX task, connects and then sends the services of the lanes
  *
  * @param[in]     params    Pointer to params
  *
- * @attention     None
+ * @attention     Publishes run beside the yield of RX task, see aws_iot_mqtt_set_full_duplex
  *
  * @return        None
  */
-static void m_sys_aws_task(void *params)
+static void m_sys_aws_tx_task(void *params)
 {
-  char temp_buf[AWS_IOT_MQTT_TX_BUF_LEN] = {0};
-  sys_aws_service_t service;
-  EventBits_t evt_bit;
+  sys_aws_service_t *service;
+  sys_aws_lane_t lane;
 
   m_sys_aws_connect();
 
-  // MQTT service
-  sys_aws_mqtt_subscribe(AWS_PUB_TOPIC_DOWNNSTREAM);
+  // MQTT and jobs topics
+  m_sys_aws_subscribe();
 
   // Shadow service
   sys_aws_shadow_init();
@@ -196,68 +315,89 @@ static void m_sys_aws_task(void *params)
   // Send error code
   sys_aws_send_error_code();
 
-  // Jobs service
-  sys_aws_jobs_init(&g_sys_aws.client, g_nvs_setting_data.thing_name, m_sys_aws_jobs_next_job_callback);
+  // Jobs service, the response is handled by RX task
+  sys_aws_jobs_init(&g_sys_aws.client, g_nvs_setting_data.thing_name);
 
-    while (FOREVER)
-    {
-        aws_iot_mqtt_yield(&g_sys_aws.client, 1000);
+  // Blocking calls of the startup are done, RX task owns the yield from now on
+  xTaskCreatePinnedToCore(m_sys_aws_rx_task,
+                          "aws_rx_task",
+                          AWS_TASK_STACK_SIZE,
+                          NULL,
+                          AWS_TASK_PRIORITY,
+                          &m_aws_rx_task_handle,
+                          AWS_RX_TASK_CORE);
 
+  while (FOREVER)
+  {
     if (aws_iot_mqtt_is_client_connected(&g_sys_aws.client))
     {
-      if (xQueueReceive(g_sys_aws.evt_queue, &service, pdMS_TO_TICKS(100)) == pdTRUE)
+      // Lanes are scanned again after each service, so a new alarm goes before older bulk data
+      service = m_sys_aws_service_next(&lane);
+      for (uint8_t i = 0; (service != NULL) && (i < AWS_SERVICE_DRAIN_MAX); i++)
       {
-        if (service.type == SYS_AWS_SHADOW)
-        {
-          // Handle Shadow
-          switch (service.shadow.cmd)
-          {
-          case SYS_AWS_SHADOW_CMD_GET:
-            sys_aws_shadow_get(service.shadow.name);
-            break;
+        m_sys_aws_service_handle(service);
+        bsp_msg_ring_release(&m_service_lane[lane]);
 
-          case SYS_AWS_SHADOW_CMD_SET:
-            sys_aws_shadow_update(service.shadow.name);
-            break;
+        service = m_sys_aws_service_next(&lane);
+      }
 
-          default:
-            break;
-          }
-        }
-        else
-        {
-          // Handle MQTT
-          switch (service.mqtt.cmd)
-          {
-          case SYS_AWS_MQTT_CMD_PUB:
-            switch (service.mqtt.data.packet_type)
-            {
-            case AWS_PKT_NOTI:
-              aws_build_packet(AWS_PKT_NOTI, &service.mqtt.data.noti_param, 
-                                temp_buf, sizeof(temp_buf));
-              break;
-            
-            case AWS_PKT_RESP:
-              aws_build_packet(AWS_PKT_RESP, &service.mqtt.data.resp_param, 
-                               temp_buf, sizeof(temp_buf));
-              break;
-
-            default:
-              break;
-            }
-            
-            sys_aws_mqtt_publish(service.mqtt.pub_topic, temp_buf);
-            break;
+      sys_aws_mqtt_batch_process();
+      sys_aws_shadow_process();
+      sys_aws_spool_process();
 
-          default:
-            break;
-          }
-        }
-      }
+      // New publishes may be in flight, RX task must wake up for their retransmission
+      m_sys_aws_wake(m_rx_wake_fd);
+
+      // Subscriptions may have changed, keep the session record for the next boot
+      m_sys_aws_session_save();
     }
-    else
+
+    // Sleep until a producer wakes us up or the next deadline
+    m_sys_aws_wait(m_tx_wake_fd, false, m_sys_aws_tx_wait_ms());
+  }
+}
+
+/**
+ * @brief         AWS RX task, reads the socket and calls the subscribe handlers
+ *
+ * @param[in]     params    Pointer to params
+ *
+ * @attention     Keep alive, retransmissions and reconnects are done here
+ *
+ * @return        None
+ */
+static void m_sys_aws_rx_task(void *params)
+{
+  EventBits_t evt_bit;
+  IoT_Error_t rc;
+  Timer shadow_timer;
+  bool rx_ready = true;
+
+  init_timer(&shadow_timer);
+
+  while (FOREVER)
+  {
+    rc = SUCCESS;
+
+    if (aws_iot_mqtt_is_client_connected(&g_sys_aws.client))
     {
-      bsp_delay_ms(1000);
+      // Yield when bytes came in, keep alive or a retransmission is due, or shadow responses that never came time out
+      if (rx_ready || (left_ms(&g_sys_aws.client.pingTimer) == 0) ||
+          (aws_iot_mqtt_get_inflight_wait_ms(&g_sys_aws.client) == 0) || has_timer_expired(&shadow_timer))
+      {
+        xSemaphoreTake(g_sys_aws.shadow_lock, portMAX_DELAY);
+        do
+        {
+          rc = aws_iot_shadow_yield(&g_sys_aws.client, AWS_YIELD_SLICE_MS);
+        } while ((rc == SUCCESS) && m_sys_aws_rx_pending());
+        xSemaphoreGive(g_sys_aws.shadow_lock);
+
+        countdown_ms(&shadow_timer, AWS_RX_WAIT_MAX_MS);
+
+        // Auto reconnect is done in the yield, TX task sleeps until it is woken up
+        if (rc == NETWORK_RECONNECTED)
+          m_sys_aws_wake(m_tx_wake_fd);
+      }
     }
 
     // Check network config
@@ -266,6 +406,243 @@ static void m_sys_aws_task(void *params)
     {
       sys_aws_reconnect_manual();
     }
+
+    // TX task is waiting for a SUBACK and reads the socket itself, try again once it is done
+    if (rc == MQTT_CLIENT_NOT_IDLE_ERROR)
+    {
+      vTaskDelay(pdMS_TO_TICKS(AWS_RX_BUSY_DELAY_MS));
+      rx_ready = true;
+      continue;
+    }
+
+    // Sleep until the socket is readable, a wake up or the next deadline
+    rx_ready = m_sys_aws_wait(m_rx_wake_fd, true, m_sys_aws_rx_wait_ms());
+  }
+}
+
+/**
+ * @brief         AWS check if received bytes are buffered above the socket
+ *
+ * @param[in]     None
+ *
+ * @attention     RX task only
+ *
+ * @return
+ *  - true:   Bytes are buffered, select() does not report them
+ *  - false:  Nothing is buffered
+ */
+static bool m_sys_aws_rx_pending(void)
+{
+  return aws_iot_mqtt_is_rx_pending(&g_sys_aws.client) ||
+         iot_tls_is_rx_pending(&g_sys_aws.client.networkStack.tlsDataParams);
+}
+
+/**
+ * @brief         AWS get time until TX task has work to do without any event
+ *
+ * @param[in]     None
+ *
+ * @attention     TX task only
+ *
+ * @return        Time in ms, BSP_TMR_FOREVER if TX task only waits for events
+ */
+static uint32_t m_sys_aws_tx_wait_ms(void)
+{
+  uint32_t wait_ms;
+
+  // Services are kept in lanes until AWS is connected
+  if (!aws_iot_mqtt_is_client_connected(&g_sys_aws.client))
+    return BSP_TMR_FOREVER;
+
+  for (uint8_t i = 0; i < SYS_AWS_LANE_CNT; i++)
+  {
+    if (bsp_msg_ring_count(&m_service_lane[i]) != 0)
+      return 0;
+  }
+
+  wait_ms = sys_aws_mqtt_batch_wait_ms();
+  wait_ms = MIN(wait_ms, sys_aws_shadow_wait_ms());
+  wait_ms = MIN(wait_ms, sys_aws_spool_wait_ms());
+
+  return wait_ms;
+}
+
+/**
+ * @brief         AWS get time until RX task has work to do without any event
+ *
+ * @param[in]     None
+ *
+ * @attention     RX task only
+ *
+ * @return        Time in ms, BSP_TMR_FOREVER if RX task only waits for events
+ */
+static uint32_t m_sys_aws_rx_wait_ms(void)
+{
+  uint32_t wait_ms;
+
+  if (!aws_iot_mqtt_is_client_connected(&g_sys_aws.client))
+    return BSP_TMR_FOREVER;
+
+  wait_ms = left_ms(&g_sys_aws.client.pingTimer);
+  wait_ms = MIN(wait_ms, aws_iot_mqtt_get_inflight_wait_ms(&g_sys_aws.client));
+  wait_ms = MIN(wait_ms, AWS_RX_WAIT_MAX_MS);
+
+  return wait_ms;
+}
+
+/**
+ * @brief         AWS wait for a wake up, and the TLS socket
+ *
+ * @param[in]     wake_fd   Wake up eventfd of the calling task
+ * @param[in]     use_sock  Wait for the TLS socket to be readable too
+ * @param[in]     wait_ms   Max wait time in ms, BSP_TMR_FOREVER to wait without timeout
+ *
+ * @attention     None
+ *
+ * @return
+ *  - true:   Socket is readable
+ *  - false:  Woken up or timeout
+ */
+static bool m_sys_aws_wait(int wake_fd, bool use_sock, uint32_t wait_ms)
+{
+  struct timeval tv;
+  fd_set read_fds;
+  uint64_t wake_cnt;
+  int sock   = -1;
+  int max_fd = wake_fd;
+
+  FD_ZERO(&read_fds);
+  FD_SET(wake_fd, &read_fds);
+
+  if (use_sock && aws_iot_mqtt_is_client_connected(&g_sys_aws.client))
+  {
+    sock = iot_tls_get_fd(&g_sys_aws.client.networkStack.tlsDataParams);
+    if (sock >= 0)
+    {
+      FD_SET(sock, &read_fds);
+      max_fd = MAX(max_fd, sock);
+    }
+  }
+
+  tv.tv_sec  = wait_ms / 1000;
+  tv.tv_usec = (wait_ms % 1000) * 1000;
+
+  if (select(max_fd + 1, &read_fds, NULL, NULL, (wait_ms == BSP_TMR_FOREVER) ? NULL : &tv) <= 0)
+    return false;
+
+  // Clear wake up count, several wake ups are handled by one pass
+  if (FD_ISSET(wake_fd, &read_fds))
+    read(wake_fd, &wake_cnt, sizeof(wake_cnt));
+
+  return (sock >= 0) && FD_ISSET(sock, &read_fds);
+}
+
+/**
+ * @brief         AWS wake an AWS task up
+ *
+ * @param[in]     wake_fd   Wake up eventfd of the task
+ *
+ * @attention     Not for ISR
+ *
+ * @return        None
+ */
+static void m_sys_aws_wake(int wake_fd)
+{
+  uint64_t wake_cnt = 1;
+
+  if (wake_fd >= 0)
+    write(wake_fd, &wake_cnt, sizeof(wake_cnt));
+}
+
+/**
+ * @brief         AWS get the oldest service of the highest non-empty lane
+ *
+ * @param[out]    lane    Lane of the service, to release it
+ *
+ * @attention     TX task only
+ *
+ * @return        Pointer to service, NULL if all lanes are empty
+ */
+static sys_aws_service_t *m_sys_aws_service_next(sys_aws_lane_t *lane)
+{
+  sys_aws_service_t *service;
+
+  for (uint8_t i = 0; i < SYS_AWS_LANE_CNT; i++)
+  {
+    service = bsp_msg_ring_peek(&m_service_lane[i]);
+    if (service != NULL)
+    {
+      *lane = (sys_aws_lane_t)i;
+      return service;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief         AWS handle one service
+ *
+ * @param[in]     service   Pointer to service
+ *
+ * @attention     TX task only
+ *
+ * @return        None
+ */
+static void m_sys_aws_service_handle(sys_aws_service_t *service)
+{
+  if (service->type == SYS_AWS_SHADOW)
+  {
+    // Handle Shadow
+    switch (service->shadow.cmd)
+    {
+    case SYS_AWS_SHADOW_CMD_GET:
+      sys_aws_shadow_get(service->shadow.name);
+      break;
+
+    case SYS_AWS_SHADOW_CMD_SET:
+      // Changes are merged and sent by sys_aws_shadow_process
+      if (service->shadow.name == SYS_AWS_ERROR_CODE)
+        sys_aws_send_error_code();
+      else
+        sys_aws_shadow_mark_dirty(service->shadow.name);
+      break;
+
+    default:
+      break;
+    }
+  }
+  else
+  {
+    // Handle MQTT
+    switch (service->mqtt.cmd)
+    {
+    case SYS_AWS_MQTT_CMD_PUB:
+      // Device data is published later as one batch
+      if ((service->mqtt.data.packet_type == AWS_PKT_NOTI) &&
+          sys_aws_mqtt_batch_add(&service->mqtt.data.noti_param))
+        break;
+
+      switch (service->mqtt.data.packet_type)
+      {
+      case AWS_PKT_NOTI:
+        // Keep notification in spool to forward it after reconnecting
+        if (!sys_aws_mqtt_publish_packet(service->mqtt.pub_topic, AWS_PKT_NOTI, &service->mqtt.data.noti_param))
+          sys_aws_spool_append(&service->mqtt.data.noti_param);
+        break;
+      
+      case AWS_PKT_RESP:
+        sys_aws_mqtt_publish_packet(service->mqtt.pub_topic, AWS_PKT_RESP, &service->mqtt.data.resp_param);
+        break;
+
+      default:
+        break;
+      }
+      break;
+
+    default:
+      break;
+    }
   }
 }
 
@@ -297,20 +674,102 @@ static bool m_sys_aws_connect(void)
   shadow_connect_params.pMqttClientId   = g_nvs_setting_data.thing_name;
   shadow_connect_params.mqttClientIdLen = (uint16_t) strlen(g_nvs_setting_data.thing_name);
 
+  // Broker keeps subscriptions and queues QoS1 messages while the device is offline
+  shadow_connect_params.isCleanSession  = false;
+
   // AWS shadow init
   ESP_LOGI(TAG, "Shadow init...");
   CHECK(SUCCESS == aws_iot_shadow_init(&g_sys_aws.client, &shadow_init_params), false);
 
+  // Subscriptions of the previous boot are not sent again if the broker resumes the session
+  CHECK(SUCCESS == aws_iot_mqtt_set_session_record(&g_sys_aws.client,
+                                                   g_nvs_setting_data.mqtt_session.hash,
+                                                   g_nvs_setting_data.mqtt_session.count), false);
+
   // Connecting to AWS
   ESP_LOGI(TAG, "Shadow connect...");
   CHECK(SUCCESS == aws_iot_shadow_connect(&g_sys_aws.client, &shadow_connect_params), false);
 
+  ESP_LOGI(TAG, "MQTT session %s, %d subscriptions recorded",
+           aws_iot_mqtt_is_session_present(&g_sys_aws.client) ? "resumed" : "new",
+           g_nvs_setting_data.mqtt_session.count);
+
   // Enable auto reconnect
   CHECK(SUCCESS == aws_iot_mqtt_autoreconnect_set_status(&g_sys_aws.client, false), false);
 
+  // Alarms wait for PUBACK without blocking TX task
+  CHECK(sys_aws_mqtt_inflight_init(), false);
+
+  // Messages larger than MQTT RX buffer come in chunks
+  CHECK(SUCCESS == aws_iot_mqtt_set_stream_handler(&g_sys_aws.client, m_sys_aws_stream_callback_handler, NULL), false);
+
+  // Publishes of TX task do not wait for the yield of RX task
+  CHECK(SUCCESS == aws_iot_mqtt_set_full_duplex(&g_sys_aws.client, true), false);
+
+  return true;
+}
+
+/**
+ * @brief         AWS subscribe to the MQTT and jobs topics in one round trip
+ *
+ * @param[in]     None
+ *
+ * @attention     TX task only
+ *
+ * @return
+ *  - true:   Subscribe success
+ *  - false:  Subscribe failed
+ */
+static bool m_sys_aws_subscribe(void)
+{
+  IoT_Subscribe_Filter filter[AWS_IOT_MQTT_SUBSCRIBE_BATCH_MAX];
+  IoT_Error_t err;
+  uint8_t cnt = 0;
+
+  sys_aws_mqtt_subscribe_filter(AWS_PUB_TOPIC_DOWNNSTREAM, &filter[cnt++]);
+  cnt += sys_aws_jobs_subscribe_filter(g_nvs_setting_data.thing_name, m_sys_aws_jobs_next_job_callback, &filter[cnt]);
+
+  ESP_LOGI(TAG, "Subscribing to %d topics...", cnt);
+
+  // One SUBSCRIBE and one SUBACK for the whole set
+  err = aws_iot_mqtt_subscribe_batch(&g_sys_aws.client, filter, cnt);
+  if (err != SUCCESS)
+  {
+    ESP_LOGW(TAG, "Subscribing error: %s", aws_error_to_name(err));
+    return false;
+  }
+
   return true;
 }
 
+/**
+ * @brief         AWS store the session record in NVS when it changed
+ *
+ * @param[in]     None
+ *
+ * @attention     TX task only
+ *
+ * @return        None
+ */
+static void m_sys_aws_session_save(void)
+{
+  uint32_t hash[SYS_NVS_MQTT_SESSION_MAX];
+  uint16_t count;
+
+  count = aws_iot_mqtt_get_session_record(&g_sys_aws.client, hash, SYS_NVS_MQTT_SESSION_MAX);
+
+  // A shorter record is safe, the missing subscriptions are sent again on the next boot
+  if ((count == g_nvs_setting_data.mqtt_session.count) &&
+      (memcmp(hash, g_nvs_setting_data.mqtt_session.hash, count * sizeof(uint32_t)) == 0))
+    return;
+
+  memset(&g_nvs_setting_data.mqtt_session, 0, sizeof(g_nvs_setting_data.mqtt_session));
+  memcpy(g_nvs_setting_data.mqtt_session.hash, hash, count * sizeof(uint32_t));
+  g_nvs_setting_data.mqtt_session.count = count;
+
+  SYS_NVS_STORE(mqtt_session);
+}
+
 /**
  * @brief         AWS disconnect callback handler
  *
@@ -340,10 +799,135 @@ static void m_sys_aws_disconnect_callback_handler(AWS_IoT_Client *p_client, void
     status = aws_iot_mqtt_attempt_reconnect(p_client);
 
     if (NETWORK_RECONNECTED == status)
+    {
       ESP_LOGI(TAG, "Manual Reconnect Successful");
+
+      // Services and spooled notifications were kept while disconnected
+      m_sys_aws_wake(m_tx_wake_fd);
+    }
     else
+    {
       ESP_LOGW(TAG, "Manual Reconnect Failed - %d", status);
+    }
+  }
+}
+
+/**
+ * @brief         AWS stream callback, puts job and shadow documents larger than MQTT RX buffer together
+ *
+ * @param[in]     p_client            Pointer to aws iot client
+ * @param[in]     topic_name          Pointer to topic name
+ * @param[in]     topic_name_len      Topic name length
+ * @param[in]     params              Pointer to params, payload is one chunk
+ * @param[in]     payload_offset      Offset of the chunk in the payload
+ * @param[in]     payload_total_len   Length of the whole payload
+ * @param[in]     p_data              Pointer to data
+ *
+ * @attention     Called from MQTT yield in RX task. Shadow documents are passed to the handlers
+ *                the shadow client subscribed. Other large messages are dropped.
+ *
+ * @return        None
+ */
+static void m_sys_aws_stream_callback_handler(AWS_IoT_Client *p_client,
+                                              char *topic_name,
+                                              uint16_t topic_name_len,
+                                              IoT_Publish_Message_Params *params,
+                                              size_t payload_offset,
+                                              size_t payload_total_len,
+                                              void *p_data)
+{
+  IoT_Publish_Message_Params doc_params;
+  size_t doc_max;
+
+  IOT_UNUSED(p_data);
+
+  // New message, a message cut by a disconnect is dropped
+  if (payload_offset == 0)
+  {
+    free(m_stream_buf);
+    m_stream_buf = NULL;
+
+    // Only next job notify and describe replies carry a job document
+    m_stream_shadow = false;
+    if (m_sys_aws_topic_ends_with(topic_name, topic_name_len, "/jobs/notify-next") ||
+        m_sys_aws_topic_ends_with(topic_name, topic_name_len, "/jobs/$next/get/accepted"))
+    {
+      doc_max = AWS_STREAM_JOB_DOC_MAX;
+    }
+    else if (m_sys_aws_topic_ends_with(topic_name, topic_name_len, "/shadow/get/accepted") ||
+             m_sys_aws_topic_ends_with(topic_name, topic_name_len, "/shadow/update/accepted") ||
+             m_sys_aws_topic_ends_with(topic_name, topic_name_len, "/shadow/update/delta"))
+    {
+      doc_max         = AWS_STREAM_SHADOW_DOC_MAX;
+      m_stream_shadow = true;
+    }
+    else
+    {
+      ESP_LOGW(TAG, "Large message dropped, %d bytes: %.*s", (int)payload_total_len, topic_name_len, topic_name);
+      return;
+    }
+
+    if (payload_total_len > doc_max)
+    {
+      ESP_LOGW(TAG, "Document too large, %d bytes: %.*s", (int)payload_total_len, topic_name_len, topic_name);
+      return;
+    }
+
+    m_stream_buf = (uint8_t *)malloc(payload_total_len);
+    if (m_stream_buf == NULL)
+    {
+      ESP_LOGE(TAG, "malloc error, document is dropped");
+      return;
+    }
+  }
+
+  if (m_stream_buf == NULL)
+    return;
+
+  memcpy(m_stream_buf + payload_offset, params->payload, params->payloadLen);
+
+  if (payload_offset + params->payloadLen < payload_total_len)
+    return;
+
+  doc_params            = *params;
+  doc_params.payload    = m_stream_buf;
+  doc_params.payloadLen = payload_total_len;
+
+  if (m_stream_shadow)
+  {
+    if (aws_iot_mqtt_deliver_message(p_client, topic_name, topic_name_len, &doc_params) != SUCCESS)
+      ESP_LOGW(TAG, "Shadow document not delivered: %.*s", topic_name_len, topic_name);
   }
+  else
+  {
+    m_sys_aws_jobs_next_job_callback(p_client, topic_name, topic_name_len, &doc_params, NULL);
+  }
+
+  free(m_stream_buf);
+  m_stream_buf = NULL;
+}
+
+/**
+ * @brief         AWS check the end of a received topic name
+ *
+ * @param[in]     topic_name      Pointer to topic name, not null terminated
+ * @param[in]     topic_name_len  Topic name length
+ * @param[in]     suffix          Expected end of the topic name
+ *
+ * @attention     None
+ *
+ * @return
+ *  - true:   Topic name ends with suffix
+ *  - false:  Other topic
+ */
+static bool m_sys_aws_topic_ends_with(const char *topic_name, uint16_t topic_name_len, const char *suffix)
+{
+  size_t suffix_len = strlen(suffix);
+
+  if (topic_name_len < suffix_len)
+    return false;
+
+  return (strncmp(topic_name + topic_name_len - suffix_len, suffix, suffix_len) == 0);
 }
 
 /**
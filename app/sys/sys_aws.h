@@ -34,40 +34,70 @@ typedef enum
 }
 sys_aws_service_type_t;
 
+/**
+ * @brief AWS service lane enum, in priority order
+ */
+typedef enum
+{
+   SYS_AWS_LANE_ALARM = 0     // Alarm notifications
+  ,SYS_AWS_LANE_RESP          // Command responses
+  ,SYS_AWS_LANE_SHADOW        // Shadow get/update and error code upload
+  ,SYS_AWS_LANE_TELEMETRY     // Device data and other notifications
+
+  ,SYS_AWS_LANE_CNT
+}
+sys_aws_lane_t;
+
+/**
+ * @brief AWS service lane statistics
+ */
+typedef struct
+{
+  uint32_t depth;             // Services waiting in lane
+  uint32_t drop;              // Services dropped because the lane was full
+}
+sys_aws_lane_stats_t;
+
 /**
  * @brief AWS service and data structure
  */
 typedef struct
 {
-  struct
-  {
-    sys_aws_shadow_cmd_t cmd;
-    sys_aws_shadow_name_t name;
+  sys_aws_service_type_t type;
 
+  union
+  {
     struct
     {
-      char firmware_id[10];
-      uint8_t schedule_type;
+      sys_aws_shadow_cmd_t cmd;
+      sys_aws_shadow_name_t name;
+
+      struct
+      {
+        char firmware_id[10];
+        uint8_t schedule_type;
+      }
+      data;
     }
-    data;
-  }
-  shadow;
-  
-  struct
-  {
-    sys_aws_mqtt_cmd_t cmd;
-    sys_aws_mqtt_pub_topic_t pub_topic;
+    shadow;
+
     struct
     {
-      aws_packet_type_t packet_type;
-      aws_resp_param_t resp_param; 
-      aws_noti_param_t noti_param;
+      sys_aws_mqtt_cmd_t cmd;
+      sys_aws_mqtt_pub_topic_t pub_topic;
+      struct
+      {
+        aws_packet_type_t packet_type;
+        union
+        {
+          aws_resp_param_t resp_param;
+          aws_noti_param_t noti_param;
+        };
+      }
+      data;
     }
-    data;
-  }
-  mqtt;
-
-  sys_aws_service_type_t type;
+    mqtt;
+  };
 }
 sys_aws_service_t;
 
@@ -75,8 +105,7 @@ sys_aws_service_t;
 typedef struct
 {
   AWS_IoT_Client client;
-  QueueHandle_t evt_queue;
-  sys_aws_service_t service;
+  SemaphoreHandle_t shadow_lock;  // Shadow actions of TX task and shadow yield of RX task
   bool initialized;
 }
 sys_aws_t;
@@ -107,7 +136,64 @@ void sys_aws_init(void);
  */
 void sys_aws_start(void);
 
+/**
+ * @brief         AWS reserve a service slot to be filled by the caller
+ *
+ * @param[in]     lane    Priority lane of the service
+ *
+ * @attention     Safe to call from any task. The slot must be given to
+ *                sys_aws_service_commit() as soon as it is filled.
+ *                TX task always drains higher lanes first.
+ *
+ * @return        Pointer to service slot, NULL if AWS is not started or the lane is full
+ */
+sys_aws_service_t *sys_aws_service_reserve(sys_aws_lane_t lane);
+
+/**
+ * @brief         AWS hand a filled service slot over to the TX task
+ *
+ * @param[in]     service   Pointer to slot returned by sys_aws_service_reserve()
+ *
+ * @attention     None
+ *
+ * @return        None
+ */
+void sys_aws_service_commit(sys_aws_service_t *service);
+
+/**
+ * @brief         AWS get service lane statistics
+ *
+ * @param[in]     lane    Lane
+ * @param[out]    stats   Pointer to statistics
+ *
+ * @attention     None
+ *
+ * @return        None
+ */
+void sys_aws_service_lane_stats(sys_aws_lane_t lane, sys_aws_lane_stats_t *stats);
+
+/**
+ * @brief         AWS wake AWS tasks up to handle new services or events
+ *
+ * @param[in]     None
+ *
+ * @attention     Not for ISR
+ *
+ * @return        None
+ */
+void sys_aws_wakeup(void);
+
 void sys_aws_reconnect_manual(void);
+
+/**
+ * @brief         AWS mark the error code shadow as changed if NVS holds error codes
+ *
+ * @param[in]     None
+ *
+ * @attention     TX task only, others use sys_aws_shadow_trigger_command
+ *
+ * @return        None
+ */
 void sys_aws_send_error_code(void);
 
 #endif /* __SYS_AWS_H */
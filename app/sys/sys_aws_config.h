@@ -33,6 +33,9 @@
 #define AWS_OFFICIAL_PRIVATE_KEY_PATH    "/spiffs/private.pem.key"
 #define AWS_PORT                         (8883)
 
+// Official certificate is signed from a CSR of a P-256 key made on the device, instead of an RSA key made by AWS
+#define AWS_PROVISION_CSR                (1)
+
 /* Public defines ----------------------------------------------------- */
 /* Public enumerate/structure ----------------------------------------- */
 /* Public macros ------------------------------------------------------ */
@@ -25,6 +25,7 @@
 
 /* Private enum/structs ----------------------------------------------------- */
 /* Private defines ---------------------------------------------------------- */
+#define SYS_AWS_JOBS_SUB_TOPIC_CNT  (4)   // Topics subscribed by the jobs service
 /* Private Constants -------------------------------------------------------- */
 static const char *TAG_JOB = "sys/aws_jobs";
 
@@ -34,7 +35,8 @@ static AWS_IoT_Client *m_client;
 
 /* Public variables --------------------------------------------------------- */
 /* Function prototypes ------------------------------------------------------ */
-void sys_aws_jobs_init(AWS_IoT_Client *p_client, const char *thing_name, pApplicationHandler_t p_next_job_cb);
+uint8_t sys_aws_jobs_subscribe_filter(const char *thing_name, pApplicationHandler_t p_next_job_cb, IoT_Subscribe_Filter *filter);
+void sys_aws_jobs_init(AWS_IoT_Client *p_client, const char *thing_name);
 
 /* Private function prototypes ---------------------------------------------- */
 static void m_sys_aws_jobs_update_accepted_callback(AWS_IoT_Client *p_client,
@@ -74,16 +76,66 @@ void sys_aws_jobs_send_update(const char *job_id, JobExecutionStatus status)
     ESP_LOGI(TAG_JOB, "AWS jobs send update error: %s", aws_error_to_name(err));
 }
 
-inline void __attribute__((always_inline)) sys_aws_jobs_init(AWS_IoT_Client *p_client, const char *thing_name, pApplicationHandler_t p_next_job_cb)
+/**
+ * @brief         AWS jobs fill the subscribe filters of the jobs topics
+ *
+ * @param[in]     thing_name      Thing name
+ * @param[in]     p_next_job_cb   Callback of next job notify and describe replies
+ * @param[out]    filter          SYS_AWS_JOBS_SUB_TOPIC_CNT filters for aws_iot_mqtt_subscribe_batch
+ *
+ * @attention     Topic names are kept in static buffers
+ *
+ * @return        Number of filters filled
+ */
+uint8_t sys_aws_jobs_subscribe_filter(const char *thing_name, pApplicationHandler_t p_next_job_cb, IoT_Subscribe_Filter *filter)
+{
+  static char topic_to_subscribe[SYS_AWS_JOBS_SUB_TOPIC_CNT][MAX_JOB_TOPIC_LENGTH_BYTES];
+
+  const struct
+  {
+    const char *job_id;
+    AwsIotJobExecutionTopicType topic_type;
+    AwsIotJobExecutionTopicReplyType reply_type;
+    pApplicationHandler_t handler;
+  }
+  JOB_TOPIC[SYS_AWS_JOBS_SUB_TOPIC_CNT] =
+  {
+     { NULL            , JOB_NOTIFY_NEXT_TOPIC, JOB_REQUEST_TYPE       , p_next_job_cb                           }
+    ,{ JOB_ID_NEXT     , JOB_DESCRIBE_TOPIC   , JOB_WILDCARD_REPLY_TYPE, p_next_job_cb                           }
+    ,{ JOB_ID_WILDCARD , JOB_UPDATE_TOPIC     , JOB_ACCEPTED_REPLY_TYPE, m_sys_aws_jobs_update_accepted_callback }
+    ,{ JOB_ID_WILDCARD , JOB_UPDATE_TOPIC     , JOB_REJECTED_REPLY_TYPE, m_sys_aws_jobs_update_rejected_callback }
+  };
+
+  uint8_t cnt = 0;
+  int len;
+
+  for (uint8_t i = 0; i < SYS_AWS_JOBS_SUB_TOPIC_CNT; i++)
+  {
+    len = aws_iot_jobs_get_api_topic(topic_to_subscribe[i], MAX_JOB_TOPIC_LENGTH_BYTES,
+                                     JOB_TOPIC[i].topic_type, JOB_TOPIC[i].reply_type,
+                                     thing_name, JOB_TOPIC[i].job_id);
+    if ((len < 0) || (len >= MAX_JOB_TOPIC_LENGTH_BYTES))
+    {
+      ESP_LOGI(TAG_JOB, "Job topic %d too long", i);
+      continue;
+    }
+
+    filter[cnt].pTopicName              = topic_to_subscribe[i];
+    filter[cnt].topicNameLen            = (uint16_t) len;
+    filter[cnt].qos                     = QOS0;
+    filter[cnt].pApplicationHandler     = JOB_TOPIC[i].handler;
+    filter[cnt].pApplicationHandlerData = NULL;
+    cnt++;
+  }
+
+  return cnt;
+}
+
+inline void __attribute__((always_inline)) sys_aws_jobs_init(AWS_IoT_Client *p_client, const char *thing_name)
 {
   m_thing_name = thing_name;
   m_client     = p_client;
 
-  char topic_to_subscribe_notify_next[MAX_JOB_TOPIC_LENGTH_BYTES];
-  char topic_to_subscribe_get_next[MAX_JOB_TOPIC_LENGTH_BYTES];
-  char topic_to_subscribe_update_accepted[MAX_JOB_TOPIC_LENGTH_BYTES];
-  char topic_to_subscribe_update_rejected[MAX_JOB_TOPIC_LENGTH_BYTES];
-
   char topic_to_publish_get_next[MAX_JOB_TOPIC_LENGTH_BYTES];
 
   AwsIotDescribeJobExecutionRequest describe_request;
@@ -93,46 +145,7 @@ inline void __attribute__((always_inline)) sys_aws_jobs_init(AWS_IoT_Client *p_c
 
   IoT_Error_t err = FAILURE;
 
-  err = aws_iot_jobs_subscribe_to_job_messages(p_client, QOS0, thing_name,
-                                              NULL, JOB_NOTIFY_NEXT_TOPIC, JOB_REQUEST_TYPE,
-                                              p_next_job_cb, NULL, topic_to_subscribe_notify_next,
-                                              sizeof(topic_to_subscribe_notify_next));
-  if (err != SUCCESS)
-  {
-    ESP_LOGI(TAG_JOB, "Subscribe to JOB_NOTIFY_NEXT_TOPIC error: %s", aws_error_to_name(err));
-    return;
-  }
-
-  err = aws_iot_jobs_subscribe_to_job_messages(p_client, QOS0, thing_name,
-                                               JOB_ID_NEXT, JOB_DESCRIBE_TOPIC, JOB_WILDCARD_REPLY_TYPE,
-                                               p_next_job_cb, NULL, topic_to_subscribe_get_next,
-                                               sizeof(topic_to_subscribe_get_next));
-  if (err != SUCCESS)
-  {
-    ESP_LOGI(TAG_JOB, "Subscribe to JOB_DESCRIBE_TOPIC error: %s", aws_error_to_name(err));
-    return;
-  }
-
-  err = aws_iot_jobs_subscribe_to_job_messages(p_client, QOS0, thing_name,
-                                               JOB_ID_WILDCARD, JOB_UPDATE_TOPIC, JOB_ACCEPTED_REPLY_TYPE,
-                                               m_sys_aws_jobs_update_accepted_callback, NULL, topic_to_subscribe_update_accepted,
-                                               sizeof(topic_to_subscribe_update_accepted));
-  if (err != SUCCESS)
-  {
-    ESP_LOGI(TAG_JOB, "Subscribe to JOB_UPDATE_TOPIC error: %s", aws_error_to_name(err));
-    return;
-  }
-
-  err = aws_iot_jobs_subscribe_to_job_messages(p_client, QOS0, thing_name,
-                                               JOB_ID_WILDCARD, JOB_UPDATE_TOPIC, JOB_REJECTED_REPLY_TYPE,
-                                               m_sys_aws_jobs_update_rejected_callback, NULL, topic_to_subscribe_update_rejected,
-                                               sizeof(topic_to_subscribe_update_rejected));
-  if (err != SUCCESS)
-  {
-    ESP_LOGI(TAG_JOB, "Subscribe to JOB_UPDATE_TOPIC error: %s", aws_error_to_name(err));
-    return;
-  }
-
+  // Jobs topics are subscribed together with the other topics at startup, see sys_aws_jobs_subscribe_filter
   err = aws_iot_jobs_describe(p_client, QOS0, thing_name,
                               JOB_ID_NEXT, &describe_request, topic_to_publish_get_next,
                               sizeof(topic_to_publish_get_next), NULL, 0);
@@ -141,8 +154,6 @@ inline void __attribute__((always_inline)) sys_aws_jobs_init(AWS_IoT_Client *p_c
     ESP_LOGI(TAG_JOB, "Job describe error: %s", aws_error_to_name(err));
     return;
   }
-
-  aws_iot_mqtt_yield(p_client, 1000);
 }
 
 /* Private function definitions --------------------------------------------- */
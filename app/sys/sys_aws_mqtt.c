@@ -22,20 +22,48 @@
 #include "aws_iot_json_utils.h"
 #include "frozen.h"
 #include "sys_time.h"
+#include "bsp_timer.h"
+#include "sys_aws_spool.h"
 
 /* Private enum/structs ----------------------------------------------------- */
+/**
+ * @brief Payload writer context of in-place publish
+ */
+typedef struct
+{
+  aws_packet_encoding_t encoding;
+  aws_packet_type_t     type;
+  void                  *param;
+  uint8_t               count;    // Number of notifications in param, 0 for a single packet
+}
+m_sys_aws_mqtt_writer_t;
+
 /* Private defines ---------------------------------------------------------- */
 #define AWS_PUB_MSG_SIZE_MAX              (1000) // Size max of json data for publish payload
+#define AWS_ALARM_INFLIGHT_WINDOW         (AWS_IOT_MQTT_INFLIGHT_WINDOW_MAX)  // QoS1 alarms waiting for PUBACK at the same time
+#define AWS_ALARM_RETRY_MS                (5000) // Time to wait for PUBACK before an alarm is sent again
+#define AWS_NOTI_BATCH_RETRY_MIN_MS       (1000)  // First retry after a failed batch publish
+#define AWS_NOTI_BATCH_RETRY_MAX_MS       (30000) // Retry time is doubled after each failure up to this
 
 static const char *AWS_SUBSCRIBE_TOPIC[] =
 {
   "lox/%s/down",
 };
 
-static const char *AWS_PUBLISH_TOPIC[] =
+#define INFO(_i, _n, _e)[_i] = { .name = _n, .encoding = _e }
+static const sys_aws_mqtt_topic_info_t AWS_PUBLISH_TOPIC[] =
 {
-  "lox/%s/up",
+  //    +===============================+===================+===============+
+  //    | ID                            | Name              | Encoding      |
+  //    +-------------------------------+-------------------+---------------+
+   INFO ( AWS_PUB_TOPIC_UPSTREAM        , "lox/%s/up"       , AWS_ENC_JSON  )
+  ,INFO ( AWS_PUB_TOPIC_UPSTREAM_CBOR   , "lox/%s/up/cbor"  , AWS_ENC_CBOR  )
+  //    +===============================+===================+===============+
 };
+#undef  INFO
+
+// Topic of all notifications, its encoding is selected in AWS_PUBLISH_TOPIC
+#define AWS_NOTI_PUB_TOPIC                (AWS_PUB_TOPIC_UPSTREAM)
 
 /* Private Constants -------------------------------------------------------- */
 static const char *TAG = "sys/aws_mqtt";
@@ -44,6 +72,26 @@ static const char *TAG = "sys/aws_mqtt";
 static jsmn_parser  m_json_parser;
 static jsmntok_t    m_json_token_struct[MAX_JSON_TOKEN_EXPECTED];
 
+static struct
+{
+  aws_noti_param_t noti[AWS_NOTI_BATCH_SIZE_MAX];
+  uint8_t count;
+  uint32_t retry_ms;    // Backoff after a failed publish, 0 if the last publish succeeded
+  tmr_t flush_tmr;
+}
+m_noti_batch;
+
+// Copy of each alarm waiting for PUBACK, spooled again if it never comes
+static struct
+{
+  uint16_t packet_id;     // 0 if free
+  aws_noti_param_t noti;
+}
+m_alarm_inflight[AWS_ALARM_INFLIGHT_WINDOW];
+
+// PUBACK is handled by RX task and may come before TX task has recorded the alarm
+static SemaphoreHandle_t m_alarm_lock;
+
 /* Public variables --------------------------------------------------------- */
 /* Private function prototypes ---------------------------------------------- */
 static void m_sys_aws_subscribe_callback_handler(AWS_IoT_Client             *p_client,
@@ -51,52 +99,80 @@ static void m_sys_aws_subscribe_callback_handler(AWS_IoT_Client             *p_c
                                                  uint16_t                   topic_name_len,
                                                  IoT_Publish_Message_Params *params,
                                                  void                       *p_data);
+static uint8_t m_sys_aws_mqtt_batch_size(void);
+static void m_sys_aws_mqtt_batch_spool(void);
+static void m_sys_aws_mqtt_noti_fill(aws_noti_param_t *noti, aws_noti_type_t noti_type, void *param);
+static size_t m_sys_aws_mqtt_payload_writer(unsigned char *buf, size_t size, void *p_data);
+static bool m_sys_aws_mqtt_publish_in_place(sys_aws_mqtt_pub_topic_t topic, m_sys_aws_mqtt_writer_t *writer);
+static bool m_sys_aws_mqtt_is_alarm(m_sys_aws_mqtt_writer_t *writer);
+static void m_sys_aws_mqtt_publish_complete_handler(AWS_IoT_Client *p_client,
+                                                    uint16_t       packet_id,
+                                                    IoT_Error_t    result,
+                                                    void           *p_data);
 
 /* Function definitions ----------------------------------------------------- */
 void sys_aws_mqtt_send_noti(aws_noti_type_t noti_type, void *param)
 {
-  g_sys_aws.service.mqtt.data.packet_type                = AWS_PKT_NOTI;
-  g_sys_aws.service.mqtt.data.noti_param.noti_type       = noti_type;
-  g_sys_aws.service.mqtt.data.noti_param.noti_id         = 1;
-
-  sys_time_get_epoch_ms(&g_sys_aws.service.mqtt.data.noti_param.info.time);
+  sys_aws_service_t *service;
+  aws_noti_param_t noti;
 
-  if (noti_type == AWS_NOTI_ALARM)
-  {
-    uint32_t *alarm_code = (uint32_t *)param;
-    g_sys_aws.service.mqtt.data.noti_param.info.alarm_code = *alarm_code;
-  }
-  else if (noti_type == AWS_NOTI_DEVICE_DATA)
+  // Spool while offline, and while older notifications are still in spool to keep the order.
+  // An alarm does not wait behind the spool backlog.
+  if (!aws_iot_mqtt_is_client_connected(&g_sys_aws.client) ||
+      ((noti_type != AWS_NOTI_ALARM) && !sys_aws_spool_is_empty()))
   {
-    memcpy(&g_sys_aws.service.mqtt.data.noti_param.info.device_data,
-           (aws_noti_dev_data_t *)param,
-           sizeof(aws_noti_dev_data_t));
+    m_sys_aws_mqtt_noti_fill(&noti, noti_type, param);
+    sys_aws_spool_append(&noti);
+    return;
   }
 
-  sys_aws_mqtt_trigger_publish(AWS_PUB_TOPIC_UPSTREAM);
+  service = sys_aws_service_reserve((noti_type == AWS_NOTI_ALARM) ? SYS_AWS_LANE_ALARM : SYS_AWS_LANE_TELEMETRY);
+  if (service == NULL)
+    return;
+
+  service->type                  = SYS_AWS_MQTT;
+  service->mqtt.cmd              = SYS_AWS_MQTT_CMD_PUB;
+  service->mqtt.pub_topic        = AWS_NOTI_PUB_TOPIC;
+  service->mqtt.data.packet_type = AWS_PKT_NOTI;
+
+  m_sys_aws_mqtt_noti_fill(&service->mqtt.data.noti_param, noti_type, param);
+
+  sys_aws_service_commit(service);
 }
 
-void sys_aws_mqtt_trigger_publish(sys_aws_mqtt_pub_topic_t topic)
+bool sys_aws_mqtt_inflight_init(void)
 {
-  g_sys_aws.service.type           = SYS_AWS_MQTT;
-  g_sys_aws.service.mqtt.cmd       = SYS_AWS_MQTT_CMD_PUB;
-  g_sys_aws.service.mqtt.pub_topic = topic;
+  IoT_Error_t err;
+
+  if (m_alarm_lock == NULL)
+  {
+    m_alarm_lock = xSemaphoreCreateMutex();
+    CHECK(m_alarm_lock != NULL, false);
+  }
+
+  err = aws_iot_mqtt_set_inflight_window(&g_sys_aws.client, AWS_ALARM_INFLIGHT_WINDOW, AWS_ALARM_RETRY_MS,
+                                         m_sys_aws_mqtt_publish_complete_handler, NULL);
+
+  if (err != SUCCESS)
+  {
+    ESP_LOGE(TAG, "In flight window error: %s", aws_error_to_name(err));
+    return false;
+  }
 
-  xQueueSend(g_sys_aws.evt_queue, (void *)&g_sys_aws.service, pdMS_TO_TICKS(100));
+  return true;
 }
 
 bool sys_aws_mqtt_subscribe(sys_aws_mqtt_sub_topic_t topic)
 {
   IoT_Error_t err;
+  IoT_Subscribe_Filter filter;
 
-  static char aws_sub_topic[100];
+  sys_aws_mqtt_subscribe_filter(topic, &filter);
 
-  sprintf(aws_sub_topic, AWS_SUBSCRIBE_TOPIC[topic], g_nvs_setting_data.thing_name);
+  ESP_LOGI(TAG, "Subscribing...: %s", filter.pTopicName);
 
-  ESP_LOGI(TAG, "Subscribing...: %s", aws_sub_topic);
-
-  err = aws_iot_mqtt_subscribe(&g_sys_aws.client, aws_sub_topic, strlen(aws_sub_topic), QOS0,
-                              m_sys_aws_subscribe_callback_handler, NULL);
+  err = aws_iot_mqtt_subscribe(&g_sys_aws.client, filter.pTopicName, filter.topicNameLen, filter.qos,
+                              filter.pApplicationHandler, filter.pApplicationHandlerData);
 
   if (err != SUCCESS)
   {
@@ -107,21 +183,41 @@ bool sys_aws_mqtt_subscribe(sys_aws_mqtt_sub_topic_t topic)
   return true;
 }
 
-bool sys_aws_mqtt_publish(sys_aws_mqtt_pub_topic_t topic, char *buf)
+void sys_aws_mqtt_subscribe_filter(sys_aws_mqtt_sub_topic_t topic, IoT_Subscribe_Filter *filter)
+{
+  // Subscribed topic names must stay in memory
+  static char aws_sub_topic[AWS_SUB_TOPIC_CNT][100];
+
+  sprintf(aws_sub_topic[topic], AWS_SUBSCRIBE_TOPIC[topic], g_nvs_setting_data.thing_name);
+
+  filter->pTopicName              = aws_sub_topic[topic];
+  filter->topicNameLen            = (uint16_t) strlen(aws_sub_topic[topic]);
+  filter->qos                     = QOS1;   // The broker queues commands while the device is offline
+  filter->pApplicationHandler     = m_sys_aws_subscribe_callback_handler;
+  filter->pApplicationHandlerData = NULL;
+}
+
+bool sys_aws_mqtt_publish(sys_aws_mqtt_pub_topic_t topic, void *buf, uint32_t len)
 {
   IoT_Error_t err;
-  IoT_Publish_Message_Params params_publish_msg;
+  IoT_Publish_Message_Params params_publish_msg = { 0 };
 
   static char aws_pub_topic[100];
 
-  sprintf(aws_pub_topic, AWS_PUBLISH_TOPIC[topic], g_nvs_setting_data.thing_name);
+  CHECK(len != 0, false);
 
-  params_publish_msg.payload    = (void *)buf;
-  params_publish_msg.payloadLen = strlen(buf);
+  sprintf(aws_pub_topic, AWS_PUBLISH_TOPIC[topic].name, g_nvs_setting_data.thing_name);
+
+  params_publish_msg.qos        = QOS0;
+  params_publish_msg.payload    = buf;
+  params_publish_msg.payloadLen = len;
 
   ESP_LOGI(TAG, "Publishing...: %s", aws_pub_topic);
 
-  printf("Payload: %s \n", buf);
+  if (AWS_PUBLISH_TOPIC[topic].encoding == AWS_ENC_JSON)
+    printf("Payload: %.*s \n", (int)len, (char *)buf);
+  else
+    printf("Payload: %d bytes \n", len);
 
   err = aws_iot_mqtt_publish(&g_sys_aws.client, aws_pub_topic, strlen(aws_pub_topic), &params_publish_msg);
 
@@ -134,6 +230,122 @@ bool sys_aws_mqtt_publish(sys_aws_mqtt_pub_topic_t topic, char *buf)
   return true;
 }
 
+bool sys_aws_mqtt_publish_packet(sys_aws_mqtt_pub_topic_t topic, aws_packet_type_t type, void *param)
+{
+  m_sys_aws_mqtt_writer_t writer =
+  {
+    .encoding = AWS_PUBLISH_TOPIC[topic].encoding,
+    .type     = type,
+    .param    = param,
+    .count    = 0
+  };
+
+  return m_sys_aws_mqtt_publish_in_place(topic, &writer);
+}
+
+bool sys_aws_mqtt_publish_batch(aws_noti_param_t *noti, uint8_t count)
+{
+  m_sys_aws_mqtt_writer_t writer =
+  {
+    .encoding = AWS_PUBLISH_TOPIC[AWS_NOTI_PUB_TOPIC].encoding,
+    .type     = AWS_PKT_NOTI,
+    .param    = noti,
+    .count    = count
+  };
+
+  CHECK(count != 0, false);
+
+  // An alarm alone keeps its delivery guarantee, it waits for PUBACK in the in flight window
+  if ((count == 1) && (noti->noti_type == AWS_NOTI_ALARM))
+    writer.count = 0;
+
+  return m_sys_aws_mqtt_publish_in_place(AWS_NOTI_PUB_TOPIC, &writer);
+}
+
+aws_packet_encoding_t sys_aws_mqtt_get_encoding(sys_aws_mqtt_pub_topic_t topic)
+{
+  return AWS_PUBLISH_TOPIC[topic].encoding;
+}
+
+bool sys_aws_mqtt_batch_add(aws_noti_param_t *noti)
+{
+  if ((noti->noti_type != AWS_NOTI_DEVICE_DATA) || (m_sys_aws_mqtt_batch_size() <= 1))
+    return false;
+
+  // Samples came faster than the batch is processed, or the last publish failed
+  if (m_noti_batch.count >= m_sys_aws_mqtt_batch_size())
+  {
+    if (m_noti_batch.retry_ms == 0)
+      sys_aws_mqtt_batch_flush();
+
+    // Batch still can not be published, it goes to spool with the new sample to keep their order
+    if (m_noti_batch.count != 0)
+    {
+      m_sys_aws_mqtt_batch_spool();
+      sys_aws_spool_append(noti);
+      return true;
+    }
+  }
+
+  // Start flush window at the first sample of the batch
+  if (m_noti_batch.count == 0)
+    bsp_tmr_start(&m_noti_batch.flush_tmr, g_nvs_setting_data.properties.batch_interval * 1000);
+
+  memcpy(&m_noti_batch.noti[m_noti_batch.count], noti, sizeof(aws_noti_param_t));
+  m_noti_batch.count++;
+
+  ESP_LOGI(TAG, "Batch device data: %d/%d", m_noti_batch.count, m_sys_aws_mqtt_batch_size());
+
+  return true;
+}
+
+void sys_aws_mqtt_batch_process(void)
+{
+  if (m_noti_batch.count == 0)
+    return;
+
+  // A full batch waits for the retry time after a failed publish
+  if (bsp_tmr_is_expired(&m_noti_batch.flush_tmr) ||
+      ((m_noti_batch.retry_ms == 0) && (m_noti_batch.count >= m_sys_aws_mqtt_batch_size())))
+    sys_aws_mqtt_batch_flush();
+}
+
+uint32_t sys_aws_mqtt_batch_wait_ms(void)
+{
+  if (m_noti_batch.count == 0)
+    return BSP_TMR_FOREVER;
+
+  if ((m_noti_batch.retry_ms == 0) && (m_noti_batch.count >= m_sys_aws_mqtt_batch_size()))
+    return 0;
+
+  return bsp_tmr_remaining(&m_noti_batch.flush_tmr);
+}
+
+void sys_aws_mqtt_batch_flush(void)
+{
+  if (m_noti_batch.count == 0)
+    return;
+
+  if (sys_aws_mqtt_publish_batch(m_noti_batch.noti, m_noti_batch.count))
+  {
+    m_noti_batch.count    = 0;
+    m_noti_batch.retry_ms = 0;
+    bsp_tmr_stop(&m_noti_batch.flush_tmr);
+    return;
+  }
+
+  // Try again later, the flush window timer is stopped once it is expired
+  if (m_noti_batch.retry_ms == 0)
+    m_noti_batch.retry_ms = AWS_NOTI_BATCH_RETRY_MIN_MS;
+  else if (m_noti_batch.retry_ms < AWS_NOTI_BATCH_RETRY_MAX_MS / 2)
+    m_noti_batch.retry_ms *= 2;
+  else
+    m_noti_batch.retry_ms = AWS_NOTI_BATCH_RETRY_MAX_MS;
+
+  ESP_LOGW(TAG, "Batch publish failed, retry in %d ms", (int)m_noti_batch.retry_ms);
+  bsp_tmr_start(&m_noti_batch.flush_tmr, m_noti_batch.retry_ms);
+}
+
 /* Private function definitions --------------------------------------------- */
 /**
  * @brief         AWS subscibe callback handler
@@ -169,4 +381,221 @@ static void m_sys_aws_subscribe_callback_handler(AWS_IoT_Client *p_client,
              sizeof(m_json_token_struct) / sizeof(m_json_token_struct[0]));
 }
 
+/**
+ * @brief         Get number of device data samples per batch
+ *
+ * @param[in]     None
+ *
+ * @attention     Value from NVS properties is limited to AWS_NOTI_BATCH_SIZE_MAX
+ *
+ * @return        Batch size
+ */
+static uint8_t m_sys_aws_mqtt_batch_size(void)
+{
+  if (g_nvs_setting_data.properties.batch_size > AWS_NOTI_BATCH_SIZE_MAX)
+    return AWS_NOTI_BATCH_SIZE_MAX;
+
+  return (uint8_t)g_nvs_setting_data.properties.batch_size;
+}
+
+/**
+ * @brief         Move all samples of the device data batch to spool
+ *
+ * @param[in]     None
+ *
+ * @attention     Spool forwards them once a publish succeeds again
+ *
+ * @return        None
+ */
+static void m_sys_aws_mqtt_batch_spool(void)
+{
+  ESP_LOGW(TAG, "Batch is full, %d samples are spooled", m_noti_batch.count);
+
+  for (uint8_t i = 0; i < m_noti_batch.count; i++)
+    sys_aws_spool_append(&m_noti_batch.noti[i]);
+
+  m_noti_batch.count    = 0;
+  m_noti_batch.retry_ms = 0;
+  bsp_tmr_stop(&m_noti_batch.flush_tmr);
+}
+
+/**
+ * @brief         Fill notification param
+ *
+ * @param[out]    noti        Pointer to notification param
+ * @param[in]     noti_type   Notification type
+ * @param[in]     param       Pointer to notification data
+ *
+ * @attention     None
+ *
+ * @return        None
+ */
+static void m_sys_aws_mqtt_noti_fill(aws_noti_param_t *noti, aws_noti_type_t noti_type, void *param)
+{
+  noti->noti_type = noti_type;
+  noti->noti_id   = 1;
+
+  sys_time_get_epoch_ms(&noti->info.time);
+
+  if (noti_type == AWS_NOTI_ALARM)
+  {
+    uint32_t *alarm_code = (uint32_t *)param;
+    noti->info.alarm_code = *alarm_code;
+  }
+  else if (noti_type == AWS_NOTI_DEVICE_DATA)
+  {
+    memcpy(&noti->info.device_data, (aws_noti_dev_data_t *)param, sizeof(aws_noti_dev_data_t));
+  }
+}
+
+/**
+ * @brief         Build packet directly into the MQTT write buffer
+ *
+ * @param[in]     buf       Pointer to payload area of the MQTT write buffer
+ * @param[in]     size      Size of payload area
+ * @param[in]     p_data    Pointer to writer context
+ *
+ * @attention     Called by the MQTT client with its write buffer locked
+ *
+ * @return        Payload length, 0 if the packet does not fit
+ */
+static size_t m_sys_aws_mqtt_payload_writer(unsigned char *buf, size_t size, void *p_data)
+{
+  m_sys_aws_mqtt_writer_t *writer = (m_sys_aws_mqtt_writer_t *)p_data;
+  uint32_t len;
+
+  if (writer->count != 0)
+    len = aws_build_notification_batch(writer->encoding, writer->param, writer->count, buf, size);
+  else
+    len = aws_build_packet(writer->encoding, writer->type, writer->param, buf, size);
+
+  if (writer->encoding == AWS_ENC_JSON)
+    printf("Payload: %.*s \n", (int)len, (char *)buf);
+  else
+    printf("Payload: %d bytes \n", len);
+
+  return len;
+}
+
+/**
+ * @brief         AWS MQTT publish packet built by the payload writer
+ *
+ * @param[in]     topic     Topic to be published
+ * @param[in]     writer    Pointer to writer context
+ *
+ * @attention     None
+ *
+ * @return
+ *  - true:   Publish success
+ *  - false:  Publish failed
+ */
+static bool m_sys_aws_mqtt_publish_in_place(sys_aws_mqtt_pub_topic_t topic, m_sys_aws_mqtt_writer_t *writer)
+{
+  IoT_Error_t err;
+  IoT_Publish_Message_Params params_publish_msg = { 0 };
+
+  static char aws_pub_topic[100];
+
+  sprintf(aws_pub_topic, AWS_PUBLISH_TOPIC[topic].name, g_nvs_setting_data.thing_name);
+
+  // Alarms must be delivered, they wait for PUBACK in the in flight window without blocking TX task
+  params_publish_msg.qos = m_sys_aws_mqtt_is_alarm(writer) ? QOS1 : QOS0;
+
+  ESP_LOGI(TAG, "Publishing...: %s", aws_pub_topic);
+
+  if (params_publish_msg.qos == QOS1)
+    xSemaphoreTake(m_alarm_lock, portMAX_DELAY);
+
+  err = aws_iot_mqtt_publish_in_place(&g_sys_aws.client, aws_pub_topic, strlen(aws_pub_topic),
+                                      &params_publish_msg, m_sys_aws_mqtt_payload_writer, writer);
+
+  if (err != SUCCESS)
+  {
+    if (params_publish_msg.qos == QOS1)
+      xSemaphoreGive(m_alarm_lock);
+
+    ESP_LOGI(TAG, "Publishing error: %s", aws_error_to_name(err));
+    return false;
+  }
+
+  if ((params_publish_msg.qos == QOS1) && (aws_iot_mqtt_get_inflight_count(&g_sys_aws.client) != 0))
+  {
+    for (uint8_t i = 0; i < AWS_ALARM_INFLIGHT_WINDOW; i++)
+    {
+      if (m_alarm_inflight[i].packet_id == 0)
+      {
+        m_alarm_inflight[i].packet_id = params_publish_msg.id;
+        memcpy(&m_alarm_inflight[i].noti, writer->param, sizeof(aws_noti_param_t));
+        break;
+      }
+    }
+  }
+
+  if (params_publish_msg.qos == QOS1)
+    xSemaphoreGive(m_alarm_lock);
+
+  return true;
+}
+
+/**
+ * @brief         Check if writer builds a single alarm notification
+ *
+ * @param[in]     writer    Pointer to writer context
+ *
+ * @attention     None
+ *
+ * @return
+ *  - true:   Alarm notification
+ *  - false:  Other packet or batch
+ */
+static bool m_sys_aws_mqtt_is_alarm(m_sys_aws_mqtt_writer_t *writer)
+{
+  if ((writer->count != 0) || (writer->type != AWS_PKT_NOTI))
+    return false;
+
+  return (((aws_noti_param_t *)writer->param)->noti_type == AWS_NOTI_ALARM);
+}
+
+/**
+ * @brief         AWS QoS1 publish complete callback handler
+ *
+ * @param[in]     p_client        Pointer to client
+ * @param[in]     packet_id       Packet id of the publish
+ * @param[in]     result          SUCCESS when PUBACK came, MQTT_REQUEST_TIMEOUT_ERROR after the last retry
+ * @param[in]     p_data          Pointer to data
+ *
+ * @attention     Called from MQTT yield in RX task, after the SDK has released the write buffer
+ *
+ * @return        None
+ */
+static void m_sys_aws_mqtt_publish_complete_handler(AWS_IoT_Client *p_client,
+                                                    uint16_t       packet_id,
+                                                    IoT_Error_t    result,
+                                                    void           *p_data)
+{
+  xSemaphoreTake(m_alarm_lock, portMAX_DELAY);
+
+  for (uint8_t i = 0; i < AWS_ALARM_INFLIGHT_WINDOW; i++)
+  {
+    if (m_alarm_inflight[i].packet_id != packet_id)
+      continue;
+
+    m_alarm_inflight[i].packet_id = 0;
+
+    if (result == SUCCESS)
+    {
+      ESP_LOGI(TAG, "Alarm delivered, packet id: %d", packet_id);
+    }
+    else
+    {
+      // Alarm is kept in spool to forward it again
+      ESP_LOGW(TAG, "Alarm not acknowledged, packet id: %d", packet_id);
+      sys_aws_spool_append(&m_alarm_inflight[i].noti);
+    }
+    break;
+  }
+
+  xSemaphoreGive(m_alarm_lock);
+}
+
 /* End of file -------------------------------------------------------------- */
\ No newline at end of file
@@ -17,8 +17,10 @@
 /* Includes ----------------------------------------------------------- */
 #include "platform_common.h"
 #include "aws_builder.h"
+#include "aws_iot_mqtt_client_interface.h"
 
 /* Public defines ----------------------------------------------------- */
+#define AWS_NOTI_BATCH_SIZE_MAX           (8)    // Size max of notification batch, must fit in AWS_IOT_MQTT_TX_BUF_LEN
 /* Public enumerate/structure ----------------------------------------- */
 /**
  * @brief AWS MQTT command enum
@@ -35,16 +37,28 @@ sys_aws_mqtt_cmd_t;
  */
 typedef enum
 {
-  AWS_PUB_TOPIC_UPSTREAM
+   AWS_PUB_TOPIC_UPSTREAM
+  ,AWS_PUB_TOPIC_UPSTREAM_CBOR
 }
 sys_aws_mqtt_pub_topic_t;
 
+/**
+ * AWS publish topic info
+ */
+typedef struct
+{
+  char * const name;
+  aws_packet_encoding_t encoding;
+}
+sys_aws_mqtt_topic_info_t;
+
 /**
  * AWS subcribe topics
  */
 typedef enum
 {
-  AWS_PUB_TOPIC_DOWNNSTREAM
+   AWS_PUB_TOPIC_DOWNNSTREAM
+  ,AWS_SUB_TOPIC_CNT
 }
 sys_aws_mqtt_sub_topic_t;
 
@@ -52,15 +66,17 @@ sys_aws_mqtt_sub_topic_t;
 /* Public variables --------------------------------------------------- */
 /* Public function prototypes ----------------------------------------- */
 /**
- * @brief         AWS MQTT trigger publish
+ * @brief         AWS MQTT set the in flight window of QoS1 alarms
  *
- * @param[in]     topic   Topic to be published
+ * @param[in]     None
  *
- * @attention     None
+ * @attention     Call after MQTT connect, the window is kept across reconnects
  *
- * @return        None
+ * @return
+ *  - true:   Alarms are published without waiting for PUBACK
+ *  - false:  Alarms are published blocking
  */
-void sys_aws_mqtt_trigger_publish(sys_aws_mqtt_pub_topic_t topic);
+bool sys_aws_mqtt_inflight_init(void);
 
 /**
  * @brief         AWS MQTT subscribe
@@ -73,22 +89,126 @@ void sys_aws_mqtt_trigger_publish(sys_aws_mqtt_pub_topic_t topic);
  */
 bool sys_aws_mqtt_subscribe(sys_aws_mqtt_sub_topic_t topic);
 
+/**
+ * @brief         AWS MQTT fill the subscribe filter of a topic
+ *
+ * @param[in]     topic   Topic to be subscribed
+ * @param[out]    filter  Filter for aws_iot_mqtt_subscribe_batch
+ *
+ * @attention     The topic name is kept in a static buffer, one per topic
+ *
+ * @return        None
+ */
+void sys_aws_mqtt_subscribe_filter(sys_aws_mqtt_sub_topic_t topic, IoT_Subscribe_Filter *filter);
+
 /**
  * @brief         AWS MQTT publish
  *
  * @param[in]     topic   Topic to be published
+ * @param[in]     buf     Pointer to payload
+ * @param[in]     len     Payload length
  *
  * @attention     None
  *
- * @return        None
+ * @return
+ *  - true:   Publish success
+ *  - false:  Publish failed
+ */
+bool sys_aws_mqtt_publish(sys_aws_mqtt_pub_topic_t topic, void *buf, uint32_t len);
+
+/**
+ * @brief         AWS MQTT build and publish packet without intermediate buffer
+ *
+ * @param[in]     topic   Topic to be published
+ * @param[in]     type    Packet type
+ * @param[in]     param   Pointer to packet param
+ *
+ * @attention     Packet is built by topic encoding straight into the MQTT write buffer
+ *
+ * @return
+ *  - true:   Publish success
+ *  - false:  Publish failed
+ */
+bool sys_aws_mqtt_publish_packet(sys_aws_mqtt_pub_topic_t topic, aws_packet_type_t type, void *param);
+
+/**
+ * @brief         AWS MQTT publish notifications as one batch packet
+ *
+ * @param[in]     noti    Pointer to array of notification params
+ * @param[in]     count   Number of notifications, up to AWS_NOTI_BATCH_SIZE_MAX
+ *
+ * @attention     A single alarm is published as a QoS1 notification, the same as a live alarm
+ *
+ * @return
+ *  - true:   Publish success
+ *  - false:  Publish failed
+ */
+bool sys_aws_mqtt_publish_batch(aws_noti_param_t *noti, uint8_t count);
+
+/**
+ * @brief         AWS MQTT get payload encoding of a publish topic
+ *
+ * @param[in]     topic   Publish topic
+ *
+ * @attention     None
+ *
+ * @return        Payload encoding
  */
-bool sys_aws_mqtt_publish(sys_aws_mqtt_pub_topic_t topic, char *buf);
+aws_packet_encoding_t sys_aws_mqtt_get_encoding(sys_aws_mqtt_pub_topic_t topic);
 
 /**
  * @brief         AWS MQTT send noti
  */
 void sys_aws_mqtt_send_noti(aws_noti_type_t noti_type, void *param);
 
+/**
+ * @brief         AWS MQTT add notification to device data batch
+ *
+ * @param[in]     noti    Pointer to notification param
+ *
+ * @attention     Only device data notifications are batched, and only when
+ *                properties.batch_size is greater than 1. If a full batch can not
+ *                be published, it goes to spool with the new notification.
+ *
+ * @return
+ *  - true:   Notification is kept in batch
+ *  - false:  Notification must be published immediately
+ */
+bool sys_aws_mqtt_batch_add(aws_noti_param_t *noti);
+
+/**
+ * @brief         AWS MQTT publish device data batch when it is full or its interval is expired
+ *
+ * @param[in]     None
+ *
+ * @attention     None
+ *
+ * @return        None
+ */
+void sys_aws_mqtt_batch_process(void);
+
+/**
+ * @brief         AWS MQTT get time until the device data batch must be published
+ *
+ * @param[in]     None
+ *
+ * @attention     None
+ *
+ * @return        Time in ms, BSP_TMR_FOREVER if the batch is empty
+ */
+uint32_t sys_aws_mqtt_batch_wait_ms(void);
+
+/**
+ * @brief         AWS MQTT publish all pending device data in batch
+ *
+ * @param[in]     None
+ *
+ * @attention     Batch is kept if the publish fails and published again after a backoff
+ *
+ * @return        None
+ */
+void sys_aws_mqtt_batch_flush(void);
+
 #endif /* __SYS_AWS_MQTT_H */
 
 /* End of file -------------------------------------------------------- */
\ No newline at end of file
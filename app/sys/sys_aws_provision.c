@@ -25,11 +25,25 @@
 #include "frozen.h"
 #include "esp_spiffs.h"
 
+#include "mbedtls/pk.h"
+#include "mbedtls/ecp.h"
+#include "mbedtls/x509_csr.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+
 /* Private enum/structs ----------------------------------------------------- */
 /* Private defines ---------------------------------------------------------- */
 #define AWS_PROVISION_TASK_STACK_SIZE       (8192 / sizeof(StackType_t))
 #define AWS_PROVISION_TASK_PRIORITY         (3)
 #define AWS_PROVISION_NUM_SUBSCRIBE_TOPIC   (4)
+#define AWS_PROVISION_CSR_MAX_LEN           (800)
+#define AWS_PROVISION_KEY_MAX_LEN           (512)
+
+#if (AWS_PROVISION_CSR)
+#define AWS_CERTIFICATE_CREATE_API          "$aws/certificates/create-from-csr/json"
+#else
+#define AWS_CERTIFICATE_CREATE_API          "$aws/certificates/create/json"
+#endif
 
 /* Private Constants -------------------------------------------------------- */
 static const char *TAG = "sys/aws_provision";
@@ -37,11 +51,11 @@ static const char *AWS_SUBSCRIBE_TOPIC[AWS_PROVISION_NUM_SUBSCRIBE_TOPIC] =
 {
   "$aws/provisioning-templates/"AWS_TEMPLATE_NAME"/provision/json/accepted",
   "$aws/provisioning-templates/"AWS_TEMPLATE_NAME"/provision/json/rejected",
-  "$aws/certificates/create/json/accepted",
-  "$aws/certificates/create/json/rejected"
+  AWS_CERTIFICATE_CREATE_API"/accepted",
+  AWS_CERTIFICATE_CREATE_API"/rejected"
 };
 
-static const char *AWS_CERTIFICATE_CREATE_TOPIC          = "$aws/certificates/create/json";
+static const char *AWS_CERTIFICATE_CREATE_TOPIC          = AWS_CERTIFICATE_CREATE_API;
 static const char *AWS_REGISTER_THING_TOPIC              = "$aws/provisioning-templates/"AWS_TEMPLATE_NAME"/provision/json";
 
 static const uint8_t aws_root_ca_pem_start[]      asm("_binary_aws_root_ca_pem_start");
@@ -61,6 +75,9 @@ static jsmn_parser  m_json_parser;
 static jsmntok_t    m_json_token_struct[MAX_JSON_TOKEN_EXPECTED];
 static AWS_IoT_Client             m_aws_client;
 static IoT_Publish_Message_Params m_params_publish_msg = { 0 };
+#if (AWS_PROVISION_CSR)
+static mbedtls_pk_context         m_csr_key;
+#endif
 
 /* Public variables --------------------------------------------------------- */
 /* Private function prototypes ---------------------------------------------- */
@@ -70,6 +87,10 @@ static bool m_sys_aws_enable_monitor(void);
 static bool m_sys_aws_get_official_certs(void);
 static bool m_sys_aws_register_thing(char *token, int token_len);
 static bool m_sys_aws_save_certificates(char *p_path, char *p_data, uint16_t data_len);
+#if (AWS_PROVISION_CSR)
+static bool m_sys_aws_create_csr(unsigned char *p_csr, size_t csr_size);
+static bool m_sys_aws_save_private_key(char *p_path);
+#endif
 static void m_sys_aws_disconnect_callback_handler(AWS_IoT_Client *p_client, void *data);
 static void m_sys_aws_subscribe_callback_handler(AWS_IoT_Client             *p_client,
                                                  char                       *topic_name,
@@ -245,9 +266,24 @@ static bool m_sys_aws_get_official_certs(void)
 {
   IoT_Error_t err = FAILURE;
 
+#if (AWS_PROVISION_CSR)
+  unsigned char csr[AWS_PROVISION_CSR_MAX_LEN];
+  char buf[AWS_PROVISION_CSR_MAX_LEN + 100] = "";
+  struct json_out out = JSON_OUT_BUF(buf, sizeof(buf));
+
+  // AWS signs the CSR, the private key stays on the device
+  if (!m_sys_aws_create_csr(csr, sizeof(csr)))
+    return false;
+
+  json_printf(&out, "{certificateSigningRequest: %Q}", (const char *)csr);
+
+  m_params_publish_msg.payload    = (void *)buf;
+  m_params_publish_msg.payloadLen = strlen(buf);
+#else
   const char *payload             = "{}";
   m_params_publish_msg.payload    = (void *)payload;
   m_params_publish_msg.payloadLen = strlen(payload);
+#endif
   m_params_publish_msg.qos        = QOS1;
   m_params_publish_msg.isRetained = 0;
 
@@ -370,9 +406,120 @@ static bool m_sys_aws_save_certificates(char *p_path, char *p_data, uint16_t dat
 
   fclose(fp);
 
+  // Parse the new content on the next connect
+  iot_tls_credential_flush(p_path);
+
   return true;
 }
 
+#if (AWS_PROVISION_CSR)
+/**
+ * @brief         Create a P-256 key and a CSR for it
+ *
+ * @param[in]     p_csr         Pointer to CSR destination, PEM
+ * @param[in]     csr_size      Size of CSR destination
+ *
+ * @attention     Key is kept in RAM until the certificate is saved
+ *
+ * @return
+ *    - true:   Create CSR success
+ *    - false:  Create CSR fail
+ */
+static bool m_sys_aws_create_csr(unsigned char *p_csr, size_t csr_size)
+{
+  mbedtls_entropy_context  entropy;
+  mbedtls_ctr_drbg_context ctr_drbg;
+  mbedtls_x509write_csr    csr;
+  char subject[sizeof(m_provision_params.aws_client_id) + 4];
+  int  ret;
+
+  mbedtls_entropy_init(&entropy);
+  mbedtls_ctr_drbg_init(&ctr_drbg);
+  mbedtls_x509write_csr_init(&csr);
+  mbedtls_pk_free(&m_csr_key);
+  mbedtls_pk_init(&m_csr_key);
+
+  snprintf(subject, sizeof(subject), "CN=%s", m_provision_params.aws_client_id);
+
+  ret = mbedtls_ctr_drbg_seed(&ctr_drbg, mbedtls_entropy_func, &entropy,
+                              (const unsigned char *)TAG, strlen(TAG));
+  if (0 == ret)
+    ret = mbedtls_pk_setup(&m_csr_key, mbedtls_pk_info_from_type(MBEDTLS_PK_ECKEY));
+
+  if (0 == ret)
+    ret = mbedtls_ecp_gen_key(MBEDTLS_ECP_DP_SECP256R1, mbedtls_pk_ec(m_csr_key),
+                              mbedtls_ctr_drbg_random, &ctr_drbg);
+
+  if (0 == ret)
+  {
+    mbedtls_x509write_csr_set_md_alg(&csr, MBEDTLS_MD_SHA256);
+    mbedtls_x509write_csr_set_key(&csr, &m_csr_key);
+    ret = mbedtls_x509write_csr_set_subject_name(&csr, subject);
+  }
+
+  if (0 == ret)
+    ret = mbedtls_x509write_csr_pem(&csr, p_csr, csr_size, mbedtls_ctr_drbg_random, &ctr_drbg);
+
+  mbedtls_x509write_csr_free(&csr);
+  mbedtls_ctr_drbg_free(&ctr_drbg);
+  mbedtls_entropy_free(&entropy);
+
+  if (0 != ret)
+  {
+    ESP_LOGE(TAG, "%s: Create CSR failed: -0x%x", __FUNCTION__, -ret);
+    mbedtls_pk_free(&m_csr_key);
+    mbedtls_pk_init(&m_csr_key);
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * @brief         Save private key of the CSR to SPIFF
+ *
+ * @param[in]     p_path        Pointer to save data destination
+ *
+ * @attention     Key is freed from RAM after saving
+ *
+ * @return
+ *    - true:   Save key success
+ *    - false:  Save key fail
+ */
+static bool m_sys_aws_save_private_key(char *p_path)
+{
+  unsigned char key[AWS_PROVISION_KEY_MAX_LEN];
+  FILE *fp = NULL;
+  int  ret;
+
+  ret = mbedtls_pk_write_key_pem(&m_csr_key, key, sizeof(key));
+  mbedtls_pk_free(&m_csr_key);
+  mbedtls_pk_init(&m_csr_key);
+  if (0 != ret)
+  {
+    ESP_LOGE(TAG, "%s: Write key failed: -0x%x", __FUNCTION__, -ret);
+    return false;
+  }
+
+  unlink(p_path);
+  fp = fopen(p_path, "w+");
+  if (NULL == fp)
+  {
+    ESP_LOGE(TAG, "%s: Open file failed", __FUNCTION__);
+    return false;
+  }
+
+  fputs((const char *)key, fp);
+  fclose(fp);
+  memset(key, 0, sizeof(key));
+
+  // Parse the new content on the next connect
+  iot_tls_credential_flush(p_path);
+
+  return true;
+}
+#endif
+
 /**
  * @brief         AWS subscibe callback handler
  *
@@ -426,6 +573,11 @@ static void m_sys_aws_subscribe_callback_handler(AWS_IoT_Client *p_client,
       m_sys_aws_save_certificates(AWS_OFFICIAL_CERTIFICATE_PATH,
                                   params->payload + json_obs->start,
                                   json_obs->end - json_obs->start);
+
+#if (AWS_PROVISION_CSR)
+      // Certificate is signed for the key of the CSR, the response has no private key
+      m_sys_aws_save_private_key(AWS_OFFICIAL_PRIVATE_KEY_PATH);
+#endif
     }
 
     json_obs = findToken("privateKey", params->payload, m_json_token_struct);
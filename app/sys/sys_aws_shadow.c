@@ -16,6 +16,8 @@
 #include "sys_nvs.h"
 #include "sys_aws.h"
 #include "aws_parser.h"
+#include "bsp_timer.h"
+#include "bsp_error.h"
 
 #include "platform_common.h"
 #include "aws_iot_config.h"
@@ -24,6 +26,9 @@
 #include "aws_iot_mqtt_client_interface.h"
 #include "aws_iot_json_utils.h"
 
+#include <inttypes.h>
+#include <sys/param.h>
+
 #include "frozen.h"
 #include "jsmn.h"
 
@@ -37,7 +42,15 @@ sys_shadow_t;
 /* Private defines ---------------------------------------------------------- */
 #define SHADOW_INFO(_type, _name)[_type] {.name = _name}
 
-#define AWS_MAX_JSON_BUFF         (1000)
+#define AWS_MAX_JSON_BUFF         (1800)  // Any shadow update fits within AWS_IOT_MQTT_TX_BUF_LEN
+#define AWS_SHADOW_FLUSH_MS       (500)   // Changes of this window are sent as one update per shadow
+
+// The accepted reply echoes every error code with a metadata timestamp, it has to fit the shadow RX buffer or it
+// is dropped and the codes are never removed. Replies larger than the MQTT RX buffer are put together by sys_aws.c
+#define AWS_SHADOW_ACCEPTED_MAX   (SHADOW_MAX_SIZE_OF_RX_BUFFER - 1)
+#define AWS_SHADOW_ACCEPTED_SIZE  (280)   // Accepted reply without codes: value, metadata, version, timestamp, client token
+#define AWS_SHADOW_ERROR_CODE_SIZE  (37)  // One code in the accepted reply: ",-2147483648" and ",{"timestamp":1650000000}"
+#define AWS_SHADOW_ERROR_CODE_CNT_MAX ((AWS_SHADOW_ACCEPTED_MAX - AWS_SHADOW_ACCEPTED_SIZE) / AWS_SHADOW_ERROR_CODE_SIZE)
 
 /* Private Constants -------------------------------------------------------- */
 static const char *TAG = "sys/aws_shadow";
@@ -59,10 +72,27 @@ static size_t m_size_json_buffer = sizeof(m_json_buffer) / sizeof(m_json_buffer[
 
 static jsonStruct_t m_json_struct[SYS_SHADOW_MAX];
 
+// Shadows with changes not sent yet, one bit per sys_aws_shadow_name_t. TX task only
+static uint32_t m_shadow_dirty;
+static tmr_t    m_shadow_flush_tmr;
+
+// Error codes in the update waiting for its ack, the oldest ones in NVS, removed when it is accepted
+static volatile uint16_t m_error_code_cnt;
+static uint32_t m_error_code_overwritten;   // bsp_error_overwritten() when the update was built
+
+// Hash of the reported state in the update waiting for its ack, cached when it is accepted
+static volatile uint32_t m_shadow_sent_hash[SYS_SHADOW_MAX];
+
 /* Public variables --------------------------------------------------- */
 /* Private function prototypes ------------------------------- */
 static void m_shadow_json_init(void);
-static void m_shadow_create_json_format(char *json_buffer, sys_aws_shadow_name_t name);
+static bool m_shadow_create_json_format(char *json_buffer, sys_aws_shadow_name_t name);
+
+static sys_aws_shadow_name_t m_shadow_find(const char *p_shadow_name);
+static uint32_t m_shadow_hash(const char *buf, size_t len);
+static bool m_shadow_is_cacheable(sys_aws_shadow_name_t name);
+static bool m_shadow_parse_version(const char *p_received_json, uint32_t *version);
+static void m_shadow_cache_store(sys_aws_shadow_name_t name, uint32_t version, uint32_t hash);
 
 static void m_parse_shadow_get_payload(sys_aws_shadow_name_t name, const char *buf, uint16_t buf_len);
 
@@ -100,6 +130,8 @@ bool sys_aws_shadow_init(void)
   // NOTE: Device will gets status of shadow on AWS first then 
   //       will update new status on AWS even device call shadow update
   //       The value on the AWS is the final value for device
+  //       Updates equal to the last accepted reported state are skipped,
+  //       a get with a different version clears that cache
 
   // Get data from AWS
   sys_aws_shadow_trigger_command(SYS_AWS_SHADOW_CMD_GET, SYS_SHADOW_SCALE_TARE);     // Get data first time
@@ -113,77 +145,171 @@ bool sys_aws_shadow_init(void)
 
 void sys_aws_shadow_trigger_command(sys_aws_shadow_cmd_t cmd, sys_aws_shadow_name_t name)
 {
+  sys_aws_service_t *service;
+
   if (!aws_iot_mqtt_is_client_connected(&g_sys_aws.client))
   {
     ESP_LOGW(TAG, "Aws shadow is not connected !. Update event update to queue");
   }
 
-  g_sys_aws.service.type        = SYS_AWS_SHADOW;
-  g_sys_aws.service.shadow.cmd  = cmd;
-  g_sys_aws.service.shadow.name = name;
-  xQueueSend(g_sys_aws.evt_queue, (void *)&g_sys_aws.service, pdMS_TO_TICKS(100));
+  service = sys_aws_service_reserve(SYS_AWS_LANE_SHADOW);
+  if (service == NULL)
+    return;
+
+  service->type        = SYS_AWS_SHADOW;
+  service->shadow.cmd  = cmd;
+  service->shadow.name = name;
+  sys_aws_service_commit(service);
+}
+
+void sys_aws_shadow_mark_dirty(sys_aws_shadow_name_t name)
+{
+  if (name >= SYS_SHADOW_MAX)
+    return;
+
+  // Start flush window at the first change
+  if (m_shadow_dirty == 0)
+    bsp_tmr_start(&m_shadow_flush_tmr, AWS_SHADOW_FLUSH_MS);
+
+  m_shadow_dirty |= (1UL << name);
+}
+
+void sys_aws_shadow_process(void)
+{
+  if ((m_shadow_dirty != 0) && bsp_tmr_is_expired(&m_shadow_flush_tmr))
+    sys_aws_shadow_flush();
+}
+
+uint32_t sys_aws_shadow_wait_ms(void)
+{
+  if (m_shadow_dirty == 0)
+    return BSP_TMR_FOREVER;
+
+  return bsp_tmr_remaining(&m_shadow_flush_tmr);
+}
+
+void sys_aws_shadow_flush(void)
+{
+  uint32_t dirty = m_shadow_dirty;
+
+  m_shadow_dirty = 0;
+
+  for (uint8_t name = 0; name < SYS_SHADOW_MAX; name++)
+  {
+    if ((dirty & (1UL << name)) && !sys_aws_shadow_update(name))
+      m_shadow_dirty |= (1UL << name);
+  }
+
+  // Shadows that could not be sent are tried again in the next window
+  if (m_shadow_dirty != 0)
+    bsp_tmr_start(&m_shadow_flush_tmr, AWS_SHADOW_FLUSH_MS);
+  else
+    bsp_tmr_stop(&m_shadow_flush_tmr);
 }
 
 bool sys_aws_shadow_update(sys_aws_shadow_name_t name)
 {
   IoT_Error_t err;
+  size_t reported = 0;
+  uint32_t hash = 0;
+
+  if (name == SYS_AWS_ERROR_CODE)
+  {
+    // Codes of the previous update are removed when it is accepted, send them once
+    if (m_error_code_cnt != 0)
+      return false;
+
+    // Codes beyond one chunk go once this one is accepted
+    m_error_code_cnt         = MIN(bsp_error_read_start(), AWS_SHADOW_ERROR_CODE_CNT_MAX);
+    m_error_code_overwritten = bsp_error_overwritten();
+    if (m_error_code_cnt == 0)
+      return true;
+  }
 
   ESP_LOGI(TAG, "Shadow update...");
 
   err = aws_iot_shadow_init_json_document(m_json_buffer, m_size_json_buffer);
-  if (err != SUCCESS)
+
+  if ((err == SUCCESS) && (name == SYS_AWS_ERROR_CODE))
   {
-    ESP_LOGI(TAG, "Shadow init json document error: %s", aws_error_to_name(err));
-    return false;
+    // Error codes are reported only, a desired copy would double them in the accepted reply
+    strcat(m_json_buffer, "\"reported\":");
+    reported = strlen(m_json_buffer);
   }
-
-  err = aws_iot_shadow_add_desired(m_json_buffer, m_size_json_buffer);
-  if (err != SUCCESS)
+  else if (err == SUCCESS)
   {
-    ESP_LOGI(TAG, "Shadow add desired error: %s", aws_error_to_name(err));
-    return false;
+    err = aws_iot_shadow_add_desired(m_json_buffer, m_size_json_buffer);
+
+    if ((err == SUCCESS) && !m_shadow_create_json_format(m_json_buffer, name))
+      err = SHADOW_JSON_BUFFER_TRUNCATED;
+
+    if (err == SUCCESS)
+    {
+      err      = aws_iot_shadow_add_reported(m_json_buffer, m_size_json_buffer);
+      reported = strlen(m_json_buffer);
+    }
   }
 
-  m_shadow_create_json_format(m_json_buffer, name);
+  if ((err == SUCCESS) && !m_shadow_create_json_format(m_json_buffer, name))
+    err = SHADOW_JSON_BUFFER_TRUNCATED;
 
-  err = aws_iot_shadow_add_reported(m_json_buffer, m_size_json_buffer);
-  if (err != SUCCESS)
+  // Compare the reported state with the last one the cloud accepted
+  if ((err == SUCCESS) && m_shadow_is_cacheable(name))
   {
-    ESP_LOGI(TAG, "Shadow add reported error: %s", aws_error_to_name(err));
-    return false;
+    hash = m_shadow_hash(m_json_buffer + reported, strlen(m_json_buffer) - reported);
+
+    if ((g_nvs_setting_data.shadow_cache.version[name] != 0) &&
+        (g_nvs_setting_data.shadow_cache.hash[name] == hash))
+    {
+      ESP_LOGI(TAG, "Shadow %s unchanged since version %" PRIu32 ", update skipped",
+               SHADOW_TABLE[name].name, g_nvs_setting_data.shadow_cache.version[name]);
+      return true;
+    }
   }
 
-  m_shadow_create_json_format(m_json_buffer, name);
+  if (err == SUCCESS)
+    err = aws_iot_finalize_json_document(m_json_buffer, m_size_json_buffer);
 
-  err = aws_iot_finalize_json_document(m_json_buffer, m_size_json_buffer);
   if (err != SUCCESS)
   {
-    ESP_LOGI(TAG, "Shadow finalize json document error: %s", aws_error_to_name(err));
+    ESP_LOGI(TAG, "Shadow json document error: %s", aws_error_to_name(err));
+    if (name == SYS_AWS_ERROR_CODE)
+      m_error_code_cnt = 0;
     return false;
   }
 
   ESP_LOGI(TAG, "Json buffer: %s", m_json_buffer);
 
+  m_shadow_sent_hash[name] = hash;
+
+  // Response is handled by the shadow yield of RX task
+  xSemaphoreTake(g_sys_aws.shadow_lock, portMAX_DELAY);
   err = aws_iot_shadow_update(&g_sys_aws.client, (const char *)g_nvs_setting_data.thing_name,
                               SHADOW_TABLE[name].name, m_json_buffer,
                               m_shadow_update_status_callback,
                               NULL, 4, true);
+  xSemaphoreGive(g_sys_aws.shadow_lock);
   if (err != SUCCESS)
   {
     ESP_LOGI(TAG, "Shadow update error: %s", aws_error_to_name(err));
+    if (name == SYS_AWS_ERROR_CODE)
+      m_error_code_cnt = 0;
     return false;
   }
 
-  CHECK(SUCCESS == aws_iot_shadow_yield(&g_sys_aws.client, 200), false);
-
   return true;
 }
 
 bool sys_aws_shadow_get(sys_aws_shadow_name_t name)
 {
-  IoT_Error_t err = aws_iot_shadow_get(&g_sys_aws.client, (const char *)g_nvs_setting_data.thing_name,
-                                       SHADOW_TABLE[name].name, m_shadow_get_callback,
-                                       NULL, 4, true);
+  IoT_Error_t err;
+
+  // Response is handled by the shadow yield of RX task
+  xSemaphoreTake(g_sys_aws.shadow_lock, portMAX_DELAY);
+  err = aws_iot_shadow_get(&g_sys_aws.client, (const char *)g_nvs_setting_data.thing_name,
+                           SHADOW_TABLE[name].name, m_shadow_get_callback,
+                           NULL, 4, true);
+  xSemaphoreGive(g_sys_aws.shadow_lock);
   if (err != SUCCESS)
   {
     ESP_LOGI(TAG, "Shadow get error: %s", aws_error_to_name(err));
@@ -200,33 +326,48 @@ bool sys_aws_shadow_get(sys_aws_shadow_name_t name)
  * @param[in]     json_buffer     Pointer to json buffer
  * @param[in]     name            Shadow name
  *
- * @attention     None
+ * @attention     Error codes are the oldest m_error_code_cnt codes in NVS
  *
- * @return        None
+ * @return
+ *  - true:   Json is appended
+ *  - false:  Json buffer is too small
  */
-static void m_shadow_create_json_format(char *json_buffer, sys_aws_shadow_name_t name)
+static bool m_shadow_create_json_format(char *json_buffer, sys_aws_shadow_name_t name)
 {
-  char buf[AWS_MAX_JSON_BUFF];
-  struct json_out out = JSON_OUT_BUF(buf, sizeof(buf));
+  size_t len = strlen(json_buffer);
+  struct json_out out = JSON_OUT_BUF(json_buffer + len, AWS_MAX_JSON_BUFF - len);
+  int out_len = 0;
 
   // Create json format
   switch (name)
   {
   case SYS_SHADOW_FIRMWARE_ID:
   {
-    json_printf(&out, "{data:{fw: %Q}}", DEVICE_FIRMWARE_VERSION);
+    out_len = json_printf(&out, "{data:{fw: %Q}}", DEVICE_FIRMWARE_VERSION);
     break;
   }
 
   case SYS_SHADOW_SCALE_TARE:
   {
-    json_printf(&out, "{data:{scare_tare: %d}}",  g_nvs_setting_data.properties.scale_tare);
+    out_len = json_printf(&out, "{data:{scare_tare: %d}}",  g_nvs_setting_data.properties.scale_tare);
     break;
   }
 
   case SYS_AWS_ERROR_CODE:
   {
-    json_printf(&out, "{value: %d}", g_nvs_setting_data.bsp_error.err_code);
+    uint32_t code[BSP_ERROR_CNT_MAX];
+    uint16_t cnt = (m_error_code_cnt < BSP_ERROR_CNT_MAX) ? m_error_code_cnt : BSP_ERROR_CNT_MAX;
+
+    bsp_error_read_start();
+    for (uint16_t i = 0; i < cnt; i++)
+      code[i] = bsp_error_read();
+
+    // Oldest codes go first, value keeps the newest of the update as when they were sent one by one
+    g_nvs_setting_data.bsp_error.err_code = code[cnt - 1];
+    out_len = json_printf(&out, "{value: %d, codes: [", g_nvs_setting_data.bsp_error.err_code);
+    for (uint16_t i = 0; i < cnt; i++)
+      out_len += json_printf(&out, (i == 0) ? "%d" : ", %d", (int)code[i]);
+    out_len += json_printf(&out, "]}");
     break;
   }
 
@@ -234,7 +375,124 @@ static void m_shadow_create_json_format(char *json_buffer, sys_aws_shadow_name_t
     break;
   }
 
-  snprintf(json_buffer + strlen(json_buffer), AWS_MAX_JSON_BUFF, buf);
+  return ((size_t)out_len < AWS_MAX_JSON_BUFF - len);
+}
+
+/**
+ * @brief         AWS shadow find the shadow of a name received from AWS
+ *
+ * @param[in]     p_shadow_name   Pointer to shadow name
+ *
+ * @attention     None
+ *
+ * @return        Shadow name, SYS_SHADOW_MAX if it is unknown
+ */
+static sys_aws_shadow_name_t m_shadow_find(const char *p_shadow_name)
+{
+  for (uint8_t i = 0; i < SYS_SHADOW_MAX; i++)
+  {
+    if (0 == strcmp(p_shadow_name, SHADOW_TABLE[i].name))
+      return (sys_aws_shadow_name_t)i;
+  }
+
+  return SYS_SHADOW_MAX;
+}
+
+/**
+ * @brief         AWS shadow hash of a reported state, 32-bit FNV-1a
+ *
+ * @param[in]     buf       Pointer to reported state
+ * @param[in]     len       Reported state length
+ *
+ * @attention     None
+ *
+ * @return        Hash
+ */
+static uint32_t m_shadow_hash(const char *buf, size_t len)
+{
+  uint32_t hash = 2166136261UL;
+
+  for (size_t i = 0; i < len; i++)
+  {
+    hash ^= (uint8_t)buf[i];
+    hash *= 16777619UL;
+  }
+
+  return hash;
+}
+
+/**
+ * @brief         AWS shadow check if the reported state of a shadow is cached
+ *
+ * @param[in]     name      Shadow name
+ *
+ * @attention     Error codes are new on every update, they are never cached
+ *
+ * @return
+ *  - true:   Shadow is cached
+ *  - false:  Shadow is always sent
+ */
+static bool m_shadow_is_cacheable(sys_aws_shadow_name_t name)
+{
+  return (name < SYS_NVS_SHADOW_CACHE_MAX) && (name != SYS_AWS_ERROR_CODE);
+}
+
+/**
+ * @brief         AWS shadow parse the version of a shadow document
+ *
+ * @param[in]     p_received_json   Pointer to received json
+ * @param[out]    version           Shadow version
+ *
+ * @attention     None
+ *
+ * @return
+ *  - true:   Version is found
+ *  - false:  Document has no version
+ */
+static bool m_shadow_parse_version(const char *p_received_json, uint32_t *version)
+{
+  jsmntok_t   *json_obs;
+  jsmn_parser json_parser;
+  jsmntok_t   json_token_struct[MAX_JSON_TOKEN_EXPECTED];
+
+  jsmn_init(&json_parser);
+  if (jsmn_parse(&json_parser,
+                 p_received_json,
+                 (int)strlen(p_received_json),
+                 json_token_struct,
+                 sizeof(json_token_struct) / sizeof(json_token_struct[0])) <= 0)
+    return false;
+
+  json_obs = findToken("version", p_received_json, json_token_struct);
+  if (json_obs == NULL)
+    return false;
+
+  return (parseUnsignedInteger32Value(version, p_received_json, json_obs) == SUCCESS);
+}
+
+/**
+ * @brief         AWS shadow store the reported state the cloud holds for a shadow
+ *
+ * @param[in]     name      Shadow name
+ * @param[in]     version   Shadow version, 0 drops the cached state
+ * @param[in]     hash      Hash of the reported state
+ *
+ * @attention     NVS is written only when the cache changes
+ *
+ * @return        None
+ */
+static void m_shadow_cache_store(sys_aws_shadow_name_t name, uint32_t version, uint32_t hash)
+{
+  if (!m_shadow_is_cacheable(name))
+    return;
+
+  if ((g_nvs_setting_data.shadow_cache.version[name] == version) &&
+      (g_nvs_setting_data.shadow_cache.hash[name] == hash))
+    return;
+
+  g_nvs_setting_data.shadow_cache.version[name] = version;
+  g_nvs_setting_data.shadow_cache.hash[name]    = hash;
+  SYS_NVS_STORE(shadow_cache);
 }
 
 /**
@@ -300,13 +558,28 @@ static void m_shadow_get_callback(const char          *p_thing_name,
                                   void                *p_context_data)
 {
   IOT_UNUSED(p_thing_name);
-  IOT_UNUSED(p_shadow_name);
   IOT_UNUSED(action);
   IOT_UNUSED(p_context_data);
 
   jsmntok_t   *json_obs;
   jsmn_parser json_parser;
   jsmntok_t   json_token_struct[MAX_JSON_TOKEN_EXPECTED];
+  sys_aws_shadow_name_t name = m_shadow_find(p_shadow_name);
+  uint32_t version = 0;
+
+  // Shadow changed in the cloud or was deleted since the last accepted update, report it again
+  if (m_shadow_is_cacheable(name) && (g_nvs_setting_data.shadow_cache.version[name] != 0))
+  {
+    if ((status != SHADOW_ACK_ACCEPTED) ||
+        !m_shadow_parse_version(p_received_json, &version) ||
+        (version != g_nvs_setting_data.shadow_cache.version[name]))
+    {
+      ESP_LOGW(TAG, "Shadow %s version %" PRIu32 ", cached %" PRIu32, p_shadow_name, version,
+               g_nvs_setting_data.shadow_cache.version[name]);
+      m_shadow_cache_store(name, 0, 0);
+      sys_aws_shadow_trigger_command(SYS_AWS_SHADOW_CMD_SET, name);
+    }
+  }
 
   // Json parse data that contains desired and reported value
   jsmn_init(&json_parser);
@@ -322,13 +595,8 @@ static void m_shadow_get_callback(const char          *p_thing_name,
     ESP_LOGI(TAG, "Shadow get callback");
     printf("Payload: %.*s\n", json_obs->end - json_obs->start, p_received_json + json_obs->start);
 
-    for (uint16_t i = 0; i < SYS_SHADOW_MAX; i++)
-    {
-      if (0 == strcmp(p_shadow_name, SHADOW_TABLE[i].name))
-      {
-        m_parse_shadow_get_payload(i, p_received_json + json_obs->start, json_obs->end - json_obs->start);
-      }
-    }
+    if (name < SYS_SHADOW_MAX)
+      m_parse_shadow_get_payload(name, p_received_json + json_obs->start, json_obs->end - json_obs->start);
   }
 }
 
@@ -384,11 +652,12 @@ static void m_shadow_update_status_callback(const char          *p_thing_name,
                                             void                *p_context_data)
 {
   IOT_UNUSED(p_thing_name);
-  IOT_UNUSED(p_shadow_name);
   IOT_UNUSED(action);
-  IOT_UNUSED(p_received_json);
   IOT_UNUSED(p_context_data);
 
+  sys_aws_shadow_name_t name = m_shadow_find(p_shadow_name);
+  uint32_t version = 0;
+
   switch (status)
   {
   case SHADOW_ACK_TIMEOUT:
@@ -406,18 +675,32 @@ static void m_shadow_update_status_callback(const char          *p_thing_name,
   {
     ESP_LOGI(TAG, "Update accepted");
 
-    // Delete error code have been sent out
-    if (memcmp(p_shadow_name, SHADOW_TABLE[SYS_AWS_ERROR_CODE].name, strlen(SHADOW_TABLE[SYS_AWS_ERROR_CODE].name)) == 0)
+    // Delete error codes have been sent out, less those new codes overwrote while waiting for the ack
+    if (name == SYS_AWS_ERROR_CODE)
+    {
+      uint32_t gone = bsp_error_overwritten() - m_error_code_overwritten;
+      uint16_t cnt  = (gone < m_error_code_cnt) ? (uint16_t)(m_error_code_cnt - gone) : 0;
+
+      ESP_LOGW(TAG, "Delete %d error codes", cnt);
+      bsp_error_remove(cnt);
+
+      // Next chunk is sent by the TX task
+      if (bsp_error_read_start() != 0)
+        sys_aws_shadow_trigger_command(SYS_AWS_SHADOW_CMD_SET, SYS_AWS_ERROR_CODE);
+    }
+    else if (m_shadow_is_cacheable(name) && m_shadow_parse_version(p_received_json, &version))
     {
-      ESP_LOGW(TAG, "Delete error code: %d",
-               g_nvs_setting_data.bsp_error.nvs.code[g_nvs_setting_data.bsp_error.nvs.err_cnt - 1]);
-      bsp_error_remove();
+      m_shadow_cache_store(name, version, m_shadow_sent_hash[name]);
     }
     break;
   }
   default:
     break;
   }
+
+  // Codes not accepted stay in NVS and go with the next error code update
+  if (name == SYS_AWS_ERROR_CODE)
+    m_error_code_cnt = 0;
 }
 
 /* End of file -------------------------------------------------------------- */
@@ -71,14 +71,58 @@ bool sys_aws_shadow_init(void);
 void sys_aws_shadow_trigger_command(sys_aws_shadow_cmd_t cmd, sys_aws_shadow_name_t name);
 
 /**
- * @brief         AWS shadow update
+ * @brief         AWS shadow mark a shadow as changed, it is sent with the next flush
  *
  * @param[in]     name     Shadow name
  *
+ * @attention     TX task only
+ *
+ * @return        None
+ */
+void sys_aws_shadow_mark_dirty(sys_aws_shadow_name_t name);
+
+/**
+ * @brief         AWS shadow send changed shadows when the flush window is expired
+ *
+ * @param[in]     None
+ *
+ * @attention     TX task only
+ *
+ * @return        None
+ */
+void sys_aws_shadow_process(void);
+
+/**
+ * @brief         AWS shadow get time until changed shadows must be sent
+ *
+ * @param[in]     None
+ *
  * @attention     None
  *
+ * @return        Time in ms, BSP_TMR_FOREVER if no shadow is changed
+ */
+uint32_t sys_aws_shadow_wait_ms(void);
+
+/**
+ * @brief         AWS shadow send one update for each changed shadow
+ *
+ * @param[in]     None
+ *
+ * @attention     TX task only. Shadows that are not sent stay changed
+ *
+ * @return        None
+ */
+void sys_aws_shadow_flush(void);
+
+/**
+ * @brief         AWS shadow update
+ *
+ * @param[in]     name     Shadow name
+ *
+ * @attention     Nothing is sent when the reported state equals the last accepted one cached in NVS
+ *
  * @return
- *  - true:   Update success
+ *  - true:   Update success or skipped
  *  - false:  Update failed
  */
 bool sys_aws_shadow_update(sys_aws_shadow_name_t name);
@@ -0,0 +1,344 @@
+/**
+ * @file       sys_aws_spool.c
+ * @copyright  Copyright (C) 2020 Hydratech. All rights reserved.
+ * @license    This project is released under the Hydratech License.
+ * @version    1.0.0
+ * @date       2022-04-12
+ * @author     Thuan Le
+ * @brief      System file to store notifications in SPIFFS while AWS is offline
+ *             and forward them once it is connected again
+ * @note       Log is append-only and holds fixed size records protected by CRC.
+ *             Read offset is kept in two checkpoint files written in turn, so a
+ *             reset while writing one of them still leaves the other one valid.
+ *             A record can be sent twice after a reset, but it is never lost.
+ * @example    None
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "sys_aws_spool.h"
+#include "sys_aws_mqtt.h"
+#include "sys_aws.h"
+#include "bsp_timer.h"
+#include "esp_rom_crc.h"
+#include <stddef.h>
+#include <sys/stat.h>
+
+/* Private defines ---------------------------------------------------- */
+#define AWS_SPOOL_LOG_FILE            "/spiffs/aws_spool.log"
+#define AWS_SPOOL_CKP_FILE_A          "/spiffs/aws_spool_a.ckp"
+#define AWS_SPOOL_CKP_FILE_B          "/spiffs/aws_spool_b.ckp"
+
+#define AWS_SPOOL_SIZE_MAX            (64 * 1024) // Log size max, 1/4 of storage partition
+#define AWS_SPOOL_DRAIN_INTERVAL_MS   (1000)      // Min time between two forwarded batches
+
+/* Private enumerate/structure ---------------------------------------- */
+/**
+ * @brief Log record
+ */
+typedef struct
+{
+  uint32_t crc;
+  aws_noti_param_t noti;
+}
+aws_spool_record_t;
+
+/**
+ * @brief Checkpoint
+ */
+typedef struct
+{
+  uint32_t seq;       // Incremented on every write, the highest valid one wins
+  uint32_t offset;    // Offset of the first record not forwarded yet
+  uint32_t crc;
+}
+aws_spool_ckp_t;
+
+/* Private macros ----------------------------------------------------- */
+#define AWS_SPOOL_CRC(_p, _len)       esp_rom_crc32_le(0, (const uint8_t *)(_p), (_len))
+
+/* Public variables --------------------------------------------------- */
+/* Private variables -------------------------------------------------- */
+static const char *TAG = "sys_aws_spool";
+
+static const char *AWS_SPOOL_CKP_FILE[] =
+{
+  AWS_SPOOL_CKP_FILE_A,
+  AWS_SPOOL_CKP_FILE_B
+};
+
+static struct
+{
+  SemaphoreHandle_t lock;
+  aws_spool_ckp_t ckp;
+  uint32_t end;                                   // Offset after the last complete record
+  tmr_t drain_tmr;
+  aws_noti_param_t noti[AWS_NOTI_BATCH_SIZE_MAX];
+}
+m_spool;
+
+/* Private function prototypes ---------------------------------------- */
+static void m_sys_aws_spool_load_ckp(void);
+static bool m_sys_aws_spool_save_ckp(uint32_t offset);
+static uint8_t m_sys_aws_spool_read(uint32_t *offset);
+static void m_sys_aws_spool_reset(void);
+
+/* Function definitions ----------------------------------------------- */
+void sys_aws_spool_init(void)
+{
+  struct stat st;
+
+  m_spool.lock = xSemaphoreCreateMutex();
+
+  m_sys_aws_spool_load_ckp();
+
+  // A partial record at the end is left by a reset while appending, it is overwritten by the next append
+  if (stat(AWS_SPOOL_LOG_FILE, &st) == 0)
+    m_spool.end = (st.st_size / sizeof(aws_spool_record_t)) * sizeof(aws_spool_record_t);
+  else
+    m_spool.end = 0;
+
+  if (m_spool.ckp.offset >= m_spool.end)
+    m_sys_aws_spool_reset();
+
+  ESP_LOGI(TAG, "Pending notifications: %d", (int)((m_spool.end - m_spool.ckp.offset) / sizeof(aws_spool_record_t)));
+}
+
+bool sys_aws_spool_append(aws_noti_param_t *noti)
+{
+  aws_spool_record_t record;
+  FILE *f;
+  bool ret = false;
+
+  CHECK(m_spool.lock != NULL, false);
+
+  xSemaphoreTake(m_spool.lock, portMAX_DELAY);
+
+  if (m_spool.end + sizeof(record) > AWS_SPOOL_SIZE_MAX)
+  {
+    ESP_LOGW(TAG, "Spool is full, notification is dropped");
+    goto _exit;
+  }
+
+  memcpy(&record.noti, noti, sizeof(record.noti));
+  record.crc = AWS_SPOOL_CRC(&record.noti, sizeof(record.noti));
+
+  f = fopen(AWS_SPOOL_LOG_FILE, (m_spool.end == 0) ? "wb" : "r+b");
+  if (f == NULL)
+  {
+    ESP_LOGE(TAG, "Open log failed");
+    goto _exit;
+  }
+
+  if ((fseek(f, m_spool.end, SEEK_SET) == 0) && (fwrite(&record, sizeof(record), 1, f) == 1))
+  {
+    m_spool.end += sizeof(record);
+    ret = true;
+  }
+  fclose(f);
+
+_exit:
+  xSemaphoreGive(m_spool.lock);
+
+  // Start draining now rather than after the TX task's next deadline
+  if (ret && aws_iot_mqtt_is_client_connected(&g_sys_aws.client))
+    sys_aws_wakeup();
+
+  return ret;
+}
+
+bool sys_aws_spool_is_empty(void)
+{
+  bool empty;
+
+  if (m_spool.lock == NULL)
+    return true;
+
+  xSemaphoreTake(m_spool.lock, portMAX_DELAY);
+  empty = (m_spool.ckp.offset >= m_spool.end);
+  xSemaphoreGive(m_spool.lock);
+
+  return empty;
+}
+
+void sys_aws_spool_process(void)
+{
+  uint32_t offset;
+  uint8_t count;
+
+  if (sys_aws_spool_is_empty())
+    return;
+
+  if ((m_spool.drain_tmr.interval != 0) && !bsp_tmr_is_expired(&m_spool.drain_tmr))
+    return;
+
+  bsp_tmr_start(&m_spool.drain_tmr, AWS_SPOOL_DRAIN_INTERVAL_MS);
+
+  // Appends may run while publishing, they only move m_spool.end forward
+  xSemaphoreTake(m_spool.lock, portMAX_DELAY);
+  offset = m_spool.ckp.offset;
+  count  = m_sys_aws_spool_read(&offset);
+  xSemaphoreGive(m_spool.lock);
+
+  if ((count != 0) && !sys_aws_mqtt_publish_batch(m_spool.noti, count))
+    return;
+
+  xSemaphoreTake(m_spool.lock, portMAX_DELAY);
+
+  if (offset >= m_spool.end)
+    m_sys_aws_spool_reset();
+  else
+    m_sys_aws_spool_save_ckp(offset);
+
+  xSemaphoreGive(m_spool.lock);
+
+  ESP_LOGI(TAG, "Forwarded %d, pending %d", count, (int)((m_spool.end - m_spool.ckp.offset) / sizeof(aws_spool_record_t)));
+}
+
+uint32_t sys_aws_spool_wait_ms(void)
+{
+  if (sys_aws_spool_is_empty())
+    return BSP_TMR_FOREVER;
+
+  if (m_spool.drain_tmr.interval == 0)
+    return 0;
+
+  return bsp_tmr_remaining(&m_spool.drain_tmr);
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief         Load the newest valid checkpoint
+ *
+ * @param[in]     None
+ *
+ * @attention     None
+ *
+ * @return        None
+ */
+static void m_sys_aws_spool_load_ckp(void)
+{
+  aws_spool_ckp_t ckp;
+  FILE *f;
+
+  memset(&m_spool.ckp, 0, sizeof(m_spool.ckp));
+
+  for (uint8_t i = 0; i < sizeof(AWS_SPOOL_CKP_FILE) / sizeof(AWS_SPOOL_CKP_FILE[0]); i++)
+  {
+    f = fopen(AWS_SPOOL_CKP_FILE[i], "rb");
+    if (f == NULL)
+      continue;
+
+    if ((fread(&ckp, sizeof(ckp), 1, f) == 1) &&
+        (ckp.crc == AWS_SPOOL_CRC(&ckp, offsetof(aws_spool_ckp_t, crc))) &&
+        (ckp.seq >= m_spool.ckp.seq))
+    {
+      memcpy(&m_spool.ckp, &ckp, sizeof(ckp));
+    }
+
+    fclose(f);
+  }
+}
+
+/**
+ * @brief         Save checkpoint to the file not holding the newest one
+ *
+ * @param[in]     offset    Offset of the first record not forwarded yet
+ *
+ * @attention     None
+ *
+ * @return
+ *  - true:   Success
+ *  - false:  SPIFFS error, checkpoint is kept in RAM
+ */
+static bool m_sys_aws_spool_save_ckp(uint32_t offset)
+{
+  FILE *f;
+  bool ret;
+
+  m_spool.ckp.seq++;
+  m_spool.ckp.offset = offset;
+  m_spool.ckp.crc    = AWS_SPOOL_CRC(&m_spool.ckp, offsetof(aws_spool_ckp_t, crc));
+
+  f = fopen(AWS_SPOOL_CKP_FILE[m_spool.ckp.seq & 1], "wb");
+  CHECK(f != NULL, false);
+
+  ret = (fwrite(&m_spool.ckp, sizeof(m_spool.ckp), 1, f) == 1);
+  fclose(f);
+
+  return ret;
+}
+
+/**
+ * @brief         Read a batch of records into m_spool.noti
+ *
+ * @param[in,out] offset    Offset to read from, moved after the last record read
+ *
+ * @attention     Corrupted records are skipped. An alarm is always read alone, so it is
+ *                forwarded through the QoS1 path of sys_aws_mqtt_publish_batch.
+ *
+ * @return        Number of notifications read
+ */
+static uint8_t m_sys_aws_spool_read(uint32_t *offset)
+{
+  aws_spool_record_t record;
+  uint8_t count = 0;
+  FILE *f;
+
+  f = fopen(AWS_SPOOL_LOG_FILE, "rb");
+  CHECK(f != NULL, 0);
+
+  if (fseek(f, *offset, SEEK_SET) != 0)
+  {
+    fclose(f);
+    return 0;
+  }
+
+  while ((count < AWS_NOTI_BATCH_SIZE_MAX) && (*offset < m_spool.end))
+  {
+    if (fread(&record, sizeof(record), 1, f) != 1)
+      break;
+
+    if (record.crc != AWS_SPOOL_CRC(&record.noti, sizeof(record.noti)))
+    {
+      ESP_LOGW(TAG, "Corrupted record is skipped");
+      *offset += sizeof(record);
+      continue;
+    }
+
+    // An alarm is read alone, the batch before it stops there
+    if ((record.noti.noti_type == AWS_NOTI_ALARM) && (count != 0))
+      break;
+
+    *offset += sizeof(record);
+    memcpy(&m_spool.noti[count++], &record.noti, sizeof(record.noti));
+
+    if (record.noti.noti_type == AWS_NOTI_ALARM)
+      break;
+  }
+
+  fclose(f);
+
+  return count;
+}
+
+/**
+ * @brief         Remove log and checkpoints once everything is forwarded
+ *
+ * @param[in]     None
+ *
+ * @attention     None
+ *
+ * @return        None
+ */
+static void m_sys_aws_spool_reset(void)
+{
+  // Remove log first, a reset in between leaves checkpoints pointing past an empty log
+  remove(AWS_SPOOL_LOG_FILE);
+  remove(AWS_SPOOL_CKP_FILE_A);
+  remove(AWS_SPOOL_CKP_FILE_B);
+
+  memset(&m_spool.ckp, 0, sizeof(m_spool.ckp));
+  m_spool.end = 0;
+}
+
+/* End of file -------------------------------------------------------- */
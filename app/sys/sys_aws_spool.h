@@ -0,0 +1,90 @@
+/**
+ * @file       sys_aws_spool.h
+ * @copyright  Copyright (C) 2020 Hydratech. All rights reserved.
+ * @license    This project is released under the Hydratech License.
+ * @version    1.0.0
+ * @date       2022-04-12
+ * @author     Thuan Le
+ * @brief      System file to store notifications in SPIFFS while AWS is offline
+ *             and forward them once it is connected again
+ * @note       None
+ * @example    None
+ */
+
+/* Define to prevent recursive inclusion ------------------------------ */
+#ifndef __SYS_AWS_SPOOL_H
+#define __SYS_AWS_SPOOL_H
+
+/* Includes ----------------------------------------------------------- */
+#include "platform_common.h"
+#include "aws_builder.h"
+
+/* Public defines ----------------------------------------------------- */
+/* Public enumerate/structure ----------------------------------------- */
+/* Public macros ------------------------------------------------------ */
+/* Public variables --------------------------------------------------- */
+/* Public function prototypes ----------------------------------------- */
+/**
+ * @brief         AWS spool init, recover log and checkpoint from SPIFFS
+ *
+ * @param[in]     None
+ *
+ * @attention     SPIFFS must be mounted before
+ *
+ * @return        None
+ */
+void sys_aws_spool_init(void);
+
+/**
+ * @brief         AWS spool append notification to log
+ *
+ * @param[in]     noti    Pointer to notification param
+ *
+ * @attention     Safe to call from any task
+ *
+ * @return
+ *  - true:   Notification is stored
+ *  - false:  Log is full or SPIFFS error
+ */
+bool sys_aws_spool_append(aws_noti_param_t *noti);
+
+/**
+ * @brief         AWS spool check if there is any notification not forwarded yet
+ *
+ * @param[in]     None
+ *
+ * @attention     New notifications must be spooled while this is false to keep their order
+ *
+ * @return
+ *  - true:   Log is empty
+ *  - false:  Log has pending notifications
+ */
+bool sys_aws_spool_is_empty(void);
+
+/**
+ * @brief         AWS spool forward pending notifications
+ *
+ * @param[in]     None
+ *
+ * @attention     Called by TX task while connected. At most one batch is published
+ *                per AWS_SPOOL_DRAIN_INTERVAL_MS and the checkpoint moves only after
+ *                the batch is published.
+ *
+ * @return        None
+ */
+void sys_aws_spool_process(void);
+
+/**
+ * @brief         AWS spool get time until the next batch can be forwarded
+ *
+ * @param[in]     None
+ *
+ * @attention     None
+ *
+ * @return        Time in ms, BSP_TMR_FOREVER if the spool is empty
+ */
+uint32_t sys_aws_spool_wait_ms(void);
+
+#endif // __SYS_AWS_SPOOL_H
+
+/* End of file -------------------------------------------------------- */
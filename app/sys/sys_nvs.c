@@ -51,6 +51,8 @@ const nvs_key_data_t nvs_data_list[] =
   , NVS_DATA_PAIR("0007", soft_ap)
   , NVS_DATA_PAIR("0008", properties)
   , NVS_DATA_PAIR("0009", bsp_error)
+  , NVS_DATA_PAIR("0010", mqtt_session)
+  , NVS_DATA_PAIR("0011", shadow_cache)
 };
 
 /* Private macros ----------------------------------------------------- */
@@ -71,6 +73,14 @@ void sys_nvs_reset_data(void)
   g_nvs_setting_data.properties.transmit_delay = 5;
   g_nvs_setting_data.properties.offline_cnt    = 0;
   g_nvs_setting_data.properties.scale_tare     = 0;
+  g_nvs_setting_data.properties.batch_size     = 1;
+  g_nvs_setting_data.properties.batch_interval = 60;
+
+  g_nvs_setting_data.properties.report.deadband_weight  = 5;
+  g_nvs_setting_data.properties.report.deadband_temp    = 1;
+  g_nvs_setting_data.properties.report.deadband_battery = 2;
+  g_nvs_setting_data.properties.report.min_interval     = 10;
+  g_nvs_setting_data.properties.report.max_interval     = 3600;
   
   memset(&g_nvs_setting_data.wifi, 0, sizeof(g_nvs_setting_data.wifi));
 
@@ -80,6 +90,10 @@ void sys_nvs_reset_data(void)
   sprintf(g_nvs_setting_data.soft_ap.pwd, "%s", ESP_WIFI_PASS_DEFAULT_AP);
   
   memset(&g_nvs_setting_data.bsp_error, 0, sizeof(g_nvs_setting_data.bsp_error));
+
+  memset(&g_nvs_setting_data.mqtt_session, 0, sizeof(g_nvs_setting_data.mqtt_session));
+
+  memset(&g_nvs_setting_data.shadow_cache, 0, sizeof(g_nvs_setting_data.shadow_cache));
 }
 
 void sys_nvs_init(void)
@@ -22,7 +22,10 @@
 /* Public defines ----------------------------------------------------- */
 // IMPORTANT: The revision of nvs_data_t. Everytime nvs_data_t is changed, 
 // the NVS_DATA_VERSION value must be updated too.
-#define NVS_DATA_VERSION    (uint32_t)(0x000000A6)
+#define NVS_DATA_VERSION    (uint32_t)(0x000000AB)
+
+#define SYS_NVS_MQTT_SESSION_MAX  (16)  // Max subscriptions recorded for the persistent MQTT session
+#define SYS_NVS_SHADOW_CACHE_MAX  (4)   // Max shadows with a cached reported state, indexed by sys_aws_shadow_name_t
 
 /* Public enumerate/structure ----------------------------------------- */
 typedef struct nvs_data_struct
@@ -69,10 +72,36 @@ typedef struct nvs_data_struct
     uint16_t transmit_delay;
     uint16_t offline_cnt;
     uint16_t scale_tare;
+    uint16_t batch_size;      // Number of device data samples per publish, 1 means no batching
+    uint16_t batch_interval;  // Max time in seconds a sample waits in batch, 0 means no time limit
+
+    struct
+    {
+      uint16_t deadband_weight;   // Min change of weight to be reported, 0 means any change
+      uint16_t deadband_temp;     // Min change of temperature to be reported, 0 means any change
+      uint16_t deadband_battery;  // Min change of battery to be reported, 0 means any change
+      uint16_t min_interval;      // Min time in seconds between two reports
+      uint16_t max_interval;      // Heartbeat, max time in seconds between two reports, 0 means no heartbeat
+    }
+    report;
   }
   properties;
 
   bsp_error_t bsp_error;
+
+  struct
+  {
+    uint16_t count;                             // Number of recorded subscriptions
+    uint32_t hash[SYS_NVS_MQTT_SESSION_MAX];    // Subscriptions held by the broker session, see aws_iot_mqtt_get_session_record
+  }
+  mqtt_session;
+
+  struct
+  {
+    uint32_t version[SYS_NVS_SHADOW_CACHE_MAX];   // Shadow version of the last accepted update, 0 means nothing cached
+    uint32_t hash[SYS_NVS_SHADOW_CACHE_MAX];      // Hash of the reported state of that update
+  }
+  shadow_cache;
 }
 nvs_data_t;
 
@@ -0,0 +1,293 @@
+/**
+ * @file       sys_sched.c
+ * @copyright  Copyright (C) 2020 Hydratech. All rights reserved.
+ * @license    This project is released under the Hydratech License.
+ * @version    1.0.0
+ * @date       2022-04-16
+ * @author     Thuan Le
+ * @brief      System file to run periodic jobs from one cooperative scheduler
+ * @note       The scheduler task blocks on its event queue until the nearest job
+ *             deadline, so the idle task can put the CPU into light sleep in between.
+ * @example    None
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "sys_sched.h"
+#include "sys_time.h"
+#include "sys_telemetry.h"
+#include "sys_aws.h"
+#include "bsp.h"
+
+#if (CONFIG_PM_ENABLE)
+#include "esp_pm.h"
+#endif
+
+/* Private defines ---------------------------------------------------- */
+#define SYS_SCHED_EVT_QUEUE_SIZE      (8)
+#define SYS_SCHED_WAIT_MAX_MS         (ONE_HOUR)   // Max time to block when no job is armed
+
+/* Private enumerate/structure ---------------------------------------- */
+/**
+ * @brief Scheduler event type enum
+ */
+typedef enum
+{
+   SYS_SCHED_EVT_TRIGGER
+  ,SYS_SCHED_EVT_SET_PERIOD
+}
+sys_sched_evt_type_t;
+
+/**
+ * @brief Scheduler event
+ */
+typedef struct
+{
+  sys_sched_evt_type_t type;
+  sys_sched_job_t job;
+  uint32_t period_ms;
+}
+sys_sched_evt_t;
+
+/**
+ * @brief Scheduler job info
+ */
+typedef struct
+{
+  const char *name;
+  void (*handler)(void);
+  uint32_t first_ms;          // Delay of first run after init
+  uint32_t period_ms;         // Default period, 0 means run only when triggered
+}
+sys_sched_job_info_t;
+
+/* Private macros ----------------------------------------------------- */
+/* Public variables --------------------------------------------------- */
+/* Private function prototypes ---------------------------------------- */
+static void m_sys_sched_error_log_job(void);
+static void m_sys_sched_shadow_sync_job(void);
+static void m_sys_sched_handle_event(sys_sched_evt_t *evt);
+static void m_sys_sched_arm(sys_sched_job_t job, uint32_t delay_ms);
+static uint32_t m_sys_sched_next_wait_ms(void);
+
+/* Private variables -------------------------------------------------- */
+static const char *TAG = "sys_sched";
+
+#define INFO(_i, _n, _h, _first, _period)[_i] = { .name = _n, .handler = _h, .first_ms = _first, .period_ms = _period }
+static const sys_sched_job_info_t SYS_SCHED_JOB[] =
+{
+  //    +===============================+===============+===============================+===================+===================+
+  //    | ID                            | Name          | Handler                       | First run (ms)    | Period (ms)       |
+  //    +-------------------------------+---------------+-------------------------------+-------------------+-------------------+
+   INFO ( SYS_SCHED_JOB_TELEMETRY       , "telemetry"   , sys_telemetry_sample          , 55 * ONE_SECOND   , 55 * ONE_SECOND   )
+  ,INFO ( SYS_SCHED_JOB_NTP             , "ntp"         , sys_time_sync                 , ONE_SECOND        , NTP_SYNC_INTEVAL_MS )
+  ,INFO ( SYS_SCHED_JOB_ERROR_LOG       , "error_log"   , m_sys_sched_error_log_job     , ONE_HOUR          , ONE_HOUR          )
+  ,INFO ( SYS_SCHED_JOB_SHADOW_SYNC     , "shadow_sync" , m_sys_sched_shadow_sync_job   , ONE_HOUR          , ONE_HOUR          )
+  //    +===============================+===============+===============================+===================+===================+
+};
+#undef INFO
+
+static struct
+{
+  QueueHandle_t evt_queue;
+
+  struct
+  {
+    uint32_t period_ms;
+    uint32_t deadline;        // System tick of next run
+    bool armed;
+  }
+  job[SYS_SCHED_JOB_CNT];
+}
+m_sched;
+
+/* Function definitions ----------------------------------------------- */
+void sys_sched_init(void)
+{
+  m_sched.evt_queue = xQueueCreate(SYS_SCHED_EVT_QUEUE_SIZE, sizeof(sys_sched_evt_t));
+
+  for (uint8_t i = 0; i < SYS_SCHED_JOB_CNT; i++)
+  {
+    m_sched.job[i].period_ms = SYS_SCHED_JOB[i].period_ms;
+    m_sys_sched_arm(i, SYS_SCHED_JOB[i].first_ms);
+  }
+
+#if (CONFIG_PM_ENABLE)
+  // CPU enters light sleep from idle task when every task is blocked
+  esp_pm_config_esp32c3_t pm_config =
+  {
+    .max_freq_mhz       = CONFIG_ESP32C3_DEFAULT_CPU_FREQ_MHZ,
+    .min_freq_mhz       = 40,
+#if (CONFIG_FREERTOS_USE_TICKLESS_IDLE)
+    .light_sleep_enable = true
+#else
+    .light_sleep_enable = false
+#endif
+  };
+
+  if (esp_pm_configure(&pm_config) != ESP_OK)
+    ESP_LOGW(TAG, "Power management config failed");
+#endif
+}
+
+void sys_sched_process(void)
+{
+  sys_sched_evt_t evt;
+  uint32_t now;
+
+  // Sleep until the nearest deadline unless an event comes first
+  if (xQueueReceive(m_sched.evt_queue, &evt, pdMS_TO_TICKS(m_sys_sched_next_wait_ms())) == pdTRUE)
+  {
+    do
+    {
+      m_sys_sched_handle_event(&evt);
+    } while (xQueueReceive(m_sched.evt_queue, &evt, 0) == pdTRUE);
+  }
+
+  for (uint8_t i = 0; i < SYS_SCHED_JOB_CNT; i++)
+  {
+    now = bsp_get_sys_tick_ms();
+
+    if (!m_sched.job[i].armed || ((int32_t)(m_sched.job[i].deadline - now) > 0))
+      continue;
+
+    // Next run is counted from now, a late job is not run again to catch up
+    if (m_sched.job[i].period_ms != 0)
+      m_sys_sched_arm(i, m_sched.job[i].period_ms);
+    else
+      m_sched.job[i].armed = false;
+
+    ESP_LOGD(TAG, "Run job: %s", SYS_SCHED_JOB[i].name);
+    SYS_SCHED_JOB[i].handler();
+  }
+}
+
+bool sys_sched_trigger(sys_sched_job_t job)
+{
+  sys_sched_evt_t evt = { .type = SYS_SCHED_EVT_TRIGGER, .job = job };
+
+  CHECK((job < SYS_SCHED_JOB_CNT) && (m_sched.evt_queue != NULL), false);
+
+  return (xQueueSend(m_sched.evt_queue, &evt, 0) == pdTRUE);
+}
+
+bool sys_sched_set_period(sys_sched_job_t job, uint32_t period_ms)
+{
+  sys_sched_evt_t evt = { .type = SYS_SCHED_EVT_SET_PERIOD, .job = job, .period_ms = period_ms };
+
+  CHECK((job < SYS_SCHED_JOB_CNT) && (m_sched.evt_queue != NULL), false);
+
+  return (xQueueSend(m_sched.evt_queue, &evt, 0) == pdTRUE);
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief         Error log job, upload stored error codes to shadow
+ *
+ * @param[in]     None
+ *
+ * @attention     Upload is done by AWS task
+ *
+ * @return        None
+ */
+static void m_sys_sched_error_log_job(void)
+{
+  if (aws_iot_mqtt_is_client_connected(&g_sys_aws.client))
+    sys_aws_shadow_trigger_command(SYS_AWS_SHADOW_CMD_SET, SYS_AWS_ERROR_CODE);
+}
+
+/**
+ * @brief         Shadow sync job, get the desired state from AWS
+ *
+ * @param[in]     None
+ *
+ * @attention     None
+ *
+ * @return        None
+ */
+static void m_sys_sched_shadow_sync_job(void)
+{
+  if (aws_iot_mqtt_is_client_connected(&g_sys_aws.client))
+    sys_aws_shadow_trigger_command(SYS_AWS_SHADOW_CMD_GET, SYS_SHADOW_SCALE_TARE);
+}
+
+/**
+ * @brief         Handle scheduler event
+ *
+ * @param[in]     evt     Pointer to event
+ *
+ * @attention     None
+ *
+ * @return        None
+ */
+static void m_sys_sched_handle_event(sys_sched_evt_t *evt)
+{
+  switch (evt->type)
+  {
+  case SYS_SCHED_EVT_TRIGGER:
+    m_sys_sched_arm(evt->job, 0);
+    break;
+
+  case SYS_SCHED_EVT_SET_PERIOD:
+    ESP_LOGI(TAG, "Job %s period: %d ms", SYS_SCHED_JOB[evt->job].name, (int)evt->period_ms);
+
+    m_sched.job[evt->job].period_ms = evt->period_ms;
+
+    if (evt->period_ms != 0)
+      m_sys_sched_arm(evt->job, evt->period_ms);
+    else
+      m_sched.job[evt->job].armed = false;
+    break;
+
+  default:
+    break;
+  }
+}
+
+/**
+ * @brief         Arm job to run after a delay
+ *
+ * @param[in]     job         Job
+ * @param[in]     delay_ms    Delay from now
+ *
+ * @attention     None
+ *
+ * @return        None
+ */
+static void m_sys_sched_arm(sys_sched_job_t job, uint32_t delay_ms)
+{
+  m_sched.job[job].deadline = bsp_get_sys_tick_ms() + delay_ms;
+  m_sched.job[job].armed    = true;
+}
+
+/**
+ * @brief         Get time to the nearest deadline
+ *
+ * @param[in]     None
+ *
+ * @attention     Deadlines are compared as signed differences, so tick wrap around is handled
+ *
+ * @return        Time in ms, 0 if a job is due
+ */
+static uint32_t m_sys_sched_next_wait_ms(void)
+{
+  uint32_t now  = bsp_get_sys_tick_ms();
+  uint32_t wait = SYS_SCHED_WAIT_MAX_MS;
+  int32_t  diff;
+
+  for (uint8_t i = 0; i < SYS_SCHED_JOB_CNT; i++)
+  {
+    if (!m_sched.job[i].armed)
+      continue;
+
+    diff = (int32_t)(m_sched.job[i].deadline - now);
+    if (diff <= 0)
+      return 0;
+
+    if ((uint32_t)diff < wait)
+      wait = (uint32_t)diff;
+  }
+
+  return wait;
+}
+
+/* End of file -------------------------------------------------------- */
@@ -0,0 +1,90 @@
+/**
+ * @file       sys_sched.h
+ * @copyright  Copyright (C) 2020 Hydratech. All rights reserved.
+ * @license    This project is released under the Hydratech License.
+ * @version    1.0.0
+ * @date       2022-04-16
+ * @author     Thuan Le
+ * @brief      System file to run periodic jobs from one cooperative scheduler
+ * @note       None
+ * @example    None
+ */
+
+/* Define to prevent recursive inclusion ------------------------------ */
+#ifndef __SYS_SCHED_H
+#define __SYS_SCHED_H
+
+/* Includes ----------------------------------------------------------- */
+#include "platform_common.h"
+
+/* Public defines ----------------------------------------------------- */
+/* Public enumerate/structure ----------------------------------------- */
+/**
+ * @brief Scheduler job enum
+ */
+typedef enum
+{
+   SYS_SCHED_JOB_TELEMETRY = 0
+  ,SYS_SCHED_JOB_NTP
+  ,SYS_SCHED_JOB_ERROR_LOG
+  ,SYS_SCHED_JOB_SHADOW_SYNC
+
+  ,SYS_SCHED_JOB_CNT
+}
+sys_sched_job_t;
+
+/* Public macros ------------------------------------------------------ */
+/* Public variables --------------------------------------------------- */
+/* Public function prototypes ----------------------------------------- */
+/**
+ * @brief         Scheduler init
+ *
+ * @param[in]     None
+ *
+ * @attention     Light sleep between deadlines is enabled when CONFIG_PM_ENABLE is set
+ *
+ * @return        None
+ */
+void sys_sched_init(void);
+
+/**
+ * @brief         Scheduler run due jobs, then wait for the next deadline or event
+ *
+ * @param[in]     None
+ *
+ * @attention     Jobs run one by one in the caller task, a job must not block for long
+ *
+ * @return        None
+ */
+void sys_sched_process(void);
+
+/**
+ * @brief         Scheduler run a job as soon as possible
+ *
+ * @param[in]     job     Job
+ *
+ * @attention     Safe to call from any task. Next periodic run is counted from this run.
+ *
+ * @return
+ *  - true:   Event is queued
+ *  - false:  Event queue is full
+ */
+bool sys_sched_trigger(sys_sched_job_t job);
+
+/**
+ * @brief         Scheduler change period of a job
+ *
+ * @param[in]     job         Job
+ * @param[in]     period_ms   New period in ms, 0 to stop periodic runs
+ *
+ * @attention     Safe to call from any task. Next run is one new period from now.
+ *
+ * @return
+ *  - true:   Event is queued
+ *  - false:  Event queue is full
+ */
+bool sys_sched_set_period(sys_sched_job_t job, uint32_t period_ms);
+
+#endif // __SYS_SCHED_H
+
+/* End of file -------------------------------------------------------- */
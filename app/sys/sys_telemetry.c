@@ -0,0 +1,164 @@
+/**
+ * @file       sys_telemetry.c
+ * @copyright  Copyright (C) 2020 Hydratech. All rights reserved.
+ * @license    This project is released under the Hydratech License.
+ * @version    1.0.0
+ * @date       2022-04-14
+ * @author     Thuan Le
+ * @brief      System file to filter device data samples before they are reported to AWS
+ * @note       Samples are compared with the last reported one, not the previous sample,
+ *             so a slow drift is still reported once it exceeds the deadband.
+ * @example    None
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "sys_telemetry.h"
+#include "sys_aws_mqtt.h"
+#include "sys_nvs.h"
+#include "sys.h"
+#include "lox-job.h"
+#include "bsp.h"
+#include <stddef.h>
+
+/* Private defines ---------------------------------------------------- */
+/* Private enumerate/structure ---------------------------------------- */
+/**
+ * @brief Filtered field info
+ */
+typedef struct
+{
+  uint32_t offset;            // Offset of uint16_t field in aws_noti_dev_data_t
+  const uint16_t *deadband;   // Pointer to deadband in NVS properties
+}
+sys_telemetry_field_t;
+
+/* Private macros ----------------------------------------------------- */
+#define FIELD_VALUE(_data, _i)  (*(uint16_t *)((uint8_t *)(_data) + SYS_TELEMETRY_FIELD[_i].offset))
+
+/* Public variables --------------------------------------------------- */
+/* Private variables -------------------------------------------------- */
+static const char *TAG = "sys_telemetry";
+
+#define INFO(_f, _db) { .offset = offsetof(aws_noti_dev_data_t, _f), .deadband = &g_nvs_setting_data.properties.report._db }
+static const sys_telemetry_field_t SYS_TELEMETRY_FIELD[] =
+{
+  //     +===============+===================+
+  //     | Field         | Deadband          |
+  //     +===============+===================+
+    INFO ( weight_scale  , deadband_weight   )
+  , INFO ( temp          , deadband_temp     )
+  , INFO ( battery       , deadband_battery  )
+  //     +===============+===================+
+};
+#undef INFO
+
+static struct
+{
+  aws_noti_dev_data_t last;   // Last reported sample
+  uint32_t last_tick;         // System tick of last report
+  bool reported;              // At least one sample is reported
+}
+m_telemetry;
+
+/* Private function prototypes ---------------------------------------- */
+static bool m_sys_telemetry_is_changed(aws_noti_dev_data_t *data);
+
+/* Function definitions ----------------------------------------------- */
+bool sys_telemetry_submit(aws_noti_dev_data_t *data)
+{
+  uint32_t elapsed = bsp_get_sys_tick_ms() - m_telemetry.last_tick;
+  uint32_t min_ms  = g_nvs_setting_data.properties.report.min_interval * 1000;
+  uint32_t max_ms  = g_nvs_setting_data.properties.report.max_interval * 1000;
+  bool report;
+
+  if (!m_telemetry.reported)
+    report = true;
+  else if (data->alarm_code != m_telemetry.last.alarm_code)
+    report = true;
+  else if (elapsed < min_ms)
+    report = false;
+  else if (m_sys_telemetry_is_changed(data))
+    report = true;
+  else
+    report = ((max_ms != 0) && (elapsed >= max_ms));
+
+  if (!report)
+  {
+    ESP_LOGD(TAG, "Sample is filtered out");
+    return false;
+  }
+
+  sys_aws_mqtt_send_noti(AWS_NOTI_DEVICE_DATA, data);
+
+  memcpy(&m_telemetry.last, data, sizeof(m_telemetry.last));
+  m_telemetry.last_tick = bsp_get_sys_tick_ms();
+  m_telemetry.reported  = true;
+
+  return true;
+}
+
+void sys_telemetry_sample(void)
+{
+  aws_noti_dev_data_t device_data;
+  uint32_t alarm_code = 1111;
+  uint16_t weight;
+  bool stable;
+
+  if (g_device.sys_state != SYS_STATE_READY)
+    return;
+
+  // Only a settled weight is reported, the next job run will try again
+  if (!lox_jobs_get_weight(&weight, &stable) || !stable)
+  {
+    ESP_LOGD(TAG, "Weight is not stable");
+    return;
+  }
+
+  sys_aws_mqtt_send_noti(AWS_NOTI_ALARM, &alarm_code);
+
+  sprintf(device_data.serial_number, g_nvs_setting_data.dev.qr_code);
+
+  /* active devices 
+  ESP32C3_B2A6  -  serial # "141A14191A18"
+  ESP32C3_BBC6  -  serial # "1812454ABC"
+  */
+
+  device_data.weight_scale = weight;
+  device_data.temp         = 101;
+  device_data.battery      = 99;
+  device_data.alarm_code   = 11;
+
+  device_data.longitude = -84.3067;
+  device_data.lattitude = 34.1351;
+
+  sys_telemetry_submit(&device_data);
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief         Check if any filtered field is out of its deadband
+ *
+ * @param[in]     data    Pointer to device data sample
+ *
+ * @attention     None
+ *
+ * @return
+ *  - true:   Sample is changed
+ *  - false:  Sample is not changed
+ */
+static bool m_sys_telemetry_is_changed(aws_noti_dev_data_t *data)
+{
+  int32_t diff;
+
+  for (uint8_t i = 0; i < sizeof(SYS_TELEMETRY_FIELD) / sizeof(SYS_TELEMETRY_FIELD[0]); i++)
+  {
+    diff = (int32_t)FIELD_VALUE(data, i) - (int32_t)FIELD_VALUE(&m_telemetry.last, i);
+
+    if ((uint32_t)abs(diff) > *SYS_TELEMETRY_FIELD[i].deadband)
+      return true;
+  }
+
+  return false;
+}
+
+/* End of file -------------------------------------------------------- */
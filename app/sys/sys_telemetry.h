@@ -0,0 +1,55 @@
+/**
+ * @file       sys_telemetry.h
+ * @copyright  Copyright (C) 2020 Hydratech. All rights reserved.
+ * @license    This project is released under the Hydratech License.
+ * @version    1.0.0
+ * @date       2022-04-14
+ * @author     Thuan Le
+ * @brief      System file to filter device data samples before they are reported to AWS
+ * @note       None
+ * @example    None
+ */
+
+/* Define to prevent recursive inclusion ------------------------------ */
+#ifndef __SYS_TELEMETRY_H
+#define __SYS_TELEMETRY_H
+
+/* Includes ----------------------------------------------------------- */
+#include "platform_common.h"
+#include "aws_builder.h"
+
+/* Public defines ----------------------------------------------------- */
+/* Public enumerate/structure ----------------------------------------- */
+/* Public macros ------------------------------------------------------ */
+/* Public variables --------------------------------------------------- */
+/* Public function prototypes ----------------------------------------- */
+/**
+ * @brief         Telemetry submit a device data sample
+ *
+ * @param[in]     data    Pointer to device data sample
+ *
+ * @attention     Sample is reported when a field moves out of its deadband since the last
+ *                report, when the alarm code changes or when the heartbeat interval is
+ *                expired. Min interval is not applied to alarm code changes.
+ *                Deadbands and intervals are in g_nvs_setting_data.properties.report.
+ *
+ * @return
+ *  - true:   Sample is reported
+ *  - false:  Sample is filtered out
+ */
+bool sys_telemetry_submit(aws_noti_dev_data_t *data);
+
+/**
+ * @brief         Telemetry take a device data sample and submit it
+ *
+ * @param[in]     None
+ *
+ * @attention     Run by telemetry scheduler job, does nothing until system is ready
+ *
+ * @return        None
+ */
+void sys_telemetry_sample(void);
+
+#endif // __SYS_TELEMETRY_H
+
+/* End of file -------------------------------------------------------- */
@@ -13,7 +13,7 @@
 /* Includes ----------------------------------------------------------- */
 #include "sys_time.h"
 #include "esp_sntp.h"
-#include "bsp_timer.h"
+#include "sys_sched.h"
 #include "sys_wifi.h"
 #include "sys_nvs.h"
 #include "bsp.h"
@@ -34,7 +34,6 @@ ntp_server_t;
 /* Public variables --------------------------------------------------- */
 /* Private variables -------------------------------------------------- */
 static bool m_is_ntp_server_initialize = false;
-static auto_timer_t m_ntp_atm;
 
 #define INFO(_i, _addr, _port) [_i] = { .addr = _addr, .port = _port }
 static const ntp_server_t NTP_SERVER[] = 
@@ -54,14 +53,20 @@ static char *TAG = "sys_time";
 /* Private function prototypes ---------------------------------------- */
 static void m_sys_time_initialize_ntp(void);
 static void m_sys_time_sync_notification_cb(struct timeval *tv);
-static void m_sys_timer_ntp_callback(void *para);
 static void m_sys_time_sync_time_ntp(void);
 
 /* Function definitions ----------------------------------------------- */
 void sys_time_init(void)
 {
-  bsp_tmr_auto_init(&m_ntp_atm, m_sys_timer_ntp_callback);
-  bsp_tmr_auto_start(&m_ntp_atm, ONE_SECOND);
+  sys_sched_trigger(SYS_SCHED_JOB_NTP);
+}
+
+void sys_time_sync(void)
+{
+  ESP_LOGI(TAG, "NTP sync job");
+
+  if (sys_wifi_is_connected())
+    m_sys_time_sync_time_ntp();
 }
 
 void sys_time_get_epoch_ms(uint64_t *epoch)
@@ -98,16 +103,6 @@ static void m_sys_time_initialize_ntp(void)
   m_is_ntp_server_initialize = true;
 }
 
-static void m_sys_timer_ntp_callback(void *para)
-{
-  ESP_LOGI(TAG, "NTP timer callback");
-  
-  if (sys_wifi_is_connected())
-    m_sys_time_sync_time_ntp();
-
-  bsp_tmr_auto_start(&m_ntp_atm, NTP_SYNC_INTEVAL_MS);
-}
-
 static void m_sys_time_sync_time_ntp(void)
 {
   #define RETRY_CNT (5)
@@ -31,6 +31,11 @@
  */
 void sys_time_init(void);
 
+/**
+ * @brief  System time sync with NTP server, run by NTP scheduler job
+ */
+void sys_time_sync(void);
+
 /**
  * @brief  System time get epoch time (ms)
  */
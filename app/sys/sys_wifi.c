@@ -421,6 +421,7 @@ static esp_err_t m_sys_wifi_event_handler(void *ctx, system_event_t *event)
     if (g_sys_aws.initialized)
     {
       sys_event_group_set(SYS_AWS_RECONNECT_EVT);
+      sys_aws_wakeup();
     }
 
     if (!g_nvs_setting_data.ota.enable)
@@ -0,0 +1,24 @@
+/**
+* @file       bsp.h
+* @copyright  Copyright (C) 2020 Hydratech. All rights reserved.
+* @license    This project is released under the Hydratech License.
+* @version    1.0.0
+* @date       2022-04-20
+* @author     Thuan Le
+* @brief      Host stand-in of platform/bsp.h for the system module tests
+* @note       System tick is provided by the test
+* @example    None
+*/
+/* Define to prevent recursive inclusion ------------------------------------ */
+#ifndef __BSP_H
+#define __BSP_H
+
+/* Includes ----------------------------------------------------------------- */
+#include "platform_common.h"
+
+/* Public APIs -------------------------------------------------------------- */
+uint32_t bsp_get_sys_tick_ms(void);
+
+#endif // __BSP_H
+
+/* End of file -------------------------------------------------------------- */
@@ -0,0 +1,52 @@
+/**
+* @file       platform_common.h
+* @copyright  Copyright (C) 2020 Hydratech. All rights reserved.
+* @license    This project is released under the Hydratech License.
+* @version    1.0.0
+* @date       2022-04-20
+* @author     Thuan Le
+* @brief      Host stand-in of platform/platform_common.h for the system module tests
+* @note       Queue functions are provided by the test, so it owns time and events
+* @example    None
+*/
+/* Define to prevent recursive inclusion ------------------------------------ */
+#ifndef __PLATFORM_COMMON_H
+#define __PLATFORM_COMMON_H
+
+/* Includes ----------------------------------------------------------------- */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/* Public defines ----------------------------------------------------------- */
+#define pdTRUE                  (1)
+#define pdFALSE                 (0)
+#define pdMS_TO_TICKS(ms)       ((TickType_t)(ms))  // 1 kHz tick
+
+#define ESP_LOGE(tag, ...)      do { (void)(tag); } while (0)
+#define ESP_LOGW(tag, ...)      do { (void)(tag); } while (0)
+#define ESP_LOGI(tag, ...)      do { (void)(tag); } while (0)
+#define ESP_LOGD(tag, ...)      do { (void)(tag); } while (0)
+
+#define CHECK(expr, ret)               \
+  do {                                 \
+    if (!(expr)) {                     \
+      return (ret);                    \
+    }                                  \
+  } while (0)
+
+/* Public enumerate/structure ----------------------------------------------- */
+typedef void *QueueHandle_t;
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+
+/* Public APIs -------------------------------------------------------------- */
+QueueHandle_t xQueueCreate(uint32_t length, uint32_t item_size);
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t wait);
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t wait);
+
+#endif // __PLATFORM_COMMON_H
+
+/* End of file -------------------------------------------------------------- */
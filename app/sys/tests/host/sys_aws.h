@@ -0,0 +1,53 @@
+/**
+* @file       sys_aws.h
+* @copyright  Copyright (C) 2021 Hydratech. All rights reserved.
+* @license    This project is released under the Hydratech License.
+* @version    01.00.00
+* @date       2022-04-20
+* @author     Thuan Le
+* @brief      Host stand-in of sys/sys_aws.h for the system module tests
+* @note       The real header sits next to the module sources and is found first,
+*             so this one is force-included with -include and takes its include guard
+* @example    None
+*/
+
+/* Define to prevent recursive inclusion ------------------------------ */
+#ifndef __SYS_AWS_H
+#define __SYS_AWS_H
+
+/* Includes ----------------------------------------------------------- */
+#include "platform_common.h"
+
+/* Public enumerate/structure ----------------------------------------- */
+typedef enum
+{
+   SYS_SHADOW_FIRMWARE_ID = 0
+  ,SYS_SHADOW_SCALE_TARE
+  ,SYS_AWS_ERROR_CODE
+  ,SYS_SHADOW_MAX
+}
+sys_aws_shadow_name_t;
+
+typedef enum
+{
+   SYS_AWS_SHADOW_CMD_GET = 0
+  ,SYS_AWS_SHADOW_CMD_SET
+}
+sys_aws_shadow_cmd_t;
+
+typedef struct
+{
+  int client;
+}
+sys_aws_t;
+
+/* Public variables --------------------------------------------------- */
+extern sys_aws_t g_sys_aws;
+
+/* Public function prototypes ----------------------------------------- */
+bool aws_iot_mqtt_is_client_connected(void *p_client);
+void sys_aws_shadow_trigger_command(sys_aws_shadow_cmd_t cmd, sys_aws_shadow_name_t name);
+
+#endif // __SYS_AWS_H
+
+/* End of file -------------------------------------------------------- */
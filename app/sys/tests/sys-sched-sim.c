@@ -0,0 +1,483 @@
+/**
+ * @file       sys-sched-sim.c
+ * @copyright  Copyright (C) 2020 Hydratech. All rights reserved.
+ * @license    This project is released under the Hydratech License.
+ * @version    1.0.0
+ * @date       2022-04-20
+ * @author     Thuan Le
+ * @brief      Host harness of the job scheduler with a simulated clock. Runs sys_sched.c
+ *             as it is built for the device and checks job periods, deadlines, the
+ *             coalescing of triggers and late runs, runtime period changes and the
+ *             wait handed to the event queue, which is the time the CPU may sleep.
+ * @note       The event queue is simulated: a receive that times out moves the clock
+ *             to the end of the wait, so hours of schedule run in a few milliseconds.
+ *             The clock starts just below the 32-bit wrap to cover tick wrap around.
+ * @example    cd app/sys/tests
+ *             gcc -std=gnu11 -O2 -Ihost -I.. -I../../components/protocol -include host/sys_aws.h \
+ *                 sys-sched-sim.c ../sys_sched.c -o sys-sched-sim
+ *             ./sys-sched-sim
+ */
+
+/* Includes ----------------------------------------------------------- */
+#include "sys_sched.h"
+#include "sys_time.h"
+#include "bsp.h"
+
+/* Private defines ---------------------------------------------------- */
+#define SIM_CLOCK_START         (0xFFFFFFFFu - 30 * ONE_SECOND)
+#define SIM_QUEUE_SIZE          (8)     // Same as SYS_SCHED_EVT_QUEUE_SIZE
+#define SIM_ITEM_SIZE_MAX       (32)
+#define SIM_RUN_MAX             (512)   // Runs recorded per job
+
+/* Private enumerate/structure ---------------------------------------- */
+/**
+ * @brief Runs of one job
+ */
+typedef struct
+{
+  uint32_t cnt;
+  uint32_t at[SIM_RUN_MAX];     // Clock at each run
+}
+sim_job_runs_t;
+
+/* Private macros ----------------------------------------------------- */
+#define SIM_EXPECT(_expr)                                                 \
+  do                                                                      \
+  {                                                                       \
+    m_sim_checks++;                                                       \
+    if (!(_expr))                                                         \
+    {                                                                     \
+      m_sim_failures++;                                                   \
+      printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #_expr);           \
+    }                                                                     \
+  }                                                                       \
+  while (0)
+
+/* Public variables --------------------------------------------------- */
+sys_aws_t g_sys_aws;
+
+/* Private variables -------------------------------------------------- */
+static uint32_t m_now;
+
+static struct
+{
+  uint8_t  item[SIM_QUEUE_SIZE][SIM_ITEM_SIZE_MAX];
+  uint32_t item_size;
+  uint32_t head;
+  uint32_t tail;
+  uint32_t last_wait;       // Wait of the last receive
+  uint32_t max_wait;        // Longest wait of the last receive that timed out
+}
+m_queue;
+
+static sim_job_runs_t m_runs[SYS_SCHED_JOB_CNT];
+static uint32_t m_job_cost_ms;  // Time the next telemetry run takes
+static bool m_connected;
+
+static uint32_t m_sim_checks;
+static uint32_t m_sim_failures;
+
+/* Private function prototypes ---------------------------------------- */
+static void m_sim_reset(void);
+static void m_sim_run_for(uint32_t duration_ms);
+static void m_sim_record(sys_sched_job_t job);
+static bool m_sim_runs_every(sys_sched_job_t job, uint32_t first, uint32_t from, uint32_t period);
+
+static void m_sim_test_default_periods(void);
+static void m_sim_test_wait_is_next_deadline(void);
+static void m_sim_test_trigger_coalescing(void);
+static void m_sim_test_late_run_coalescing(void);
+static void m_sim_test_set_period(void);
+static void m_sim_test_disconnected(void);
+static void m_sim_test_queue_full(void);
+
+/* Function definitions ----------------------------------------------- */
+int main(void)
+{
+  m_sim_test_default_periods();
+  m_sim_test_wait_is_next_deadline();
+  m_sim_test_trigger_coalescing();
+  m_sim_test_late_run_coalescing();
+  m_sim_test_set_period();
+  m_sim_test_disconnected();
+  m_sim_test_queue_full();
+
+  printf("%u checks, %u failures\n", m_sim_checks, m_sim_failures);
+  printf("%s\n", (m_sim_failures == 0) ? "PASS" : "FAIL");
+
+  return (m_sim_failures == 0) ? 0 : 1;
+}
+
+/* Simulated platform ------------------------------------------------- */
+uint32_t bsp_get_sys_tick_ms(void)
+{
+  return m_now;
+}
+
+QueueHandle_t xQueueCreate(uint32_t length, uint32_t item_size)
+{
+  if ((length > SIM_QUEUE_SIZE) || (item_size > SIM_ITEM_SIZE_MAX))
+    return NULL;
+
+  m_queue.item_size = item_size;
+
+  return &m_queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t wait)
+{
+  if (m_queue.tail - m_queue.head >= SIM_QUEUE_SIZE)
+    return pdFALSE;
+
+  memcpy(m_queue.item[m_queue.tail++ % SIM_QUEUE_SIZE], item, m_queue.item_size);
+
+  return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t wait)
+{
+  m_queue.last_wait = wait;
+
+  if (m_queue.head != m_queue.tail)
+  {
+    memcpy(item, m_queue.item[m_queue.head++ % SIM_QUEUE_SIZE], m_queue.item_size);
+    return pdTRUE;
+  }
+
+  // Nothing comes, the caller sleeps for the whole wait
+  if (wait > m_queue.max_wait)
+    m_queue.max_wait = wait;
+
+  m_now += wait;
+
+  return pdFALSE;
+}
+
+/* Jobs --------------------------------------------------------------- */
+void sys_telemetry_sample(void)
+{
+  m_sim_record(SYS_SCHED_JOB_TELEMETRY);
+  m_now += m_job_cost_ms;
+  m_job_cost_ms = 0;
+}
+
+void sys_time_sync(void)
+{
+  m_sim_record(SYS_SCHED_JOB_NTP);
+}
+
+bool aws_iot_mqtt_is_client_connected(void *p_client)
+{
+  return m_connected;
+}
+
+void sys_aws_shadow_trigger_command(sys_aws_shadow_cmd_t cmd, sys_aws_shadow_name_t name)
+{
+  if ((cmd == SYS_AWS_SHADOW_CMD_SET) && (name == SYS_AWS_ERROR_CODE))
+    m_sim_record(SYS_SCHED_JOB_ERROR_LOG);
+  else if ((cmd == SYS_AWS_SHADOW_CMD_GET) && (name == SYS_SHADOW_SCALE_TARE))
+    m_sim_record(SYS_SCHED_JOB_SHADOW_SYNC);
+}
+
+/* Tests -------------------------------------------------------------- */
+/**
+ * @brief         Default periods over two hours, across the tick wrap
+ */
+static void m_sim_test_default_periods(void)
+{
+  uint32_t start;
+
+  printf("Default periods\n");
+
+  m_sim_reset();
+  start = m_now;
+  m_sim_run_for(2 * ONE_HOUR);
+
+  SIM_EXPECT(m_now < start);    // Clock wrapped
+  SIM_EXPECT(m_sim_runs_every(SYS_SCHED_JOB_TELEMETRY, 55 * ONE_SECOND, start, 55 * ONE_SECOND));
+  SIM_EXPECT(m_runs[SYS_SCHED_JOB_TELEMETRY].cnt == (2 * ONE_HOUR) / (55 * ONE_SECOND));
+  SIM_EXPECT(m_sim_runs_every(SYS_SCHED_JOB_NTP, ONE_SECOND, start, NTP_SYNC_INTEVAL_MS));
+  SIM_EXPECT(m_runs[SYS_SCHED_JOB_NTP].cnt == 2);
+  SIM_EXPECT(m_sim_runs_every(SYS_SCHED_JOB_ERROR_LOG, ONE_HOUR, start, ONE_HOUR));
+  SIM_EXPECT(m_runs[SYS_SCHED_JOB_ERROR_LOG].cnt == 2);
+  SIM_EXPECT(m_sim_runs_every(SYS_SCHED_JOB_SHADOW_SYNC, ONE_HOUR, start, ONE_HOUR));
+  SIM_EXPECT(m_runs[SYS_SCHED_JOB_SHADOW_SYNC].cnt == 2);
+}
+
+/**
+ * @brief         Each wait ends exactly at the nearest deadline, so no job runs late
+ *                and the CPU is never woken without a job to run
+ */
+static void m_sim_test_wait_is_next_deadline(void)
+{
+  uint32_t idle_wakeups = 0;
+  uint32_t total_runs, runs;
+
+  printf("Wait is next deadline\n");
+
+  m_sim_reset();
+
+  for (uint32_t i = 0; i < 500; i++)
+  {
+    total_runs = 0;
+    for (uint8_t j = 0; j < SYS_SCHED_JOB_CNT; j++)
+      total_runs += m_runs[j].cnt;
+
+    sys_sched_process();
+
+    runs = 0;
+    for (uint8_t j = 0; j < SYS_SCHED_JOB_CNT; j++)
+      runs += m_runs[j].cnt;
+
+    if (runs == total_runs)
+      idle_wakeups++;
+  }
+
+  SIM_EXPECT(idle_wakeups == 0);
+
+  // Nothing armed, the wait is bounded by SYS_SCHED_WAIT_MAX_MS
+  for (uint8_t j = 0; j < SYS_SCHED_JOB_CNT; j++)
+    sys_sched_set_period(j, 0);
+  sys_sched_process();
+  m_queue.max_wait = 0;
+  sys_sched_process();
+
+  SIM_EXPECT(m_queue.max_wait == ONE_HOUR);
+}
+
+/**
+ * @brief         Triggers queued before the scheduler runs make one run, and the
+ *                period is counted from that run
+ */
+static void m_sim_test_trigger_coalescing(void)
+{
+  uint32_t at;
+
+  printf("Trigger coalescing\n");
+
+  m_sim_reset();
+  m_sim_run_for(10 * ONE_SECOND);
+
+  SIM_EXPECT(m_runs[SYS_SCHED_JOB_NTP].cnt == 1);
+
+  SIM_EXPECT(sys_sched_trigger(SYS_SCHED_JOB_NTP));
+  SIM_EXPECT(sys_sched_trigger(SYS_SCHED_JOB_NTP));
+  SIM_EXPECT(sys_sched_trigger(SYS_SCHED_JOB_NTP));
+  at = m_now;
+  sys_sched_process();
+
+  SIM_EXPECT(m_runs[SYS_SCHED_JOB_NTP].cnt == 2);
+  SIM_EXPECT(m_runs[SYS_SCHED_JOB_NTP].at[1] == at);
+
+  m_sim_run_for(NTP_SYNC_INTEVAL_MS);
+
+  SIM_EXPECT(m_runs[SYS_SCHED_JOB_NTP].cnt == 3);
+  SIM_EXPECT(m_runs[SYS_SCHED_JOB_NTP].at[2] - at == NTP_SYNC_INTEVAL_MS);
+}
+
+/**
+ * @brief         A run late by several periods is made once, not once per missed period
+ */
+static void m_sim_test_late_run_coalescing(void)
+{
+  sim_job_runs_t *runs = &m_runs[SYS_SCHED_JOB_TELEMETRY];
+
+  printf("Late run coalescing\n");
+
+  m_sim_reset();
+  sys_sched_set_period(SYS_SCHED_JOB_TELEMETRY, ONE_SECOND);
+  sys_sched_process();
+
+  // First telemetry run blocks the scheduler for three and a half periods
+  m_job_cost_ms = 3500;
+  m_sim_run_for(10 * ONE_SECOND);
+
+  SIM_EXPECT(runs->cnt >= 3);
+
+  // Missed periods make one run right after the late one, then the period goes on from there
+  SIM_EXPECT(runs->at[1] - runs->at[0] == 3500);
+  for (uint32_t i = 2; i < runs->cnt; i++)
+    SIM_EXPECT(runs->at[i] - runs->at[i - 1] == ONE_SECOND);
+}
+
+/**
+ * @brief         Periods changed at runtime take effect one new period from the change
+ */
+static void m_sim_test_set_period(void)
+{
+  uint32_t at, cnt;
+
+  printf("Set period\n");
+
+  m_sim_reset();
+  m_sim_run_for(55 * ONE_SECOND);
+  SIM_EXPECT(m_runs[SYS_SCHED_JOB_TELEMETRY].cnt == 1);
+
+  // Faster
+  SIM_EXPECT(sys_sched_set_period(SYS_SCHED_JOB_TELEMETRY, 5 * ONE_SECOND));
+  at  = m_now;
+  cnt = m_runs[SYS_SCHED_JOB_TELEMETRY].cnt;
+  m_sim_run_for(30 * ONE_SECOND);
+
+  SIM_EXPECT(m_runs[SYS_SCHED_JOB_TELEMETRY].cnt - cnt == 6);
+  SIM_EXPECT(m_runs[SYS_SCHED_JOB_TELEMETRY].at[cnt] - at == 5 * ONE_SECOND);
+
+  // Stopped, a trigger still runs it once
+  SIM_EXPECT(sys_sched_set_period(SYS_SCHED_JOB_TELEMETRY, 0));
+  cnt = m_runs[SYS_SCHED_JOB_TELEMETRY].cnt;
+  m_sim_run_for(ONE_HOUR);
+
+  SIM_EXPECT(m_runs[SYS_SCHED_JOB_TELEMETRY].cnt == cnt);
+
+  SIM_EXPECT(sys_sched_trigger(SYS_SCHED_JOB_TELEMETRY));
+  m_sim_run_for(ONE_HOUR);
+
+  SIM_EXPECT(m_runs[SYS_SCHED_JOB_TELEMETRY].cnt == cnt + 1);
+
+  // Started again
+  SIM_EXPECT(sys_sched_set_period(SYS_SCHED_JOB_TELEMETRY, 2 * ONE_MINUTE));
+  at = m_now;
+  m_sim_run_for(10 * ONE_MINUTE);
+
+  SIM_EXPECT(m_runs[SYS_SCHED_JOB_TELEMETRY].cnt == cnt + 1 + 5);
+  SIM_EXPECT(m_runs[SYS_SCHED_JOB_TELEMETRY].at[cnt + 1] - at == 2 * ONE_MINUTE);
+}
+
+/**
+ * @brief         AWS jobs keep their period while offline but send nothing
+ */
+static void m_sim_test_disconnected(void)
+{
+  printf("Disconnected\n");
+
+  m_sim_reset();
+  m_connected = false;
+  m_sim_run_for(3 * ONE_HOUR);
+
+  SIM_EXPECT(m_runs[SYS_SCHED_JOB_ERROR_LOG].cnt == 0);
+  SIM_EXPECT(m_runs[SYS_SCHED_JOB_SHADOW_SYNC].cnt == 0);
+  SIM_EXPECT(m_runs[SYS_SCHED_JOB_NTP].cnt == 3);
+
+  m_connected = true;
+  m_sim_run_for(ONE_HOUR);
+
+  SIM_EXPECT(m_runs[SYS_SCHED_JOB_ERROR_LOG].cnt == 1);
+  SIM_EXPECT(m_runs[SYS_SCHED_JOB_SHADOW_SYNC].cnt == 1);
+}
+
+/**
+ * @brief         Events beyond the queue size are refused, not lost silently
+ */
+static void m_sim_test_queue_full(void)
+{
+  uint32_t accepted = 0;
+
+  printf("Queue full\n");
+
+  m_sim_reset();
+
+  for (uint32_t i = 0; i < SIM_QUEUE_SIZE + 4; i++)
+    accepted += sys_sched_trigger(SYS_SCHED_JOB_NTP) ? 1 : 0;
+
+  SIM_EXPECT(accepted == SIM_QUEUE_SIZE);
+  SIM_EXPECT(!sys_sched_trigger(SYS_SCHED_JOB_CNT));
+
+  sys_sched_process();
+
+  SIM_EXPECT(m_runs[SYS_SCHED_JOB_NTP].cnt == 1);
+  SIM_EXPECT(sys_sched_trigger(SYS_SCHED_JOB_NTP));
+}
+
+/* Private function definitions --------------------------------------- */
+/**
+ * @brief         Restart the clock, queue and scheduler
+ *
+ * @param[in]     None
+ *
+ * @attention     None
+ *
+ * @return        None
+ */
+static void m_sim_reset(void)
+{
+  m_now         = SIM_CLOCK_START;
+  m_job_cost_ms = 0;
+  m_connected   = true;
+
+  memset(&m_queue, 0, sizeof(m_queue));
+  memset(m_runs, 0, sizeof(m_runs));
+
+  sys_sched_init();
+}
+
+/**
+ * @brief         Run the scheduler until the clock has moved by a duration
+ *
+ * @param[in]     duration_ms   Duration
+ *
+ * @attention     The last wait may end after the duration
+ *
+ * @return        None
+ */
+static void m_sim_run_for(uint32_t duration_ms)
+{
+  uint32_t start = m_now;
+
+  while (m_now - start < duration_ms)
+    sys_sched_process();
+}
+
+/**
+ * @brief         Record a run of a job
+ *
+ * @param[in]     job     Job
+ *
+ * @attention     None
+ *
+ * @return        None
+ */
+static void m_sim_record(sys_sched_job_t job)
+{
+  if (m_runs[job].cnt < SIM_RUN_MAX)
+    m_runs[job].at[m_runs[job].cnt] = m_now;
+
+  m_runs[job].cnt++;
+}
+
+/**
+ * @brief         Check that a job ran first at a delay, then exactly every period
+ *
+ * @param[in]     job       Job
+ * @param[in]     first     Delay of the first run
+ * @param[in]     from      Clock the delay is counted from
+ * @param[in]     period    Period
+ *
+ * @attention     A zero period only checks that the job ran
+ *
+ * @return
+ *  - true:   Runs match
+ *  - false:  A run is early, late or missing
+ */
+static bool m_sim_runs_every(sys_sched_job_t job, uint32_t first, uint32_t from, uint32_t period)
+{
+  uint32_t cnt = (m_runs[job].cnt < SIM_RUN_MAX) ? m_runs[job].cnt : SIM_RUN_MAX;
+
+  if (cnt == 0)
+    return false;
+
+  if (period == 0)
+    return true;
+
+  if (m_runs[job].at[0] - from != first)
+    return false;
+
+  for (uint32_t i = 1; i < cnt; i++)
+  {
+    if (m_runs[job].at[i] - m_runs[job].at[i - 1] != period)
+      return false;
+  }
+
+  return true;
+}
+
+/* End of file -------------------------------------------------------- */